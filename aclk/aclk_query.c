@@ -12,6 +12,9 @@ pthread_mutex_t query_lock_wait = PTHREAD_MUTEX_INITIALIZER;
 
 volatile int aclk_connected = 0;
 
+int aclk_response_compression = 1;
+size_t aclk_response_compression_min_size = 512;
+
 #ifndef __GNUC__
 #pragma region ACLK_QUEUE
 #endif
@@ -29,16 +32,30 @@ struct aclk_query {
     char *data;       // Internal data (NULL if request from the cloud)
     char *msg_id;     // msg_id generated by the cloud (NULL if internal)
     char *query;      // The actual query
-    u_char deleted;   // Mark deleted for garbage collect
-    struct aclk_query *next;
+    uint32_t hash;    // Hash of topic and query, to find duplicates
+    uint64_t seq;     // Queries with the same run_after run in the order they were added
+    size_t heap_idx;  // Position in the queue heap
+    struct aclk_query *hash_next;
 };
 
+/*
+ * The queue is a binary min-heap on (run_after, seq), so adding a query and
+ * getting the next one to run are O(log n). Queries are also indexed on the
+ * hash of their topic and query, so that finding a duplicate does not scan
+ * the queue.
+ */
 struct aclk_query_queue {
-    struct aclk_query *aclk_query_head;
-    struct aclk_query *aclk_query_tail;
+    struct aclk_query **heap;
+    size_t heap_size;
+
+    struct aclk_query **index; // hash buckets, index_size is a power of 2
+    size_t index_size;
+
     unsigned int count;
-} aclk_queue = { .aclk_query_head = NULL, .aclk_query_tail = NULL, .count = 0 };
+    uint64_t seq;
+} aclk_queue = { .heap = NULL, .heap_size = 0, .index = NULL, .index_size = 0, .count = 0, .seq = 0 };
 
+#define ACLK_QUEUE_INDEX_MIN_SIZE 256
 
 unsigned int aclk_query_size()
 {
@@ -70,6 +87,142 @@ static void aclk_query_free(struct aclk_query *this_query)
     freez(this_query);
 }
 
+static inline uint32_t aclk_query_hash(const char *topic, const char *query)
+{
+    const unsigned char *s = (const unsigned char *)topic;
+    uint32_t hval = 0x811c9dc5;
+
+    while (*s) {
+        hval *= 16777619;
+        hval ^= (uint32_t) *s++;
+    }
+
+    // separate the topic from the query
+    hval *= 16777619;
+
+    if (query) {
+        s = (const unsigned char *)query;
+        while (*s) {
+            hval *= 16777619;
+            hval ^= (uint32_t) *s++;
+        }
+    }
+
+    return hval;
+}
+
+// All the following need to have a QUERY lock before calling them
+
+static inline int aclk_query_before(struct aclk_query *a, struct aclk_query *b)
+{
+    return a->run_after < b->run_after || (a->run_after == b->run_after && a->seq < b->seq);
+}
+
+static inline void aclk_queue_heap_set(size_t idx, struct aclk_query *this_query)
+{
+    aclk_queue.heap[idx] = this_query;
+    this_query->heap_idx = idx;
+}
+
+static void aclk_queue_heap_up(size_t idx)
+{
+    struct aclk_query *this_query = aclk_queue.heap[idx];
+
+    while (idx) {
+        size_t parent = (idx - 1) / 2;
+        if (!aclk_query_before(this_query, aclk_queue.heap[parent]))
+            break;
+        aclk_queue_heap_set(idx, aclk_queue.heap[parent]);
+        idx = parent;
+    }
+    aclk_queue_heap_set(idx, this_query);
+}
+
+static void aclk_queue_heap_down(size_t idx)
+{
+    struct aclk_query *this_query = aclk_queue.heap[idx];
+
+    for (;;) {
+        size_t child = idx * 2 + 1;
+        if (child >= aclk_queue.count)
+            break;
+        if (child + 1 < aclk_queue.count && aclk_query_before(aclk_queue.heap[child + 1], aclk_queue.heap[child]))
+            child++;
+        if (!aclk_query_before(aclk_queue.heap[child], this_query))
+            break;
+        aclk_queue_heap_set(idx, aclk_queue.heap[child]);
+        idx = child;
+    }
+    aclk_queue_heap_set(idx, this_query);
+}
+
+static void aclk_queue_index_resize(size_t size)
+{
+    struct aclk_query **index = callocz(size, sizeof(struct aclk_query *));
+
+    for (size_t i = 0; i < aclk_queue.index_size; i++) {
+        struct aclk_query *this_query = aclk_queue.index[i];
+        while (this_query) {
+            struct aclk_query *next = this_query->hash_next;
+            this_query->hash_next = index[this_query->hash & (size - 1)];
+            index[this_query->hash & (size - 1)] = this_query;
+            this_query = next;
+        }
+    }
+
+    freez(aclk_queue.index);
+    aclk_queue.index = index;
+    aclk_queue.index_size = size;
+}
+
+static void aclk_queue_add(struct aclk_query *this_query)
+{
+    if (unlikely(aclk_queue.count == aclk_queue.heap_size)) {
+        aclk_queue.heap_size = aclk_queue.heap_size ? aclk_queue.heap_size * 2 : ACLK_QUEUE_INDEX_MIN_SIZE;
+        aclk_queue.heap = reallocz(aclk_queue.heap, aclk_queue.heap_size * sizeof(struct aclk_query *));
+    }
+
+    this_query->seq = aclk_queue.seq++;
+    aclk_queue.heap[aclk_queue.count++] = this_query;
+    aclk_queue_heap_up(aclk_queue.count - 1);
+
+    if (unlikely(aclk_queue.count > aclk_queue.index_size))
+        aclk_queue_index_resize(aclk_queue.index_size ? aclk_queue.index_size * 2 : ACLK_QUEUE_INDEX_MIN_SIZE);
+
+    struct aclk_query **bucket = &aclk_queue.index[this_query->hash & (aclk_queue.index_size - 1)];
+    this_query->hash_next = *bucket;
+    *bucket = this_query;
+}
+
+static void aclk_queue_remove(struct aclk_query *this_query)
+{
+    struct aclk_query **ptr = &aclk_queue.index[this_query->hash & (aclk_queue.index_size - 1)];
+    while (*ptr != this_query)
+        ptr = &(*ptr)->hash_next;
+    *ptr = this_query->hash_next;
+
+    size_t idx = this_query->heap_idx;
+    struct aclk_query *last = aclk_queue.heap[--aclk_queue.count];
+    if (likely(last != this_query)) {
+        aclk_queue_heap_set(idx, last);
+        if (idx && aclk_query_before(last, aclk_queue.heap[(idx - 1) / 2]))
+            aclk_queue_heap_up(idx);
+        else
+            aclk_queue_heap_down(idx);
+    }
+}
+
+static inline void aclk_queue_stats_size()
+{
+    if (aclk_stats_enabled) {
+        ACLK_STATS_LOCK;
+        aclk_metrics.query_queue_size = aclk_queue.count;
+        if (aclk_metrics_per_sample.query_queue_max < aclk_queue.count)
+            aclk_metrics_per_sample.query_queue_max = aclk_queue.count;
+        ACLK_STATS_UNLOCK;
+    }
+}
+
 /*
  * Get the next query to process - NULL if nothing there
  * The caller needs to free memory by calling aclk_query_free()
@@ -85,98 +238,40 @@ static struct aclk_query *aclk_queue_pop()
 
     ACLK_QUEUE_LOCK;
 
-    if (likely(!aclk_queue.aclk_query_head)) {
+    if (likely(!aclk_queue.count)) {
         ACLK_QUEUE_UNLOCK;
         return NULL;
     }
 
-    this_query = aclk_queue.aclk_query_head;
-
-    // Get rid of the deleted entries
-    while (this_query && this_query->deleted) {
-        aclk_queue.count--;
-
-        aclk_queue.aclk_query_head = aclk_queue.aclk_query_head->next;
-
-        if (likely(!aclk_queue.aclk_query_head)) {
-            aclk_queue.aclk_query_tail = NULL;
-        }
-
-        aclk_query_free(this_query);
-
-        this_query = aclk_queue.aclk_query_head;
-    }
-
-    if (likely(!this_query)) {
-        ACLK_QUEUE_UNLOCK;
-        return NULL;
-    }
+    this_query = aclk_queue.heap[0];
 
-    if (!this_query->deleted && this_query->run_after > now_realtime_sec()) {
+    if (this_query->run_after > now_realtime_sec()) {
         info("Query %s will run in %ld seconds", this_query->query, this_query->run_after - now_realtime_sec());
         ACLK_QUEUE_UNLOCK;
         return NULL;
     }
 
-    aclk_queue.count--;
-    aclk_queue.aclk_query_head = aclk_queue.aclk_query_head->next;
-
-    if (likely(!aclk_queue.aclk_query_head)) {
-        aclk_queue.aclk_query_tail = NULL;
-    }
+    aclk_queue_remove(this_query);
+    aclk_queue_stats_size();
 
     ACLK_QUEUE_UNLOCK;
     return this_query;
 }
 
-// Returns the entry after which we need to create a new entry to run at the specified time
-// If NULL is returned we need to add to HEAD
-// Need to have a QUERY lock before calling this
-
-static struct aclk_query *aclk_query_find_position(time_t time_to_run)
+static struct aclk_query *aclk_query_find(char *topic, void *data, char *msg_id, char *query, uint32_t hash)
 {
-    struct aclk_query *tmp_query, *last_query;
+    struct aclk_query *tmp_query;
 
-    // Quick check if we will add to the end
-    if (likely(aclk_queue.aclk_query_tail)) {
-        if (aclk_queue.aclk_query_tail->run_after <= time_to_run)
-            return aclk_queue.aclk_query_tail;
-    }
-
-    last_query = NULL;
-    tmp_query = aclk_queue.aclk_query_head;
-
-    while (tmp_query) {
-        if (tmp_query->run_after > time_to_run)
-            return last_query;
-        last_query = tmp_query;
-        tmp_query = tmp_query->next;
-    }
-    return last_query;
-}
+    if (unlikely(!aclk_queue.index_size))
+        return NULL;
 
-// Need to have a QUERY lock before calling this
-static struct aclk_query *
-aclk_query_find(char *topic, void *data, char *msg_id, char *query, ACLK_CMD cmd, struct aclk_query **last_query)
-{
-    struct aclk_query *tmp_query, *prev_query;
-    UNUSED(cmd);
-
-    tmp_query = aclk_queue.aclk_query_head;
-    prev_query = NULL;
-    while (tmp_query) {
-        if (likely(!tmp_query->deleted)) {
-            if (strcmp(tmp_query->topic, topic) == 0 && (!query || strcmp(tmp_query->query, query) == 0)) {
-                if ((!data || data == tmp_query->data) &&
-                    (!msg_id || (msg_id && strcmp(msg_id, tmp_query->msg_id) == 0))) {
-                    if (likely(last_query))
-                        *last_query = prev_query;
-                    return tmp_query;
-                }
-            }
+    for (tmp_query = aclk_queue.index[hash & (aclk_queue.index_size - 1)]; tmp_query; tmp_query = tmp_query->hash_next) {
+        if (tmp_query->hash == hash && strcmp(tmp_query->topic, topic) == 0 &&
+            (!query || (tmp_query->query && strcmp(tmp_query->query, query) == 0))) {
+            if ((!data || data == tmp_query->data) &&
+                (!msg_id || (tmp_query->msg_id && strcmp(msg_id, tmp_query->msg_id) == 0)))
+                return tmp_query;
         }
-        prev_query = tmp_query;
-        tmp_query = tmp_query->next;
     }
     return NULL;
 }
@@ -194,32 +289,27 @@ int aclk_queue_query(char *topic, void *data, char *msg_id, char *query, int run
         return 1;
 
     run_after = now_realtime_sec() + run_after;
+    uint32_t hash = aclk_query_hash(topic, query);
 
     ACLK_QUEUE_LOCK;
-    struct aclk_query *last_query = NULL;
 
-    tmp_query = aclk_query_find(topic, data, msg_id, query, aclk_cmd, &last_query);
+    tmp_query = aclk_query_find(topic, data, msg_id, query, hash);
     if (unlikely(tmp_query)) {
+        if (aclk_stats_enabled) {
+            ACLK_STATS_LOCK;
+            aclk_metrics_per_sample.queries_deduplicated++;
+            ACLK_STATS_UNLOCK;
+        }
+
         if (tmp_query->run_after == run_after) {
             ACLK_QUEUE_UNLOCK;
             QUERY_THREAD_WAKEUP;
             return 0;
         }
 
-        if (last_query)
-            last_query->next = tmp_query->next;
-        else
-            aclk_queue.aclk_query_head = tmp_query->next;
-
         debug(D_ACLK, "Removing double entry");
+        aclk_queue_remove(tmp_query);
         aclk_query_free(tmp_query);
-        aclk_queue.count--;
-    }
-
-    if (aclk_stats_enabled) {
-        ACLK_STATS_LOCK;
-        aclk_metrics_per_sample.queries_queued++;
-        ACLK_STATS_UNLOCK;
     }
 
     new_query = callocz(1, sizeof(struct aclk_query));
@@ -235,29 +325,21 @@ int aclk_queue_query(char *topic, void *data, char *msg_id, char *query, int run
     }
 
     new_query->data = data;
-    new_query->next = NULL;
     new_query->created = now_realtime_usec();
     new_query->created_boot_time = now_boottime_usec();
     new_query->run_after = run_after;
+    new_query->hash = hash;
 
     debug(D_ACLK, "Added query (%s) (%s)", topic, query ? query : "");
 
-    tmp_query = aclk_query_find_position(run_after);
+    aclk_queue_add(new_query);
 
-    if (tmp_query) {
-        new_query->next = tmp_query->next;
-        tmp_query->next = new_query;
-        if (tmp_query == aclk_queue.aclk_query_tail)
-            aclk_queue.aclk_query_tail = new_query;
-        aclk_queue.count++;
-        ACLK_QUEUE_UNLOCK;
-        QUERY_THREAD_WAKEUP;
-        return 0;
+    if (aclk_stats_enabled) {
+        ACLK_STATS_LOCK;
+        aclk_metrics_per_sample.queries_queued++;
+        ACLK_STATS_UNLOCK;
     }
-
-    new_query->next = aclk_queue.aclk_query_head;
-    aclk_queue.aclk_query_head = new_query;
-    aclk_queue.count++;
+    aclk_queue_stats_size();
 
     ACLK_QUEUE_UNLOCK;
     QUERY_THREAD_WAKEUP;
@@ -273,16 +355,41 @@ int aclk_queue_query(char *topic, void *data, char *msg_id, char *query, int run
 #endif
 
 /*
- * Take a buffer, encode it and rewrite it
- *
+ * Append src to wb, escaped to be a JSON string.
+ * The encoded size is counted first, so that wb grows at most once.
  */
 
-static char *aclk_encode_response(char *src, size_t content_size, int keep_newlines)
+static void aclk_buffer_strcat_encoded(BUFFER *wb, const char *src, size_t content_size, int keep_newlines)
 {
-    char *tmp_buffer = mallocz(content_size * 2);
-    char *dst = tmp_buffer;
-    while (content_size > 0) {
-        switch (*src) {
+    static const char hex[] = "0123456789abcdef";
+    const unsigned char *s = (const unsigned char *)src, *end = s + content_size;
+    size_t needed = 0;
+
+    for (; s < end; s++) {
+        switch (*s) {
+            case '\n':
+                needed += keep_newlines ? 2 : 0;
+                break;
+            case '\t':
+                break;
+            case 0x00 ... 0x08:
+            case 0x0b ... 0x1F:
+                needed += 6;
+                break;
+            case '\"':
+            case '\\':
+                needed += 2;
+                break;
+            default:
+                needed++;
+        }
+    }
+
+    buffer_need_bytes(wb, needed + 1);
+    char *dst = &wb->buffer[wb->len];
+
+    for (s = (const unsigned char *)src; s < end; s++) {
+        switch (*s) {
             case '\n':
                 if (keep_newlines)
                 {
@@ -292,28 +399,51 @@ static char *aclk_encode_response(char *src, size_t content_size, int keep_newli
                 break;
             case '\t':
                 break;
-            case 0x01 ... 0x08:
+            case 0x00 ... 0x08:
             case 0x0b ... 0x1F:
                 *dst++ = '\\';
                 *dst++ = 'u';
                 *dst++ = '0';
                 *dst++ = '0';
-                *dst++ = (*src < 0x0F) ? '0' : '1';
-                *dst++ = to_hex(*src);
+                *dst++ = hex[*s >> 4];
+                *dst++ = hex[*s & 0x0F];
                 break;
             case '\"':
+            case '\\':
                 *dst++ = '\\';
-                *dst++ = *src;
+                *dst++ = *s;
                 break;
             default:
-                *dst++ = *src;
+                *dst++ = *s;
         }
-        src++;
-        content_size--;
     }
-    *dst = '\0';
 
-    return tmp_buffer;
+    wb->len += needed;
+    wb->buffer[wb->len] = '\0';
+}
+
+/*
+ * Append len bytes to wb, they may be binary
+ */
+
+static inline void aclk_buffer_memcat(BUFFER *wb, const char *src, size_t len)
+{
+    buffer_need_bytes(wb, len + 1);
+    memcpy(&wb->buffer[wb->len], src, len);
+    wb->len += len;
+    wb->buffer[wb->len] = '\0';
+}
+
+static void aclk_response_stats(size_t raw_bytes, size_t sent_bytes, usec_t encode_ut)
+{
+    if (aclk_stats_enabled) {
+        ACLK_STATS_LOCK;
+        aclk_metrics_per_sample.response_bytes_raw += raw_bytes;
+        aclk_metrics_per_sample.response_bytes_sent += sent_bytes;
+        ACLK_STATS_UNLOCK;
+
+        aclk_metric_mat_update(&aclk_metrics_per_sample.response_encode_time, encode_ut);
+    }
 }
 
 #ifndef __GNUC__
@@ -363,32 +493,31 @@ static int aclk_execute_query(struct aclk_query *this_query)
         now_realtime_timeval(&w->tv_ready);
         w->response.data->date = w->tv_ready.tv_sec;
         web_client_build_http_header(w);  // TODO: this function should offset from date, not tv_ready
+
+        // the response is escaped straight into the message
+        usec_t t = now_boottime_usec();
         BUFFER *local_buffer = buffer_create(NETDATA_WEB_RESPONSE_INITIAL_SIZE);
-        buffer_flush(local_buffer);
         local_buffer->contenttype = CT_APPLICATION_JSON;
 
         aclk_create_header(local_buffer, "http", this_query->msg_id, 0, 0, aclk_shared_state.version_neg);
-        buffer_strcat(local_buffer, ",\n\t\"payload\": ");
-        char *encoded_response = aclk_encode_response(w->response.data->buffer, w->response.data->len, 0);
-        char *encoded_header = aclk_encode_response(w->response.header_output->buffer, w->response.header_output->len, 1);
+        buffer_sprintf(local_buffer, ",\n\t\"payload\": {\n\"code\": %d,\n\"body\": \"", w->response.code);
+        aclk_buffer_strcat_encoded(local_buffer, w->response.data->buffer, w->response.data->len, 0);
+        buffer_strcat(local_buffer, "\",\n\"headers\": \"");
+        aclk_buffer_strcat_encoded(local_buffer, w->response.header_output->buffer, w->response.header_output->len, 1);
+        buffer_strcat(local_buffer, "\"\n}\n}");
 
-        buffer_sprintf(
-            local_buffer, "{\n\"code\": %d,\n\"body\": \"%s\",\n\"headers\": \"%s\"\n}", 
-            w->response.code, encoded_response, encoded_header);
+        aclk_response_stats(
+            w->response.data->len + w->response.header_output->len, local_buffer->len, now_boottime_usec() - t);
 
-        buffer_sprintf(local_buffer, "\n}");
+        debug(D_ACLK, "Response:%s", w->response.header_output->buffer);
 
-        debug(D_ACLK, "Response:%s", encoded_header);
-
-        aclk_send_message(this_query->topic, local_buffer->buffer, this_query->msg_id);
+        aclk_send_message_bin(this_query->topic, local_buffer->buffer, local_buffer->len, this_query->msg_id);
 
         buffer_free(w->response.data);
         buffer_free(w->response.header);
         buffer_free(w->response.header_output);
         freez(w);
         buffer_free(local_buffer);
-        freez(encoded_response);
-        freez(encoded_header);
         return 0;
     }
     return 1;
@@ -403,7 +532,7 @@ static int aclk_execute_query_v2(struct aclk_query *this_query)
 
 #ifdef NETDATA_WITH_ZLIB
     int z_ret;
-    BUFFER *z_buffer = buffer_create(NETDATA_WEB_RESPONSE_INITIAL_SIZE);
+    BUFFER *z_buffer = NULL;
     char *start, *end;
 #endif
 
@@ -428,9 +557,13 @@ static int aclk_execute_query_v2(struct aclk_query *this_query)
     // execute the query
     t = aclk_web_api_request_v1(cloud_req->host, w, mysep ? mysep + 1 : "noop", this_query->created_boot_time);
 
+    usec_t encode_ut = now_boottime_usec();
+    size_t raw_bytes = w->response.data->len;
+
 #ifdef NETDATA_WITH_ZLIB
     // check if gzip encoding can and should be used
-    if ((start = strstr(cloud_req->data, WEB_HDR_ACCEPT_ENC))) {
+    if (aclk_response_compression && w->response.data->len >= aclk_response_compression_min_size &&
+        (start = strstr(cloud_req->data, WEB_HDR_ACCEPT_ENC))) {
         start += strlen(WEB_HDR_ACCEPT_ENC);
         end = strstr(start, "\x0D\x0A");
         start = strstr(start, "gzip");
@@ -448,25 +581,22 @@ static int aclk_execute_query_v2(struct aclk_query *this_query)
     }
 
     if (w->response.data->len && w->response.zinitialized) {
+        // deflateBound() is enough to compress it in one go, straight into the buffer
+        z_buffer = buffer_create(deflateBound(&w->response.zstream, w->response.data->len));
         w->response.zstream.next_in = (Bytef *)w->response.data->buffer;
         w->response.zstream.avail_in = w->response.data->len;
-        do {
-            w->response.zstream.avail_out = NETDATA_WEB_RESPONSE_ZLIB_CHUNK_SIZE;
-            w->response.zstream.next_out = w->response.zbuffer;
-            z_ret = deflate(&w->response.zstream, Z_FINISH);
-            if(z_ret < 0) {
-                if(w->response.zstream.msg)
-                    error("Error compressing body. ZLIB error: \"%s\"", w->response.zstream.msg);
-                else
-                    error("Unknown error during zlib compression.");
-                retval = 1;
-                goto cleanup;
-            }
-            int bytes_to_cpy = NETDATA_WEB_RESPONSE_ZLIB_CHUNK_SIZE - w->response.zstream.avail_out;
-            buffer_need_bytes(z_buffer, bytes_to_cpy);
-            memcpy(&z_buffer->buffer[z_buffer->len], w->response.zbuffer, bytes_to_cpy);
-            z_buffer->len += bytes_to_cpy;
-        } while(z_ret != Z_STREAM_END);
+        w->response.zstream.next_out = (Bytef *)z_buffer->buffer;
+        w->response.zstream.avail_out = z_buffer->size;
+        z_ret = deflate(&w->response.zstream, Z_FINISH);
+        if(z_ret != Z_STREAM_END) {
+            if(w->response.zstream.msg)
+                error("Error compressing body. ZLIB error: \"%s\"", w->response.zstream.msg);
+            else
+                error("Unknown error during zlib compression.");
+            retval = 1;
+            goto cleanup;
+        }
+        z_buffer->len = z_buffer->size - w->response.zstream.avail_out;
         // so that web_client_build_http_header
         // puts correct content lenght into header
         buffer_free(w->response.data);
@@ -478,7 +608,7 @@ static int aclk_execute_query_v2(struct aclk_query *this_query)
     now_realtime_timeval(&w->tv_ready);
     w->response.data->date = w->tv_ready.tv_sec;
     web_client_build_http_header(w);
-    local_buffer = buffer_create(NETDATA_WEB_RESPONSE_INITIAL_SIZE);
+    local_buffer = buffer_create(w->response.header_output->len + w->response.data->len + NETDATA_WEB_RESPONSE_HEADER_SIZE);
     local_buffer->contenttype = CT_APPLICATION_JSON;
 
     aclk_create_header(local_buffer, "http", this_query->msg_id, 0, 0, aclk_shared_state.version_neg);
@@ -486,19 +616,10 @@ static int aclk_execute_query_v2(struct aclk_query *this_query)
     buffer_strcat(local_buffer, "}\x0D\x0A\x0D\x0A");
     buffer_strcat(local_buffer, w->response.header_output->buffer);
 
-    if (w->response.data->len) {
-#ifdef NETDATA_WITH_ZLIB
-        if (w->response.zinitialized) {
-            buffer_need_bytes(local_buffer, w->response.data->len);
-            memcpy(&local_buffer->buffer[local_buffer->len], w->response.data->buffer, w->response.data->len);
-            local_buffer->len += w->response.data->len;
-        } else {
-#endif
-            buffer_strcat(local_buffer, w->response.data->buffer);
-#ifdef NETDATA_WITH_ZLIB
-        }
-#endif
-    }
+    if (w->response.data->len)
+        aclk_buffer_memcat(local_buffer, w->response.data->buffer, w->response.data->len);
+
+    aclk_response_stats(raw_bytes + w->response.header_output->len, local_buffer->len, now_boottime_usec() - encode_ut);
 
     aclk_send_message_bin(this_query->topic, local_buffer->buffer, local_buffer->len, this_query->msg_id);
 
@@ -542,13 +663,13 @@ static int aclk_process_query(struct aclk_query_thread *t_info)
         return 0;
     }
 
-    if (unlikely(this_query->deleted)) {
-        debug(D_ACLK, "Garbage collect query %s:%s", this_query->topic, this_query->query);
-        aclk_query_free(this_query);
-        return 1;
-    }
     query_count++;
 
+    // the time the query waited in the queue after it was due to run
+    usec_t due_ut = MAX(this_query->created, (usec_t)this_query->run_after * USEC_PER_SEC);
+    usec_t now_ut = now_realtime_usec();
+    aclk_stats_query_wait(now_ut > due_ut ? now_ut - due_ut : 0);
+
     host = (RRDHOST*)this_query->data;
 
     debug(
@@ -645,12 +766,19 @@ void aclk_query_threads_cleanup(struct aclk_query_threads *query_threads)
         freez(query_threads->thread_list);
     }
 
-    struct aclk_query *this_query;
-
-    do {
-        this_query = aclk_queue_pop();
+    ACLK_QUEUE_LOCK;
+    while (aclk_queue.count) {
+        struct aclk_query *this_query = aclk_queue.heap[aclk_queue.count - 1];
+        aclk_queue_remove(this_query);
         aclk_query_free(this_query);
-    } while (this_query);
+    }
+    freez(aclk_queue.heap);
+    freez(aclk_queue.index);
+    aclk_queue.heap = NULL;
+    aclk_queue.index = NULL;
+    aclk_queue.heap_size = aclk_queue.index_size = 0;
+    aclk_queue_stats_size();
+    ACLK_QUEUE_UNLOCK;
 }
 
 #define TASK_LEN_MAX 16
@@ -787,3 +915,216 @@ void *aclk_query_main_thread(void *ptr)
 #ifndef __GNUC__
 #pragma endregion
 #endif
+
+#ifndef __GNUC__
+#pragma region Unit Tests
+#endif
+
+/*
+ * Check the order of the queue heap and its index of duplicates
+ * Return the number of errors
+ */
+static int aclk_queue_unittest_check(unsigned int expected_count)
+{
+    int errors = 0;
+
+    if (aclk_queue.count != expected_count) {
+        fprintf(stderr, "    the queue has %u queries, expected %u ### E R R O R ###\n", aclk_queue.count, expected_count);
+        errors++;
+    }
+
+    for (unsigned int i = 0; i < aclk_queue.count; i++) {
+        struct aclk_query *this_query = aclk_queue.heap[i];
+
+        if (this_query->heap_idx != i) {
+            fprintf(stderr, "    query %s is at %u of the heap, but it knows %zu ### E R R O R ###\n",
+                    this_query->query, i, this_query->heap_idx);
+            errors++;
+        }
+
+        if (i && aclk_query_before(this_query, aclk_queue.heap[(i - 1) / 2])) {
+            fprintf(stderr, "    query %s runs before its parent in the heap ### E R R O R ###\n", this_query->query);
+            errors++;
+        }
+
+        if (aclk_query_find(this_query->topic, this_query->data, NULL, this_query->query, this_query->hash) != this_query) {
+            fprintf(stderr, "    query %s is not found in the index ### E R R O R ###\n", this_query->query);
+            errors++;
+        }
+    }
+
+    return errors;
+}
+
+int aclk_queue_unittest(void)
+{
+    fprintf(stderr, "\nRunning test 'aclk query queue':\nchecks the order of the queries and the removal of duplicates\n");
+
+    int errors = 0, connected = aclk_connected;
+    unsigned int n = 20000, popped = 0, unique;
+    char query[100];
+    struct aclk_query *this_query, *last = NULL;
+
+    aclk_connected = 1;
+
+    // charts updated many times, like on a reconnect, all due already
+    srandom(1);
+    for (unsigned int i = 0; i < n; i++) {
+        snprintfz(query, 99, "chart.%u", (unsigned int)(random() % (n / 2)));
+        aclk_queue_query("_chart", NULL, NULL, query, -(int)(random() % 100), 1, ACLK_CMD_CHART);
+    }
+
+    unique = aclk_queue.count;
+    if (!unique || unique > n / 2) {
+        fprintf(stderr, "    %u queries out of %u charts ### E R R O R ###\n", unique, n / 2);
+        errors++;
+    }
+    errors += aclk_queue_unittest_check(unique);
+
+    // a chart delete replaces a pending update of the same chart
+    snprintfz(query, 99, "chart.%u", (unsigned int)(random() % (n / 2)));
+    if (!aclk_query_find("_chart", NULL, NULL, query, aclk_query_hash("_chart", query)))
+        unique++;
+    aclk_queue_query("_chart", NULL, NULL, query, -200, 1, ACLK_CMD_CHARTDEL);
+    this_query = aclk_query_find("_chart", NULL, NULL, query, aclk_query_hash("_chart", query));
+    if (!this_query || this_query->cmd != ACLK_CMD_CHARTDEL || aclk_queue.heap[0] != this_query) {
+        fprintf(stderr, "    the chart delete did not replace the chart update ### E R R O R ###\n");
+        errors++;
+    }
+    errors += aclk_queue_unittest_check(unique);
+
+    while ((this_query = aclk_queue_pop())) {
+        if (last && aclk_query_before(this_query, last)) {
+            fprintf(stderr, "    query %s was popped after query %s, which runs after it ### E R R O R ###\n",
+                    this_query->query, last->query);
+            errors++;
+        }
+        aclk_query_free(last);
+        last = this_query;
+        popped++;
+    }
+    aclk_query_free(last);
+
+    if (popped != unique) {
+        fprintf(stderr, "    popped %u queries out of %u ### E R R O R ###\n", popped, unique);
+        errors++;
+    }
+    errors += aclk_queue_unittest_check(0);
+
+    // a query that is not due yet stays in the queue, until it is replaced by one that is due
+    aclk_queue_query("unittest", NULL, NULL, NULL, 100, 1, ACLK_CMD_ONCONNECT);
+    if ((this_query = aclk_queue_pop())) {
+        fprintf(stderr, "    a query that is not due was popped ### E R R O R ###\n");
+        aclk_query_free(this_query);
+        errors++;
+    }
+    aclk_queue_query("unittest", NULL, NULL, NULL, 0, 1, ACLK_CMD_ONCONNECT);
+    errors += aclk_queue_unittest_check(1);
+    if (!(this_query = aclk_queue_pop())) {
+        fprintf(stderr, "    a query that is due was not popped ### E R R O R ###\n");
+        errors++;
+    }
+    aclk_query_free(this_query);
+
+    // the queries that are not due are freed on cleanup
+    aclk_queue_query("unittest", NULL, NULL, NULL, 100, 1, ACLK_CMD_ONCONNECT);
+    aclk_query_threads_cleanup(NULL);
+    errors += aclk_queue_unittest_check(0);
+
+    aclk_connected = connected;
+
+    fprintf(stderr, "    aclk query queue: %u queries, %d errors\n", n, errors);
+    return errors;
+}
+
+/*
+ * Decode a JSON string encoded by aclk_buffer_strcat_encoded()
+ * Return the length of the decoded string, or -1 when it is not a valid JSON string
+ */
+static ssize_t aclk_encoding_unittest_decode(const char *src, size_t len, char *dst)
+{
+    const char *end = src + len;
+    char *d = dst;
+
+    while (src < end) {
+        unsigned char c = (unsigned char)*src++;
+
+        if (c < 0x20 || c == '"')
+            return -1;
+
+        if (c != '\\') {
+            *d++ = (char)c;
+            continue;
+        }
+
+        if (src >= end)
+            return -1;
+
+        switch (*src++) {
+            case 'n':
+                *d++ = '\n';
+                break;
+            case '"':
+            case '\\':
+                *d++ = src[-1];
+                break;
+            case 'u':
+                if (end - src < 4 || strncmp(src, "00", 2) || !isxdigit(src[2]) || !isxdigit(src[3]))
+                    return -1;
+                *d++ = (char)strtol((char[]){ src[2], src[3], '\0' }, NULL, 16);
+                src += 4;
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    return d - dst;
+}
+
+int aclk_encoding_unittest(void)
+{
+    fprintf(stderr, "\nRunning test 'aclk encoding':\nchecks that the responses encoded as JSON strings decode to the original, without tabs and newlines\n");
+
+    int errors = 0, keep_newlines, round;
+    char src[512], expected[512], decoded[512];
+    BUFFER *wb = buffer_create(16);
+
+    srandom(1);
+    for (round = 0; round < 10000 && errors < 10; round++) {
+        size_t len = (size_t)(random() % sizeof(src)), i;
+        for (i = 0; i < len; i++)
+            src[i] = (char)((round % 2) ? random() % 256 : random() % 0x28);
+
+        for (keep_newlines = 0; keep_newlines <= 1; keep_newlines++) {
+            size_t expected_len = 0;
+            for (i = 0; i < len; i++) {
+                if (src[i] != '\t' && (src[i] != '\n' || keep_newlines))
+                    expected[expected_len++] = src[i];
+            }
+
+            buffer_flush(wb);
+            buffer_strcat(wb, "prefix");
+            aclk_buffer_strcat_encoded(wb, src, len, keep_newlines);
+
+            ssize_t decoded_len = -1;
+            if (wb->len >= 6 && strlen(wb->buffer) == wb->len)
+                decoded_len = aclk_encoding_unittest_decode(&wb->buffer[6], wb->len - 6, decoded);
+
+            if (decoded_len != (ssize_t)expected_len || memcmp(decoded, expected, expected_len) != 0) {
+                fprintf(stderr, "    round %d, %zu bytes, keep newlines %d, encoded to '%s' ### E R R O R ###\n",
+                        round, len, keep_newlines, wb->buffer);
+                errors++;
+            }
+        }
+    }
+
+    buffer_free(wb);
+
+    fprintf(stderr, "    aclk encoding: %d rounds, %d errors\n", round, errors);
+    return errors;
+}
+
+#ifndef __GNUC__
+#pragma endregion
+#endif
@@ -15,6 +15,9 @@ extern pthread_mutex_t query_lock_wait;
 
 extern volatile int aclk_connected;
 
+extern int aclk_response_compression;
+extern size_t aclk_response_compression_min_size;
+
 struct aclk_query_thread {
     netdata_thread_t thread;
     int idx;
@@ -37,4 +40,7 @@ void aclk_query_threads_start(struct aclk_query_threads *query_threads);
 void aclk_query_threads_cleanup(struct aclk_query_threads *query_threads);
 unsigned int aclk_query_size();
 
+int aclk_queue_unittest(void);
+int aclk_encoding_unittest(void);
+
 #endif //NETDATA_AGENT_CLOUD_LINK_H
@@ -16,6 +16,7 @@ uint32_t *aclk_queries_per_thread_sample = NULL;
 
 struct aclk_metrics aclk_metrics = {
     .online = 0,
+    .query_queue_size = 0,
 };
 
 struct aclk_metrics_per_sample aclk_metrics_per_sample;
@@ -49,7 +50,25 @@ struct aclk_mat_metrics aclk_mat_metrics = {
                                     .rd_total = NULL,
                                     .unit = "us",
                                     .title = "Time from receiving the Cloud Query until it was picked up "
-                                             "by query thread (just before passing to the database)." }
+                                             "by query thread (just before passing to the database)." },
+
+    .query_wait = { .name = "aclk_query_wait_time",
+                    .prio = 200010,
+                    .st = NULL,
+                    .rd_avg = NULL,
+                    .rd_max = NULL,
+                    .rd_total = NULL,
+                    .unit = "us",
+                    .title = "Time queries waited in the queue after they were due to run" },
+
+    .response_encode_time = { .name = "aclk_response_encode_time",
+                              .prio = 200012,
+                              .st = NULL,
+                              .rd_avg = NULL,
+                              .rd_max = NULL,
+                              .rd_total = NULL,
+                              .unit = "us",
+                              .title = "Time to encode and compress the responses to cloud queries" }
 };
 
 void aclk_metric_mat_update(struct aclk_metric_mat_data *metric, usec_t measurement)
@@ -106,6 +125,53 @@ static void aclk_stats_query_queue(struct aclk_metrics_per_sample *per_sample)
     rrdset_done(st_query_thread);
 }
 
+static void aclk_stats_query_queue_size(struct aclk_metrics_per_sample *per_sample, struct aclk_metrics *permanent)
+{
+    static RRDSET *st = NULL;
+    static RRDDIM *rd_size = NULL;
+    static RRDDIM *rd_max = NULL;
+    static RRDDIM *rd_deduplicated = NULL;
+
+    if (unlikely(!st)) {
+        st = rrdset_create_localhost(
+            "netdata", "aclk_query_queue", NULL, "aclk", NULL, "ACLK Query Queue", "queries",
+            "netdata", "stats", 200008, localhost->rrd_update_every, RRDSET_TYPE_LINE);
+
+        rd_size = rrddim_add(st, "queued", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        rd_max = rrddim_add(st, "max", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        rd_deduplicated = rrddim_add(st, "deduplicated", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    } else
+        rrdset_next(st);
+
+    rrddim_set_by_pointer(st, rd_size, permanent->query_queue_size);
+    rrddim_set_by_pointer(st, rd_max, per_sample->query_queue_max);
+    rrddim_set_by_pointer(st, rd_deduplicated, per_sample->queries_deduplicated);
+
+    rrdset_done(st);
+}
+
+static void aclk_stats_query_wait_histogram(struct aclk_metrics_per_sample *per_sample)
+{
+    static RRDSET *st = NULL;
+    static RRDDIM *rd[ACLK_QUERY_WAIT_BUCKETS];
+    static const char *names[ACLK_QUERY_WAIT_BUCKETS] = { "1ms", "10ms", "100ms", "1s", "10s", "more" };
+
+    if (unlikely(!st)) {
+        st = rrdset_create_localhost(
+            "netdata", "aclk_query_wait", NULL, "aclk", NULL, "ACLK Queries by Time Waited in the Queue", "queries/s",
+            "netdata", "stats", 200009, localhost->rrd_update_every, RRDSET_TYPE_STACKED);
+
+        for (int i = 0; i < ACLK_QUERY_WAIT_BUCKETS; i++)
+            rd[i] = rrddim_add(st, names[i], NULL, 1, localhost->rrd_update_every, RRD_ALGORITHM_ABSOLUTE);
+    } else
+        rrdset_next(st);
+
+    for (int i = 0; i < ACLK_QUERY_WAIT_BUCKETS; i++)
+        rrddim_set_by_pointer(st, rd[i], per_sample->query_wait[i]);
+
+    rrdset_done(st);
+}
+
 static void aclk_stats_write_q(struct aclk_metrics_per_sample *per_sample)
 {
     static RRDSET *st = NULL;
@@ -172,6 +238,28 @@ static void aclk_stats_cloud_req(struct aclk_metrics_per_sample *per_sample)
     rrdset_done(st);
 }
 
+static void aclk_stats_response_bytes(struct aclk_metrics_per_sample *per_sample)
+{
+    static RRDSET *st = NULL;
+    static RRDDIM *rd_raw = NULL;
+    static RRDDIM *rd_sent = NULL;
+
+    if (unlikely(!st)) {
+        st = rrdset_create_localhost(
+            "netdata", "aclk_response_bytes", NULL, "aclk", NULL, "Responses to cloud queries", "kB/s",
+            "netdata", "stats", 200011, localhost->rrd_update_every, RRDSET_TYPE_AREA);
+
+        rd_raw = rrddim_add(st, "response", NULL, 1, 1024 * localhost->rrd_update_every, RRD_ALGORITHM_ABSOLUTE);
+        rd_sent = rrddim_add(st, "sent", NULL, -1, 1024 * localhost->rrd_update_every, RRD_ALGORITHM_ABSOLUTE);
+    } else
+        rrdset_next(st);
+
+    rrddim_set_by_pointer(st, rd_raw, per_sample->response_bytes_raw);
+    rrddim_set_by_pointer(st, rd_sent, per_sample->response_bytes_sent);
+
+    rrdset_done(st);
+}
+
 #define MAX_DIM_NAME 16
 static void aclk_stats_query_threads(uint32_t *queries_per_thread)
 {
@@ -266,13 +354,20 @@ void *aclk_stats_main_thread(void *ptr)
         memset(aclk_queries_per_thread, 0, sizeof(uint32_t) * query_thread_count);
         ACLK_STATS_UNLOCK;
 
+        // the max is updated only when the size of the queue changes
+        if (per_sample.query_queue_max < permanent.query_queue_size)
+            per_sample.query_queue_max = permanent.query_queue_size;
+
         aclk_stats_collect(&per_sample, &permanent);
         aclk_stats_query_queue(&per_sample);
+        aclk_stats_query_queue_size(&per_sample, &permanent);
+        aclk_stats_query_wait_histogram(&per_sample);
 
         aclk_stats_write_q(&per_sample);
         aclk_stats_read_q(&per_sample);
 
         aclk_stats_cloud_req(&per_sample);
+        aclk_stats_response_bytes(&per_sample);
         aclk_stats_query_threads(aclk_queries_per_thread_sample);
 
 #ifdef NETDATA_INTERNAL_CHECKS
@@ -280,6 +375,8 @@ void *aclk_stats_main_thread(void *ptr)
 #endif
         aclk_stats_mat_metric_process(&aclk_mat_metrics.cloud_q_db_query_time, &per_sample.cloud_q_db_query_time);
         aclk_stats_mat_metric_process(&aclk_mat_metrics.cloud_q_recvd_to_processed, &per_sample.cloud_q_recvd_to_processed);
+        aclk_stats_mat_metric_process(&aclk_mat_metrics.query_wait, &per_sample.query_wait_time);
+        aclk_stats_mat_metric_process(&aclk_mat_metrics.response_encode_time, &per_sample.response_encode_time);
     }
 
     return 0;
@@ -296,3 +393,20 @@ void aclk_stats_upd_online(int online) {
         aclk_metrics_per_sample.offline_during_sample = 1;
     ACLK_STATS_UNLOCK;
 }
+
+void aclk_stats_query_wait(usec_t wait_ut)
+{
+    static const usec_t bounds[ACLK_QUERY_WAIT_BUCKETS - 1] = ACLK_QUERY_WAIT_BUCKET_BOUNDS;
+    int i;
+
+    if (!aclk_stats_enabled)
+        return;
+
+    for (i = 0; i < ACLK_QUERY_WAIT_BUCKETS - 1 && wait_ut > bounds[i]; i++) ;
+
+    ACLK_STATS_LOCK;
+    aclk_metrics_per_sample.query_wait[i]++;
+    ACLK_STATS_UNLOCK;
+
+    aclk_metric_mat_update(&aclk_metrics_per_sample.query_wait_time, wait_ut);
+}
@@ -22,9 +22,10 @@ struct aclk_stats_thread {
 };
 
 // preserve between samples
-struct aclk_metrics {
+extern struct aclk_metrics {
     volatile uint8_t online;
-};
+    volatile uint32_t query_queue_size;
+} aclk_metrics;
 
 //mat = max average total
 struct aclk_metric_mat_data {
@@ -51,10 +52,17 @@ extern struct aclk_mat_metrics {
 #endif
     struct aclk_metric_mat cloud_q_db_query_time;
     struct aclk_metric_mat cloud_q_recvd_to_processed;
+    struct aclk_metric_mat query_wait;
+    struct aclk_metric_mat response_encode_time;
 } aclk_mat_metrics;
 
 void aclk_metric_mat_update(struct aclk_metric_mat_data *metric, usec_t measurement);
 
+// upper bounds of the buckets of the query wait time histogram, in usec
+// the last bucket has no upper bound
+#define ACLK_QUERY_WAIT_BUCKETS 6
+#define ACLK_QUERY_WAIT_BUCKET_BOUNDS { 1000, 10000, 100000, 1000000, 10000000 }
+
 // reset to 0 on every sample
 extern struct aclk_metrics_per_sample {
     /* in the unlikely event of ACLK disconnecting
@@ -65,6 +73,9 @@ extern struct aclk_metrics_per_sample {
 
     volatile uint32_t queries_queued;
     volatile uint32_t queries_dispatched;
+    volatile uint32_t queries_deduplicated;
+    volatile uint32_t query_queue_max;
+    volatile uint32_t query_wait[ACLK_QUERY_WAIT_BUCKETS];
 
     volatile uint32_t write_q_added;
     volatile uint32_t write_q_consumed;
@@ -75,11 +86,16 @@ extern struct aclk_metrics_per_sample {
     volatile uint32_t cloud_req_recvd;
     volatile uint32_t cloud_req_err;
 
+    volatile uint32_t response_bytes_raw;
+    volatile uint32_t response_bytes_sent;
+
 #ifdef NETDATA_INTERNAL_CHECKS
     struct aclk_metric_mat_data latency;
 #endif
     struct aclk_metric_mat_data cloud_q_db_query_time;
     struct aclk_metric_mat_data cloud_q_recvd_to_processed;
+    struct aclk_metric_mat_data query_wait_time;
+    struct aclk_metric_mat_data response_encode_time;
 } aclk_metrics_per_sample;
 
 extern uint32_t *aclk_queries_per_thread;
@@ -87,5 +103,6 @@ extern uint32_t *aclk_queries_per_thread;
 void *aclk_stats_main_thread(void *ptr);
 void aclk_stats_thread_cleanup();
 void aclk_stats_upd_online(int online);
+void aclk_stats_query_wait(usec_t wait_ut);
 
 #endif /* NETDATA_ACLK_STATS_H */
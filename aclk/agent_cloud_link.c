@@ -1055,6 +1055,10 @@ void *aclk_main(void *ptr)
         config_set_number(CONFIG_SECTION_CLOUD, "query thread count", query_threads.count);
     }
 
+    aclk_response_compression = config_get_boolean(CONFIG_SECTION_CLOUD, "compress responses", aclk_response_compression);
+    aclk_response_compression_min_size = (size_t)config_get_number(
+        CONFIG_SECTION_CLOUD, "compress responses larger than", (long long)aclk_response_compression_min_size);
+
     //start localhost popcorning
     aclk_start_host_popcorning(localhost);
 
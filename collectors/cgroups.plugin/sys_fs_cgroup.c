@@ -57,6 +57,9 @@ static char *cgroup_unified_base = NULL;
 static int cgroup_root_count = 0;
 static int cgroup_root_max = 1000;
 static int cgroup_max_depth = 0;
+static int cgroup_discovery_queue_size = 100;
+static int cgroup_open_files = 0;
+static int cgroup_max_open_files = 0;
 
 static SIMPLE_PATTERN *enabled_cgroup_patterns = NULL;
 static SIMPLE_PATTERN *enabled_cgroup_paths = NULL;
@@ -349,6 +352,14 @@ void read_cgroup_plugin_configuration() {
     cgroup_root_max = (int)config_get_number("plugin:cgroups", "max cgroups to allow", cgroup_root_max);
     cgroup_max_depth = (int)config_get_number("plugin:cgroups", "max cgroups depth to monitor", cgroup_max_depth);
 
+    cgroup_discovery_queue_size = (int)config_get_number("plugin:cgroups", "max new cgroups per discovery", cgroup_discovery_queue_size);
+    if(cgroup_discovery_queue_size < 1)
+        cgroup_discovery_queue_size = 1;
+
+    cgroup_max_open_files = (int)config_get_number("plugin:cgroups", "max open files", (long long)(rlimit_nofile.rlim_cur / 4));
+    if(cgroup_max_open_files < 0)
+        cgroup_max_open_files = 0;
+
     cgroup_enable_new_cgroups_detected_at_runtime = config_get_boolean("plugin:cgroups", "enable new cgroups detected at run time", cgroup_enable_new_cgroups_detected_at_runtime);
 
     enabled_cgroup_patterns = simple_pattern_create(
@@ -459,6 +470,7 @@ struct blkio {
     int delay_counter;
 
     char *filename;
+    int fd;
 
     unsigned long long Read;
     unsigned long long Write;
@@ -493,6 +505,11 @@ struct memory {
     char *filename_msw_usage_in_bytes;
     char *filename_failcnt;
 
+    int fd_detailed;
+    int fd_usage_in_bytes;
+    int fd_msw_usage_in_bytes;
+    int fd_failcnt;
+
     int detailed_has_dirty;
     int detailed_has_swap;
 
@@ -558,6 +575,7 @@ struct cpuacct_stat {
     int enabled; // CONFIG_BOOLEAN_YES or CONFIG_BOOLEAN_AUTO
 
     char *filename;
+    int fd;
 
     unsigned long long user;
     unsigned long long system;
@@ -569,6 +587,7 @@ struct cpuacct_usage {
     int enabled; // CONFIG_BOOLEAN_YES or CONFIG_BOOLEAN_AUTO
 
     char *filename;
+    int fd;
 
     unsigned int cpus;
     unsigned long long *cpu_percpu;
@@ -585,10 +604,13 @@ struct cgroup_network_interface {
 #define CGROUP_OPTIONS_IS_UNIFIED           0x00000004
 
 struct cgroup {
+    avl avl;             // the index by id - this has to be first member!
+
     uint32_t options;
 
     char available;      // found in the filesystem
     char enabled;        // enabled in the config
+    char discovered;     // found in the filesystem by the running discovery
 
     char pending_renames;
 
@@ -694,21 +716,109 @@ struct cgroup {
 
 } *cgroup_root = NULL;
 
+static int cgroup_compare(void *a, void *b) {
+    if(((struct cgroup *)a)->hash < ((struct cgroup *)b)->hash) return -1;
+    else if(((struct cgroup *)a)->hash > ((struct cgroup *)b)->hash) return 1;
+    else return strcmp(((struct cgroup *)a)->id, ((struct cgroup *)b)->id);
+}
+
+// all the cgroups, both running and just discovered, indexed by id
+// used only by the discovery thread
+static avl_tree_type cgroup_index = { NULL, cgroup_compare };
+
+// new cgroups found by the discovery thread,
+// not yet visible to the collector
+static struct cgroup *discovered_cgroup_root = NULL, *discovered_cgroup_last = NULL;
+
+// cgroup_root is linked and unlinked by the discovery thread
+// and walked by the collector, only while holding this mutex
+static uv_mutex_t cgroup_root_mutex;
+
+// statistics of the last discovery, for the plugin charts
+static struct cgroup_discovery_stats {
+    size_t queued;      // new cgroups added by the discovery
+    size_t deferred;    // new cgroups left for the next discovery, because the queue was full
+    size_t removed;     // cgroups removed by the discovery
+
+    usec_t duration;    // the time spent in the discovery
+    usec_t latency;     // the time since the discovery was requested
+} discovery_stats;
+
 // ----------------------------------------------------------------------------
 // read values from /sys
 
-static inline void cgroup_read_cpuacct_stat(struct cpuacct_stat *cp) {
-    static procfile *ff = NULL;
+// the files of the cgroups are kept open across iterations, so that their paths are resolved once
+// when the open files limit is reached, the files are opened and closed on every read
 
-    if(likely(cp->filename)) {
-        ff = procfile_reopen(ff, cp->filename, NULL, PROCFILE_FLAG_DEFAULT);
+static inline int cgroup_file_open(int *fd, const char *filename) {
+    if(likely(*fd != -1))
+        return *fd;
+
+    if(unlikely(cgroup_open_files >= cgroup_max_open_files))
+        return -1;
+
+    // the scripts we run must not inherit them
+    *fd = open(filename, procfile_open_flags | O_CLOEXEC, 0666);
+    if(likely(*fd != -1))
+        cgroup_open_files++;
+
+    return *fd;
+}
+
+static inline void cgroup_file_close(int *fd) {
+    if(likely(*fd != -1)) {
+        close(*fd);
+        *fd = -1;
+        cgroup_open_files--;
+    }
+}
+
+static inline procfile *cgroup_procfile_read(procfile *ff, int *fd, const char *filename) {
+    if(likely(*fd != -1 || cgroup_open_files < cgroup_max_open_files)) {
+        if(unlikely(cgroup_file_open(fd, filename) == -1)) {
+            procfile_close(ff);
+            return NULL;
+        }
+
+        ff = procfile_readall_fd(ff, *fd, NULL, PROCFILE_FLAG_DEFAULT);
         if(unlikely(!ff)) {
-            cp->updated = 0;
-            cgroups_check = 1;
-            return;
+            // procfile_readall_fd() closed it
+            *fd = -1;
+            cgroup_open_files--;
         }
 
-        ff = procfile_readall(ff);
+        return ff;
+    }
+
+    ff = procfile_reopen(ff, filename, NULL, PROCFILE_FLAG_DEFAULT);
+    if(unlikely(!ff))
+        return NULL;
+
+    return procfile_readall(ff);
+}
+
+static inline int cgroup_read_single_number(int *fd, const char *filename, unsigned long long *result) {
+    if(likely(*fd != -1 || cgroup_open_files < cgroup_max_open_files)) {
+        if(unlikely(cgroup_file_open(fd, filename) == -1)) {
+            *result = 0;
+            return 1;
+        }
+
+        int ret = read_single_number_fd(*fd, result);
+        if(unlikely(ret))
+            cgroup_file_close(fd);
+
+        return ret;
+    }
+
+    return read_single_number_file(filename, result);
+}
+
+static inline void cgroup_read_cpuacct_stat(struct cpuacct_stat *cp) {
+    static procfile *ff = NULL;
+
+    if(likely(cp->filename)) {
+        ff = cgroup_procfile_read(ff, &cp->fd, cp->filename);
         if(unlikely(!ff)) {
             cp->updated = 0;
             cgroups_check = 1;
@@ -746,14 +856,7 @@ static inline void cgroup2_read_cpuacct_stat(struct cpuacct_stat *cp) {
     static procfile *ff = NULL;
 
     if(likely(cp->filename)) {
-        ff = procfile_reopen(ff, cp->filename, NULL, PROCFILE_FLAG_DEFAULT);
-        if(unlikely(!ff)) {
-            cp->updated = 0;
-            cgroups_check = 1;
-            return;
-        }
-
-        ff = procfile_readall(ff);
+        ff = cgroup_procfile_read(ff, &cp->fd, cp->filename);
         if(unlikely(!ff)) {
             cp->updated = 0;
             cgroups_check = 1;
@@ -783,14 +886,7 @@ static inline void cgroup_read_cpuacct_usage(struct cpuacct_usage *ca) {
     static procfile *ff = NULL;
 
     if(likely(ca->filename)) {
-        ff = procfile_reopen(ff, ca->filename, NULL, PROCFILE_FLAG_DEFAULT);
-        if(unlikely(!ff)) {
-            ca->updated = 0;
-            cgroups_check = 1;
-            return;
-        }
-
-        ff = procfile_readall(ff);
+        ff = cgroup_procfile_read(ff, &ca->fd, ca->filename);
         if(unlikely(!ff)) {
             ca->updated = 0;
             cgroups_check = 1;
@@ -846,14 +942,7 @@ static inline void cgroup_read_blkio(struct blkio *io) {
     if(likely(io->filename)) {
         static procfile *ff = NULL;
 
-        ff = procfile_reopen(ff, io->filename, NULL, PROCFILE_FLAG_DEFAULT);
-        if(unlikely(!ff)) {
-            io->updated = 0;
-            cgroups_check = 1;
-            return;
-        }
-
-        ff = procfile_readall(ff);
+        ff = cgroup_procfile_read(ff, &io->fd, io->filename);
         if(unlikely(!ff)) {
             io->updated = 0;
             cgroups_check = 1;
@@ -918,14 +1007,7 @@ static inline void cgroup2_read_blkio(struct blkio *io, unsigned int word_offset
         if(likely(io->filename)) {
             static procfile *ff = NULL;
 
-            ff = procfile_reopen(ff, io->filename, NULL, PROCFILE_FLAG_DEFAULT);
-            if(unlikely(!ff)) {
-                io->updated = 0;
-                cgroups_check = 1;
-                return;
-            }
-
-            ff = procfile_readall(ff);
+            ff = cgroup_procfile_read(ff, &io->fd, io->filename);
             if(unlikely(!ff)) {
                 io->updated = 0;
                 cgroups_check = 1;
@@ -1017,14 +1099,7 @@ static inline void cgroup_read_memory(struct memory *mem, char parent_cg_is_unif
             goto memory_next;
         }
 
-        ff = procfile_reopen(ff, mem->filename_detailed, NULL, PROCFILE_FLAG_DEFAULT);
-        if(unlikely(!ff)) {
-            mem->updated_detailed = 0;
-            cgroups_check = 1;
-            goto memory_next;
-        }
-
-        ff = procfile_readall(ff);
+        ff = cgroup_procfile_read(ff, &mem->fd_detailed, mem->filename_detailed);
         if(unlikely(!ff)) {
             mem->updated_detailed = 0;
             cgroups_check = 1;
@@ -1105,7 +1180,7 @@ static inline void cgroup_read_memory(struct memory *mem, char parent_cg_is_unif
 
     // read usage_in_bytes
     if(likely(mem->filename_usage_in_bytes)) {
-        mem->updated_usage_in_bytes = !read_single_number_file(mem->filename_usage_in_bytes, &mem->usage_in_bytes);
+        mem->updated_usage_in_bytes = !cgroup_read_single_number(&mem->fd_usage_in_bytes, mem->filename_usage_in_bytes, &mem->usage_in_bytes);
         if(unlikely(mem->updated_usage_in_bytes && mem->enabled_usage_in_bytes == CONFIG_BOOLEAN_AUTO &&
                     (mem->usage_in_bytes || netdata_zero_metrics_enabled == CONFIG_BOOLEAN_YES)))
             mem->enabled_usage_in_bytes = CONFIG_BOOLEAN_YES;
@@ -1113,7 +1188,7 @@ static inline void cgroup_read_memory(struct memory *mem, char parent_cg_is_unif
 
     // read msw_usage_in_bytes
     if(likely(mem->filename_msw_usage_in_bytes)) {
-        mem->updated_msw_usage_in_bytes = !read_single_number_file(mem->filename_msw_usage_in_bytes, &mem->msw_usage_in_bytes);
+        mem->updated_msw_usage_in_bytes = !cgroup_read_single_number(&mem->fd_msw_usage_in_bytes, mem->filename_msw_usage_in_bytes, &mem->msw_usage_in_bytes);
         if(unlikely(mem->updated_msw_usage_in_bytes && mem->enabled_msw_usage_in_bytes == CONFIG_BOOLEAN_AUTO &&
                     (mem->msw_usage_in_bytes || netdata_zero_metrics_enabled == CONFIG_BOOLEAN_YES)))
             mem->enabled_msw_usage_in_bytes = CONFIG_BOOLEAN_YES;
@@ -1126,7 +1201,7 @@ static inline void cgroup_read_memory(struct memory *mem, char parent_cg_is_unif
             mem->delay_counter_failcnt--;
         }
         else {
-            mem->updated_failcnt = !read_single_number_file(mem->filename_failcnt, &mem->failcnt);
+            mem->updated_failcnt = !cgroup_read_single_number(&mem->fd_failcnt, mem->filename_failcnt, &mem->failcnt);
             if(unlikely(mem->updated_failcnt && mem->enabled_failcnt == CONFIG_BOOLEAN_AUTO)) {
                 if(unlikely(mem->failcnt || netdata_zero_metrics_enabled == CONFIG_BOOLEAN_YES))
                     mem->enabled_failcnt = CONFIG_BOOLEAN_YES;
@@ -1329,14 +1404,18 @@ static inline void cgroup_get_chart_name(struct cgroup *cg) {
 
             s = trim(s);
             if (s) {
+                // the collector skips cgroups with pending renames,
+                // so clear the flag only after the new name is in place
+                char pending_renames = cg->pending_renames;
+
                 if(likely(name_error==0))
-                    cg->pending_renames = 0;
+                    pending_renames = 0;
                 else if (unlikely(name_error==3)) {
                     debug(D_CGROUP, "cgroup '%s' disabled based due to rename command output", cg->chart_id);
                     cg->enabled = 0;
                 }
 
-                if (likely(cg->pending_renames < 2)) {
+                if (likely(pending_renames < 2)) {
                     char *name = s;
 
                     if (!strncmp(s, "k8s_", 4)) {
@@ -1351,6 +1430,8 @@ static inline void cgroup_get_chart_name(struct cgroup *cg) {
                     cg->chart_id = cgroup_chart_id_strdupz(name);
                     cg->hash_chart = simple_hash(cg->chart_id);
                 }
+
+                cg->pending_renames = pending_renames;
             }
         }
     }
@@ -1358,6 +1439,35 @@ static inline void cgroup_get_chart_name(struct cgroup *cg) {
         error("CGROUP: cannot popen(\"%s\", \"r\").", command);
 }
 
+// returns 1 when an enabled cgroup with the same chart id is found in the list
+static inline int cgroup_disable_duplicate(struct cgroup *cg, struct cgroup *list) {
+    struct cgroup *t;
+    for (t = list; t; t = t->next) {
+        if (t != cg && t->enabled && t->hash_chart == cg->hash_chart && !strcmp(t->chart_id, cg->chart_id)) {
+            if (!strncmp(t->chart_id, "/system.slice/", 14) && !strncmp(cg->chart_id, "/init.scope/system.slice/", 25)) {
+                error("CGROUP: chart id '%s' already exists with id '%s' and is enabled. Swapping them by enabling cgroup with id '%s' and disabling cgroup with id '%s'.",
+                      cg->chart_id, t->id, cg->id, t->id);
+                debug(D_CGROUP, "Control group with chart id '%s' already exists with id '%s' and is enabled. Swapping them by enabling cgroup with id '%s' and disabling cgroup with id '%s'.",
+                      cg->chart_id, t->id, cg->id, t->id);
+                t->enabled = 0;
+                t->options |= CGROUP_OPTIONS_DISABLED_DUPLICATE;
+            }
+            else {
+                error("CGROUP: chart id '%s' already exists with id '%s' and is enabled and available. Disabling cgroup with id '%s'.",
+                      cg->chart_id, t->id, cg->id);
+                debug(D_CGROUP, "Control group with chart id '%s' already exists with id '%s' and is enabled and available. Disabling cgroup with id '%s'.",
+                      cg->chart_id, t->id, cg->id);
+                cg->enabled = 0;
+                cg->options |= CGROUP_OPTIONS_DISABLED_DUPLICATE;
+            }
+
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 static inline struct cgroup *cgroup_add(const char *id) {
     if(!id || !*id) id = "/";
     debug(D_CGROUP, "adding to list, cgroup with id '%s'", id);
@@ -1373,6 +1483,24 @@ static inline struct cgroup *cgroup_add(const char *id) {
     cg->id = strdupz(id);
     cg->hash = simple_hash(cg->id);
 
+    if(unlikely((struct cgroup *)avl_insert(&cgroup_index, (avl *)cg) != cg))
+        error("CGROUP: cgroup '%s' is already indexed", cg->id);
+
+    cg->cpuacct_stat.fd = -1;
+    cg->cpuacct_usage.fd = -1;
+
+    cg->memory.fd_detailed = -1;
+    cg->memory.fd_usage_in_bytes = -1;
+    cg->memory.fd_msw_usage_in_bytes = -1;
+    cg->memory.fd_failcnt = -1;
+
+    cg->io_service_bytes.fd = -1;
+    cg->io_serviced.fd = -1;
+    cg->throttle_io_service_bytes.fd = -1;
+    cg->throttle_io_serviced.fd = -1;
+    cg->io_merged.fd = -1;
+    cg->io_queued.fd = -1;
+
     cg->chart_title = cgroup_title_strdupz(id);
 
     cg->chart_id = cgroup_chart_id_strdupz(id);
@@ -1380,14 +1508,13 @@ static inline struct cgroup *cgroup_add(const char *id) {
 
     if(cgroup_use_unified_cgroups) cg->options |= CGROUP_OPTIONS_IS_UNIFIED;
 
-    if(!cgroup_root)
-        cgroup_root = cg;
-    else {
-        // append it
-        struct cgroup *e;
-        for(e = cgroup_root; e->next ;e = e->next) ;
-        e->next = cg;
-    }
+    // it becomes visible to the collector when the discovery completes
+    if(!discovered_cgroup_root)
+        discovered_cgroup_root = cg;
+    else
+        discovered_cgroup_last->next = cg;
+
+    discovered_cgroup_last = cg;
 
     cgroup_root_count++;
 
@@ -1451,29 +1578,8 @@ static inline struct cgroup *cgroup_add(const char *id) {
 
     // detect duplicate cgroups
     if(cg->enabled) {
-        struct cgroup *t;
-        for (t = cgroup_root; t; t = t->next) {
-            if (t != cg && t->enabled && t->hash_chart == cg->hash_chart && !strcmp(t->chart_id, cg->chart_id)) {
-                if (!strncmp(t->chart_id, "/system.slice/", 14) && !strncmp(cg->chart_id, "/init.scope/system.slice/", 25)) {
-                    error("CGROUP: chart id '%s' already exists with id '%s' and is enabled. Swapping them by enabling cgroup with id '%s' and disabling cgroup with id '%s'.",
-                          cg->chart_id, t->id, cg->id, t->id);
-                    debug(D_CGROUP, "Control group with chart id '%s' already exists with id '%s' and is enabled. Swapping them by enabling cgroup with id '%s' and disabling cgroup with id '%s'.",
-                          cg->chart_id, t->id, cg->id, t->id);
-                    t->enabled = 0;
-                    t->options |= CGROUP_OPTIONS_DISABLED_DUPLICATE;
-                }
-                else {
-                    error("CGROUP: chart id '%s' already exists with id '%s' and is enabled and available. Disabling cgroup with id '%s'.",
-                          cg->chart_id, t->id, cg->id);
-                    debug(D_CGROUP, "Control group with chart id '%s' already exists with id '%s' and is enabled and available. Disabling cgroup with id '%s'.",
-                          cg->chart_id, t->id, cg->id);
-                    cg->enabled = 0;
-                    cg->options |= CGROUP_OPTIONS_DISABLED_DUPLICATE;
-                }
-
-                break;
-            }
-        }
+        if(!cgroup_disable_duplicate(cg, cgroup_root))
+            cgroup_disable_duplicate(cg, discovered_cgroup_root);
     }
 
     if(cg->enabled && !cg->pending_renames && !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE))
@@ -1522,32 +1628,47 @@ static inline void cgroup_free(struct cgroup *cg) {
 
     freez(cg->cpuacct_stat.filename);
     freez(cg->cpuacct_usage.filename);
+    cgroup_file_close(&cg->cpuacct_stat.fd);
+    cgroup_file_close(&cg->cpuacct_usage.fd);
 
     arl_free(cg->memory.arl_base);
     freez(cg->memory.filename_detailed);
     freez(cg->memory.filename_failcnt);
     freez(cg->memory.filename_usage_in_bytes);
     freez(cg->memory.filename_msw_usage_in_bytes);
+    cgroup_file_close(&cg->memory.fd_detailed);
+    cgroup_file_close(&cg->memory.fd_failcnt);
+    cgroup_file_close(&cg->memory.fd_usage_in_bytes);
+    cgroup_file_close(&cg->memory.fd_msw_usage_in_bytes);
 
     freez(cg->io_service_bytes.filename);
     freez(cg->io_serviced.filename);
+    cgroup_file_close(&cg->io_service_bytes.fd);
+    cgroup_file_close(&cg->io_serviced.fd);
 
     freez(cg->throttle_io_service_bytes.filename);
     freez(cg->throttle_io_serviced.filename);
+    cgroup_file_close(&cg->throttle_io_service_bytes.fd);
+    cgroup_file_close(&cg->throttle_io_serviced.fd);
 
     freez(cg->io_merged.filename);
     freez(cg->io_queued.filename);
+    cgroup_file_close(&cg->io_merged.fd);
+    cgroup_file_close(&cg->io_queued.fd);
 
     free_pressure(&cg->cpu_pressure);
     free_pressure(&cg->io_pressure);
     free_pressure(&cg->memory_pressure);
 
-    freez(cg->id);
     freez(cg->chart_id);
     freez(cg->chart_title);
 
     free_label_list(cg->chart_labels);
 
+    if(unlikely((struct cgroup *)avl_remove(&cgroup_index, (avl *)cg) != cg))
+        error("CGROUP: cgroup '%s' was not indexed", cg->id);
+
+    freez(cg->id);
     freez(cg);
 
     cgroup_root_count--;
@@ -1557,13 +1678,11 @@ static inline void cgroup_free(struct cgroup *cg) {
 static inline struct cgroup *cgroup_find(const char *id) {
     debug(D_CGROUP, "searching for cgroup '%s'", id);
 
-    uint32_t hash = simple_hash(id);
+    struct cgroup tmp;
+    tmp.id = (char *)id;
+    tmp.hash = simple_hash(id);
 
-    struct cgroup *cg;
-    for(cg = cgroup_root; cg ; cg = cg->next) {
-        if(hash == cg->hash && strcmp(id, cg->id) == 0)
-            break;
-    }
+    struct cgroup *cg = (struct cgroup *)avl_search(&cgroup_index, (avl *)&tmp);
 
     debug(D_CGROUP, "cgroup '%s' %s in memory", id, (cg)?"found":"not found");
     return cg;
@@ -1591,8 +1710,17 @@ static inline void found_subdir_in_dir(const char *dir) {
                 return;
             }
         }
+
+        // the queue of new cgroups is full, leave it for the next discovery
+        if(unlikely(discovery_stats.queued >= (size_t)cgroup_discovery_queue_size)) {
+            debug(D_CGROUP, "cgroup '%s' deferred to the next discovery (%zu new cgroups already queued)", dir, discovery_stats.queued);
+            discovery_stats.deferred++;
+            return;
+        }
+
         // debug(D_CGROUP, "will add dir '%s' as cgroup", dir);
         cg = cgroup_add(dir);
+        if(cg) discovery_stats.queued++;
     }
 
     if(cg) {
@@ -1602,18 +1730,19 @@ static inline void found_subdir_in_dir(const char *dir) {
             if(simple_pattern_matches(enabled_cgroup_renames, cg->id)) {
 
                 cgroup_get_chart_name(cg);
-                cg->pending_renames = 0;
 
                 if(cg->enabled && !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE))
                     read_cgroup_network_interfaces(cg);
 
+                cg->pending_renames = 0;
+
                 debug(D_CGROUP, "cgroup '%s' renamed to '%s' (title: '%s')", cg->id, cg->chart_id, cg->chart_title);
             }
             else
                 debug(D_CGROUP, "cgroup '%s' will not be renamed - it matches the list of disabled cgroup renames (will be shown as '%s')", cg->id, cg->chart_id);
         }
 
-        cg->available = 1;
+        cg->discovered = 1;
     }
 }
 
@@ -1680,14 +1809,15 @@ static inline int find_dir_in_subdirs(const char *base, const char *this, void (
     return ret;
 }
 
-static inline void mark_all_cgroups_as_not_available() {
-    debug(D_CGROUP, "marking all cgroups as not available");
+static inline void mark_all_cgroups_as_not_discovered() {
+    debug(D_CGROUP, "marking all cgroups as not discovered");
 
     struct cgroup *cg;
 
-    // mark all as not available
+    // mark all as not discovered
+    // the collector keeps using the available flag until the discovery completes
     for(cg = cgroup_root; cg ; cg = cg->next) {
-        cg->available = 0;
+        cg->discovered = 0;
     }
 }
 
@@ -1715,6 +1845,7 @@ static inline void cleanup_all_cgroups() {
                 last->next = cg->next;
 
             cgroup_free(cg);
+            discovery_stats.removed++;
 
             if(!last)
                 cg = cgroup_root;
@@ -1728,10 +1859,294 @@ static inline void cleanup_all_cgroups() {
     }
 }
 
+// make the cgroups found by the discovery visible to the collector
+// and remove the ones that are gone - called with cgroup_root_mutex locked
+static inline void publish_discovered_cgroups() {
+    struct cgroup *cg, *last = NULL;
+
+    for(cg = cgroup_root; cg ; cg = cg->next) {
+        cg->available = cg->discovered;
+        last = cg;
+    }
+
+    for(cg = discovered_cgroup_root; cg ; cg = cg->next)
+        cg->available = cg->discovered;
+
+    if(!last)
+        cgroup_root = discovered_cgroup_root;
+    else
+        last->next = discovered_cgroup_root;
+
+    discovered_cgroup_root = discovered_cgroup_last = NULL;
+
+    // remove any non-existing cgroups
+    cleanup_all_cgroups();
+}
+
+static inline void find_cgroup_filenames(struct cgroup *cg) {
+    struct stat buf;
+
+    debug(D_CGROUP, "checking paths for cgroup '%s'", cg->id);
+
+    // check for newly added cgroups
+    // and update the filenames they read
+    char filename[FILENAME_MAX + 1];
+    if(!cgroup_use_unified_cgroups) {
+        if(unlikely(cgroup_enable_cpuacct_stat && !cg->cpuacct_stat.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/cpuacct.stat", cgroup_cpuacct_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->cpuacct_stat.filename = strdupz(filename);
+                cg->cpuacct_stat.enabled = cgroup_enable_cpuacct_stat;
+                snprintfz(filename, FILENAME_MAX, "%s%s/cpuset.cpus", cgroup_cpuset_base, cg->id);
+                cg->filename_cpuset_cpus = strdupz(filename);
+                snprintfz(filename, FILENAME_MAX, "%s%s/cpu.cfs_period_us", cgroup_cpuacct_base, cg->id);
+                cg->filename_cpu_cfs_period = strdupz(filename);
+                snprintfz(filename, FILENAME_MAX, "%s%s/cpu.cfs_quota_us", cgroup_cpuacct_base, cg->id);
+                cg->filename_cpu_cfs_quota = strdupz(filename);
+                debug(D_CGROUP, "cpuacct.stat filename for cgroup '%s': '%s'", cg->id, cg->cpuacct_stat.filename);
+            }
+            else
+                debug(D_CGROUP, "cpuacct.stat file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_cpuacct_usage && !cg->cpuacct_usage.filename && !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE))) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/cpuacct.usage_percpu", cgroup_cpuacct_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->cpuacct_usage.filename = strdupz(filename);
+                cg->cpuacct_usage.enabled = cgroup_enable_cpuacct_usage;
+                debug(D_CGROUP, "cpuacct.usage_percpu filename for cgroup '%s': '%s'", cg->id, cg->cpuacct_usage.filename);
+            }
+            else
+                debug(D_CGROUP, "cpuacct.usage_percpu file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely((cgroup_enable_detailed_memory || cgroup_used_memory_without_cache) && !cg->memory.filename_detailed && (cgroup_used_memory_without_cache || cgroup_enable_systemd_services_detailed_memory || !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE)))) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.stat", cgroup_memory_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->memory.filename_detailed = strdupz(filename);
+                cg->memory.enabled_detailed = (cgroup_enable_detailed_memory == CONFIG_BOOLEAN_YES)?CONFIG_BOOLEAN_YES:CONFIG_BOOLEAN_AUTO;
+                debug(D_CGROUP, "memory.stat filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_detailed);
+            }
+            else
+                debug(D_CGROUP, "memory.stat file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_memory && !cg->memory.filename_usage_in_bytes)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.usage_in_bytes", cgroup_memory_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->memory.filename_usage_in_bytes = strdupz(filename);
+                cg->memory.enabled_usage_in_bytes = cgroup_enable_memory;
+                debug(D_CGROUP, "memory.usage_in_bytes filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_usage_in_bytes);
+                snprintfz(filename, FILENAME_MAX, "%s%s/memory.limit_in_bytes", cgroup_memory_base, cg->id);
+                cg->filename_memory_limit = strdupz(filename);
+            }
+            else
+                debug(D_CGROUP, "memory.usage_in_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_swap && !cg->memory.filename_msw_usage_in_bytes)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.memsw.usage_in_bytes", cgroup_memory_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->memory.filename_msw_usage_in_bytes = strdupz(filename);
+                cg->memory.enabled_msw_usage_in_bytes = cgroup_enable_swap;
+                snprintfz(filename, FILENAME_MAX, "%s%s/memory.memsw.limit_in_bytes", cgroup_memory_base, cg->id);
+                cg->filename_memoryswap_limit = strdupz(filename);
+                debug(D_CGROUP, "memory.msw_usage_in_bytes filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_msw_usage_in_bytes);
+            }
+            else
+                debug(D_CGROUP, "memory.msw_usage_in_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_memory_failcnt && !cg->memory.filename_failcnt)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.failcnt", cgroup_memory_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->memory.filename_failcnt = strdupz(filename);
+                cg->memory.enabled_failcnt = cgroup_enable_memory_failcnt;
+                debug(D_CGROUP, "memory.failcnt filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_failcnt);
+            }
+            else
+                debug(D_CGROUP, "memory.failcnt file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_blkio_io && !cg->io_service_bytes.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_service_bytes", cgroup_blkio_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->io_service_bytes.filename = strdupz(filename);
+                cg->io_service_bytes.enabled = cgroup_enable_blkio_io;
+                debug(D_CGROUP, "io_service_bytes filename for cgroup '%s': '%s'", cg->id, cg->io_service_bytes.filename);
+            }
+            else
+                debug(D_CGROUP, "io_service_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_blkio_ops && !cg->io_serviced.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_serviced", cgroup_blkio_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->io_serviced.filename = strdupz(filename);
+                cg->io_serviced.enabled = cgroup_enable_blkio_ops;
+                debug(D_CGROUP, "io_serviced filename for cgroup '%s': '%s'", cg->id, cg->io_serviced.filename);
+            }
+            else
+                debug(D_CGROUP, "io_serviced file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_blkio_throttle_io && !cg->throttle_io_service_bytes.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/blkio.throttle.io_service_bytes", cgroup_blkio_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->throttle_io_service_bytes.filename = strdupz(filename);
+                cg->throttle_io_service_bytes.enabled = cgroup_enable_blkio_throttle_io;
+                debug(D_CGROUP, "throttle_io_service_bytes filename for cgroup '%s': '%s'", cg->id, cg->throttle_io_service_bytes.filename);
+            }
+            else
+                debug(D_CGROUP, "throttle_io_service_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_blkio_throttle_ops && !cg->throttle_io_serviced.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/blkio.throttle.io_serviced", cgroup_blkio_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->throttle_io_serviced.filename = strdupz(filename);
+                cg->throttle_io_serviced.enabled = cgroup_enable_blkio_throttle_ops;
+                debug(D_CGROUP, "throttle_io_serviced filename for cgroup '%s': '%s'", cg->id, cg->throttle_io_serviced.filename);
+            }
+            else
+                debug(D_CGROUP, "throttle_io_serviced file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_blkio_merged_ops && !cg->io_merged.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_merged", cgroup_blkio_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->io_merged.filename = strdupz(filename);
+                cg->io_merged.enabled = cgroup_enable_blkio_merged_ops;
+                debug(D_CGROUP, "io_merged filename for cgroup '%s': '%s'", cg->id, cg->io_merged.filename);
+            }
+            else
+                debug(D_CGROUP, "io_merged file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_blkio_queued_ops && !cg->io_queued.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_queued", cgroup_blkio_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->io_queued.filename = strdupz(filename);
+                cg->io_queued.enabled = cgroup_enable_blkio_queued_ops;
+                debug(D_CGROUP, "io_queued filename for cgroup '%s': '%s'", cg->id, cg->io_queued.filename);
+            }
+            else
+                debug(D_CGROUP, "io_queued file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+    }
+    else if(likely(cgroup_unified_exist)) {
+        if(unlikely(cgroup_enable_blkio_io && !cg->io_service_bytes.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/io.stat", cgroup_unified_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->io_service_bytes.filename = strdupz(filename);
+                cg->io_service_bytes.enabled = cgroup_enable_blkio_io;
+                debug(D_CGROUP, "io.stat filename for unified cgroup '%s': '%s'", cg->id, cg->io_service_bytes.filename);
+            } else
+                debug(D_CGROUP, "io.stat file for unified cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+        if (unlikely(cgroup_enable_blkio_ops && !cg->io_serviced.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/io.stat", cgroup_unified_base, cg->id);
+            if (likely(stat(filename, &buf) != -1)) {
+                cg->io_serviced.filename = strdupz(filename);
+                cg->io_serviced.enabled = cgroup_enable_blkio_ops;
+                debug(D_CGROUP, "io.stat filename for unified cgroup '%s': '%s'", cg->id, cg->io_service_bytes.filename);
+            } else
+                debug(D_CGROUP, "io.stat file for unified cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+        if(unlikely(cgroup_enable_cpuacct_stat && !cg->cpuacct_stat.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/cpu.stat", cgroup_unified_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->cpuacct_stat.filename = strdupz(filename);
+                cg->cpuacct_stat.enabled = cgroup_enable_cpuacct_stat;
+                cg->filename_cpuset_cpus = NULL;
+                cg->filename_cpu_cfs_period = NULL;
+                snprintfz(filename, FILENAME_MAX, "%s%s/cpu.max", cgroup_unified_base, cg->id);
+                cg->filename_cpu_cfs_quota = strdupz(filename);
+                debug(D_CGROUP, "cpu.stat filename for unified cgroup '%s': '%s'", cg->id, cg->cpuacct_stat.filename);
+            }
+            else
+                debug(D_CGROUP, "cpu.stat file for unified cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+        if(unlikely((cgroup_enable_detailed_memory || cgroup_used_memory_without_cache) && !cg->memory.filename_detailed && (cgroup_used_memory_without_cache || cgroup_enable_systemd_services_detailed_memory || !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE)))) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.stat", cgroup_unified_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->memory.filename_detailed = strdupz(filename);
+                cg->memory.enabled_detailed = (cgroup_enable_detailed_memory == CONFIG_BOOLEAN_YES)?CONFIG_BOOLEAN_YES:CONFIG_BOOLEAN_AUTO;
+                debug(D_CGROUP, "memory.stat filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_detailed);
+            }
+            else
+                debug(D_CGROUP, "memory.stat file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_memory && !cg->memory.filename_usage_in_bytes)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.current", cgroup_unified_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->memory.filename_usage_in_bytes = strdupz(filename);
+                cg->memory.enabled_usage_in_bytes = cgroup_enable_memory;
+                debug(D_CGROUP, "memory.current filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_usage_in_bytes);
+                snprintfz(filename, FILENAME_MAX, "%s%s/memory.max", cgroup_unified_base, cg->id);
+                cg->filename_memory_limit = strdupz(filename);
+            }
+            else
+                debug(D_CGROUP, "memory.current file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if(unlikely(cgroup_enable_swap && !cg->memory.filename_msw_usage_in_bytes)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.swap.current", cgroup_unified_base, cg->id);
+            if(likely(stat(filename, &buf) != -1)) {
+                cg->memory.filename_msw_usage_in_bytes = strdupz(filename);
+                cg->memory.enabled_msw_usage_in_bytes = cgroup_enable_swap;
+                snprintfz(filename, FILENAME_MAX, "%s%s/memory.swap.max", cgroup_unified_base, cg->id);
+                cg->filename_memoryswap_limit = strdupz(filename);
+                debug(D_CGROUP, "memory.swap.current filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_msw_usage_in_bytes);
+            }
+            else
+                debug(D_CGROUP, "memory.swap file for cgroup '%s': '%s' does not exist.", cg->id, filename);
+        }
+
+        if (unlikely(cgroup_enable_pressure_cpu && !cg->cpu_pressure.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/cpu.pressure", cgroup_unified_base, cg->id);
+            if (likely(stat(filename, &buf) != -1)) {
+                cg->cpu_pressure.filename = strdupz(filename);
+                cg->cpu_pressure.some.enabled = cgroup_enable_pressure_cpu;
+                cg->cpu_pressure.full.enabled = CONFIG_BOOLEAN_NO;
+                debug(D_CGROUP, "cpu.pressure filename for cgroup '%s': '%s'", cg->id, cg->cpu_pressure.filename);
+            } else {
+                debug(D_CGROUP, "cpu.pressure file for cgroup '%s': '%s' does not exist", cg->id, filename);
+            }
+        }
+
+        if (unlikely((cgroup_enable_pressure_io_some || cgroup_enable_pressure_io_full) && !cg->io_pressure.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/io.pressure", cgroup_unified_base, cg->id);
+            if (likely(stat(filename, &buf) != -1)) {
+                cg->io_pressure.filename = strdupz(filename);
+                cg->io_pressure.some.enabled = cgroup_enable_pressure_io_some;
+                cg->io_pressure.full.enabled = cgroup_enable_pressure_io_full;
+                debug(D_CGROUP, "io.pressure filename for cgroup '%s': '%s'", cg->id, cg->io_pressure.filename);
+            } else {
+                debug(D_CGROUP, "io.pressure file for cgroup '%s': '%s' does not exist", cg->id, filename);
+            }
+        }
+
+        if (unlikely((cgroup_enable_pressure_memory_some || cgroup_enable_pressure_memory_full) && !cg->memory_pressure.filename)) {
+            snprintfz(filename, FILENAME_MAX, "%s%s/memory.pressure", cgroup_unified_base, cg->id);
+            if (likely(stat(filename, &buf) != -1)) {
+                cg->memory_pressure.filename = strdupz(filename);
+                cg->memory_pressure.some.enabled = cgroup_enable_pressure_memory_some;
+                cg->memory_pressure.full.enabled = cgroup_enable_pressure_memory_full;
+                debug(D_CGROUP, "memory.pressure filename for cgroup '%s': '%s'", cg->id, cg->memory_pressure.filename);
+            } else {
+                debug(D_CGROUP, "memory.pressure file for cgroup '%s': '%s' does not exist", cg->id, filename);
+            }
+        }
+    }
+}
+
 static inline void find_all_cgroups() {
     debug(D_CGROUP, "searching for cgroups");
 
-    mark_all_cgroups_as_not_available();
+    mark_all_cgroups_as_not_discovered();
+
     if(!cgroup_use_unified_cgroups) {
         if(cgroup_enable_cpuacct_stat || cgroup_enable_cpuacct_usage) {
             if(find_dir_in_subdirs(cgroup_cpuacct_base, NULL, found_subdir_in_dir) == -1) {
@@ -1777,276 +2192,33 @@ static inline void find_all_cgroups() {
         }
     }
 
-    // remove any non-existing cgroups
-    cleanup_all_cgroups();
-
+    // filenames are only set once (from NULL), so the collector
+    // may see them appear on running cgroups without locking
     struct cgroup *cg;
-    struct stat buf;
     for(cg = cgroup_root; cg ; cg = cg->next) {
-        // fprintf(stderr, " >>> CGROUP '%s' (%u - %s) with name '%s'\n", cg->id, cg->hash, cg->available?"available":"stopped", cg->name);
-
         if(unlikely(cg->pending_renames))
             cg->pending_renames--;
 
-        if(unlikely(!cg->available || cg->pending_renames))
+        if(unlikely(!cg->discovered || cg->pending_renames))
             continue;
 
-        debug(D_CGROUP, "checking paths for cgroup '%s'", cg->id);
-
-        // check for newly added cgroups
-        // and update the filenames they read
-        char filename[FILENAME_MAX + 1];
-        if(!cgroup_use_unified_cgroups) {
-            if(unlikely(cgroup_enable_cpuacct_stat && !cg->cpuacct_stat.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/cpuacct.stat", cgroup_cpuacct_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->cpuacct_stat.filename = strdupz(filename);
-                    cg->cpuacct_stat.enabled = cgroup_enable_cpuacct_stat;
-                    snprintfz(filename, FILENAME_MAX, "%s%s/cpuset.cpus", cgroup_cpuset_base, cg->id);
-                    cg->filename_cpuset_cpus = strdupz(filename);
-                    snprintfz(filename, FILENAME_MAX, "%s%s/cpu.cfs_period_us", cgroup_cpuacct_base, cg->id);
-                    cg->filename_cpu_cfs_period = strdupz(filename);
-                    snprintfz(filename, FILENAME_MAX, "%s%s/cpu.cfs_quota_us", cgroup_cpuacct_base, cg->id);
-                    cg->filename_cpu_cfs_quota = strdupz(filename);
-                    debug(D_CGROUP, "cpuacct.stat filename for cgroup '%s': '%s'", cg->id, cg->cpuacct_stat.filename);
-                }
-                else
-                    debug(D_CGROUP, "cpuacct.stat file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_cpuacct_usage && !cg->cpuacct_usage.filename && !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE))) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/cpuacct.usage_percpu", cgroup_cpuacct_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->cpuacct_usage.filename = strdupz(filename);
-                    cg->cpuacct_usage.enabled = cgroup_enable_cpuacct_usage;
-                    debug(D_CGROUP, "cpuacct.usage_percpu filename for cgroup '%s': '%s'", cg->id, cg->cpuacct_usage.filename);
-                }
-                else
-                    debug(D_CGROUP, "cpuacct.usage_percpu file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely((cgroup_enable_detailed_memory || cgroup_used_memory_without_cache) && !cg->memory.filename_detailed && (cgroup_used_memory_without_cache || cgroup_enable_systemd_services_detailed_memory || !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE)))) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.stat", cgroup_memory_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->memory.filename_detailed = strdupz(filename);
-                    cg->memory.enabled_detailed = (cgroup_enable_detailed_memory == CONFIG_BOOLEAN_YES)?CONFIG_BOOLEAN_YES:CONFIG_BOOLEAN_AUTO;
-                    debug(D_CGROUP, "memory.stat filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_detailed);
-                }
-                else
-                    debug(D_CGROUP, "memory.stat file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_memory && !cg->memory.filename_usage_in_bytes)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.usage_in_bytes", cgroup_memory_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->memory.filename_usage_in_bytes = strdupz(filename);
-                    cg->memory.enabled_usage_in_bytes = cgroup_enable_memory;
-                    debug(D_CGROUP, "memory.usage_in_bytes filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_usage_in_bytes);
-                    snprintfz(filename, FILENAME_MAX, "%s%s/memory.limit_in_bytes", cgroup_memory_base, cg->id);
-                    cg->filename_memory_limit = strdupz(filename);
-                }
-                else
-                    debug(D_CGROUP, "memory.usage_in_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_swap && !cg->memory.filename_msw_usage_in_bytes)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.memsw.usage_in_bytes", cgroup_memory_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->memory.filename_msw_usage_in_bytes = strdupz(filename);
-                    cg->memory.enabled_msw_usage_in_bytes = cgroup_enable_swap;
-                    snprintfz(filename, FILENAME_MAX, "%s%s/memory.memsw.limit_in_bytes", cgroup_memory_base, cg->id);
-                    cg->filename_memoryswap_limit = strdupz(filename);
-                    debug(D_CGROUP, "memory.msw_usage_in_bytes filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_msw_usage_in_bytes);
-                }
-                else
-                    debug(D_CGROUP, "memory.msw_usage_in_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_memory_failcnt && !cg->memory.filename_failcnt)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.failcnt", cgroup_memory_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->memory.filename_failcnt = strdupz(filename);
-                    cg->memory.enabled_failcnt = cgroup_enable_memory_failcnt;
-                    debug(D_CGROUP, "memory.failcnt filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_failcnt);
-                }
-                else
-                    debug(D_CGROUP, "memory.failcnt file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_blkio_io && !cg->io_service_bytes.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_service_bytes", cgroup_blkio_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->io_service_bytes.filename = strdupz(filename);
-                    cg->io_service_bytes.enabled = cgroup_enable_blkio_io;
-                    debug(D_CGROUP, "io_service_bytes filename for cgroup '%s': '%s'", cg->id, cg->io_service_bytes.filename);
-                }
-                else
-                    debug(D_CGROUP, "io_service_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_blkio_ops && !cg->io_serviced.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_serviced", cgroup_blkio_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->io_serviced.filename = strdupz(filename);
-                    cg->io_serviced.enabled = cgroup_enable_blkio_ops;
-                    debug(D_CGROUP, "io_serviced filename for cgroup '%s': '%s'", cg->id, cg->io_serviced.filename);
-                }
-                else
-                    debug(D_CGROUP, "io_serviced file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_blkio_throttle_io && !cg->throttle_io_service_bytes.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/blkio.throttle.io_service_bytes", cgroup_blkio_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->throttle_io_service_bytes.filename = strdupz(filename);
-                    cg->throttle_io_service_bytes.enabled = cgroup_enable_blkio_throttle_io;
-                    debug(D_CGROUP, "throttle_io_service_bytes filename for cgroup '%s': '%s'", cg->id, cg->throttle_io_service_bytes.filename);
-                }
-                else
-                    debug(D_CGROUP, "throttle_io_service_bytes file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_blkio_throttle_ops && !cg->throttle_io_serviced.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/blkio.throttle.io_serviced", cgroup_blkio_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->throttle_io_serviced.filename = strdupz(filename);
-                    cg->throttle_io_serviced.enabled = cgroup_enable_blkio_throttle_ops;
-                    debug(D_CGROUP, "throttle_io_serviced filename for cgroup '%s': '%s'", cg->id, cg->throttle_io_serviced.filename);
-                }
-                else
-                    debug(D_CGROUP, "throttle_io_serviced file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_blkio_merged_ops && !cg->io_merged.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_merged", cgroup_blkio_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->io_merged.filename = strdupz(filename);
-                    cg->io_merged.enabled = cgroup_enable_blkio_merged_ops;
-                    debug(D_CGROUP, "io_merged filename for cgroup '%s': '%s'", cg->id, cg->io_merged.filename);
-                }
-                else
-                    debug(D_CGROUP, "io_merged file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_blkio_queued_ops && !cg->io_queued.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/blkio.io_queued", cgroup_blkio_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->io_queued.filename = strdupz(filename);
-                    cg->io_queued.enabled = cgroup_enable_blkio_queued_ops;
-                    debug(D_CGROUP, "io_queued filename for cgroup '%s': '%s'", cg->id, cg->io_queued.filename);
-                }
-                else
-                    debug(D_CGROUP, "io_queued file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-        }
-        else if(likely(cgroup_unified_exist)) {
-            if(unlikely(cgroup_enable_blkio_io && !cg->io_service_bytes.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/io.stat", cgroup_unified_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->io_service_bytes.filename = strdupz(filename);
-                    cg->io_service_bytes.enabled = cgroup_enable_blkio_io;
-                    debug(D_CGROUP, "io.stat filename for unified cgroup '%s': '%s'", cg->id, cg->io_service_bytes.filename);
-                } else
-                    debug(D_CGROUP, "io.stat file for unified cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-            if (unlikely(cgroup_enable_blkio_ops && !cg->io_serviced.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/io.stat", cgroup_unified_base, cg->id);
-                if (likely(stat(filename, &buf) != -1)) {
-                    cg->io_serviced.filename = strdupz(filename);
-                    cg->io_serviced.enabled = cgroup_enable_blkio_ops;
-                    debug(D_CGROUP, "io.stat filename for unified cgroup '%s': '%s'", cg->id, cg->io_service_bytes.filename);
-                } else
-                    debug(D_CGROUP, "io.stat file for unified cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-            if(unlikely(cgroup_enable_cpuacct_stat && !cg->cpuacct_stat.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/cpu.stat", cgroup_unified_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->cpuacct_stat.filename = strdupz(filename);
-                    cg->cpuacct_stat.enabled = cgroup_enable_cpuacct_stat;
-                    cg->filename_cpuset_cpus = NULL;
-                    cg->filename_cpu_cfs_period = NULL;
-                    snprintfz(filename, FILENAME_MAX, "%s%s/cpu.max", cgroup_unified_base, cg->id);
-                    cg->filename_cpu_cfs_quota = strdupz(filename);
-                    debug(D_CGROUP, "cpu.stat filename for unified cgroup '%s': '%s'", cg->id, cg->cpuacct_stat.filename);
-                }
-                else
-                    debug(D_CGROUP, "cpu.stat file for unified cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-            if(unlikely((cgroup_enable_detailed_memory || cgroup_used_memory_without_cache) && !cg->memory.filename_detailed && (cgroup_used_memory_without_cache || cgroup_enable_systemd_services_detailed_memory || !(cg->options & CGROUP_OPTIONS_SYSTEM_SLICE_SERVICE)))) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.stat", cgroup_unified_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->memory.filename_detailed = strdupz(filename);
-                    cg->memory.enabled_detailed = (cgroup_enable_detailed_memory == CONFIG_BOOLEAN_YES)?CONFIG_BOOLEAN_YES:CONFIG_BOOLEAN_AUTO;
-                    debug(D_CGROUP, "memory.stat filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_detailed);
-                }
-                else
-                    debug(D_CGROUP, "memory.stat file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_memory && !cg->memory.filename_usage_in_bytes)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.current", cgroup_unified_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->memory.filename_usage_in_bytes = strdupz(filename);
-                    cg->memory.enabled_usage_in_bytes = cgroup_enable_memory;
-                    debug(D_CGROUP, "memory.current filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_usage_in_bytes);
-                    snprintfz(filename, FILENAME_MAX, "%s%s/memory.max", cgroup_unified_base, cg->id);
-                    cg->filename_memory_limit = strdupz(filename);
-                }
-                else
-                    debug(D_CGROUP, "memory.current file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
-
-            if(unlikely(cgroup_enable_swap && !cg->memory.filename_msw_usage_in_bytes)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.swap.current", cgroup_unified_base, cg->id);
-                if(likely(stat(filename, &buf) != -1)) {
-                    cg->memory.filename_msw_usage_in_bytes = strdupz(filename);
-                    cg->memory.enabled_msw_usage_in_bytes = cgroup_enable_swap;
-                    snprintfz(filename, FILENAME_MAX, "%s%s/memory.swap.max", cgroup_unified_base, cg->id);
-                    cg->filename_memoryswap_limit = strdupz(filename);
-                    debug(D_CGROUP, "memory.swap.current filename for cgroup '%s': '%s'", cg->id, cg->memory.filename_msw_usage_in_bytes);
-                }
-                else
-                    debug(D_CGROUP, "memory.swap file for cgroup '%s': '%s' does not exist.", cg->id, filename);
-            }
+        find_cgroup_filenames(cg);
+    }
 
-            if (unlikely(cgroup_enable_pressure_cpu && !cg->cpu_pressure.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/cpu.pressure", cgroup_unified_base, cg->id);
-                if (likely(stat(filename, &buf) != -1)) {
-                    cg->cpu_pressure.filename = strdupz(filename);
-                    cg->cpu_pressure.some.enabled = cgroup_enable_pressure_cpu;
-                    cg->cpu_pressure.full.enabled = CONFIG_BOOLEAN_NO;
-                    debug(D_CGROUP, "cpu.pressure filename for cgroup '%s': '%s'", cg->id, cg->cpu_pressure.filename);
-                } else {
-                    debug(D_CGROUP, "cpu.pressure file for cgroup '%s': '%s' does not exist", cg->id, filename);
-                }
-            }
+    for(cg = discovered_cgroup_root; cg ; cg = cg->next) {
+        if(unlikely(cg->pending_renames))
+            cg->pending_renames--;
 
-            if (unlikely((cgroup_enable_pressure_io_some || cgroup_enable_pressure_io_full) && !cg->io_pressure.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/io.pressure", cgroup_unified_base, cg->id);
-                if (likely(stat(filename, &buf) != -1)) {
-                    cg->io_pressure.filename = strdupz(filename);
-                    cg->io_pressure.some.enabled = cgroup_enable_pressure_io_some;
-                    cg->io_pressure.full.enabled = cgroup_enable_pressure_io_full;
-                    debug(D_CGROUP, "io.pressure filename for cgroup '%s': '%s'", cg->id, cg->io_pressure.filename);
-                } else {
-                    debug(D_CGROUP, "io.pressure file for cgroup '%s': '%s' does not exist", cg->id, filename);
-                }
-            }
+        if(unlikely(cg->pending_renames))
+            continue;
 
-            if (unlikely((cgroup_enable_pressure_memory_some || cgroup_enable_pressure_memory_full) && !cg->memory_pressure.filename)) {
-                snprintfz(filename, FILENAME_MAX, "%s%s/memory.pressure", cgroup_unified_base, cg->id);
-                if (likely(stat(filename, &buf) != -1)) {
-                    cg->memory_pressure.filename = strdupz(filename);
-                    cg->memory_pressure.some.enabled = cgroup_enable_pressure_memory_some;
-                    cg->memory_pressure.full.enabled = cgroup_enable_pressure_memory_full;
-                    debug(D_CGROUP, "memory.pressure filename for cgroup '%s': '%s'", cg->id, cg->memory_pressure.filename);
-                } else {
-                    debug(D_CGROUP, "memory.pressure file for cgroup '%s': '%s' does not exist", cg->id, filename);
-                }
-            }
-        }
+        find_cgroup_filenames(cg);
     }
 
+    uv_mutex_lock(&cgroup_root_mutex);
+    publish_discovered_cgroups();
+    uv_mutex_unlock(&cgroup_root_mutex);
+
     debug(D_CGROUP, "done searching for cgroups");
 }
 
@@ -3871,6 +4043,135 @@ void update_cgroup_charts(int update_every) {
     debug(D_CGROUP, "done updating cgroups charts");
 }
 
+// ----------------------------------------------------------------------------
+// cgroups discovery thread
+
+// find_all_cgroups() may run external scripts for every new cgroup,
+// so it runs in its own thread, to keep the collection of the
+// already known cgroups on time
+
+static struct discovery_thread {
+    netdata_thread_t thread;
+    uv_mutex_t mutex;
+    uv_cond_t cond_var;
+    int start_discovery;
+    usec_t requested_ut;
+
+    struct cgroup_discovery_stats last; // the statistics of the last completed discovery
+
+    volatile int exited;
+} discovery_thread;
+
+static void *cgroup_discovery_worker(void *ptr) {
+    UNUSED(ptr);
+
+    while(!netdata_exit) {
+        uv_mutex_lock(&discovery_thread.mutex);
+        while(!discovery_thread.start_discovery)
+            uv_cond_wait(&discovery_thread.cond_var, &discovery_thread.mutex);
+        discovery_thread.start_discovery = 0;
+        usec_t requested_ut = discovery_thread.requested_ut;
+        uv_mutex_unlock(&discovery_thread.mutex);
+
+        if(unlikely(netdata_exit))
+            break;
+
+        memset(&discovery_stats, 0, sizeof(discovery_stats));
+
+        usec_t started_ut = now_monotonic_usec();
+        find_all_cgroups();
+        usec_t finished_ut = now_monotonic_usec();
+
+        discovery_stats.duration = finished_ut - started_ut;
+        discovery_stats.latency = finished_ut - requested_ut;
+
+        uv_mutex_lock(&discovery_thread.mutex);
+        discovery_thread.last = discovery_stats;
+        uv_mutex_unlock(&discovery_thread.mutex);
+    }
+
+    discovery_thread.exited = 1;
+    return NULL;
+}
+
+static inline void cgroup_discovery_request() {
+    uv_mutex_lock(&discovery_thread.mutex);
+
+    // requests made while a discovery is waiting to start are merged
+    if(!discovery_thread.start_discovery) {
+        discovery_thread.start_discovery = 1;
+        discovery_thread.requested_ut = now_monotonic_usec();
+    }
+
+    uv_cond_signal(&discovery_thread.cond_var);
+    uv_mutex_unlock(&discovery_thread.mutex);
+}
+
+static inline void update_discovery_charts(int update_every) {
+    static RRDSET *st_time = NULL, *st_queue = NULL;
+    static RRDDIM *rd_duration = NULL, *rd_latency = NULL, *rd_queued = NULL, *rd_deferred = NULL, *rd_removed = NULL;
+
+    struct cgroup_discovery_stats stats;
+
+    uv_mutex_lock(&discovery_thread.mutex);
+    stats = discovery_thread.last;
+    uv_mutex_unlock(&discovery_thread.mutex);
+
+    if(unlikely(!st_time)) {
+        st_time = rrdset_create_localhost(
+                "netdata"
+                , "plugin_cgroups_discovery_time"
+                , NULL
+                , "cgroups"
+                , NULL
+                , "NetData CGroups Plugin Discovery Time"
+                , "milliseconds"
+                , PLUGIN_CGROUPS_NAME
+                , "stats"
+                , 132001
+                , update_every
+                , RRDSET_TYPE_LINE
+        );
+
+        rd_duration = rrddim_add(st_time, "duration", NULL, 1, 1000, RRD_ALGORITHM_ABSOLUTE);
+        rd_latency  = rrddim_add(st_time, "latency",  NULL, 1, 1000, RRD_ALGORITHM_ABSOLUTE);
+    }
+    else
+        rrdset_next(st_time);
+
+    rrddim_set_by_pointer(st_time, rd_duration, (collected_number)stats.duration);
+    rrddim_set_by_pointer(st_time, rd_latency,  (collected_number)stats.latency);
+    rrdset_done(st_time);
+
+    if(unlikely(!st_queue)) {
+        st_queue = rrdset_create_localhost(
+                "netdata"
+                , "plugin_cgroups_discovery_queue"
+                , NULL
+                , "cgroups"
+                , NULL
+                , "NetData CGroups Plugin Discovery Queue"
+                , "cgroups"
+                , PLUGIN_CGROUPS_NAME
+                , "stats"
+                , 132002
+                , update_every
+                , RRDSET_TYPE_LINE
+        );
+
+        rd_queued   = rrddim_add(st_queue, "added",    NULL,  1, 1, RRD_ALGORITHM_ABSOLUTE);
+        rd_deferred = rrddim_add(st_queue, "deferred", NULL,  1, 1, RRD_ALGORITHM_ABSOLUTE);
+        rd_removed  = rrddim_add(st_queue, "removed",  NULL, -1, 1, RRD_ALGORITHM_ABSOLUTE);
+    }
+    else
+        rrdset_next(st_queue);
+
+    rrddim_set_by_pointer(st_queue, rd_queued,   (collected_number)stats.queued);
+    rrddim_set_by_pointer(st_queue, rd_deferred, (collected_number)stats.deferred);
+    rrddim_set_by_pointer(st_queue, rd_removed,  (collected_number)stats.removed);
+    rrdset_done(st_queue);
+}
+
 // ----------------------------------------------------------------------------
 // cgroups main
 
@@ -3880,6 +4181,18 @@ static void cgroup_main_cleanup(void *ptr) {
 
     info("cleaning up...");
 
+    if(discovery_thread.thread && !discovery_thread.exited) {
+        info("stopping the cgroups discovery thread...");
+        cgroup_discovery_request();
+
+        // the discovery may be running an external script, do not wait for it forever
+        usec_t max = 2 * USEC_PER_SEC, step = 50000;
+        while(!discovery_thread.exited && max > 0) {
+            max -= step;
+            sleep_usec(step);
+        }
+    }
+
     static_thread->enabled = NETDATA_MAIN_THREAD_EXITED;
 }
 
@@ -3895,6 +4208,20 @@ void *cgroups_main(void *ptr) {
 
     RRDSET *stcpu_thread = NULL;
 
+    if(uv_mutex_init(&cgroup_root_mutex) || uv_mutex_init(&discovery_thread.mutex) || uv_cond_init(&discovery_thread.cond_var)) {
+        error("CGROUP: cannot initialize the cgroups discovery locks. Disabling the cgroups plugin.");
+        goto exit;
+    }
+
+    if(netdata_thread_create(&discovery_thread.thread, "PLUGIN[cgroups-discovery]", NETDATA_THREAD_OPTION_DEFAULT, cgroup_discovery_worker, NULL)) {
+        discovery_thread.thread = 0;
+        error("CGROUP: cannot create the cgroups discovery thread. Disabling the cgroups plugin.");
+        goto exit;
+    }
+
+    // find the cgroups before the first collection
+    cgroup_discovery_request();
+
     heartbeat_t hb;
     heartbeat_init(&hb);
     usec_t step = cgroup_update_every * USEC_PER_SEC;
@@ -3908,13 +4235,15 @@ void *cgroups_main(void *ptr) {
 
         find_dt += hb_dt;
         if(unlikely(find_dt >= find_every || cgroups_check)) {
-            find_all_cgroups();
+            cgroup_discovery_request();
             find_dt = 0;
             cgroups_check = 0;
         }
 
+        uv_mutex_lock(&cgroup_root_mutex);
         read_all_cgroups(cgroup_root);
         update_cgroup_charts(cgroup_update_every);
+        uv_mutex_unlock(&cgroup_root_mutex);
 
         // END -- the job is done
 
@@ -3949,9 +4278,12 @@ void *cgroups_main(void *ptr) {
             rrddim_set(stcpu_thread, "user"  , thread.ru_utime.tv_sec * 1000000ULL + thread.ru_utime.tv_usec);
             rrddim_set(stcpu_thread, "system", thread.ru_stime.tv_sec * 1000000ULL + thread.ru_stime.tv_usec);
             rrdset_done(stcpu_thread);
+
+            update_discovery_charts(cgroup_update_every);
         }
     }
 
+exit:
     netdata_thread_cleanup_pop(1);
     return NULL;
 }
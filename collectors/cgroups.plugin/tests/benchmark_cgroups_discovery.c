@@ -0,0 +1,244 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+/*
+ * Measures the discovery and the collection of cgroups,
+ * using a fake unified cgroups hierarchy created in /tmp.
+ *
+ * compile from the top of a configured and built source tree with
+ *  gcc -O2 -I. -DHAVE_CONFIG_H -DTARGET_OS=1 -o benchmark_cgroups_discovery collectors/cgroups.plugin/tests/benchmark_cgroups_discovery.c \
+ *      database/rrdlabels.o libnetdata/[a-z]*.o libnetdata/[a-z]*[a-z]/[a-z]*.o -pthread -luv -luuid -lz -lm
+ *
+ * run with
+ *  ./benchmark_cgroups_discovery [number of cgroups] [number of cgroups] ...
+ */
+
+#include "../sys_fs_cgroup.c"
+#include "libnetdata/required_dummies.h"
+
+RRDHOST *localhost = NULL;
+int netdata_zero_metrics_enabled = CONFIG_BOOLEAN_YES;
+char *netdata_configured_primary_plugins_dir = NULL;
+
+struct config netdata_config = {
+        .first_section = NULL,
+        .last_section = NULL,
+        .mutex = NETDATA_MUTEX_INITIALIZER,
+        .index = {
+                .avl_tree = {
+                        .root = NULL,
+                        .compar = appconfig_section_compare
+                },
+                .rwlock = AVL_LOCK_INITIALIZER
+        }
+};
+
+// ----------------------------------------------------------------------------
+// doubles of the functions the plugin uses to create charts
+
+void rrdset_is_obsolete(RRDSET *st) { UNUSED(st); }
+void rrdset_isnot_obsolete(RRDSET *st) { UNUSED(st); }
+void rrdset_update_labels(RRDSET *st, struct label *labels) { UNUSED(st); UNUSED(labels); }
+void rrdset_next_usec(RRDSET *st, usec_t microseconds) { UNUSED(st); UNUSED(microseconds); }
+void rrdset_done(RRDSET *st) { UNUSED(st); }
+void update_pressure_chart(struct pressure_chart *chart) { UNUSED(chart); }
+
+RRDSET *rrdset_create_custom(
+    RRDHOST *host, const char *type, const char *id, const char *name, const char *family, const char *context,
+    const char *title, const char *units, const char *plugin, const char *module, long priority, int update_every,
+    RRDSET_TYPE chart_type, RRD_MEMORY_MODE memory_mode, long history_entries)
+{
+    UNUSED(host); UNUSED(type); UNUSED(id); UNUSED(name); UNUSED(family); UNUSED(context); UNUSED(title);
+    UNUSED(units); UNUSED(plugin); UNUSED(module); UNUSED(priority); UNUSED(update_every); UNUSED(chart_type);
+    UNUSED(memory_mode); UNUSED(history_entries);
+    return NULL;
+}
+
+RRDDIM *rrddim_add_custom(
+    RRDSET *st, const char *id, const char *name, collected_number multiplier, collected_number divisor,
+    RRD_ALGORITHM algorithm, RRD_MEMORY_MODE memory_mode)
+{
+    UNUSED(st); UNUSED(id); UNUSED(name); UNUSED(multiplier); UNUSED(divisor); UNUSED(algorithm); UNUSED(memory_mode);
+    return NULL;
+}
+
+collected_number rrddim_set(RRDSET *st, const char *id, collected_number value) {
+    UNUSED(st); UNUSED(id); UNUSED(value);
+    return 0;
+}
+
+collected_number rrddim_set_by_pointer(RRDSET *st, RRDDIM *rd, collected_number value) {
+    UNUSED(st); UNUSED(rd); UNUSED(value);
+    return 0;
+}
+
+RRDSETVAR *rrdsetvar_custom_chart_variable_create(RRDSET *st, const char *name) {
+    UNUSED(st); UNUSED(name);
+    return NULL;
+}
+
+void rrdsetvar_custom_chart_variable_set(RRDSETVAR *rs, calculated_number value) { UNUSED(rs); UNUSED(value); }
+
+void netdev_rename_device_add(const char *host_device, const char *container_device, const char *container_name, struct label *labels) {
+    UNUSED(host_device); UNUSED(container_device); UNUSED(container_name); UNUSED(labels);
+}
+
+void netdev_rename_device_del(const char *host_device) { UNUSED(host_device); }
+
+struct mountinfo *mountinfo_read(int do_statvfs) { UNUSED(do_statvfs); return NULL; }
+struct mountinfo *mountinfo_find_by_filesystem_mount_source(struct mountinfo *root, const char *filesystem, const char *mount_source) {
+    UNUSED(root); UNUSED(filesystem); UNUSED(mount_source);
+    return NULL;
+}
+struct mountinfo *mountinfo_find_by_filesystem_super_option(struct mountinfo *root, const char *filesystem, const char *super_options) {
+    UNUSED(root); UNUSED(filesystem); UNUSED(super_options);
+    return NULL;
+}
+void mountinfo_free_all(struct mountinfo *mi) { UNUSED(mi); }
+
+// ----------------------------------------------------------------------------
+// the fake cgroups hierarchy
+
+static const char *files[][2] = {
+        { "cpu.stat",       "usage_usec 1000\nuser_usec 600\nsystem_usec 400\n" },
+        { "memory.current", "1048576\n" },
+        { "memory.stat",    "anon 1000\nfile 2000\nkernel_stack 100\nslab 200\nsock 0\nshmem 0\nanon_thp 0\nfile_writeback 0\nfile_dirty 0\npgfault 10\npgmajfault 1\n" },
+        { "io.stat",        "8:0 rbytes=1000 wbytes=2000 rios=10 wios=20 dbytes=0 dios=0\n" },
+        { NULL, NULL }
+};
+
+static void cgroups_create(const char *base, size_t count) {
+    char filename[FILENAME_MAX + 1];
+    size_t i, f;
+
+    for(i = 0; i < count ;i++) {
+        snprintfz(filename, FILENAME_MAX, "%s/cgroup%zu.scope", base, i);
+        if(mkdir(filename, 0755) == -1 && errno != EEXIST)
+            fatal("cannot create directory '%s'", filename);
+
+        for(f = 0; files[f][0] ;f++) {
+            snprintfz(filename, FILENAME_MAX, "%s/cgroup%zu.scope/%s", base, i, files[f][0]);
+            FILE *fp = fopen(filename, "w");
+            if(!fp) fatal("cannot create file '%s'", filename);
+            fputs(files[f][1], fp);
+            fclose(fp);
+        }
+    }
+}
+
+static void cgroups_remove(const char *base, size_t count) {
+    char filename[FILENAME_MAX + 1];
+    size_t i, f;
+
+    for(i = 0; i < count ;i++) {
+        for(f = 0; files[f][0] ;f++) {
+            snprintfz(filename, FILENAME_MAX, "%s/cgroup%zu.scope/%s", base, i, files[f][0]);
+            unlink(filename);
+        }
+
+        snprintfz(filename, FILENAME_MAX, "%s/cgroup%zu.scope", base, i);
+        rmdir(filename);
+    }
+}
+
+static usec_t time_read_all_cgroups(int iterations) {
+    usec_t started = now_monotonic_usec();
+
+    int i;
+    for(i = 0; i < iterations ;i++)
+        read_all_cgroups(cgroup_root);
+
+    return (now_monotonic_usec() - started) / iterations;
+}
+
+static void benchmark(const char *base, size_t count) {
+    usec_t started;
+
+    cgroups_create(base, count);
+
+    started = now_monotonic_usec();
+    find_all_cgroups();
+    usec_t first_discovery = now_monotonic_usec() - started;
+
+    started = now_monotonic_usec();
+    find_all_cgroups();
+    usec_t next_discovery = now_monotonic_usec() - started;
+
+    // new cgroups are added disabled, so that the discovery does not run
+    // the network interfaces script for them - enable them for collection
+    struct cgroup *cg;
+    for(cg = cgroup_root; cg ; cg = cg->next)
+        cg->enabled = 1;
+
+    int max_open_files = cgroup_max_open_files;
+
+    cgroup_max_open_files = 0;
+    usec_t read_reopening = time_read_all_cgroups(10);
+
+    cgroup_max_open_files = max_open_files;
+    time_read_all_cgroups(1);
+    usec_t read_open = time_read_all_cgroups(10);
+
+    fprintf(stderr, "%6zu cgroups: first discovery %8.2f ms, next discovery %8.2f ms, "
+                    "read all reopening files %8.2f ms, read all with %d open files %8.2f ms\n"
+            , count
+            , first_discovery / 1000.0
+            , next_discovery / 1000.0
+            , read_reopening / 1000.0
+            , cgroup_open_files
+            , read_open / 1000.0
+    );
+
+    cgroups_remove(base, count);
+    find_all_cgroups();
+}
+
+int main(int argc, char **argv) {
+    size_t sizes[] = { 1000, 5000, 10000, 0 };
+
+    char base[] = "/tmp/netdata-cgroups-benchmark-XXXXXX";
+    if(!mkdtemp(base))
+        fatal("cannot create a temporary directory");
+
+    struct rlimit rl;
+    if(getrlimit(RLIMIT_NOFILE, &rl) == 0) {
+        rl.rlim_cur = rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &rl);
+        getrlimit(RLIMIT_NOFILE, &rl);
+    }
+
+    if(uv_mutex_init(&cgroup_root_mutex))
+        fatal("cannot initialize mutex");
+
+    cgroup_use_unified_cgroups = 1;
+    cgroup_unified_base = base;
+    cgroup_enable_systemd_services = 0;
+    cgroup_enable_pressure_cpu = 0;
+    cgroup_enable_pressure_io_some = 0;
+    cgroup_enable_pressure_io_full = 0;
+    cgroup_enable_pressure_memory_some = 0;
+    cgroup_enable_pressure_memory_full = 0;
+
+    cgroup_enable_new_cgroups_detected_at_runtime = 0;
+    cgroup_root_max = INT_MAX;
+    cgroup_discovery_queue_size = INT_MAX;
+    cgroup_max_open_files = (int)(rl.rlim_cur - 100);
+
+    enabled_cgroup_patterns = simple_pattern_create("*", NULL, SIMPLE_PATTERN_EXACT);
+    enabled_cgroup_paths = simple_pattern_create("*", NULL, SIMPLE_PATTERN_EXACT);
+    enabled_cgroup_renames = NULL;
+    systemd_services_cgroups = NULL;
+
+    if(argc > 1) {
+        int i;
+        for(i = 1; i < argc ;i++)
+            benchmark(base, str2ul(argv[i]));
+    }
+    else {
+        int i;
+        for(i = 0; sizes[i] ;i++)
+            benchmark(base, sizes[i]);
+    }
+
+    rmdir(base);
+    return 0;
+}
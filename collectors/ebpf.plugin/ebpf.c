@@ -13,14 +13,19 @@
  *
  *****************************************************************/
 
-// callback required by eval()
-int health_variable_lookup(const char *variable, uint32_t hash, struct rrdcalc *rc, calculated_number *result)
+// callbacks required by eval()
+struct rrdvar *health_variable_bind(const char *variable, uint32_t hash, struct rrdcalc *rc)
 {
     UNUSED(variable);
     UNUSED(hash);
     UNUSED(rc);
-    UNUSED(result);
-    return 0;
+    return NULL;
+};
+
+calculated_number rrdvar2number(struct rrdvar *rv)
+{
+    UNUSED(rv);
+    return NAN;
 };
 
 void send_statistics(const char *action, const char *action_result, const char *action_data)
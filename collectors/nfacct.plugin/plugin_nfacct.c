@@ -39,13 +39,17 @@ void signals_block(void) {};
 void signals_unblock(void) {};
 void signals_reset(void) {};
 
-// callback required by eval()
-int health_variable_lookup(const char *variable, uint32_t hash, struct rrdcalc *rc, calculated_number *result) {
+// callbacks required by eval()
+struct rrdvar *health_variable_bind(const char *variable, uint32_t hash, struct rrdcalc *rc) {
     (void)variable;
     (void)hash;
     (void)rc;
-    (void)result;
-    return 0;
+    return NULL;
+};
+
+calculated_number rrdvar2number(struct rrdvar *rv) {
+    (void)rv;
+    return NAN;
 };
 
 // required by get_system_cpus()
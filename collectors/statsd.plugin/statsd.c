@@ -8,30 +8,9 @@
 
 // --------------------------------------------------------------------------------------
 
-// #define STATSD_MULTITHREADED 1
-
-#ifdef STATSD_MULTITHREADED
-// DO NOT ENABLE MULTITHREADING - IT IS NOT WELL TESTED
-#define STATSD_AVL_TREE avl_tree_lock
-#define STATSD_AVL_INSERT avl_insert_lock
-#define STATSD_AVL_SEARCH avl_search_lock
-#define STATSD_AVL_INDEX_INIT { .avl_tree = { NULL, statsd_metric_compare }, .rwlock = AVL_LOCK_INITIALIZER }
-#define STATSD_FIRST_PTR_MUTEX netdata_mutex_t first_mutex
-#define STATSD_FIRST_PTR_MUTEX_INIT .first_mutex = NETDATA_MUTEX_INITIALIZER
-#define STATSD_FIRST_PTR_MUTEX_LOCK(index) netdata_mutex_lock(&((index)->first_mutex))
-#define STATSD_FIRST_PTR_MUTEX_UNLOCK(index) netdata_mutex_unlock(&((index)->first_mutex))
-#define STATSD_DICTIONARY_OPTIONS DICTIONARY_FLAG_DEFAULT
-#else
-#define STATSD_AVL_TREE avl_tree_type
-#define STATSD_AVL_INSERT avl_insert
-#define STATSD_AVL_SEARCH avl_search
-#define STATSD_AVL_INDEX_INIT { .root = NULL, .compar = statsd_metric_compare }
-#define STATSD_FIRST_PTR_MUTEX
-#define STATSD_FIRST_PTR_MUTEX_INIT
-#define STATSD_FIRST_PTR_MUTEX_LOCK(index)
-#define STATSD_FIRST_PTR_MUTEX_UNLOCK(index)
-#define STATSD_DICTIONARY_OPTIONS DICTIONARY_FLAG_SINGLE_THREADED
-#endif
+// each index of metrics is split in this many partitions (a power of 2),
+// each with its own lock, selected by the hash of the metric name
+#define STATSD_INDEX_PARTITIONS 64
 
 #define STATSD_DECIMAL_DETAIL 1000 // floating point values get multiplied by this, with the same divisor
 
@@ -46,9 +25,13 @@ typedef struct statsd_metric_counter { // counter and meter
     long long value;
 } STATSD_METRIC_COUNTER;
 
-typedef struct statsd_histogram_extensions {
-    netdata_mutex_t mutex;
+typedef enum statsd_histogram_mode {
+    STATSD_HISTOGRAM_MODE_DEFAULT,  // not set - use the default
+    STATSD_HISTOGRAM_MODE_EXACT,    // keep all the values collected and sort them
+    STATSD_HISTOGRAM_MODE_SKETCH    // add the values collected to a quantile sketch
+} STATSD_HISTOGRAM_MODE;
 
+typedef struct statsd_histogram_extensions {
     // average is stored in metric->last
     collected_number last_min;
     collected_number last_max;
@@ -69,6 +52,8 @@ typedef struct statsd_histogram_extensions {
     size_t size;
     size_t used;
     LONG_DOUBLE *values;   // dynamic array of values collected
+
+    QUANTILE_SKETCH *sketch; // set in sketch mode, instead of the values
 } STATSD_METRIC_HISTOGRAM_EXTENSIONS;
 
 typedef struct statsd_metric_histogram { // histogram and timer
@@ -105,6 +90,44 @@ typedef enum statsd_metric_type {
     STATSD_METRIC_TYPE_SET
 } STATSD_METRIC_TYPE;
 
+#define STATSD_METRIC_TYPES (STATSD_METRIC_TYPE_SET + 1)
+
+
+// --------------------------------------------------------------------------------------------------------------------
+// the values each collector thread has collected for a metric, since the last flush
+// they are merged into the metric by the charting thread, when it flushes the metric
+
+// they are aligned and padded to cache lines, so that the values
+// of different threads do not share cache lines
+#define STATSD_CACHE_LINE_SIZE 64
+
+typedef struct statsd_metric_thread {
+    netdata_mutex_t mutex;          // uncontended - the collector thread holds it to update the values
+                                    // and the charting thread holds it to merge them into the metric
+
+    size_t count;                   // the number of events collected since the last merge
+
+    union {
+        struct {
+            LONG_DOUBLE value;      // the last value set
+            LONG_DOUBLE delta;      // the sum of the increments/decrements received after it
+            usec_t set_ut;          // the time the value was set, 0 when it has not been set
+            usec_t delta_ut;        // the time the last increment/decrement was received
+        } gauge;
+
+        long long counter;          // counter and meter
+
+        struct {
+            size_t size;
+            size_t used;
+            LONG_DOUBLE *values;
+            QUANTILE_SKETCH *sketch;
+        } histogram;                // histogram and timer
+
+        DICTIONARY *set;
+    };
+} __attribute__ ((aligned (STATSD_CACHE_LINE_SIZE))) STATSD_METRIC_THREAD;
+
 
 typedef struct statsd_metric {
     avl avl;                        // indexing - has to be first
@@ -118,6 +141,8 @@ typedef struct statsd_metric {
     collected_number events;        // the number of times this metric has been collected (never resets)
     size_t count;                   // the number of times this metric has been collected since the last flush
 
+    STATSD_METRIC_THREAD **threads; // the values collected by each collector thread (allocated by the thread)
+
     // the actual collected data
     union {
         STATSD_METRIC_GAUGE gauge;
@@ -128,7 +153,7 @@ typedef struct statsd_metric {
 
     // chart related members
     STATS_METRIC_OPTIONS options;   // STATSD_METRIC_OPTION_* (bitfield)
-    char reset;                     // set to 1 by the charting thread to instruct the collector thread(s) to reset this metric
+    char reset;                     // set to 1 by the charting thread to reset this metric before merging new values
     collected_number last;          // the last value sent to netdata
     RRDSET *st;                     // the private chart of this metric
     RRDDIM *rd_value;               // the dimension of this metric value
@@ -149,11 +174,11 @@ typedef struct statsd_index {
     size_t metrics;                 // the number of metrics in this index
     size_t useful;                  // the number of useful metrics in this index
 
-    STATSD_AVL_TREE index;          // the AVL tree
+    avl_tree_lock index[STATSD_INDEX_PARTITIONS]; // the AVL trees, one per partition
 
     STATSD_METRIC *first;           // the linked list of metrics (new metrics are added in front)
     STATSD_METRIC *first_useful;    // the linked list of useful metrics (new metrics are added in front)
-    STATSD_FIRST_PTR_MUTEX;         // when mutli-threading is enabled, a lock to protect the linked list
+    netdata_mutex_t first_mutex;    // a lock to protect the linked list of metrics
 
     STATS_METRIC_OPTIONS default_options;  // default options for all metrics in this index
 } STATSD_INDEX;
@@ -221,6 +246,9 @@ typedef struct statsd_app {
     DICTIONARY *dict;
     long rrd_history_entries;
 
+    STATSD_HISTOGRAM_MODE histogram_mode;
+    double histogram_sketch_accuracy;
+
     const char *source;
     STATSD_APP_CHART *charts;
     struct statsd_app *next;
@@ -231,13 +259,30 @@ typedef struct statsd_app {
 
 struct collection_thread_status {
     int status;
+    int id;                         // the index of this thread in statsd.collection_threads_status
     size_t max_sockets;
 
+    // counters updated only by this thread - the charting thread sums them
+    size_t events[STATSD_METRIC_TYPES];
+    size_t tcp_socket_reads;
+    size_t tcp_packets_received;
+    size_t tcp_bytes_read;
+    size_t udp_socket_reads;
+    size_t udp_packets_received;
+    size_t udp_bytes_read;
+
+    LISTEN_SOCKETS *sockets;        // the sockets this thread receives metrics from
+    LISTEN_SOCKETS own_sockets;     // the sockets of this thread, when it does not share them with the others
+
+    // the packets the kernel dropped on each UDP socket of this thread, because its receive buffer was full
+    uint32_t udp_socket_drops[MAX_LISTEN_FDS];
+
     netdata_thread_t thread;
     struct rusage rusage;
     RRDSET *st_cpu;
     RRDDIM *rd_user;
     RRDDIM *rd_system;
+    RRDDIM *rd_udp_drops;
 };
 
 static struct statsd {
@@ -277,8 +322,11 @@ static struct statsd {
     size_t histogram_increase_step;
     double histogram_percentile;
     char *histogram_percentile_str;
+    STATSD_HISTOGRAM_MODE histogram_mode;
+    double histogram_sketch_accuracy;
 
     int threads;
+    int sockets_per_thread;
     struct collection_thread_status *collection_threads_status;
 
     LISTEN_SOCKETS sockets;
@@ -294,63 +342,60 @@ static struct statsd {
                 .name = "gauge",
                 .events = 0,
                 .metrics = 0,
-                .index = STATSD_AVL_INDEX_INIT,
                 .default_options = STATSD_METRIC_OPTION_NONE,
                 .first = NULL,
-                STATSD_FIRST_PTR_MUTEX_INIT
+                .first_mutex = NETDATA_MUTEX_INITIALIZER
         },
         .counters   = {
                 .name = "counter",
                 .events = 0,
                 .metrics = 0,
-                .index = STATSD_AVL_INDEX_INIT,
                 .default_options = STATSD_METRIC_OPTION_NONE,
                 .first = NULL,
-                STATSD_FIRST_PTR_MUTEX_INIT
+                .first_mutex = NETDATA_MUTEX_INITIALIZER
         },
         .timers     = {
                 .name = "timer",
                 .events = 0,
                 .metrics = 0,
-                .index = STATSD_AVL_INDEX_INIT,
                 .default_options = STATSD_METRIC_OPTION_NONE,
                 .first = NULL,
-                STATSD_FIRST_PTR_MUTEX_INIT
+                .first_mutex = NETDATA_MUTEX_INITIALIZER
         },
         .histograms = {
                 .name = "histogram",
                 .events = 0,
                 .metrics = 0,
-                .index = STATSD_AVL_INDEX_INIT,
                 .default_options = STATSD_METRIC_OPTION_NONE,
                 .first = NULL,
-                STATSD_FIRST_PTR_MUTEX_INIT
+                .first_mutex = NETDATA_MUTEX_INITIALIZER
         },
         .meters     = {
                 .name = "meter",
                 .events = 0,
                 .metrics = 0,
-                .index = STATSD_AVL_INDEX_INIT,
                 .default_options = STATSD_METRIC_OPTION_NONE,
                 .first = NULL,
-                STATSD_FIRST_PTR_MUTEX_INIT
+                .first_mutex = NETDATA_MUTEX_INITIALIZER
         },
         .sets       = {
                 .name = "set",
                 .events = 0,
                 .metrics = 0,
-                .index = STATSD_AVL_INDEX_INIT,
                 .default_options = STATSD_METRIC_OPTION_NONE,
                 .first = NULL,
-                STATSD_FIRST_PTR_MUTEX_INIT
+                .first_mutex = NETDATA_MUTEX_INITIALIZER
         },
 
         .tcp_idle_timeout = 600,
 
         .apps = NULL,
         .histogram_percentile = 95.0,
+        .histogram_mode = STATSD_HISTOGRAM_MODE_EXACT,
+        .histogram_sketch_accuracy = 1.0,
         .histogram_increase_step = 10,
         .threads = 0,
+        .sockets_per_thread = 1,
         .collection_threads_status = NULL,
         .sockets = {
                 .config          = &netdata_config,
@@ -365,18 +410,48 @@ static struct statsd {
 // --------------------------------------------------------------------------------------------------------------------
 // statsd index management - add/find metrics
 
+// the collector thread running on this thread (NULL on all other threads)
+static __thread struct collection_thread_status *statsd_collector = NULL;
+
 static int statsd_metric_compare(void* a, void* b) {
     if(((STATSD_METRIC *)a)->hash < ((STATSD_METRIC *)b)->hash) return -1;
     else if(((STATSD_METRIC *)a)->hash > ((STATSD_METRIC *)b)->hash) return 1;
     else return strcmp(((STATSD_METRIC *)a)->name, ((STATSD_METRIC *)b)->name);
 }
 
+static void statsd_index_init(STATSD_INDEX *index) {
+    int i;
+    for(i = 0; i < STATSD_INDEX_PARTITIONS ;i++)
+        avl_init_lock(&index->index[i], statsd_metric_compare);
+}
+
+static inline avl_tree_lock *statsd_index_partition(STATSD_INDEX *index, uint32_t hash) {
+    return &index->index[hash & (STATSD_INDEX_PARTITIONS - 1)];
+}
+
 static inline STATSD_METRIC *statsd_metric_index_find(STATSD_INDEX *index, const char *name, uint32_t hash) {
     STATSD_METRIC tmp;
     tmp.name = name;
     tmp.hash = (hash)?hash:simple_hash(tmp.name);
 
-    return (STATSD_METRIC *)STATSD_AVL_SEARCH(&index->index, (avl *)&tmp);
+    return (STATSD_METRIC *)avl_search_lock(statsd_index_partition(index, tmp.hash), (avl *)&tmp);
+}
+
+// the mode of a new histogram or timer - the last app matching it that sets one, or the default
+static STATSD_HISTOGRAM_MODE statsd_histogram_mode_for_metric(const char *name, double *accuracy) {
+    STATSD_HISTOGRAM_MODE mode = statsd.histogram_mode;
+    *accuracy = statsd.histogram_sketch_accuracy;
+
+    STATSD_APP *app;
+    for(app = statsd.apps; app ;app = app->next) {
+        if(app->histogram_mode != STATSD_HISTOGRAM_MODE_DEFAULT && simple_pattern_matches(app->metrics, name)) {
+            mode = app->histogram_mode;
+            if(app->histogram_sketch_accuracy > 0.0)
+                *accuracy = app->histogram_sketch_accuracy;
+        }
+    }
+
+    return mode;
 }
 
 static inline STATSD_METRIC *statsd_find_or_add_metric(STATSD_INDEX *index, const char *name, STATSD_METRIC_TYPE type) {
@@ -393,31 +468,65 @@ static inline STATSD_METRIC *statsd_find_or_add_metric(STATSD_INDEX *index, cons
         m->hash = hash;
         m->type = type;
         m->options = index->default_options;
+        m->threads = callocz((size_t)statsd.threads, sizeof(STATSD_METRIC_THREAD *));
 
         if(type == STATSD_METRIC_TYPE_HISTOGRAM || type == STATSD_METRIC_TYPE_TIMER) {
             m->histogram.ext = callocz(sizeof(STATSD_METRIC_HISTOGRAM_EXTENSIONS), 1);
-            netdata_mutex_init(&m->histogram.ext->mutex);
+
+            double accuracy;
+            if(statsd_histogram_mode_for_metric(name, &accuracy) == STATSD_HISTOGRAM_MODE_SKETCH) {
+                m->histogram.ext->sketch = callocz(sizeof(QUANTILE_SKETCH), 1);
+                quantile_sketch_init(m->histogram.ext->sketch, accuracy / 100.0, QUANTILE_SKETCH_DEFAULT_MAX_BUCKETS);
+            }
         }
-        STATSD_METRIC *n = (STATSD_METRIC *)STATSD_AVL_INSERT(&index->index, (avl *)m);
+
+        STATSD_METRIC *n = (STATSD_METRIC *)avl_insert_lock(statsd_index_partition(index, hash), (avl *)m);
         if(unlikely(n != m)) {
+            if(m->histogram.ext && m->histogram.ext->sketch) {
+                quantile_sketch_free(m->histogram.ext->sketch);
+                freez(m->histogram.ext->sketch);
+            }
             freez((void *)m->histogram.ext);
+            freez((void *)m->threads);
             freez((void *)m->name);
             freez((void *)m);
             m = n;
         }
         else {
-            STATSD_FIRST_PTR_MUTEX_LOCK(index);
+            netdata_mutex_lock(&index->first_mutex);
             index->metrics++;
             m->next = index->first;
             index->first = m;
-            STATSD_FIRST_PTR_MUTEX_UNLOCK(index);
+            netdata_mutex_unlock(&index->first_mutex);
         }
     }
 
-    index->events++;
+    statsd_collector->events[type]++;
     return m;
 }
 
+// returns the values of the metric for the calling collector thread, locked
+static inline STATSD_METRIC_THREAD *statsd_metric_thread_lock(STATSD_METRIC *m) {
+    STATSD_METRIC_THREAD *t = m->threads[statsd_collector->id];
+
+    if(unlikely(!t)) {
+        int ret = posix_memalign((void *)&t, STATSD_CACHE_LINE_SIZE, sizeof(STATSD_METRIC_THREAD));
+        if(unlikely(ret))
+            fatal("STATSD: posix_memalign: %s", strerror(ret));
+
+        memset(t, 0, sizeof(STATSD_METRIC_THREAD));
+        netdata_mutex_init(&t->mutex);
+        __atomic_store_n(&m->threads[statsd_collector->id], t, __ATOMIC_RELEASE);
+    }
+
+    netdata_mutex_lock(&t->mutex);
+    return t;
+}
+
+static inline void statsd_metric_thread_unlock(STATSD_METRIC_THREAD *t) {
+    netdata_mutex_unlock(&t->mutex);
+}
+
 
 // --------------------------------------------------------------------------------------------------------------------
 // statsd parsing numbers
@@ -463,11 +572,6 @@ static inline long long statsd_parse_int(const char *v, long long def) {
 // --------------------------------------------------------------------------------------------------------------------
 // statsd processors per metric type
 
-static inline void statsd_reset_metric(STATSD_METRIC *m) {
-    m->reset = 0;
-    m->count = 0;
-}
-
 static inline int value_is_zinit(const char *value) {
     return (value && *value == 'z' && *++value == 'i' && *++value == 'n' && *++value == 'i' && *++value == 't' && *++value == '\0');
 }
@@ -483,22 +587,24 @@ static inline void statsd_process_gauge(STATSD_METRIC *m, const char *value, con
         return;
     }
 
-    if(unlikely(m->reset)) {
-        // no need to reset anything specific for gauges
-        statsd_reset_metric(m);
-    }
-
     if(unlikely(value_is_zinit(value))) {
         // magic loading of metric, without affecting anything
     }
     else {
-        if (unlikely(*value == '+' || *value == '-'))
-            m->gauge.value += statsd_parse_float(value, 1.0) / statsd_parse_sampling_rate(sampling);
-        else
-            m->gauge.value = statsd_parse_float(value, 1.0);
+        STATSD_METRIC_THREAD *t = statsd_metric_thread_lock(m);
+
+        if (unlikely(*value == '+' || *value == '-')) {
+            t->gauge.delta += statsd_parse_float(value, 1.0) / statsd_parse_sampling_rate(sampling);
+            t->gauge.delta_ut = now_monotonic_usec();
+        }
+        else {
+            t->gauge.value = statsd_parse_float(value, 1.0);
+            t->gauge.delta = 0;
+            t->gauge.set_ut = now_monotonic_usec();
+        }
 
-        m->events++;
-        m->count++;
+        t->count++;
+        statsd_metric_thread_unlock(t);
     }
 }
 
@@ -507,16 +613,16 @@ static inline void statsd_process_counter_or_meter(STATSD_METRIC *m, const char
 
     // we accept empty values for counters
 
-    if(unlikely(m->reset)) statsd_reset_metric(m);
-
     if(unlikely(value_is_zinit(value))) {
         // magic loading of metric, without affecting anything
     }
     else {
-        m->counter.value += llrintl((LONG_DOUBLE) statsd_parse_int(value, 1) / statsd_parse_sampling_rate(sampling));
+        long long v = llrintl((LONG_DOUBLE) statsd_parse_int(value, 1) / statsd_parse_sampling_rate(sampling));
 
-        m->events++;
-        m->count++;
+        STATSD_METRIC_THREAD *t = statsd_metric_thread_lock(m);
+        t->counter += v;
+        t->count++;
+        statsd_metric_thread_unlock(t);
     }
 }
 
@@ -531,11 +637,6 @@ static inline void statsd_process_histogram_or_timer(STATSD_METRIC *m, const cha
         return;
     }
 
-    if(unlikely(m->reset)) {
-        m->histogram.ext->used = 0;
-        statsd_reset_metric(m);
-    }
-
     if(unlikely(value_is_zinit(value))) {
         // magic loading of metric, without affecting anything
     }
@@ -545,21 +646,35 @@ static inline void statsd_process_histogram_or_timer(STATSD_METRIC *m, const cha
         if(unlikely(isless(sampling_rate, 0.01))) sampling_rate = 0.01;
         if(unlikely(isgreater(sampling_rate, 1.0))) sampling_rate = 1.0;
 
+        STATSD_METRIC_THREAD *t = statsd_metric_thread_lock(m);
+
+        if(m->histogram.ext->sketch) {
+            // weight the value by the sampling rate, instead of repeating it
+            if(unlikely(!t->histogram.sketch)) {
+                t->histogram.sketch = callocz(sizeof(QUANTILE_SKETCH), 1);
+                quantile_sketch_init(t->histogram.sketch, m->histogram.ext->sketch->relative_accuracy, m->histogram.ext->sketch->max_buckets);
+            }
+
+            quantile_sketch_add(t->histogram.sketch, v, (double)(1.0 / sampling_rate));
+
+            t->count++;
+            statsd_metric_thread_unlock(t);
+            return;
+        }
+
         long long samples = llrintl(1.0 / sampling_rate);
         while(samples-- > 0) {
 
-            if(unlikely(m->histogram.ext->used == m->histogram.ext->size)) {
-                netdata_mutex_lock(&m->histogram.ext->mutex);
-                m->histogram.ext->size += statsd.histogram_increase_step;
-                m->histogram.ext->values = reallocz(m->histogram.ext->values, sizeof(LONG_DOUBLE) * m->histogram.ext->size);
-                netdata_mutex_unlock(&m->histogram.ext->mutex);
+            if(unlikely(t->histogram.used == t->histogram.size)) {
+                t->histogram.size += statsd.histogram_increase_step;
+                t->histogram.values = reallocz(t->histogram.values, sizeof(LONG_DOUBLE) * t->histogram.size);
             }
 
-            m->histogram.ext->values[m->histogram.ext->used++] = v;
+            t->histogram.values[t->histogram.used++] = v;
         }
 
-        m->events++;
-        m->count++;
+        t->count++;
+        statsd_metric_thread_unlock(t);
     }
 }
 
@@ -574,31 +689,20 @@ static inline void statsd_process_set(STATSD_METRIC *m, const char *value) {
         return;
     }
 
-    if(unlikely(m->reset)) {
-        if(likely(m->set.dict)) {
-            dictionary_destroy(m->set.dict);
-            m->set.dict = NULL;
-        }
-        statsd_reset_metric(m);
-    }
-
-    if (unlikely(!m->set.dict)) {
-        m->set.dict   = dictionary_create(STATSD_DICTIONARY_OPTIONS | DICTIONARY_FLAG_VALUE_LINK_DONT_CLONE);
-        m->set.unique = 0;
-    }
-
     if(unlikely(value_is_zinit(value))) {
         // magic loading of metric, without affecting anything
     }
     else {
-        void *t = dictionary_get(m->set.dict, value);
-        if (unlikely(!t)) {
-            dictionary_set(m->set.dict, value, NULL, 1);
-            m->set.unique++;
-        }
+        STATSD_METRIC_THREAD *t = statsd_metric_thread_lock(m);
+
+        if (unlikely(!t->set))
+            t->set = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED | DICTIONARY_FLAG_VALUE_LINK_DONT_CLONE | DICTIONARY_FLAG_HASH_TABLE);
 
-        m->events++;
-        m->count++;
+        if (unlikely(!dictionary_get(t->set, value)))
+            dictionary_set(t->set, value, NULL, 1);
+
+        t->count++;
+        statsd_metric_thread_unlock(t);
     }
 }
 
@@ -649,7 +753,7 @@ static void statsd_process_metric(const char *name, const char *value, const cha
                 value, sampling);
     }
     else {
-        statsd.unknown_types++;
+        __atomic_fetch_add(&statsd.unknown_types, 1, __ATOMIC_RELAXED);
         error("STATSD: metric '%s' with value '%s' is sent with unknown metric type '%s'", name, value?value:"", type);
     }
 }
@@ -749,6 +853,34 @@ static inline size_t statsd_process(char *buffer, size_t size, int require_newli
 // --------------------------------------------------------------------------------------------------------------------
 // statsd pollfd interface
 
+#ifdef SO_RXQ_OVFL
+// the kernel reports the total number of packets dropped on a socket, with every message received after a drop
+// the drops of the shared sockets are counted once, on the first thread, whichever thread received them
+static inline void statsd_udp_socket_drops(int fd, struct msghdr *msg) {
+    struct cmsghdr *cmsg;
+    for(cmsg = CMSG_FIRSTHDR(msg); cmsg ; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if(cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SO_RXQ_OVFL) {
+            LISTEN_SOCKETS *sockets = statsd_collector->sockets;
+            struct collection_thread_status *owner =
+                    (sockets == &statsd.sockets) ? &statsd.collection_threads_status[0] : statsd_collector;
+
+            size_t i;
+            for(i = 0; i < sockets->opened ;i++) {
+                if(sockets->fds[i] == fd) {
+                    uint32_t drops;
+                    memcpy(&drops, CMSG_DATA(cmsg), sizeof(uint32_t));
+
+                    // threads sharing a socket may report its counter out of order
+                    uint32_t old = __atomic_load_n(&owner->udp_socket_drops[i], __ATOMIC_RELAXED);
+                    while(drops > old && !__atomic_compare_exchange_n(&owner->udp_socket_drops[i], &old, drops, 0, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) ;
+                    break;
+                }
+            }
+        }
+    }
+}
+#endif
+
 #define STATSD_TCP_BUFFER_SIZE 65536 // minimize tcp reads
 #define STATSD_UDP_BUFFER_SIZE 9000  // this should be up to MTU
 
@@ -764,6 +896,10 @@ struct statsd_tcp {
     char buffer[];
 };
 
+#ifdef SO_RXQ_OVFL
+#define STATSD_UDP_CONTROL_SIZE CMSG_SPACE(sizeof(uint32_t))
+#endif
+
 #ifdef HAVE_RECVMMSG
 struct statsd_udp {
     int *running;
@@ -771,6 +907,9 @@ struct statsd_udp {
     size_t size;
     struct iovec *iovecs;
     struct mmsghdr *msgs;
+#ifdef SO_RXQ_OVFL
+    char *controls;                 // the ancillary data of each message, for SO_RXQ_OVFL
+#endif
 };
 #else
 struct statsd_udp {
@@ -790,8 +929,8 @@ static void *statsd_add_callback(POLLINFO *pi, short int *events, void *data) {
     struct statsd_tcp *t = (struct statsd_tcp *)callocz(sizeof(struct statsd_tcp) + STATSD_TCP_BUFFER_SIZE, 1);
     t->type = STATSD_SOCKET_DATA_TYPE_TCP;
     t->size = STATSD_TCP_BUFFER_SIZE - 1;
-    statsd.tcp_socket_connects++;
-    statsd.tcp_socket_connected++;
+    __atomic_fetch_add(&statsd.tcp_socket_connects, 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&statsd.tcp_socket_connected, 1, __ATOMIC_RELAXED);
 
     return t;
 }
@@ -803,12 +942,12 @@ static void statsd_del_callback(POLLINFO *pi) {
     if(likely(t)) {
         if(t->type == STATSD_SOCKET_DATA_TYPE_TCP) {
             if(t->len != 0) {
-                statsd.socket_errors++;
+                __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                 error("STATSD: client is probably sending unterminated metrics. Closed socket left with '%s'. Trying to process it.", t->buffer);
                 statsd_process(t->buffer, t->len, 0);
             }
-            statsd.tcp_socket_disconnects++;
-            statsd.tcp_socket_connected--;
+            __atomic_fetch_add(&statsd.tcp_socket_disconnects, 1, __ATOMIC_RELAXED);
+            __atomic_fetch_sub(&statsd.tcp_socket_connected, 1, __ATOMIC_RELAXED);
         }
         else
             error("STATSD: internal error: received socket data type is %d, but expected %d", (int)t->type, (int)STATSD_SOCKET_DATA_TYPE_TCP);
@@ -828,14 +967,14 @@ static int statsd_rcv_callback(POLLINFO *pi, short int *events) {
             struct statsd_tcp *d = (struct statsd_tcp *)pi->data;
             if(unlikely(!d)) {
                 error("STATSD: internal error: expected TCP data pointer is NULL");
-                statsd.socket_errors++;
+                __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                 return -1;
             }
 
 #ifdef NETDATA_INTERNAL_CHECKS
             if(unlikely(d->type != STATSD_SOCKET_DATA_TYPE_TCP)) {
                 error("STATSD: internal error: socket data type should be %d, but it is %d", (int)STATSD_SOCKET_DATA_TYPE_TCP, (int)d->type);
-                statsd.socket_errors++;
+                __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                 return -1;
             }
 #endif
@@ -848,7 +987,7 @@ static int statsd_rcv_callback(POLLINFO *pi, short int *events) {
                     // read failed
                     if (errno != EWOULDBLOCK && errno != EAGAIN && errno != EINTR) {
                         error("STATSD: recv() on TCP socket %d failed.", fd);
-                        statsd.socket_errors++;
+                        __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                         ret = -1;
                     }
                 }
@@ -860,12 +999,12 @@ static int statsd_rcv_callback(POLLINFO *pi, short int *events) {
                 else {
                     // data received
                     d->len += rc;
-                    statsd.tcp_socket_reads++;
-                    statsd.tcp_bytes_read += rc;
+                    statsd_collector->tcp_socket_reads++;
+                    statsd_collector->tcp_bytes_read += rc;
                 }
 
                 if(likely(d->len > 0)) {
-                    statsd.tcp_packets_received++;
+                    statsd_collector->tcp_packets_received++;
                     d->len = statsd_process(d->buffer, d->len, 1);
                 }
 
@@ -880,14 +1019,14 @@ static int statsd_rcv_callback(POLLINFO *pi, short int *events) {
             struct statsd_udp *d = (struct statsd_udp *)pi->data;
             if(unlikely(!d)) {
                 error("STATSD: internal error: expected UDP data pointer is NULL");
-                statsd.socket_errors++;
+                __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                 return -1;
             }
 
 #ifdef NETDATA_INTERNAL_CHECKS
             if(unlikely(d->type != STATSD_SOCKET_DATA_TYPE_UDP)) {
                 error("STATSD: internal error: socket data should be %d, but it is %d", (int)d->type, (int)STATSD_SOCKET_DATA_TYPE_UDP);
-                statsd.socket_errors++;
+                __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                 return -1;
             }
 #endif
@@ -895,25 +1034,37 @@ static int statsd_rcv_callback(POLLINFO *pi, short int *events) {
 #ifdef HAVE_RECVMMSG
             ssize_t rc;
             do {
+#ifdef SO_RXQ_OVFL
+                // the kernel updates these on every call
+                size_t m;
+                for (m = 0; m < d->size; m++)
+                    d->msgs[m].msg_hdr.msg_controllen = STATSD_UDP_CONTROL_SIZE;
+#endif
+
                 rc = recvmmsg(fd, d->msgs, (unsigned int)d->size, MSG_DONTWAIT, NULL);
                 if (rc < 0) {
                     // read failed
                     if (errno != EWOULDBLOCK && errno != EAGAIN && errno != EINTR) {
                         error("STATSD: recvmmsg() on UDP socket %d failed.", fd);
-                        statsd.socket_errors++;
+                        __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                         return -1;
                     }
                 } else if (rc) {
                     // data received
-                    statsd.udp_socket_reads++;
-                    statsd.udp_packets_received += rc;
+                    statsd_collector->udp_socket_reads++;
+                    statsd_collector->udp_packets_received += rc;
 
                     size_t i;
                     for (i = 0; i < (size_t)rc; ++i) {
                         size_t len = (size_t)d->msgs[i].msg_len;
-                        statsd.udp_bytes_read += len;
+                        statsd_collector->udp_bytes_read += len;
                         statsd_process(d->msgs[i].msg_hdr.msg_iov->iov_base, len, 0);
                     }
+
+#ifdef SO_RXQ_OVFL
+                    // the last message has the latest number of packets dropped on this socket
+                    statsd_udp_socket_drops(fd, &d->msgs[rc - 1].msg_hdr);
+#endif
                 }
             } while (rc != -1);
 
@@ -925,14 +1076,14 @@ static int statsd_rcv_callback(POLLINFO *pi, short int *events) {
                     // read failed
                     if (errno != EWOULDBLOCK && errno != EAGAIN && errno != EINTR) {
                         error("STATSD: recv() on UDP socket %d failed.", fd);
-                        statsd.socket_errors++;
+                        __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
                         return -1;
                     }
                 } else if (rc) {
                     // data received
-                    statsd.udp_socket_reads++;
-                    statsd.udp_packets_received++;
-                    statsd.udp_bytes_read += rc;
+                    statsd_collector->udp_socket_reads++;
+                    statsd_collector->udp_packets_received++;
+                    statsd_collector->udp_bytes_read += rc;
                     statsd_process(d->buffer, (size_t) rc, 0);
                 }
             } while (rc != -1);
@@ -943,7 +1094,7 @@ static int statsd_rcv_callback(POLLINFO *pi, short int *events) {
 
         default: {
             error("STATSD: internal error: unknown socktype %d on socket %d", pi->socktype, fd);
-            statsd.socket_errors++;
+            __atomic_fetch_add(&statsd.socket_errors, 1, __ATOMIC_RELAXED);
             return -1;
         }
     }
@@ -980,6 +1131,9 @@ void statsd_collector_thread_cleanup(void *data) {
 
     freez(d->iovecs);
     freez(d->msgs);
+#ifdef SO_RXQ_OVFL
+    freez(d->controls);
+#endif
 #endif
 
     freez(d);
@@ -988,6 +1142,7 @@ void statsd_collector_thread_cleanup(void *data) {
 void *statsd_collector_thread(void *ptr) {
     struct collection_thread_status *status = ptr;
     status->status = 1;
+    statsd_collector = status;
 
     info("STATSD collector thread started with taskid %d", gettid());
 
@@ -1002,16 +1157,24 @@ void *statsd_collector_thread(void *ptr) {
     d->iovecs = callocz(sizeof(struct iovec), d->size);
     d->msgs = callocz(sizeof(struct mmsghdr), d->size);
 
+#ifdef SO_RXQ_OVFL
+    d->controls = callocz(d->size, STATSD_UDP_CONTROL_SIZE);
+#endif
+
     size_t i;
     for (i = 0; i < d->size; i++) {
         d->iovecs[i].iov_base = mallocz(STATSD_UDP_BUFFER_SIZE);
         d->iovecs[i].iov_len = STATSD_UDP_BUFFER_SIZE - 1;
         d->msgs[i].msg_hdr.msg_iov = &d->iovecs[i];
         d->msgs[i].msg_hdr.msg_iovlen = 1;
+#ifdef SO_RXQ_OVFL
+        d->msgs[i].msg_hdr.msg_control = &d->controls[i * STATSD_UDP_CONTROL_SIZE];
+        d->msgs[i].msg_hdr.msg_controllen = STATSD_UDP_CONTROL_SIZE;
+#endif
     }
 #endif
 
-    poll_events(&statsd.sockets
+    poll_events(status->sockets
             , statsd_add_callback
             , statsd_del_callback
             , statsd_rcv_callback
@@ -1037,6 +1200,19 @@ void *statsd_collector_thread(void *ptr) {
 
 #define STATSD_CONF_LINE_MAX 8192
 
+static STATSD_HISTOGRAM_MODE statsd_histogram_mode_id(const char *name) {
+    if(!strcmp(name, "exact")) return STATSD_HISTOGRAM_MODE_EXACT;
+    if(!strcmp(name, "sketch")) return STATSD_HISTOGRAM_MODE_SKETCH;
+    return STATSD_HISTOGRAM_MODE_DEFAULT;
+}
+
+static const char *statsd_histogram_mode_name(STATSD_HISTOGRAM_MODE mode) {
+    switch(mode) {
+        case STATSD_HISTOGRAM_MODE_SKETCH: return "sketch";
+        default: return "exact";
+    }
+}
+
 static STATSD_APP_CHART_DIM_VALUE_TYPE string2valuetype(const char *type, size_t line, const char *filename) {
     if(!type || !*type) type = "last";
 
@@ -1192,7 +1368,7 @@ static int statsd_readfile(const char *filename, STATSD_APP *app, STATSD_APP_CHA
             else if(app) {
                 if(!strcmp(s, "dictionary")) {
                     if(!app->dict)
-                        app->dict = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED);
+                        app->dict = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED | DICTIONARY_FLAG_HASH_TABLE);
 
                     dict = app->dict;
                 }
@@ -1288,6 +1464,18 @@ static int statsd_readfile(const char *filename, STATSD_APP *app, STATSD_APP_CHA
                 if (app->rrd_history_entries < 5)
                     app->rrd_history_entries = 5;
             }
+            else if (!strcmp(name, "histograms and timers mode")) {
+                app->histogram_mode = statsd_histogram_mode_id(value);
+                if (app->histogram_mode == STATSD_HISTOGRAM_MODE_DEFAULT)
+                    error("STATSD: invalid histograms and timers mode '%s' at line %zu of file '%s'.", value, line, filename);
+            }
+            else if (!strcmp(name, "histograms and timers sketch relative accuracy")) {
+                app->histogram_sketch_accuracy = str2ld(value, NULL);
+                if (!isgreater(app->histogram_sketch_accuracy, 0) || !isless(app->histogram_sketch_accuracy, 100)) {
+                    error("STATSD: invalid histograms and timers sketch relative accuracy '%s' at line %zu of file '%s'.", value, line, filename);
+                    app->histogram_sketch_accuracy = 0.0;
+                }
+            }
             else {
                 error("STATSD: ignoring line %zu ('%s') of file '%s'. Unknown keyword for the [app] section.", line, name, filename);
                 continue;
@@ -1654,6 +1842,144 @@ static inline void statsd_private_chart_timer_or_histogram(STATSD_METRIC *m, con
     rrdset_done(m->st);
 }
 
+// --------------------------------------------------------------------------------------------------------------------
+// statsd merge the values collected by the collector threads
+
+static int statsd_merge_set_value(char *name, void *entry, void *data) {
+    (void)entry;
+    STATSD_METRIC *m = data;
+
+    if(unlikely(!dictionary_get(m->set.dict, name))) {
+        dictionary_set(m->set.dict, name, NULL, 1);
+        m->set.unique++;
+    }
+
+    return 0;
+}
+
+static inline void statsd_merge_histogram_values(STATSD_METRIC *m, STATSD_METRIC_THREAD *t) {
+    STATSD_METRIC_HISTOGRAM_EXTENSIONS *ext = m->histogram.ext;
+
+    if(ext->sketch) {
+        if(likely(t->histogram.sketch)) {
+            quantile_sketch_merge(ext->sketch, t->histogram.sketch);
+            quantile_sketch_reset(t->histogram.sketch);
+        }
+        return;
+    }
+
+    if(unlikely(ext->used + t->histogram.used > ext->size)) {
+        ext->size = ext->used + t->histogram.used + statsd.histogram_increase_step;
+        ext->values = reallocz(ext->values, sizeof(LONG_DOUBLE) * ext->size);
+    }
+
+    memcpy(&ext->values[ext->used], t->histogram.values, sizeof(LONG_DOUBLE) * t->histogram.used);
+    ext->used += t->histogram.used;
+    t->histogram.used = 0;
+}
+
+static inline void statsd_merge_metric(STATSD_METRIC *m) {
+    if(unlikely(m->reset)) {
+        // the charting thread has used the values of the last flush
+        if(m->type == STATSD_METRIC_TYPE_HISTOGRAM || m->type == STATSD_METRIC_TYPE_TIMER) {
+            m->histogram.ext->used = 0;
+            if(m->histogram.ext->sketch)
+                quantile_sketch_reset(m->histogram.ext->sketch);
+        }
+
+        else if(m->type == STATSD_METRIC_TYPE_SET && m->set.dict) {
+            dictionary_destroy(m->set.dict);
+            m->set.dict = NULL;
+        }
+
+        m->reset = 0;
+        m->count = 0;
+    }
+
+    usec_t gauge_set_ut = 0;
+    LONG_DOUBLE gauge_delta = 0.0;
+
+    if(m->type == STATSD_METRIC_TYPE_GAUGE) {
+        // find the latest value set by any thread
+        int i;
+        for(i = 0; i < statsd.threads ;i++) {
+            STATSD_METRIC_THREAD *t = __atomic_load_n(&m->threads[i], __ATOMIC_ACQUIRE);
+            if(!t) continue;
+
+            netdata_mutex_lock(&t->mutex);
+            if(t->gauge.set_ut > gauge_set_ut) gauge_set_ut = t->gauge.set_ut;
+            netdata_mutex_unlock(&t->mutex);
+        }
+    }
+
+    int i;
+    for(i = 0; i < statsd.threads ;i++) {
+        STATSD_METRIC_THREAD *t = __atomic_load_n(&m->threads[i], __ATOMIC_ACQUIRE);
+        if(!t) continue;
+
+        DICTIONARY *set = NULL;
+
+        netdata_mutex_lock(&t->mutex);
+
+        if(likely(t->count)) {
+            m->events += t->count;
+            m->count += t->count;
+            t->count = 0;
+
+            switch(m->type) {
+                case STATSD_METRIC_TYPE_GAUGE:
+                    // the latest value set by any thread, plus the
+                    // increments/decrements received after it
+                    if(t->gauge.set_ut && t->gauge.set_ut >= gauge_set_ut) {
+                        gauge_set_ut = t->gauge.set_ut;
+                        m->gauge.value = t->gauge.value;
+                    }
+
+                    if(t->gauge.set_ut == gauge_set_ut || t->gauge.delta_ut > gauge_set_ut)
+                        gauge_delta += t->gauge.delta;
+
+                    t->gauge.delta = 0;
+                    t->gauge.set_ut = 0;
+                    t->gauge.delta_ut = 0;
+                    break;
+
+                case STATSD_METRIC_TYPE_COUNTER:
+                case STATSD_METRIC_TYPE_METER:
+                    m->counter.value += t->counter;
+                    t->counter = 0;
+                    break;
+
+                case STATSD_METRIC_TYPE_HISTOGRAM:
+                case STATSD_METRIC_TYPE_TIMER:
+                    statsd_merge_histogram_values(m, t);
+                    break;
+
+                case STATSD_METRIC_TYPE_SET:
+                    // merge it after releasing the lock of the thread
+                    set = t->set;
+                    t->set = NULL;
+                    break;
+            }
+        }
+
+        netdata_mutex_unlock(&t->mutex);
+
+        if(unlikely(set)) {
+            if(unlikely(!m->set.dict)) {
+                m->set.dict   = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED | DICTIONARY_FLAG_VALUE_LINK_DONT_CLONE | DICTIONARY_FLAG_HASH_TABLE);
+                m->set.unique = 0;
+            }
+
+            dictionary_get_all_name_value(set, statsd_merge_set_value, m);
+            dictionary_destroy(set);
+        }
+    }
+
+    if(m->type == STATSD_METRIC_TYPE_GAUGE)
+        m->gauge.value += gauge_delta;
+}
+
+
 // --------------------------------------------------------------------------------------------------------------------
 // statsd flush metrics
 
@@ -1717,9 +2043,24 @@ static inline void statsd_flush_timer_or_histogram(STATSD_METRIC *m, const char
     debug(D_STATSD, "flushing %s metric '%s'", dim, m->name);
 
     int updated = 0;
-    if(unlikely(!m->reset && m->count && m->histogram.ext->used > 0)) {
-        netdata_mutex_lock(&m->histogram.ext->mutex);
+    QUANTILE_SKETCH *sketch = m->histogram.ext->sketch;
+    if(unlikely(sketch && !m->reset && m->count && sketch->count > 0)) {
+        m->histogram.ext->last_min = (collected_number)roundl(sketch->min * statsd.decimal_detail);
+        m->histogram.ext->last_max = (collected_number)roundl(sketch->max * statsd.decimal_detail);
+        m->last = (collected_number)roundl(quantile_sketch_average(sketch) * statsd.decimal_detail);
+        m->histogram.ext->last_median = (collected_number)roundl(quantile_sketch_quantile(sketch, 0.5) * statsd.decimal_detail);
+        m->histogram.ext->last_stddev = (collected_number)roundl(quantile_sketch_standard_deviation(sketch) * statsd.decimal_detail);
+        m->histogram.ext->last_sum = (collected_number)roundl(sketch->sum * statsd.decimal_detail);
+        m->histogram.ext->last_percentile = (collected_number)roundl(quantile_sketch_quantile(sketch, statsd.histogram_percentile / 100.0) * statsd.decimal_detail);
+
+        debug(D_STATSD, "STATSD %s metric %s (sketch): min " COLLECTED_NUMBER_FORMAT ", max " COLLECTED_NUMBER_FORMAT ", last " COLLECTED_NUMBER_FORMAT ", pcent " COLLECTED_NUMBER_FORMAT ", median " COLLECTED_NUMBER_FORMAT ", stddev " COLLECTED_NUMBER_FORMAT ", sum " COLLECTED_NUMBER_FORMAT,
+              dim, m->name, m->histogram.ext->last_min, m->histogram.ext->last_max, m->last, m->histogram.ext->last_percentile, m->histogram.ext->last_median, m->histogram.ext->last_stddev, m->histogram.ext->last_sum);
 
+        m->histogram.ext->zeroed = 0;
+        m->reset = 1;
+        updated = 1;
+    }
+    else if(unlikely(!sketch && !m->reset && m->count && m->histogram.ext->used > 0)) {
         size_t len = m->histogram.ext->used;
         LONG_DOUBLE *series = m->histogram.ext->values;
         sort_series(series, len);
@@ -1737,8 +2078,6 @@ static inline void statsd_flush_timer_or_histogram(STATSD_METRIC *m, const char
         else
             m->histogram.ext->last_percentile = (collected_number)roundl(series[pct_len - 1] * statsd.decimal_detail);
 
-        netdata_mutex_unlock(&m->histogram.ext->mutex);
-
         debug(D_STATSD, "STATSD %s metric %s: min " COLLECTED_NUMBER_FORMAT ", max " COLLECTED_NUMBER_FORMAT ", last " COLLECTED_NUMBER_FORMAT ", pcent " COLLECTED_NUMBER_FORMAT ", median " COLLECTED_NUMBER_FORMAT ", stddev " COLLECTED_NUMBER_FORMAT ", sum " COLLECTED_NUMBER_FORMAT,
               dim, m->name, m->histogram.ext->last_min, m->histogram.ext->last_max, m->last, m->histogram.ext->last_percentile, m->histogram.ext->last_median, m->histogram.ext->last_stddev, m->histogram.ext->last_sum);
 
@@ -2059,8 +2398,14 @@ const char *statsd_metric_type_string(STATSD_METRIC_TYPE type) {
 static inline void statsd_flush_index_metrics(STATSD_INDEX *index, void (*flush_metric)(STATSD_METRIC *)) {
     STATSD_METRIC *m;
 
+    // the collector threads add new metrics in front of the list,
+    // so the rest of the list can be walked without the lock
+    netdata_mutex_lock(&index->first_mutex);
+    STATSD_METRIC *first = index->first;
+    netdata_mutex_unlock(&index->first_mutex);
+
     // find the useful metrics (incremental = each time we are called, we check the new metrics only)
-    for(m = index->first; m ; m = m->next) {
+    for(m = first; m ; m = m->next) {
         // since we add new metrics at the beginning
         // check for useful charts, until the point we last checked
         if(unlikely(is_metric_checked(m))) break;
@@ -2102,12 +2447,58 @@ static inline void statsd_flush_index_metrics(STATSD_INDEX *index, void (*flush_
         }
     }
 
-    // flush all the useful metrics
+    // merge the values of the collector threads and flush all the useful metrics
     for(m = index->first_useful; m ; m = m->next_useful) {
+        statsd_merge_metric(m);
         flush_metric(m);
     }
 }
 
+// sum the counters of the collector threads
+// the drop counters of the kernel are cumulative, since the creation of each socket
+static inline size_t statsd_collector_thread_udp_drops(struct collection_thread_status *status) {
+    size_t i, drops = 0;
+    for(i = 0; i < MAX_LISTEN_FDS ;i++)
+        drops += __atomic_load_n(&status->udp_socket_drops[i], __ATOMIC_RELAXED);
+
+    return drops;
+}
+
+static inline void statsd_sum_collector_threads_counters(void) {
+    size_t events[STATSD_METRIC_TYPES] = { 0 };
+    size_t tcp_socket_reads = 0, tcp_packets_received = 0, tcp_bytes_read = 0;
+    size_t udp_socket_reads = 0, udp_packets_received = 0, udp_bytes_read = 0;
+
+    int i, type;
+    for(i = 0; i < statsd.threads ;i++) {
+        struct collection_thread_status *status = &statsd.collection_threads_status[i];
+
+        for(type = 0; type < STATSD_METRIC_TYPES ;type++)
+            events[type] += status->events[type];
+
+        tcp_socket_reads     += status->tcp_socket_reads;
+        tcp_packets_received += status->tcp_packets_received;
+        tcp_bytes_read       += status->tcp_bytes_read;
+        udp_socket_reads     += status->udp_socket_reads;
+        udp_packets_received += status->udp_packets_received;
+        udp_bytes_read       += status->udp_bytes_read;
+    }
+
+    statsd.gauges.events     = events[STATSD_METRIC_TYPE_GAUGE];
+    statsd.counters.events   = events[STATSD_METRIC_TYPE_COUNTER];
+    statsd.meters.events     = events[STATSD_METRIC_TYPE_METER];
+    statsd.timers.events     = events[STATSD_METRIC_TYPE_TIMER];
+    statsd.histograms.events = events[STATSD_METRIC_TYPE_HISTOGRAM];
+    statsd.sets.events       = events[STATSD_METRIC_TYPE_SET];
+
+    statsd.tcp_socket_reads     = tcp_socket_reads;
+    statsd.tcp_packets_received = tcp_packets_received;
+    statsd.tcp_bytes_read       = tcp_bytes_read;
+    statsd.udp_socket_reads     = udp_socket_reads;
+    statsd.udp_packets_received = udp_packets_received;
+    statsd.udp_bytes_read       = udp_bytes_read;
+}
+
 
 // --------------------------------------------------------------------------------------
 // statsd main thread
@@ -2116,6 +2507,53 @@ static int statsd_listen_sockets_setup(void) {
     return listen_sockets_setup(&statsd.sockets);
 }
 
+// ask the kernel to report the packets it drops on the UDP sockets
+static void statsd_listen_sockets_report_drops(LISTEN_SOCKETS *sockets) {
+#ifdef SO_RXQ_OVFL
+    size_t i;
+    for(i = 0; i < sockets->opened ;i++) {
+        int enable = 1;
+        if(sockets->fds_types[i] == SOCK_DGRAM && setsockopt(sockets->fds[i], SOL_SOCKET, SO_RXQ_OVFL, &enable, sizeof(enable)) == -1)
+            error("STATSD: cannot enable SO_RXQ_OVFL on socket %s", sockets->fds_names[i]);
+    }
+#else
+    (void)sockets;
+#endif
+}
+
+// give each collector thread its own sockets, bound to the same addresses with SO_REUSEPORT,
+// so that the kernel distributes the packets and the connections to the threads
+// the first thread (or all of them, when this is not possible) uses statsd.sockets
+static void statsd_collector_thread_sockets_setup(struct collection_thread_status *status) {
+    status->sockets = &statsd.sockets;
+
+    if(!statsd.sockets_per_thread || !status->id)
+        return;
+
+    size_t i;
+    for(i = 0; i < statsd.sockets.opened ;i++) {
+        // binding a unix socket again, would remove the first one
+        if(statsd.sockets.fds_families[i] == AF_UNIX)
+            return;
+    }
+
+    status->own_sockets.config          = statsd.sockets.config;
+    status->own_sockets.config_section  = statsd.sockets.config_section;
+    status->own_sockets.default_bind_to = statsd.sockets.default_bind_to;
+    status->own_sockets.default_port    = statsd.sockets.default_port;
+    status->own_sockets.backlog         = statsd.sockets.backlog;
+
+    listen_sockets_setup(&status->own_sockets);
+    if(status->own_sockets.failed || status->own_sockets.opened != statsd.sockets.opened) {
+        error("STATSD: cannot open separate sockets for collector thread %d - it will share the sockets of the first thread.", status->id + 1);
+        listen_sockets_close(&status->own_sockets);
+        return;
+    }
+
+    statsd_listen_sockets_report_drops(&status->own_sockets);
+    status->sockets = &status->own_sockets;
+}
+
 static void statsd_main_cleanup(void *data) {
     struct netdata_static_thread *static_thread = (struct netdata_static_thread *)data;
     static_thread->enabled = NETDATA_MAIN_THREAD_EXITING;
@@ -2135,6 +2573,13 @@ static void statsd_main_cleanup(void *data) {
     }
 
     info("STATSD: closing sockets...");
+    if (statsd.collection_threads_status) {
+        int i;
+        for (i = 0; i < statsd.threads; i++) {
+            if(statsd.collection_threads_status[i].sockets == &statsd.collection_threads_status[i].own_sockets)
+                listen_sockets_close(&statsd.collection_threads_status[i].own_sockets);
+        }
+    }
     listen_sockets_close(&statsd.sockets);
 
     info("STATSD: cleanup completed.");
@@ -2158,6 +2603,10 @@ void *statsd_main(void *ptr) {
 
 #ifdef HAVE_RECVMMSG
     statsd.recvmmsg_size = (size_t)config_get_number(CONFIG_SECTION_STATSD, "udp messages to process at once", (long long)statsd.recvmmsg_size);
+    if(statsd.recvmmsg_size < 1) {
+        error("STATSD: Invalid number of udp messages to process at once %zu, using 10", statsd.recvmmsg_size);
+        statsd.recvmmsg_size = 10;
+    }
 #endif
 
     statsd.charts_for = simple_pattern_create(config_get(CONFIG_SECTION_STATSD, "create private charts for metrics matching", "*"), NULL, SIMPLE_PATTERN_EXACT);
@@ -2180,6 +2629,16 @@ void *statsd_main(void *ptr) {
         statsd.histogram_percentile_str = strdupz(buffer);
     }
 
+    statsd.histogram_mode = statsd_histogram_mode_id(config_get(CONFIG_SECTION_STATSD, "histograms and timers mode", statsd_histogram_mode_name(statsd.histogram_mode)));
+    if(statsd.histogram_mode == STATSD_HISTOGRAM_MODE_DEFAULT)
+        statsd.histogram_mode = STATSD_HISTOGRAM_MODE_EXACT;
+
+    statsd.histogram_sketch_accuracy = (double)config_get_float(CONFIG_SECTION_STATSD, "histograms and timers sketch relative accuracy", statsd.histogram_sketch_accuracy);
+    if(!isgreater(statsd.histogram_sketch_accuracy, 0) || !isless(statsd.histogram_sketch_accuracy, 100)) {
+        error("STATSD: invalid histograms and timers sketch relative accuracy %0.5f given", statsd.histogram_sketch_accuracy);
+        statsd.histogram_sketch_accuracy = 1.0;
+    }
+
     if(config_get_boolean(CONFIG_SECTION_STATSD, "add dimension for number of events received", 1)) {
         statsd.gauges.default_options |= STATSD_METRIC_OPTION_CHART_DIMENSION_COUNT;
         statsd.counters.default_options |= STATSD_METRIC_OPTION_CHART_DIMENSION_COUNT;
@@ -2209,16 +2668,21 @@ void *statsd_main(void *ptr) {
 
     size_t max_sockets = (size_t)config_get_number(CONFIG_SECTION_STATSD, "statsd server max TCP sockets", (long long int)(rlimit_nofile.rlim_cur / 4));
 
-#ifdef STATSD_MULTITHREADED
     statsd.threads = (int)config_get_number(CONFIG_SECTION_STATSD, "threads", processors);
     if(statsd.threads < 1) {
         error("STATSD: Invalid number of threads %d, using %d", statsd.threads, processors);
         statsd.threads = processors;
-        config_set_number(CONFIG_SECTION_STATSD, "collector threads", statsd.threads);
+        config_set_number(CONFIG_SECTION_STATSD, "threads", statsd.threads);
     }
-#else
-    statsd.threads = 1;
-#endif
+
+    statsd.sockets_per_thread = config_get_boolean(CONFIG_SECTION_STATSD, "sockets per thread", statsd.sockets_per_thread);
+
+    statsd_index_init(&statsd.gauges);
+    statsd_index_init(&statsd.counters);
+    statsd_index_init(&statsd.meters);
+    statsd_index_init(&statsd.timers);
+    statsd_index_init(&statsd.histograms);
+    statsd_index_init(&statsd.sets);
 
     // read custom application definitions
     statsd_readdir(netdata_configured_user_config_dir, netdata_configured_stock_config_dir, "statsd.d");
@@ -2234,10 +2698,14 @@ void *statsd_main(void *ptr) {
         goto cleanup;
     }
 
+    statsd_listen_sockets_report_drops(&statsd.sockets);
+
     statsd.collection_threads_status = callocz((size_t)statsd.threads, sizeof(struct collection_thread_status));
 
     int i;
     for(i = 0; i < statsd.threads ;i++) {
+        statsd.collection_threads_status[i].id = i;
+        statsd_collector_thread_sockets_setup(&statsd.collection_threads_status[i]);
         statsd.collection_threads_status[i].max_sockets = max_sockets / statsd.threads;
         char tag[NETDATA_THREAD_TAG_MAX + 1];
         snprintfz(tag, NETDATA_THREAD_TAG_MAX, "STATSD_COLLECTOR[%d]", i + 1);
@@ -2412,6 +2880,21 @@ void *statsd_main(void *ptr) {
     );
     RRDDIM *rd_pcharts = rrddim_add(st_pcharts, "charts", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
 
+    RRDSET *st_udp_drops = rrdset_create_localhost(
+            "netdata"
+            , "statsd_udp_drops"
+            , NULL
+            , "statsd"
+            , NULL
+            , "statsd server UDP packets dropped by the kernel"
+            , "packets/s"
+            , PLUGIN_STATSD_NAME
+            , "stats"
+            , 132017
+            , statsd.update_every
+            , RRDSET_TYPE_STACKED
+    );
+
     RRDSET *stcpu_thread = rrdset_create_localhost(
             "netdata"
             , "plugin_statsd_charting_cpu"
@@ -2455,6 +2938,9 @@ void *statsd_main(void *ptr) {
 
         statsd.collection_threads_status[i].rd_user   = rrddim_add(statsd.collection_threads_status[i].st_cpu, "user", NULL, 1, 1000, RRD_ALGORITHM_INCREMENTAL);
         statsd.collection_threads_status[i].rd_system = rrddim_add(statsd.collection_threads_status[i].st_cpu, "system", NULL, 1, 1000, RRD_ALGORITHM_INCREMENTAL);
+
+        snprintfz(id, 100, "thread%d", i + 1);
+        statsd.collection_threads_status[i].rd_udp_drops = rrddim_add(st_udp_drops, id, NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
     }
 
             // ----------------------------------------------------------------------------------------------------------------
@@ -2475,6 +2961,8 @@ void *statsd_main(void *ptr) {
 
         statsd_update_all_app_charts();
 
+        statsd_sum_collector_threads_counters();
+
         getrusage(RUSAGE_THREAD, &thread);
 
         if(unlikely(netdata_exit))
@@ -2490,6 +2978,7 @@ void *statsd_main(void *ptr) {
             rrdset_next(st_tcp_connects);
             rrdset_next(st_tcp_connected);
             rrdset_next(st_pcharts);
+            rrdset_next(st_udp_drops);
             rrdset_next(stcpu_thread);
             for(i = 0; i < statsd.threads ;i++)
                 rrdset_next(statsd.collection_threads_status[i].st_cpu);
@@ -2543,6 +3032,10 @@ void *statsd_main(void *ptr) {
         rrddim_set_by_pointer(st_pcharts, rd_pcharts,              (collected_number)statsd.private_charts);
         rrdset_done(st_pcharts);
 
+        for(i = 0; i < statsd.threads ;i++)
+            rrddim_set_by_pointer(st_udp_drops, statsd.collection_threads_status[i].rd_udp_drops, (collected_number)statsd_collector_thread_udp_drops(&statsd.collection_threads_status[i]));
+        rrdset_done(st_udp_drops);
+
         rrddim_set_by_pointer(stcpu_thread, rd_user, thread.ru_utime.tv_sec * 1000000ULL + thread.ru_utime.tv_usec);
         rrddim_set_by_pointer(stcpu_thread, rd_system, thread.ru_stime.tv_sec * 1000000ULL + thread.ru_stime.tv_usec);
         rrdset_done(stcpu_thread);
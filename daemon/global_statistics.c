@@ -69,11 +69,26 @@ void rrdr_query_completed(uint64_t db_points_read, uint64_t result_points_genera
 #endif
 }
 
+static LATENCY_HISTOGRAM web_request_histograms[WEB_REQUEST_ENDPOINTS] = {
+        [WEB_REQUEST_ENDPOINT_DATA]       = LATENCY_HISTOGRAM_INITIALIZER("web_data"),
+        [WEB_REQUEST_ENDPOINT_BADGE]      = LATENCY_HISTOGRAM_INITIALIZER("web_badge"),
+        [WEB_REQUEST_ENDPOINT_ALLMETRICS] = LATENCY_HISTOGRAM_INITIALIZER("web_allmetrics"),
+        [WEB_REQUEST_ENDPOINT_CHARTS]     = LATENCY_HISTOGRAM_INITIALIZER("web_charts"),
+        [WEB_REQUEST_ENDPOINT_ALARMS]     = LATENCY_HISTOGRAM_INITIALIZER("web_alarms"),
+        [WEB_REQUEST_ENDPOINT_API]        = LATENCY_HISTOGRAM_INITIALIZER("web_api"),
+        [WEB_REQUEST_ENDPOINT_FILES]      = LATENCY_HISTOGRAM_INITIALIZER("web_files"),
+        [WEB_REQUEST_ENDPOINT_OTHER]      = LATENCY_HISTOGRAM_INITIALIZER("web_other"),
+};
+
 void finished_web_request_statistics(uint64_t dt,
                                      uint64_t bytes_received,
                                      uint64_t bytes_sent,
                                      uint64_t content_size,
-                                     uint64_t compressed_content_size) {
+                                     uint64_t compressed_content_size,
+                                     WEB_REQUEST_ENDPOINT endpoint) {
+    if(likely(endpoint < WEB_REQUEST_ENDPOINTS))
+        latency_histogram_add(&web_request_histograms[endpoint], dt);
+
 #if defined(HAVE_C___ATOMIC) && !defined(NETDATA_NO_ATOMIC_INSTRUCTIONS)
     uint64_t old_web_usec_max = global_statistics.web_usec_max;
     while(dt > old_web_usec_max)
@@ -171,6 +186,205 @@ static inline void global_statistics_copy(struct global_statistics *gs, uint8_t
 #endif
 }
 
+// ----------------------------------------------------------------------------
+// latency percentiles
+
+static struct latency_chart {
+    LATENCY_HISTOGRAM *histogram;
+    const char *id;
+    const char *title;
+    long priority;
+
+    RRDSET *st;
+    RRDDIM *rd_p50, *rd_p95, *rd_p99;
+} latency_charts[] = {
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_DATA],         "latency_web_data",        "NetData Web Requests Latency for /api/v1/data",              130700, NULL, NULL, NULL, NULL },
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_BADGE],        "latency_web_badge",       "NetData Web Requests Latency for /api/v1/badge.svg",         130701, NULL, NULL, NULL, NULL },
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_ALLMETRICS],   "latency_web_allmetrics",  "NetData Web Requests Latency for /api/v1/allmetrics",        130702, NULL, NULL, NULL, NULL },
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_CHARTS],       "latency_web_charts",      "NetData Web Requests Latency for /api/v1/chart(s) and info", 130703, NULL, NULL, NULL, NULL },
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_ALARMS],       "latency_web_alarms",      "NetData Web Requests Latency for /api/v1/alarm*",            130704, NULL, NULL, NULL, NULL },
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_API],          "latency_web_api",         "NetData Web Requests Latency for other API calls",           130705, NULL, NULL, NULL, NULL },
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_FILES],        "latency_web_files",       "NetData Web Requests Latency for files",                     130706, NULL, NULL, NULL, NULL },
+        { &web_request_histograms[WEB_REQUEST_ENDPOINT_OTHER],        "latency_web_other",       "NetData Web Requests Latency for other requests",            130707, NULL, NULL, NULL, NULL },
+        { &prometheus_scrape_histogram,                               "latency_prometheus",      "NetData Prometheus Exporter Scrape Rendering Time",          130708, NULL, NULL, NULL, NULL },
+        { &rrd2rrdr_histogram,                                        "latency_queries",         "NetData Queries Latency (rrd2rrdr)",                         130710, NULL, NULL, NULL, NULL },
+        { &rrdset_done_histogram,                                     "latency_rrdset_done",     "NetData Charts Completion Latency (rrdset_done)",            130711, NULL, NULL, NULL, NULL },
+        { &streaming_parse_histogram,                                 "latency_streaming_parse", "NetData Streaming Parse Time per Chart Update",              130712, NULL, NULL, NULL, NULL },
+#ifdef ENABLE_DBENGINE
+        { &pg_cache_wait_histogram,                                   "latency_pg_cache_wait",   "NetData DB engine Page Cache Wait Time",                     130713, NULL, NULL, NULL, NULL },
+#endif
+        { NULL, NULL, NULL, 0, NULL, NULL, NULL, NULL }
+};
+
+static void latency_charts_update(void) {
+    static const double percentiles[] = { 50.0, 95.0, 99.0 };
+    struct latency_chart *c;
+
+    for(c = latency_charts; c->histogram ; c++) {
+        // the charts are added once their histograms have values
+        if(!c->st && !latency_histogram_used(c->histogram))
+            continue;
+
+        uint64_t values[3];
+        latency_histogram_read(c->histogram, percentiles, values, 3);
+
+        if (unlikely(!c->st)) {
+            c->st = rrdset_create_localhost(
+                    "netdata"
+                    , c->id
+                    , NULL
+                    , "latency"
+                    , NULL
+                    , c->title
+                    , "microseconds"
+                    , "netdata"
+                    , "stats"
+                    , c->priority
+                    , localhost->rrd_update_every
+                    , RRDSET_TYPE_LINE
+            );
+
+            c->rd_p50 = rrddim_add(c->st, "p50", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+            c->rd_p95 = rrddim_add(c->st, "p95", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+            c->rd_p99 = rrddim_add(c->st, "p99", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        }
+        else
+            rrdset_next(c->st);
+
+        rrddim_set_by_pointer(c->st, c->rd_p50, (collected_number)values[0]);
+        rrddim_set_by_pointer(c->st, c->rd_p95, (collected_number)values[1]);
+        rrddim_set_by_pointer(c->st, c->rd_p99, (collected_number)values[2]);
+        rrdset_done(c->st);
+    }
+}
+
+// ----------------------------------------------------------------------------
+// CPU of the netdata threads and lock contention
+
+struct threads_cpu_chart {
+    RRDSET *st;
+    RRDDIM **exited;
+    size_t exited_used, exited_size;
+};
+
+static void threads_cpu_chart_dimension(const char *tag, unsigned long long cpu_usec, size_t threads, void *data) {
+    struct threads_cpu_chart *c = data;
+
+    RRDDIM *rd = rrddim_find(c->st, tag);
+    if(unlikely(!rd))
+        rd = rrddim_add(c->st, tag, NULL, 1, 1000, RRD_ALGORITHM_INCREMENTAL);
+    else if(unlikely(rrddim_flag_check(rd, RRDDIM_FLAG_OBSOLETE)))
+        rrddim_isnot_obsolete(c->st, rd);
+
+    rrddim_set_by_pointer(c->st, rd, (collected_number)cpu_usec);
+
+    // this is the last value of the tag, until a thread with the same tag starts
+    if(unlikely(!threads)) {
+        if(c->exited_used == c->exited_size) {
+            c->exited_size = c->exited_size ? c->exited_size * 2 : 16;
+            c->exited = reallocz(c->exited, c->exited_size * sizeof(RRDDIM *));
+        }
+        c->exited[c->exited_used++] = rd;
+    }
+}
+
+static void threads_cpu_chart_update(void) {
+    static struct threads_cpu_chart c = { NULL, NULL, 0, 0 };
+
+    if (unlikely(!c.st)) {
+        c.st = rrdset_create_localhost(
+                "netdata"
+                , "threads_cpu"
+                , NULL
+                , "threads"
+                , NULL
+                , "NetData CPU usage per Thread"
+                , "milliseconds/s"
+                , "netdata"
+                , "stats"
+                , 130850
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_STACKED
+        );
+    }
+    else
+        rrdset_next(c.st);
+
+    c.exited_used = 0;
+    netdata_threads_cpu_usage(threads_cpu_chart_dimension, &c);
+    rrdset_done(c.st);
+
+    size_t i;
+    for(i = 0; i < c.exited_used ;i++)
+        rrddim_is_obsolete(c.st, c.exited[i]);
+}
+
+static void lock_charts_dimension(struct netdata_lock_class *lc, void *data) {
+    RRDSET **st = data;
+
+    size_t contentions = __atomic_load_n(&lc->contentions, __ATOMIC_RELAXED);
+    unsigned long long wait_usec = __atomic_load_n(&lc->wait_usec, __ATOMIC_RELAXED);
+
+    // the classes are charted once they have waited
+    RRDDIM *rd_wait = rrddim_find(st[0], lc->name);
+    if(!rd_wait) {
+        if(!contentions) return;
+        rd_wait = rrddim_add(st[0], lc->name, NULL, 1, 1000, RRD_ALGORITHM_INCREMENTAL);
+    }
+
+    RRDDIM *rd_contentions = rrddim_find(st[1], lc->name);
+    if(!rd_contentions)
+        rd_contentions = rrddim_add(st[1], lc->name, NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+
+    rrddim_set_by_pointer(st[0], rd_wait, (collected_number)wait_usec);
+    rrddim_set_by_pointer(st[1], rd_contentions, (collected_number)contentions);
+}
+
+static void lock_charts_update(void) {
+    static RRDSET *st[2] = { NULL, NULL };
+
+    if (unlikely(!st[0])) {
+        st[0] = rrdset_create_localhost(
+                "netdata"
+                , "locks_wait"
+                , NULL
+                , "locks"
+                , NULL
+                , "NetData Time Waited for Locks, per Lock Class"
+                , "milliseconds/s"
+                , "netdata"
+                , "stats"
+                , 130800
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_STACKED
+        );
+
+        st[1] = rrdset_create_localhost(
+                "netdata"
+                , "locks_contentions"
+                , NULL
+                , "locks"
+                , NULL
+                , "NetData Locks Found Taken, per Lock Class"
+                , "contentions/s"
+                , "netdata"
+                , "stats"
+                , 130801
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_STACKED
+        );
+    }
+    else {
+        rrdset_next(st[0]);
+        rrdset_next(st[1]);
+    }
+
+    netdata_locks_statistics(lock_charts_dimension, st);
+
+    rrdset_done(st[0]);
+    rrdset_done(st[1]);
+}
+
 void global_statistics_charts(void) {
     static unsigned long long old_web_requests = 0,
                               old_web_usec = 0,
@@ -945,6 +1159,268 @@ void global_statistics_charts(void) {
             rrdset_done(st_ram_usage);
         }
     }
+
+    // ----------------------------------------------------------------
+
+    {
+        static RRDSET *st_sqlite_queue = NULL, *st_sqlite_writes = NULL;
+        static RRDDIM *rd_queued = NULL, *rd_written = NULL, *rd_transactions = NULL;
+        size_t queued, written, transactions;
+
+        sql_metadata_writer_statistics(&queued, &written, &transactions);
+
+        if (unlikely(!st_sqlite_queue)) {
+            st_sqlite_queue = rrdset_create_localhost(
+                "netdata"
+                , "sqlite_metadata_queue"
+                , NULL
+                , "sqlite"
+                , NULL
+                , "NetData SQLite Metadata Writer Queue"
+                , "writes"
+                , "netdata"
+                , "stats"
+                , 130511
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_LINE
+            );
+
+            rd_queued = rrddim_add(st_sqlite_queue, "queued", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        }
+        else
+            rrdset_next(st_sqlite_queue);
+
+        rrddim_set_by_pointer(st_sqlite_queue, rd_queued, (collected_number)queued);
+        rrdset_done(st_sqlite_queue);
+
+        if (unlikely(!st_sqlite_writes)) {
+            st_sqlite_writes = rrdset_create_localhost(
+                "netdata"
+                , "sqlite_metadata_writes"
+                , NULL
+                , "sqlite"
+                , NULL
+                , "NetData SQLite Metadata Writes"
+                , "operations/s"
+                , "netdata"
+                , "stats"
+                , 130512
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_LINE
+            );
+
+            rd_written = rrddim_add(st_sqlite_writes, "writes", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            rd_transactions = rrddim_add(st_sqlite_writes, "transactions", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+        }
+        else
+            rrdset_next(st_sqlite_writes);
+
+        rrddim_set_by_pointer(st_sqlite_writes, rd_written, (collected_number)written);
+        rrddim_set_by_pointer(st_sqlite_writes, rd_transactions, (collected_number)transactions);
+        rrdset_done(st_sqlite_writes);
+    }
+
+    {
+        static RRDSET *st_compaction = NULL, *st_compaction_time = NULL;
+        static RRDDIM *rd_rows = NULL, *rd_pages = NULL, *rd_duration = NULL;
+        size_t compactions, rows, pages;
+        usec_t duration_ut;
+
+        sql_metadata_compaction_statistics(&compactions, &rows, &pages, &duration_ut);
+
+        if (unlikely(!st_compaction)) {
+            st_compaction = rrdset_create_localhost(
+                "netdata"
+                , "sqlite_metadata_compaction"
+                , NULL
+                , "sqlite"
+                , NULL
+                , "NetData SQLite Metadata Compaction"
+                , "objects/s"
+                , "netdata"
+                , "stats"
+                , 130513
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_LINE
+            );
+
+            rd_rows = rrddim_add(st_compaction, "charts", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            rd_pages = rrddim_add(st_compaction, "pages", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+        }
+        else
+            rrdset_next(st_compaction);
+
+        rrddim_set_by_pointer(st_compaction, rd_rows, (collected_number)rows);
+        rrddim_set_by_pointer(st_compaction, rd_pages, (collected_number)pages);
+        rrdset_done(st_compaction);
+
+        if (unlikely(!st_compaction_time)) {
+            st_compaction_time = rrdset_create_localhost(
+                "netdata"
+                , "sqlite_metadata_compaction_time"
+                , NULL
+                , "sqlite"
+                , NULL
+                , "NetData SQLite Metadata Compaction Time"
+                , "milliseconds/s"
+                , "netdata"
+                , "stats"
+                , 130514
+                , localhost->rrd_update_every
+                , RRDSET_TYPE_AREA
+            );
+
+            rd_duration = rrddim_add(st_compaction_time, "compaction", NULL, 1, USEC_PER_MS, RRD_ALGORITHM_INCREMENTAL);
+        }
+        else
+            rrdset_next(st_compaction_time);
+
+        rrddim_set_by_pointer(st_compaction_time, rd_duration, (collected_number)duration_ut);
+        rrdset_done(st_compaction_time);
+    }
 #endif
 
+    // ----------------------------------------------------------------
+
+    if(log_async_enabled()) {
+        static RRDSET *st_logs = NULL;
+        static RRDDIM *rd_written = NULL,
+                      *rd_dropped = NULL;
+
+        if (unlikely(!st_logs)) {
+            st_logs = rrdset_create_localhost(
+                    "netdata"
+                    , "logs"
+                    , NULL
+                    , "netdata"
+                    , NULL
+                    , "NetData Asynchronous Log Lines"
+                    , "lines/s"
+                    , "netdata"
+                    , "stats"
+                    , 130600
+                    , localhost->rrd_update_every
+                    , RRDSET_TYPE_LINE
+            );
+
+            rd_written = rrddim_add(st_logs, "written", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            rd_dropped = rrddim_add(st_logs, "dropped", NULL, -1, 1, RRD_ALGORITHM_INCREMENTAL);
+        }
+        else
+            rrdset_next(st_logs);
+
+        uint64_t records, dropped;
+        log_async_statistics(&records, &dropped);
+
+        rrddim_set_by_pointer(st_logs, rd_written, (collected_number) records);
+        rrddim_set_by_pointer(st_logs, rd_dropped, (collected_number) dropped);
+        rrdset_done(st_logs);
+    }
+
+    // ----------------------------------------------------------------
+
+    if(profiler_enabled()) {
+        static RRDSET *st_profiler = NULL;
+        static RRDDIM *rd_samples = NULL,
+                      *rd_dropped = NULL;
+
+        if (unlikely(!st_profiler)) {
+            st_profiler = rrdset_create_localhost(
+                    "netdata"
+                    , "profiler"
+                    , NULL
+                    , "netdata"
+                    , NULL
+                    , "NetData Sampling Profiler Samples"
+                    , "samples/s"
+                    , "netdata"
+                    , "stats"
+                    , 130690
+                    , localhost->rrd_update_every
+                    , RRDSET_TYPE_LINE
+            );
+
+            rd_samples = rrddim_add(st_profiler, "taken", NULL, 1, 1, RRD_ALGORITHM_INCREMENTAL);
+            rd_dropped = rrddim_add(st_profiler, "dropped", NULL, -1, 1, RRD_ALGORITHM_INCREMENTAL);
+        }
+        else
+            rrdset_next(st_profiler);
+
+        uint64_t samples, dropped;
+        profiler_statistics(&samples, &dropped);
+
+        rrddim_set_by_pointer(st_profiler, rd_samples, (collected_number) samples);
+        rrddim_set_by_pointer(st_profiler, rd_dropped, (collected_number) dropped);
+        rrdset_done(st_profiler);
+    }
+
+    // ----------------------------------------------------------------
+
+    {
+        static RRDSET *st_strings = NULL, *st_strings_memory = NULL;
+        static RRDDIM *rd_unique = NULL,
+                      *rd_references = NULL,
+                      *rd_memory = NULL;
+
+        size_t entries, references, memory;
+        string_statistics(&entries, &references, &memory, NULL);
+
+        if (unlikely(!st_strings)) {
+            st_strings = rrdset_create_localhost(
+                    "netdata"
+                    , "strings"
+                    , NULL
+                    , "netdata"
+                    , NULL
+                    , "NetData Interned Strings"
+                    , "strings"
+                    , "netdata"
+                    , "stats"
+                    , 130520
+                    , localhost->rrd_update_every
+                    , RRDSET_TYPE_LINE
+            );
+
+            rd_unique     = rrddim_add(st_strings, "unique", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+            rd_references = rrddim_add(st_strings, "references", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        }
+        else
+            rrdset_next(st_strings);
+
+        rrddim_set_by_pointer(st_strings, rd_unique, (collected_number) entries);
+        rrddim_set_by_pointer(st_strings, rd_references, (collected_number) references);
+        rrdset_done(st_strings);
+
+        if (unlikely(!st_strings_memory)) {
+            st_strings_memory = rrdset_create_localhost(
+                    "netdata"
+                    , "strings_memory"
+                    , NULL
+                    , "netdata"
+                    , NULL
+                    , "NetData Interned Strings Memory"
+                    , "bytes"
+                    , "netdata"
+                    , "stats"
+                    , 130521
+                    , localhost->rrd_update_every
+                    , RRDSET_TYPE_AREA
+            );
+
+            rd_memory = rrddim_add(st_strings_memory, "used", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        }
+        else
+            rrdset_next(st_strings_memory);
+
+        rrddim_set_by_pointer(st_strings_memory, rd_memory, (collected_number) memory);
+        rrdset_done(st_strings_memory);
+    }
+
+    // ----------------------------------------------------------------
+
+    latency_charts_update();
+    threads_cpu_chart_update();
+
+    if(netdata_locks_statistics_enabled)
+        lock_charts_update();
 }
@@ -10,11 +10,26 @@
 
 extern void rrdr_query_completed(uint64_t db_points_read, uint64_t result_points_generated);
 
+// the latency of web requests is charted separately for each of these
+typedef enum web_request_endpoint {
+    WEB_REQUEST_ENDPOINT_DATA = 0,      // /api/v1/data
+    WEB_REQUEST_ENDPOINT_BADGE,         // /api/v1/badge.svg
+    WEB_REQUEST_ENDPOINT_ALLMETRICS,    // /api/v1/allmetrics
+    WEB_REQUEST_ENDPOINT_CHARTS,        // /api/v1/chart, /api/v1/charts, /api/v1/info
+    WEB_REQUEST_ENDPOINT_ALARMS,        // /api/v1/alarm*
+    WEB_REQUEST_ENDPOINT_API,           // all other /api/v1/ calls
+    WEB_REQUEST_ENDPOINT_FILES,         // static files of the dashboard
+    WEB_REQUEST_ENDPOINT_OTHER,
+
+    WEB_REQUEST_ENDPOINTS               // the number of endpoints
+} WEB_REQUEST_ENDPOINT;
+
 extern void finished_web_request_statistics(uint64_t dt,
                                      uint64_t bytes_received,
                                      uint64_t bytes_sent,
                                      uint64_t content_size,
-                                     uint64_t compressed_content_size);
+                                     uint64_t compressed_content_size,
+                                     WEB_REQUEST_ENDPOINT endpoint);
 
 extern uint64_t web_client_connected(void);
 extern void web_client_disconnected(void);
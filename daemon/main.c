@@ -3,6 +3,10 @@
 #include "common.h"
 #include "buildinfo.h"
 
+#ifdef ENABLE_ACLK
+#include "aclk/aclk_query.h"
+#endif
+
 int netdata_zero_metrics_enabled;
 int netdata_anonymous_statistics_enabled;
 
@@ -48,6 +52,7 @@ void netdata_cleanup_and_exit(int ret) {
         rrdhost_free_all();
 #ifdef ENABLE_DBENGINE
         rrdeng_exit(&multidb_ctx);
+        sql_close_database();
 #endif
     }
 
@@ -62,6 +67,7 @@ void netdata_cleanup_and_exit(int ret) {
     security_clean_openssl();
 #endif
     info("EXIT: all done - netdata is now exiting - bye bye...");
+    log_async_stop();
     exit(ret);
 }
 
@@ -437,6 +443,9 @@ static void log_init(void) {
     error_log_errors_per_period = (unsigned long)config_get_number(CONFIG_SECTION_GLOBAL, "errors to trigger flood protection", (long long int)error_log_errors_per_period);
     error_log_errors_per_period_backup = error_log_errors_per_period;
 
+    if(config_get_boolean(CONFIG_SECTION_GLOBAL, "asynchronous logging", CONFIG_BOOLEAN_NO))
+        log_async_buffer_size = (size_t)config_get_number(CONFIG_SECTION_GLOBAL, "asynchronous log buffer per thread", 65536);
+
     setenv("NETDATA_ERRORS_THROTTLE_PERIOD", config_get(CONFIG_SECTION_GLOBAL, "errors flood protection period"    , ""), 1);
     setenv("NETDATA_ERRORS_PER_PERIOD",      config_get(CONFIG_SECTION_GLOBAL, "errors to trigger flood protection", ""), 1);
 }
@@ -1026,6 +1035,11 @@ int main(int argc, char **argv) {
                         if(strcmp(optarg, "unittest") == 0) {
                             if(unit_test_buffer()) return 1;
                             if(unit_test_str2ld()) return 1;
+                            if(unit_test_latency_histogram()) return 1;
+#ifdef ENABLE_ACLK
+                            if(aclk_queue_unittest()) return 1;
+                            if(aclk_encoding_unittest()) return 1;
+#endif
                             // No call to load the config file on this code-path
                             post_conf_load(&user);
                             get_netdata_configured_variables();
@@ -1042,6 +1056,7 @@ int main(int argc, char **argv) {
                             if(unit_test_storage()) return 1;
 #ifdef ENABLE_DBENGINE
                             if(test_dbengine()) return 1;
+                            if(sql_metadata_writer_unittest()) return 1;
 #endif
                             fprintf(stderr, "\n\nALL TESTS PASSED\n\n");
                             return 0;
@@ -1441,6 +1456,15 @@ int main(int argc, char **argv) {
      */
     signals_restore_SIGCHLD();
 
+    // start the log writer, now that we will not fork again
+    log_async_init();
+
+    netdata_locks_statistics_enabled = config_get_boolean(CONFIG_SECTION_GLOBAL, "lock contention statistics", CONFIG_BOOLEAN_NO);
+
+    // the threads started from now on are sampled by the profiler
+    if(config_get_boolean(CONFIG_SECTION_GLOBAL, "sampling profiler", CONFIG_BOOLEAN_NO))
+        profiler_init((int)config_get_number(CONFIG_SECTION_GLOBAL, "sampling profiler frequency", PROFILER_DEFAULT_FREQUENCY));
+
     // ------------------------------------------------------------------------
     // initialize rrd, registry, health, rrdpush, etc.
 
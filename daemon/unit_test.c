@@ -316,8 +316,33 @@ static int check_storage_number_exists() {
     return 0;
 }
 
+static int check_storage_number_limits() {
+    struct {
+        storage_number raw;
+        calculated_number expected;
+    } limits[] = {
+            { STORAGE_NUMBER_POSITIVE_MAX_RAW, (calculated_number)0x00ffffff * 100000000000000.0 },
+            { STORAGE_NUMBER_POSITIVE_MIN_RAW, (calculated_number)1 / 10000000.0 },
+            { STORAGE_NUMBER_NEGATIVE_MAX_RAW, (calculated_number)-1 / 10000000.0 },
+            { STORAGE_NUMBER_NEGATIVE_MIN_RAW, (calculated_number)-0x00ffffff * 100000000000000.0 },
+            { 0, 0.0 }
+    };
+
+    int i;
+    for(i = 0; limits[i].raw ; i++) {
+        calculated_number d = unpack_storage_number(limits[i].raw);
+        if(d != limits[i].expected) {
+            fprintf(stderr, "Storage number %08x unpacked as " CALCULATED_NUMBER_FORMAT ", expected " CALCULATED_NUMBER_FORMAT "\n", limits[i].raw, d, limits[i].expected);
+            return 1;
+        }
+    }
+
+    return 0;
+}
+
 int unit_test_storage() {
     if(check_storage_number_exists()) return 0;
+    if(check_storage_number_limits()) return 1;
 
     calculated_number storage_number_positive_min = unpack_storage_number(STORAGE_NUMBER_POSITIVE_MIN_RAW);
     calculated_number storage_number_negative_max = unpack_storage_number(STORAGE_NUMBER_NEGATIVE_MAX_RAW);
@@ -387,6 +412,79 @@ int unit_test_str2ld() {
     return 0;
 }
 
+struct latency_histogram_test_thread {
+    LATENCY_HISTOGRAM *h;
+    uint64_t first, last;
+};
+
+static void *latency_histogram_test_thread(void *ptr) {
+    struct latency_histogram_test_thread *t = (struct latency_histogram_test_thread *)ptr;
+    uint64_t v;
+    for(v = t->first; v <= t->last ;v++)
+        latency_histogram_add(t->h, v);
+    return NULL;
+}
+
+int unit_test_latency_histogram() {
+    static LATENCY_HISTOGRAM h = LATENCY_HISTOGRAM_INITIALIZER("unittest");
+    static const double percentiles[] = { 0.0, 50.0, 95.0, 99.0, 100.0 };
+    uint64_t values[5];
+    size_t i;
+
+    // 4 threads add 1 to 100000, and exit before the histogram is read
+    struct latency_histogram_test_thread threads[4];
+    for(i = 0; i < 4 ;i++) {
+        threads[i].h = &h;
+        threads[i].first = i * 25000 + 1;
+        threads[i].last = (i + 1) * 25000;
+    }
+
+    pthread_t ids[4];
+    for(i = 0; i < 4 ;i++)
+        if(pthread_create(&ids[i], NULL, latency_histogram_test_thread, &threads[i]) != 0) {
+            fprintf(stderr, "Cannot create latency histogram test thread.\n");
+            return -1;
+        }
+
+    for(i = 0; i < 4 ;i++)
+        pthread_join(ids[i], NULL);
+
+    // and this thread adds 1 to 100000 once more
+    latency_histogram_test_thread(&threads[0]);
+    latency_histogram_test_thread(&threads[1]);
+    latency_histogram_test_thread(&threads[2]);
+    latency_histogram_test_thread(&threads[3]);
+
+    uint64_t samples = latency_histogram_read(&h, percentiles, values, 5);
+    if(samples != 200000) {
+        fprintf(stderr, "Latency histogram counted %llu values, instead of 200000.\n", (unsigned long long)samples);
+        return -1;
+    }
+
+    for(i = 0; i < 5 ;i++) {
+        // the reported value is the top of its bucket, at most 1/16 above the real one
+        uint64_t expected = (uint64_t)ceil(percentiles[i] * 100000.0 / 100.0);
+        if(expected < 1) expected = 1;
+
+        if(values[i] < expected || values[i] > expected + expected / LATENCY_HISTOGRAM_SUB_BUCKETS) {
+            fprintf(stderr, "Latency histogram percentile %0.0f is %llu, expected %llu.\n"
+                    , percentiles[i], (unsigned long long)values[i], (unsigned long long)expected);
+            return -1;
+        }
+    }
+
+    // every read starts a new interval
+    latency_histogram_add(&h, 7);
+    samples = latency_histogram_read(&h, percentiles, values, 5);
+    if(samples != 1 || values[0] != 7 || values[4] != 7) {
+        fprintf(stderr, "Latency histogram did not start a new interval after read.\n");
+        return -1;
+    }
+
+    fprintf(stderr, "Latency histogram percentiles are within %d%% of the values added.\n", 100 / LATENCY_HISTOGRAM_SUB_BUCKETS);
+    return 0;
+}
+
 int unit_test_buffer() {
     BUFFER *wb = buffer_create(1);
     char string[2048 + 1];
@@ -1299,6 +1397,153 @@ int check_strdupz_path_subpath() {
     return 0;
 }
 
+static int test_rrdr_window(void) {
+    fprintf(stderr, "\nRunning test 'rrdr window':\nchecks that the incrementally maintained windows give the values of the db queries\n");
+
+    default_rrd_memory_mode = RRD_MEMORY_MODE_ALLOC;
+    default_rrd_update_every = 1;
+
+    RRDSET *st = rrdset_create_localhost("netdata", "unittest-rrdr-window", NULL, "netdata", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1, RRDSET_TYPE_LINE);
+    RRDDIM *rd1 = rrddim_add(st, "dim1", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *rd2 = rrddim_add(st, "dim2", NULL, 1, 10, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *rd3 = rrddim_add(st, "dim3", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+    RRDR_GROUPING groupings[] = { RRDR_GROUPING_AVERAGE, RRDR_GROUPING_SUM, RRDR_GROUPING_MIN, RRDR_GROUPING_MAX };
+    uint32_t options[] = { 0, RRDR_OPTION_NOT_ALIGNED, RRDR_OPTION_NOT_ALIGNED | RRDR_OPTION_ABSOLUTE };
+    const char *dimensions[] = { NULL, "dim1,dim3" };
+    long long afters[] = { -1, -10, -60 };
+
+    #define WINDOWS (sizeof(groupings) / sizeof(groupings[0]) * sizeof(options) / sizeof(options[0]) * sizeof(dimensions) / sizeof(dimensions[0]) * sizeof(afters) / sizeof(afters[0]))
+    struct rrdr_window *windows[WINDOWS] = { NULL };
+
+    int errors = 0;
+    size_t checks = 0;
+    long i;
+    for(i = 0; i < 300 ; i++) {
+        if(i) st->usec_since_last_update = USEC_PER_SEC;
+
+        rrddim_set_by_pointer(st, rd1, i % 7 - 3);
+        rrddim_set_by_pointer(st, rd2, (i * i) % 13);
+        if(i % 5) rrddim_set_by_pointer(st, rd3, 1000 - i);
+        rrdset_done(st);
+
+        if(!i) rd1->last_collected_time.tv_usec = rd2->last_collected_time.tv_usec = rd3->last_collected_time.tv_usec =
+                   st->last_collected_time.tv_usec = st->last_updated.tv_usec = 0;
+
+        size_t g, o, d, a, w = 0;
+        for(g = 0; g < sizeof(groupings) / sizeof(groupings[0]) ; g++)
+        for(o = 0; o < sizeof(options) / sizeof(options[0]) ; o++)
+        for(d = 0; d < sizeof(dimensions) / sizeof(dimensions[0]) ; d++)
+        for(a = 0; a < sizeof(afters) / sizeof(afters[0]) ; a++, w++) {
+            calculated_number expected = NAN, value = NAN;
+            time_t expected_after = 0, expected_before = 0, after = 0, before = 0;
+            int expected_null = 0, null = 0;
+
+            int expected_ret = rrdset2value_api_v1(st, NULL, &expected, dimensions[d], 1, afters[a], 0, groupings[g], 0, options[o], &expected_after, &expected_before, &expected_null, NULL);
+            int ret = rrdset2value_api_v1(st, NULL, &value, dimensions[d], 1, afters[a], 0, groupings[g], 0, options[o], &after, &before, &null, &windows[w]);
+            checks++;
+
+            if(ret != expected_ret || after != expected_after || before != expected_before || null != expected_null ||
+               (!expected_null && calculated_number_round(value * 10000000.0) != calculated_number_round(expected * 10000000.0))) {
+                fprintf(stderr, "    rrdr window %s, options %u, dimensions '%s', after %lld, at point %ld: expected %d " CALCULATED_NUMBER_FORMAT " (%ld - %ld, null %d), found %d " CALCULATED_NUMBER_FORMAT " (%ld - %ld, null %d), ### E R R O R ###\n",
+                        group_method2string(groupings[g]), options[o], dimensions[d] ? dimensions[d] : "*", afters[a], i,
+                        expected_ret, expected, (long)expected_after, (long)expected_before, expected_null,
+                        ret, value, (long)after, (long)before, null);
+                errors++;
+            }
+        }
+    }
+
+    size_t w;
+    for(w = 0; w < WINDOWS ; w++)
+        rrdr_window_free(windows[w]);
+    #undef WINDOWS
+
+    fprintf(stderr, "    rrdr window: %zu checks, %d errors\n", checks, errors);
+    return errors;
+}
+
+static int test_rrddim_accumulators(void) {
+    fprintf(stderr, "\nRunning test 'rrddim accumulators':\nchecks that the running sums of the stored values give the sums of the db queries\n");
+
+    default_rrd_memory_mode = RRD_MEMORY_MODE_ALLOC;
+    default_rrd_update_every = 1;
+    rrddim_accumulators_enabled = 1;
+
+    RRDSET *st = rrdset_create_localhost("netdata", "unittest-accumulators", NULL, "netdata", NULL, "Unit Testing", "a value", "unittest", NULL, 1, 1, RRDSET_TYPE_LINE);
+    RRDDIM *rd1 = rrddim_add(st, "dim1", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *rd2 = rrddim_add(st, "dim2", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    RRDDIM *rds[] = { rd1, rd2 };
+    struct rrddim_accumulator_cursor cursors[2] = { { .point_in_time = 0 } };
+    time_t afters[2] = { 0, 0 };
+
+    int errors = 0;
+    size_t checks = 0, hits = 0;
+    long i;
+    for(i = 0; i < RRDDIM_ACCUMULATOR_REBASE_POINTS + 400 ; i++) {
+        if(i) st->usec_since_last_update = USEC_PER_SEC;
+
+        rrddim_set_by_pointer(st, rd1, i % 7 - 3);
+        if(i % 5) rrddim_set_by_pointer(st, rd2, 1000 + i);
+        rrdset_done(st);
+
+        if(!i) rd1->last_collected_time.tv_usec = rd2->last_collected_time.tv_usec =
+                   st->last_collected_time.tv_usec = st->last_updated.tv_usec = 0;
+
+        if(i < 10 || i % 10) continue;
+
+        // a window that lags a few points, like the exporting engine does
+        time_t before = rrdset_last_entry_t(st) - 3;
+
+        size_t d;
+        for(d = 0; d < 2 ; d++) {
+            RRDDIM *rd = rds[d];
+            time_t after = afters[d] ? afters[d] : before - 9;
+            afters[d] = before + 1;
+
+            // the second dimension skips a window once, so its cursor is not continuous
+            if(d == 1 && i == 200) continue;
+
+            calculated_number sum = 0, expected_sum = 0;
+            size_t count = 0, expected_count = 0;
+            struct rrddim_query_handle handle;
+            for(rd->state->query_ops.init(rd, &handle, after, before); !rd->state->query_ops.is_finished(&handle);) {
+                time_t t;
+                storage_number n = rd->state->query_ops.next_metric(&handle, &t);
+                if(does_storage_number_exist(n)) {
+                    expected_sum += unpack_storage_number(n);
+                    expected_count++;
+                }
+            }
+            rd->state->query_ops.finalize(&handle);
+
+            if(!rrddim_accumulator_read(rd, &cursors[d], after, before, &sum, &count))
+                continue;
+
+            hits++;
+            checks++;
+            if(count != expected_count || calculated_number_round(sum * 10000000.0) != calculated_number_round(expected_sum * 10000000.0)) {
+                fprintf(stderr, "    accumulator of %s, window %ld - %ld: expected " CALCULATED_NUMBER_FORMAT " of %zu values, found " CALCULATED_NUMBER_FORMAT " of %zu values ### E R R O R ###\n",
+                        rd->name, (long)after, (long)before, expected_sum, expected_count, sum, count);
+                errors++;
+            }
+        }
+    }
+
+    // the first two windows (the first read allocates the accumulator), the skipped window, and the rebase,
+    // have to be read from the db
+    size_t windows = (size_t)(i - 10) / 10 * 2;
+    if(hits + 8 < windows) {
+        fprintf(stderr, "    accumulators answered only %zu of %zu windows ### E R R O R ###\n", hits, windows);
+        errors++;
+    }
+
+    rrddim_accumulators_enabled = 0;
+
+    fprintf(stderr, "    rrddim accumulators: %zu checks, %d errors\n", checks, errors);
+    return errors;
+}
+
 int run_all_mockup_tests(void)
 {
     if(check_strdupz_path_subpath())
@@ -1313,6 +1558,12 @@ int run_all_mockup_tests(void)
     if(!test_variable_renames())
         return 1;
 
+    if(test_rrdr_window())
+        return 1;
+
+    if(test_rrddim_accumulators())
+        return 1;
+
     if(run_test(&test1))
         return 1;
 
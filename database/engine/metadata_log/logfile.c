@@ -252,11 +252,14 @@ int load_metadata_logfile(struct metalog_instance *ctx, struct metadata_logfile
     int ret, fd, error;
     uint64_t file_size;
     char path[RRDENG_PATH_MAX];
+    usec_t started_ut;
 
     generate_metadata_logfile_path(metalogfile, path, sizeof(path));
     if (file_is_migrated(path))
         return 0;
 
+    started_ut = now_monotonic_usec();
+
     fd = open_file_buffered_io(path, O_RDWR, &file);
     if (fd < 0) {
 //        ++ctx->stats.fs_errors;
@@ -280,7 +283,8 @@ int load_metadata_logfile(struct metalog_instance *ctx, struct metadata_logfile
 
     iterate_records(metalogfile);
 
-    info("Metadata log \"%s\" migrated to the database (size:%"PRIu64").", path, file_size);
+    info("Metadata log \"%s\" migrated to the database (size:%"PRIu64") in %llu ms.", path, file_size,
+         (now_monotonic_usec() - started_ut) / USEC_PER_MS);
     add_migrated_file(path, file_size);
     return 0;
 
@@ -403,6 +407,7 @@ static int scan_metalog_files(struct metalog_instance *ctx)
     metalog_parser_object.parser = parser;
     ctx->metalog_parser_object = &metalog_parser_object;
 
+    usec_t started_ut = now_monotonic_usec();
     for (failed_to_load = 0, i = 0 ; i < matched_files ; ++i) {
         metalogfile = metalogfiles[i];
         db_lock();
@@ -421,6 +426,8 @@ static int scan_metalog_files(struct metalog_instance *ctx)
         freez(metalogfile);
     }
     matched_files -= failed_to_load;
+    info("Metadata log files in \"%s\" were replayed in %llu ms.", dbfiles_path,
+         (now_monotonic_usec() - started_ut) / USEC_PER_MS);
     debug(D_METADATALOG, "PARSER ended");
 
     parser_destroy(parser);
@@ -108,6 +108,9 @@ void pg_cache_wake_up_waiters(struct rrdengine_instance *ctx, struct rrdeng_page
     rrdeng_page_descr_mutex_unlock(ctx, descr);
 }
 
+// the time spent waiting for pages to be loaded or released by others
+LATENCY_HISTOGRAM pg_cache_wait_histogram = LATENCY_HISTOGRAM_INITIALIZER("pg_cache_wait");
+
 /*
  * The caller must hold page descriptor lock.
  * The lock will be released and re-acquired. The descriptor is not guaranteed
@@ -116,10 +119,13 @@ void pg_cache_wake_up_waiters(struct rrdengine_instance *ctx, struct rrdeng_page
 void pg_cache_wait_event_unsafe(struct rrdeng_page_descr *descr)
 {
     struct page_cache_descr *pg_cache_descr = descr->pg_cache_descr;
+    usec_t started_ut = now_monotonic_high_precision_usec();
 
     ++pg_cache_descr->waiters;
     uv_cond_wait(&pg_cache_descr->cond, &pg_cache_descr->mutex);
     --pg_cache_descr->waiters;
+
+    latency_histogram_add(&pg_cache_wait_histogram, now_monotonic_high_precision_usec() - started_ut);
 }
 
 /*
@@ -132,11 +138,13 @@ int pg_cache_timedwait_event_unsafe(struct rrdeng_page_descr *descr, uint64_t ti
 {
     int ret;
     struct page_cache_descr *pg_cache_descr = descr->pg_cache_descr;
+    usec_t started_ut = now_monotonic_high_precision_usec();
 
     ++pg_cache_descr->waiters;
     ret = uv_cond_timedwait(&pg_cache_descr->cond, &pg_cache_descr->mutex, timeout_sec * NSEC_PER_SEC);
     --pg_cache_descr->waiters;
 
+    latency_histogram_add(&pg_cache_wait_histogram, now_monotonic_high_precision_usec() - started_ut);
     return ret;
 }
 
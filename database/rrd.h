@@ -24,6 +24,7 @@ struct label;
 struct rrdeng_page_descr;
 struct rrdengine_instance;
 struct pg_cache_page_index;
+struct prometheus_dimension_cache;
 #endif
 
 #include "../daemon/common.h"
@@ -204,6 +205,7 @@ typedef enum skip_escaped_characters {
 
 char *translate_label_source(LABEL_SOURCE l);
 struct label *create_label(char *key, char *value, LABEL_SOURCE label_source);
+extern void free_label(struct label *label);
 extern struct label *add_label_to_list(struct label *l, char *key, char *value, LABEL_SOURCE label_source);
 extern void update_label_list(struct label **labels, struct label *new_labels);
 extern void replace_label_list(struct label_index *labels, struct label *new_labels);
@@ -358,6 +360,53 @@ struct rrddim_query_handle {
 };
 
 
+// ----------------------------------------------------------------------------
+// running sums of the values stored per RRD dimension
+//
+// When enabled, rrdset_done() keeps the cumulative sum and count of the stored
+// points of every dimension that has been read, for the last
+// RRDDIM_ACCUMULATOR_SLOTS points.
+// Consumers keep a cursor with the cumulative values at the end of the last
+// timeframe they read, so that the sum of any following timeframe is the
+// difference of two cumulative values, without querying the database.
+// The cumulative values are rebased every RRDDIM_ACCUMULATOR_REBASE_POINTS
+// points and on gaps, to keep them precise, invalidating older cursors.
+// The accumulator of a dimension (about 400 bytes, with long double values)
+// is allocated by its first read, so only the dimensions of the charts
+// exported with the average or sum data source pay for it.
+
+#define RRDDIM_ACCUMULATOR_SLOTS 8
+#define RRDDIM_ACCUMULATOR_REBASE_POINTS 3600
+
+struct rrddim_accumulator_slot {
+    time_t point_in_time;               // the time of the point, 0 when the slot is empty
+    calculated_number sum;              // the sum of the stored values, up to and including this point
+    uint32_t count;                     // the number of the existing stored values, up to and including this point
+    uint32_t epoch;                     // the rebase this point belongs to
+};
+
+struct rrddim_accumulator {
+    uint32_t seq;                       // odd while the collector updates the accumulator
+    uint32_t epoch;                     // incremented on every rebase
+    uint32_t points;                    // the points added since the last rebase
+    time_t last_point_in_time;          // the time of the last point added
+
+    struct rrddim_accumulator_slot slots[RRDDIM_ACCUMULATOR_SLOTS];
+};
+
+struct rrddim_accumulator_cursor {
+    time_t point_in_time;               // the last point read, 0 when the cursor is not valid
+    calculated_number sum;
+    uint32_t count;
+    uint32_t epoch;
+};
+
+extern int rrddim_accumulators_enabled;
+
+extern void rrddim_accumulator_add(RRDDIM *rd, usec_t point_in_time, storage_number n);
+extern int rrddim_accumulator_read(RRDDIM *rd, struct rrddim_accumulator_cursor *cursor, time_t after, time_t before,
+                                   calculated_number *sum, size_t *count);
+
 // ----------------------------------------------------------------------------
 // volatile state per RRD dimension
 struct rrddim_volatile {
@@ -402,6 +451,10 @@ struct rrddim_volatile {
         // get the timestamp of the first entry of this metric
         time_t (*oldest_time)(RRDDIM *rd);
     } query_ops;
+
+    struct rrddim_accumulator *accumulator;                 // running sums of the stored values, when read
+    struct rrddim_accumulator_cursor *exporting_cursors;    // one per exporting connector instance
+    struct prometheus_dimension_cache *prometheus_cache;    // the metric name and labels for /api/v1/allmetrics
 };
 
 // ----------------------------------------------------------------------------
@@ -532,7 +585,10 @@ struct rrdset {
     size_t compaction_id;                           // The last metadata log compaction procedure that has processed
                                                     // this object.
     struct rrdset_volatile *state;                  // volatile state that is not persistently stored
-    size_t unused[2];
+    size_t metadata_version;                        // incremented when the name, the context or the dimension
+                                                    // names and algorithms change, so that anything derived
+                                                    // from them can be invalidated
+    size_t unused[1];
 
     size_t rrddim_page_alignment;                   // keeps metric pages in alignment when using dbengine
 
@@ -579,8 +635,8 @@ struct rrdset {
 
 };
 
-#define rrdset_rdlock(st) netdata_rwlock_rdlock(&((st)->rrdset_rwlock))
-#define rrdset_wrlock(st) netdata_rwlock_wrlock(&((st)->rrdset_rwlock))
+#define rrdset_rdlock(st) netdata_rwlock_rdlock_class(&((st)->rrdset_rwlock), "rrdset")
+#define rrdset_wrlock(st) netdata_rwlock_wrlock_class(&((st)->rrdset_rwlock), "rrdset")
 #define rrdset_unlock(st) netdata_rwlock_unlock(&((st)->rrdset_rwlock))
 
 
@@ -804,6 +860,14 @@ struct rrdhost {
     uint32_t health_default_warn_repeat_every;      // the default value for the interval between repeating warning notifications
     uint32_t health_default_crit_repeat_every;      // the default value for the interval between repeating critical notifications
 
+    struct health_worker *health_worker;            // the health worker thread evaluating the alarms of this host
+    size_t health_heap_index;                       // the position of this host in the timer heap of its health worker
+    time_t health_next_run;                         // the next time the alarms of this host should be evaluated
+    usec_t health_evaluation_usec;                  // the duration of the last evaluation of the alarms of this host
+    usec_t health_lag_usec;                         // how late the last evaluation of the alarms of this host started
+    RRDDIM *health_rd_evaluation_time;              // the dimension of this host on the health evaluation time chart
+    RRDDIM *health_rd_lag;                          // the dimension of this host on the health lag chart
+
 
     // all RRDCALCs are primarily allocated and linked here
     // RRDCALCs may be linked to charts at any point
@@ -848,6 +912,8 @@ struct rrdhost {
 
     avl_tree_lock rrdfamily_root_index;             // the host's chart families index
     avl_tree_lock rrdvar_root_index;                // the host's chart variables index
+    size_t rrdvar_generation;                       // incremented when variables are added to or removed from
+                                                    // the chart, family and host variables indexes of this host
 
 #ifdef ENABLE_DBENGINE
     struct rrdengine_instance *rrdeng_ctx;          // DB engine instance for this host
@@ -868,8 +934,8 @@ struct rrdhost {
 };
 extern RRDHOST *localhost;
 
-#define rrdhost_rdlock(host) netdata_rwlock_rdlock(&((host)->rrdhost_rwlock))
-#define rrdhost_wrlock(host) netdata_rwlock_wrlock(&((host)->rrdhost_rwlock))
+#define rrdhost_rdlock(host) netdata_rwlock_rdlock_class(&((host)->rrdhost_rwlock), "rrdhost")
+#define rrdhost_wrlock(host) netdata_rwlock_wrlock_class(&((host)->rrdhost_rwlock), "rrdhost")
 #define rrdhost_unlock(host) netdata_rwlock_unlock(&((host)->rrdhost_rwlock))
 
 #define rrdhost_aclk_state_lock(host) netdata_mutex_lock(&((host)->aclk_state_lock))
@@ -890,8 +956,8 @@ extern RRDHOST *localhost;
 
 extern netdata_rwlock_t rrd_rwlock;
 
-#define rrd_rdlock() netdata_rwlock_rdlock(&rrd_rwlock)
-#define rrd_wrlock() netdata_rwlock_wrlock(&rrd_rwlock)
+#define rrd_rdlock() netdata_rwlock_rdlock_class(&rrd_rwlock, "rrd")
+#define rrd_wrlock() netdata_rwlock_wrlock_class(&rrd_rwlock, "rrd")
 #define rrd_unlock() netdata_rwlock_unlock(&rrd_rwlock)
 
 // ----------------------------------------------------------------------------
@@ -1049,6 +1115,7 @@ extern void rrdset_next_usec(RRDSET *st, usec_t microseconds);
 #define rrdset_next(st) rrdset_next_usec(st, 0ULL)
 
 extern void rrdset_done(RRDSET *st);
+extern LATENCY_HISTOGRAM rrdset_done_histogram;
 
 extern void rrdset_is_obsolete(RRDSET *st);
 extern void rrdset_isnot_obsolete(RRDSET *st);
@@ -1082,7 +1149,7 @@ static inline time_t rrdset_last_entry_t(RRDSET *st)
 {
     time_t last_entry_t;
 
-    netdata_rwlock_rdlock(&st->rrdset_rwlock);
+    rrdset_rdlock(st);
     last_entry_t = rrdset_last_entry_t_nolock(st);
     netdata_rwlock_unlock(&st->rrdset_rwlock);
 
@@ -1111,7 +1178,7 @@ static inline time_t rrdset_first_entry_t(RRDSET *st)
 {
     time_t first_entry_t;
 
-    netdata_rwlock_rdlock(&st->rrdset_rwlock);
+    rrdset_rdlock(st);
     first_entry_t = rrdset_first_entry_t_nolock(st);
     netdata_rwlock_unlock(&st->rrdset_rwlock);
 
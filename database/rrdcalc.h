@@ -74,6 +74,7 @@ struct rrdcalc {
     int before;                     // ending point in time-series
     int after;                      // starting point in time-series
     uint32_t options;               // calculation options
+    struct rrdr_window *window;     // the points of the lookup, maintained incrementally between evaluations
 
     // ------------------------------------------------------------------------
     // expressions related to the alarm
@@ -81,6 +82,7 @@ struct rrdcalc {
     EVAL_EXPRESSION *calculation;   // expression to calculate the value of the alarm
     EVAL_EXPRESSION *warning;       // expression to check the warning condition
     EVAL_EXPRESSION *critical;      // expression to check the critical condition
+    size_t rrdvar_generation;       // the variables generation of the host the expressions are bound to
 
     // ------------------------------------------------------------------------
     // notification delay settings
@@ -65,7 +65,8 @@ static inline int rrdcalctemplate_test_additional_restriction(RRDCALCTEMPLATE *r
  * @param st is the chart where the alarm will be attached.
  */
 void rrdcalctemplate_link_matching_test(RRDCALCTEMPLATE *rt, RRDSET *st, RRDHOST *host) {
-    if(rt->hash_context == st->hash_context && !strcmp(rt->context, st->context) &&
+    // contexts are interned, equal contexts are the same pointer
+    if(rt->context == st->context &&
         rrdcalctemplate_test_additional_restriction(rt, st) ) {
         if (!rrdcalctemplate_is_there_label_restriction(rt, host)) {
             RRDCALC *rc = rrdcalc_create_from_template(host, rt, st->id);
@@ -114,7 +115,7 @@ inline void rrdcalctemplate_free(RRDCALCTEMPLATE *rt) {
     freez(rt->name);
     freez(rt->exec);
     freez(rt->recipient);
-    freez(rt->context);
+    string_freez(rt->context);
     freez(rt->source);
     freez(rt->units);
     freez(rt->info);
@@ -35,6 +35,7 @@ static inline void calc_link_to_rrddim(RRDDIM *rd)
 int rrddim_compare(void* a, void* b) {
     if(((RRDDIM *)a)->hash < ((RRDDIM *)b)->hash) return -1;
     else if(((RRDDIM *)a)->hash > ((RRDDIM *)b)->hash) return 1;
+    else if(((RRDDIM *)a)->id == ((RRDDIM *)b)->id) return 0;
     else return strcmp(((RRDDIM *)a)->id, ((RRDDIM *)b)->id);
 }
 
@@ -75,6 +76,7 @@ inline int rrddim_set_name(RRDSET *st, RRDDIM *rd, const char *name) {
     rd->hash_name = simple_hash(rd->name);
     rrddimvar_rename_all(rd);
     rd->exposed = 0;
+    st->metadata_version++;
     rrdset_flag_clear(st, RRDSET_FLAG_UPSTREAM_EXPOSED);
     return 1;
 }
@@ -86,6 +88,7 @@ inline int rrddim_set_algorithm(RRDSET *st, RRDDIM *rd, RRD_ALGORITHM algorithm)
     debug(D_RRD_CALLS, "Updating algorithm of dimension '%s/%s' from %s to %s", st->id, rd->name, rrd_algorithm_name(rd->algorithm), rrd_algorithm_name(algorithm));
     rd->algorithm = algorithm;
     rd->exposed = 0;
+    st->metadata_version++;
     rrdset_flag_set(st, RRDSET_FLAG_HOMOGENEOUS_CHECK);
     rrdset_flag_clear(st, RRDSET_FLAG_UPSTREAM_EXPOSED);
     return 1;
@@ -179,6 +182,110 @@ static time_t rrddim_query_oldest_time(RRDDIM *rd) {
 }
 
 
+// ----------------------------------------------------------------------------
+// RRDDIM running sums of the stored values
+
+int rrddim_accumulators_enabled = 0;
+
+// called by the collector for every point stored - the only writer of the accumulator
+void rrddim_accumulator_add(RRDDIM *rd, usec_t point_in_time, storage_number n) {
+    struct rrddim_accumulator *acc = __atomic_load_n(&rd->state->accumulator, __ATOMIC_ACQUIRE);
+    if(likely(!acc))
+        // nobody reads this dimension
+        return;
+
+    time_t update_every = rd->rrdset->update_every;
+    time_t t = (time_t)(point_in_time / USEC_PER_SEC);
+
+    calculated_number sum = 0;
+    uint32_t count = 0;
+
+    __atomic_store_n(&acc->seq, acc->seq + 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+
+    if(unlikely(!acc->last_point_in_time || t != acc->last_point_in_time + update_every || acc->points >= RRDDIM_ACCUMULATOR_REBASE_POINTS)) {
+        // first point, a gap, or time to rebase
+        acc->epoch++;
+        acc->points = 0;
+    }
+    else {
+        struct rrddim_accumulator_slot *last = &acc->slots[(acc->last_point_in_time / update_every) % RRDDIM_ACCUMULATOR_SLOTS];
+        sum = last->sum;
+        count = last->count;
+    }
+
+    if(likely(does_storage_number_exist(n))) {
+        sum += unpack_storage_number(n);
+        count++;
+    }
+
+    struct rrddim_accumulator_slot *slot = &acc->slots[(t / update_every) % RRDDIM_ACCUMULATOR_SLOTS];
+    slot->point_in_time = t;
+    slot->sum = sum;
+    slot->count = count;
+    slot->epoch = acc->epoch;
+
+    acc->points++;
+    acc->last_point_in_time = t;
+
+    __atomic_store_n(&acc->seq, acc->seq + 1, __ATOMIC_RELEASE);
+}
+
+// returns 1 and the sum and count of the points in [after, before], when the cursor ends at after - update_every
+// the cursor is moved to before, when the accumulator still has it
+int rrddim_accumulator_read(RRDDIM *rd, struct rrddim_accumulator_cursor *cursor, time_t after, time_t before,
+                            calculated_number *sum, size_t *count) {
+    struct rrddim_accumulator *acc = __atomic_load_n(&rd->state->accumulator, __ATOMIC_ACQUIRE);
+    if(unlikely(!acc)) {
+        // the first read of this dimension - the collector adds the points that follow
+        struct rrddim_accumulator *expected = NULL;
+
+        acc = callocz(1, sizeof(struct rrddim_accumulator));
+        if(!__atomic_compare_exchange_n(&rd->state->accumulator, &expected, acc, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+            // another reader was faster
+            freez(acc);
+
+        cursor->point_in_time = 0;
+        return 0;
+    }
+
+    time_t update_every = rd->rrdset->update_every;
+    struct rrddim_accumulator_slot slot;
+    int retries = 3;
+    uint32_t seq1, seq2;
+    do {
+        seq1 = __atomic_load_n(&acc->seq, __ATOMIC_ACQUIRE);
+        slot = acc->slots[(before / update_every) % RRDDIM_ACCUMULATOR_SLOTS];
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        seq2 = __atomic_load_n(&acc->seq, __ATOMIC_RELAXED);
+    } while(unlikely((seq1 != seq2 || (seq1 & 1)) && --retries));
+
+    if(unlikely(seq1 != seq2 || (seq1 & 1)))
+        // the collector is too busy with this dimension
+        slot.point_in_time = 0;
+
+    if(unlikely(slot.point_in_time != before)) {
+        // not collected yet, or already overwritten
+        cursor->point_in_time = 0;
+        return 0;
+    }
+
+    int ret = 0;
+    if(likely(cursor->point_in_time && cursor->point_in_time + update_every == after && cursor->epoch == slot.epoch)) {
+        *sum = slot.sum - cursor->sum;
+        *count = slot.count - cursor->count;
+        ret = 1;
+    }
+
+    cursor->point_in_time = slot.point_in_time;
+    cursor->sum = slot.sum;
+    cursor->count = slot.count;
+    cursor->epoch = slot.epoch;
+
+    return ret;
+}
+
+
 // ----------------------------------------------------------------------------
 // RRDDIM create a dimension
 
@@ -350,8 +457,8 @@ RRDDIM *rrddim_add_custom(RRDSET *st, const char *id, const char *name, collecte
 
     strcpy(rd->magic, RRDDIMENSION_MAGIC);
 
-    rd->id = strdupz(id);
-    rd->hash = simple_hash(rd->id);
+    rd->id = string_strdupz(id);
+    rd->hash = string_hash(rd->id);
 
     rd->cache_filename = strdupz(fullfilename);
 
@@ -392,6 +499,9 @@ RRDDIM *rrddim_add_custom(RRDSET *st, const char *id, const char *name, collecte
     rd->last_collected_time.tv_usec = 0;
     rd->rrdset = st;
     rd->state = mallocz(sizeof(*rd->state));
+    rd->state->accumulator = NULL;
+    rd->state->exporting_cursors = NULL;
+    rd->state->prometheus_cache = NULL;
     if(memory_mode == RRD_MEMORY_MODE_DBENGINE) {
 #ifdef ENABLE_DBENGINE
         uuid_t *dim_uuid = find_dimension_uuid(st, rd);
@@ -510,8 +620,11 @@ void rrddim_free_custom(RRDSET *st, RRDDIM *rd, int db_rotated)
         case RRD_MEMORY_MODE_MAP:
         case RRD_MEMORY_MODE_RAM:
             debug(D_RRD_CALLS, "Unmapping dimension '%s'.", rd->name);
-            freez((void *)rd->id);
+            string_freez(rd->id);
             freez(rd->cache_filename);
+            freez(rd->state->accumulator);
+            freez(rd->state->exporting_cursors);
+            freez(rd->state->prometheus_cache);
             freez(rd->state);
             munmap(rd, rd->memsize);
             break;
@@ -520,13 +633,16 @@ void rrddim_free_custom(RRDSET *st, RRDDIM *rd, int db_rotated)
         case RRD_MEMORY_MODE_NONE:
         case RRD_MEMORY_MODE_DBENGINE:
             debug(D_RRD_CALLS, "Removing dimension '%s'.", rd->name);
-            freez((void *)rd->id);
+            string_freez(rd->id);
             freez(rd->cache_filename);
 #ifdef ENABLE_DBENGINE
             if (rrd_memory_mode == RRD_MEMORY_MODE_DBENGINE) {
                 freez(rd->state->metric_uuid);
             }
 #endif
+            freez(rd->state->accumulator);
+            freez(rd->state->exporting_cursors);
+            freez(rd->state->prometheus_cache);
             freez(rd->state);
             freez(rd);
             break;
@@ -28,8 +28,8 @@ RRDFAMILY *rrdfamily_create(RRDHOST *host, const char *id) {
     if(!rc) {
         rc = callocz(1, sizeof(RRDFAMILY));
 
-        rc->family = strdupz(id);
-        rc->hash_family = simple_hash(rc->family);
+        rc->family = string_strdupz(id);
+        rc->hash_family = string_hash(rc->family);
 
         // initialize the variables index
         avl_init_lock(&rc->rrdvar_root_index, rrdvar_compare);
@@ -53,7 +53,7 @@ void rrdfamily_free(RRDHOST *host, RRDFAMILY *rc) {
             debug(D_RRD_CALLS, "RRDFAMILY: Cleaning up remaining family variables for host '%s', family '%s'", host->hostname, rc->family);
             rrdvar_free_remaining_variables(host, &rc->rrdvar_root_index);
 
-            freez((void *) rc->family);
+            string_freez(rc->family);
             freez(rc);
         }
     }
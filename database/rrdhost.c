@@ -835,6 +835,7 @@ void rrdhost_free(RRDHOST *host) {
     debug(D_RRD_CALLS, "RRDHOST: Cleaning up remaining host variables for host '%s'", host->hostname);
     rrdvar_free_remaining_variables(host, &host->rrdvar_root_index);
 
+    health_host_unschedule(host);
     health_alarm_log_free(host);
 
 #ifdef ENABLE_DBENGINE
@@ -1206,7 +1207,7 @@ static struct label *rrdhost_load_kubernetes_labels(void)
                 while (ll != NULL) {
                     info("Ignoring Label [source id=%s]: \"%s\" -> \"%s\"\n", translate_label_source(ll->label_source), ll->key, ll->value);
                     ll = ll->next;
-                    freez(l);
+                    free_label(l);
                     l=ll;
                 }
             }
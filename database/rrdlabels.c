@@ -80,32 +80,31 @@ char *strip_double_quotes(char *str, SKIP_ESCAPED_CHARACTERS_OPTION skip_escaped
     return str;
 }
 
+// the keys and the values of labels are interned, since all hosts and charts share a few of them
 struct label *create_label(char *key, char *value, LABEL_SOURCE label_source)
 {
-    size_t key_len = strlen(key), value_len = strlen(value);
-    size_t n = sizeof(struct label) + key_len + 1 + value_len + 1;
-    struct label *result = callocz(1,n);
-    if (result != NULL) {
-        char *c = (char *)result;
-        c += sizeof(struct label);
-        strcpy(c, key);
-        result->key = c;
-        c += key_len + 1;
-        strcpy(c, value);
-        result->value = c;
-        result->label_source = label_source;
-        result->key_hash = simple_hash(result->key);
-    }
+    struct label *result = callocz(1, sizeof(struct label));
+    result->key = (char *)string_strdupz(key);
+    result->value = (char *)string_strdupz(value);
+    result->label_source = label_source;
+    result->key_hash = string_hash(result->key);
     return result;
 }
 
+void free_label(struct label *label)
+{
+    string_freez(label->key);
+    string_freez(label->value);
+    freez(label);
+}
+
 void free_label_list(struct label *labels)
 {
     while (labels != NULL)
     {
         struct label *current = labels;
         labels = labels->next;
-        freez(current);
+        free_label(current);
     }
 }
 
@@ -174,7 +173,7 @@ struct label *merge_label_lists(struct label *lo_pri, struct label *hi_pri)
             result = current;
         }
         else
-            freez(current);
+            free_label(current);
     }
     return result;
 }
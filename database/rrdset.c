@@ -175,6 +175,8 @@ int rrdset_set_name(RRDSET *st, const char *name) {
     if(unlikely(rrdset_index_add_name(host, st) != st))
         error("RRDSET: INTERNAL ERROR: attempted to index duplicate chart name '%s'", st->name);
 
+    st->metadata_version++;
+
     rrdset_flag_clear(st, RRDSET_FLAG_BACKEND_SEND);
     rrdset_flag_clear(st, RRDSET_FLAG_BACKEND_IGNORE);
     rrdset_flag_clear(st, RRDSET_FLAG_UPSTREAM_SEND);
@@ -379,11 +381,16 @@ void rrdset_free(RRDSET *st) {
 
     // free directly allocated members
     freez(st->config_section);
-    freez(st->plugin_name);
-    freez(st->module_name);
-    freez(st->state->old_title);
-    freez(st->state->old_family);
-    freez(st->state->old_context);
+    string_freez(st->plugin_name);
+    string_freez(st->module_name);
+    string_freez(st->type);
+    string_freez(st->family);
+    string_freez(st->title);
+    string_freez(st->units);
+    string_freez(st->context);
+    string_freez(st->state->old_title);
+    string_freez(st->state->old_family);
+    string_freez(st->state->old_context);
     free_label_list(st->state->labels.head);
     freez(st->state);
 
@@ -481,6 +488,16 @@ void rrdset_delete_obsolete_dimensions(RRDSET *st) {
 // ----------------------------------------------------------------------------
 // RRDSET - create a chart
 
+// the strings of charts are interned, since all hosts run the same collectors
+static inline char *rrdset_strdupz_json_fixed(const char *s) {
+    char *t = strdupz(s);
+    json_fix_string(t);
+
+    char *ret = (char *)string_strdupz(t);
+    freez(t);
+    return ret;
+}
+
 static inline RRDSET *rrdset_find_on_create(RRDHOST *host, const char *fullid) {
     RRDSET *st = rrdset_find(host, fullid);
     if(unlikely(st)) {
@@ -578,13 +595,13 @@ RRDSET *rrdset_create_custom(
         if (plugin && st->plugin_name) {
             if (unlikely(strcmp(plugin, st->plugin_name))) {
                 old_plugin = st->plugin_name;
-                st->plugin_name = strdupz(plugin);
+                st->plugin_name = (char *)string_strdupz(plugin);
                 mark_rebuild |= META_PLUGIN_UPDATED;
             }
         } else {
             if (plugin != st->plugin_name) { // one is NULL?
                 old_plugin = st->plugin_name;
-                st->plugin_name = plugin ? strdupz(plugin) : NULL;
+                st->plugin_name = (char *)string_strdupz(plugin);
                 mark_rebuild |= META_PLUGIN_UPDATED;
             }
         }
@@ -592,26 +609,24 @@ RRDSET *rrdset_create_custom(
         if (module && st->module_name) {
             if (unlikely(strcmp(module, st->module_name))) {
                 old_module = st->module_name;
-                st->module_name = strdupz(module);
+                st->module_name = (char *)string_strdupz(module);
                 mark_rebuild |= META_MODULE_UPDATED;
             }
         } else {
             if (module != st->module_name) {
                 if (st->module_name && *st->module_name) {
                     old_module = st->module_name;
-                    st->module_name = module ? strdupz(module) : NULL;
+                    st->module_name = (char *)string_strdupz(module);
                     mark_rebuild |= META_MODULE_UPDATED;
                 }
             }
         }
 
         if (unlikely(title && st->state->old_title && strcmp(st->state->old_title, title))) {
-            char *new_title = strdupz(title);
             old_title_v = st->state->old_title;
-            st->state->old_title = strdupz(title);
-            json_fix_string(new_title);
+            st->state->old_title = (char *)string_strdupz(title);
             old_title = st->title;
-            st->title = new_title;
+            st->title = rrdset_strdupz_json_fixed(title);
             mark_rebuild |= META_CHART_UPDATED;
         }
 
@@ -623,13 +638,12 @@ RRDSET *rrdset_create_custom(
         }
 
         if (unlikely(context && st->state->old_context && strcmp(st->state->old_context, context))) {
-            char *new_context = strdupz(context);
             old_context_v = st->state->old_context;
-            st->state->old_context = strdupz(context);
-            json_fix_string(new_context);
+            st->state->old_context = (char *)string_strdupz(context);
             old_context = st->context;
-            st->context = new_context;
-            st->hash_context = simple_hash(st->context);
+            st->context = rrdset_strdupz_json_fixed(context);
+            st->hash_context = string_hash(st->context);
+            st->metadata_version++;
             mark_rebuild |= META_CHART_UPDATED;
         }
 
@@ -650,14 +664,14 @@ RRDSET *rrdset_create_custom(
                 rrdset_flag_set(st, RRDSET_FLAG_ACLK);
             }
 #endif
-            freez(old_plugin);
-            freez(old_module);
-            freez(old_title);
-            freez(old_family);
-            freez(old_context);
-            freez(old_title_v);
-            freez(old_family_v);
-            freez(old_context_v);
+            string_freez(old_plugin);
+            string_freez(old_module);
+            string_freez(old_title);
+            string_freez(old_family);
+            string_freez(old_context);
+            string_freez(old_title_v);
+            string_freez(old_family_v);
+            string_freez(old_context_v);
             if (mark_rebuild != META_CHART_ACTIVATED) {
                 info("Collector updated metadata for chart %s", st->id);
                 sched_yield();
@@ -824,8 +838,8 @@ RRDSET *rrdset_create_custom(
             st->rrd_memory_mode = (memory_mode == RRD_MEMORY_MODE_NONE) ? RRD_MEMORY_MODE_NONE : RRD_MEMORY_MODE_ALLOC;
     }
 
-    st->plugin_name = plugin?strdupz(plugin):NULL;
-    st->module_name = module?strdupz(module):NULL;
+    st->plugin_name = (char *)string_strdupz(plugin);
+    st->module_name = (char *)string_strdupz(module);
 
     st->config_section = strdupz(config_section);
     st->rrdhost = host;
@@ -844,20 +858,19 @@ RRDSET *rrdset_create_custom(
     st->cache_dir = cache_dir;
 
     st->chart_type = rrdset_type_id(config_get(st->config_section, "chart type", rrdset_type_name(chart_type)));
-    st->type       = config_get(st->config_section, "type", type);
+    st->type       = (char *)string_strdupz(config_get(st->config_section, "type", type));
 
     st->state = callocz(1, sizeof(*st->state));
-    st->family     = config_get(st->config_section, "family", family?family:st->type);
-    st->state->old_family = strdupz(st->family);
-    json_fix_string(st->family);
+    const char *s  = config_get(st->config_section, "family", family?family:st->type);
+    st->state->old_family = (char *)string_strdupz(s);
+    st->family     = rrdset_strdupz_json_fixed(s);
 
-    st->units      = config_get(st->config_section, "units", units?units:"");
-    json_fix_string(st->units);
+    st->units      = rrdset_strdupz_json_fixed(config_get(st->config_section, "units", units?units:""));
 
-    st->context    = config_get(st->config_section, "context", context?context:st->id);
-    st->state->old_context = strdupz(st->context);
-    json_fix_string(st->context);
-    st->hash_context = simple_hash(st->context);
+    s              = config_get(st->config_section, "context", context?context:st->id);
+    st->state->old_context = (char *)string_strdupz(s);
+    st->context    = rrdset_strdupz_json_fixed(s);
+    st->hash_context = string_hash(st->context);
 
     st->priority = config_get_number(st->config_section, "priority", priority);
     if(enabled)
@@ -907,9 +920,9 @@ RRDSET *rrdset_create_custom(
         // could not use the name, use the id
         rrdset_set_name(st, id);
 
-    st->title = config_get(st->config_section, "title", title);
-    st->state->old_title = strdupz(st->title);
-    json_fix_string(st->title);
+    s              = config_get(st->config_section, "title", title);
+    st->state->old_title = (char *)string_strdupz(s);
+    st->title      = rrdset_strdupz_json_fixed(s);
 
     st->rrdfamily = rrdfamily_create(host, st->family);
 
@@ -1117,6 +1130,13 @@ static inline usec_t rrdset_init_last_updated_time(RRDSET *st) {
     return last_updated_ut;
 }
 
+static inline void rrdset_done_store_metric(RRDDIM *rd, usec_t point_in_time, storage_number n) {
+    rd->state->collect_ops.store_metric(rd, point_in_time, n);
+
+    if(unlikely(rrddim_accumulators_enabled))
+        rrddim_accumulator_add(rd, point_in_time, n);
+}
+
 static inline size_t rrdset_done_interpolate(
         RRDSET *st
         , usec_t update_every_ut
@@ -1237,13 +1257,13 @@ static inline size_t rrdset_done_interpolate(
             }
 
             if(unlikely(!store_this_entry)) {
-                rd->state->collect_ops.store_metric(rd, next_store_ut, SN_EMPTY_SLOT); //pack_storage_number(0, SN_NOT_EXISTS)
+                rrdset_done_store_metric(rd, next_store_ut, SN_EMPTY_SLOT); //pack_storage_number(0, SN_NOT_EXISTS)
 //                rd->values[current_entry] = SN_EMPTY_SLOT; //pack_storage_number(0, SN_NOT_EXISTS);
                 continue;
             }
 
             if(likely(rd->updated && rd->collections_counter > 1 && iterations < st->gap_when_lost_iterations_above)) {
-                rd->state->collect_ops.store_metric(rd, next_store_ut, pack_storage_number(new_value, storage_flags));
+                rrdset_done_store_metric(rd, next_store_ut, pack_storage_number(new_value, storage_flags));
 //                rd->values[current_entry] = pack_storage_number(new_value, storage_flags );
                 rd->last_stored_value = new_value;
 
@@ -1267,7 +1287,7 @@ static inline size_t rrdset_done_interpolate(
                 #endif
 
 //                rd->values[current_entry] = SN_EMPTY_SLOT; // pack_storage_number(0, SN_NOT_EXISTS);
-                rd->state->collect_ops.store_metric(rd, next_store_ut, SN_EMPTY_SLOT); //pack_storage_number(0, SN_NOT_EXISTS)
+                rrdset_done_store_metric(rd, next_store_ut, SN_EMPTY_SLOT); //pack_storage_number(0, SN_NOT_EXISTS)
                 rd->last_stored_value = NAN;
             }
 
@@ -1359,9 +1379,7 @@ static inline void rrdset_done_fill_the_gap(RRDSET *st) {
     }
 }
 
-void rrdset_done(RRDSET *st) {
-    if(unlikely(netdata_exit)) return;
-
+static void rrdset_done_internal(RRDSET *st) {
     debug(D_RRD_CALLS, "rrdset_done() for chart %s", st->name);
 
     RRDDIM *rd;
@@ -1922,6 +1940,16 @@ void rrdset_done(RRDSET *st) {
     netdata_thread_enable_cancelability();
 }
 
+LATENCY_HISTOGRAM rrdset_done_histogram = LATENCY_HISTOGRAM_INITIALIZER("rrdset_done");
+
+void rrdset_done(RRDSET *st) {
+    if(unlikely(netdata_exit)) return;
+
+    usec_t started_ut = now_monotonic_high_precision_usec();
+    rrdset_done_internal(st);
+    latency_histogram_add(&rrdset_done_histogram, now_monotonic_high_precision_usec() - started_ut);
+}
+
 void rrdset_add_label_to_new_list(RRDSET *st, char *key, char *value, LABEL_SOURCE source)
 {
     st->state->new_labels = add_label_to_list(st->state->new_labels, key, value, source);
@@ -66,17 +66,17 @@ static inline void rrdsetvar_create_variables(RRDSETVAR *rs) {
 
     // ------------------------------------------------------------------------
     // CHART
-    rs->var_local       = rrdvar_create_and_index("local",  &st->rrdvar_root_index, rs->variable, rs->type, options, rs->value);
+    rs->var_local       = rrdvar_create_and_index(host, "local",  &st->rrdvar_root_index, rs->variable, rs->type, options, rs->value);
 
     // ------------------------------------------------------------------------
     // FAMILY
-    rs->var_family      = rrdvar_create_and_index("family", &st->rrdfamily->rrdvar_root_index, rs->key_fullid,   rs->type, options, rs->value);
-    rs->var_family_name = rrdvar_create_and_index("family", &st->rrdfamily->rrdvar_root_index, rs->key_fullname, rs->type, options, rs->value);
+    rs->var_family      = rrdvar_create_and_index(host, "family", &st->rrdfamily->rrdvar_root_index, rs->key_fullid,   rs->type, options, rs->value);
+    rs->var_family_name = rrdvar_create_and_index(host, "family", &st->rrdfamily->rrdvar_root_index, rs->key_fullname, rs->type, options, rs->value);
 
     // ------------------------------------------------------------------------
     // HOST
-    rs->var_host        = rrdvar_create_and_index("host",   &host->rrdvar_root_index, rs->key_fullid,   rs->type, options, rs->value);
-    rs->var_host_name   = rrdvar_create_and_index("host",   &host->rrdvar_root_index, rs->key_fullname, rs->type, options, rs->value);
+    rs->var_host        = rrdvar_create_and_index(host, "host",   &host->rrdvar_root_index, rs->key_fullid,   rs->type, options, rs->value);
+    rs->var_host_name   = rrdvar_create_and_index(host, "host",   &host->rrdvar_root_index, rs->key_fullname, rs->type, options, rs->value);
 }
 
 RRDSETVAR *rrdsetvar_create(RRDSET *st, const char *variable, RRDVAR_TYPE type, void *value, RRDVAR_OPTIONS options) {
@@ -26,6 +26,13 @@ int rrdvar_compare(void* a, void* b) {
     else return strcmp(((RRDVAR *)a)->name, ((RRDVAR *)b)->name);
 }
 
+// every time a variable is added to or removed from the indexes of a host
+// the expressions of its alarms have to look up their variables again
+static inline void rrdvar_generation_increment(RRDHOST *host) {
+    if(likely(host))
+        __atomic_add_fetch(&host->rrdvar_generation, 1, __ATOMIC_RELEASE);
+}
+
 static inline RRDVAR *rrdvar_index_add(avl_tree_lock *tree, RRDVAR *rv) {
     RRDVAR *ret = (RRDVAR *)avl_insert_lock(tree, (avl *)(rv));
     if(ret != rv)
@@ -59,6 +66,9 @@ inline void rrdvar_free(RRDHOST *host, avl_tree_lock *tree, RRDVAR *rv) {
         debug(D_VARIABLES, "Deleting variable '%s'", rv->name);
         if(unlikely(!rrdvar_index_del(tree, rv)))
             error("RRDVAR: Attempted to delete variable '%s' from host '%s', but it is not found.", rv->name, host->hostname);
+
+        // the expressions bound to it have to look it up again
+        rrdvar_generation_increment(host);
     }
 
     if(rv->options & RRDVAR_OPTION_ALLOCATED)
@@ -68,7 +78,7 @@ inline void rrdvar_free(RRDHOST *host, avl_tree_lock *tree, RRDVAR *rv) {
     freez(rv);
 }
 
-inline RRDVAR *rrdvar_create_and_index(const char *scope __maybe_unused, avl_tree_lock *tree, const char *name,
+inline RRDVAR *rrdvar_create_and_index(RRDHOST *host, const char *scope __maybe_unused, avl_tree_lock *tree, const char *name,
                                        RRDVAR_TYPE type, RRDVAR_OPTIONS options, void *value) {
     char *variable = strdupz(name);
     rrdvar_fix_name(variable);
@@ -93,8 +103,12 @@ inline RRDVAR *rrdvar_create_and_index(const char *scope __maybe_unused, avl_tre
             freez(variable);
             rv = NULL;
         }
-        else
+        else {
             debug(D_VARIABLES, "Variable '%s' created in scope '%s'", variable, scope);
+
+            // the expressions that did not find it have to look it up again
+            rrdvar_generation_increment(host);
+        }
     }
     else {
         debug(D_VARIABLES, "Variable '%s' is already found in scope '%s'.", variable, scope);
@@ -132,11 +146,11 @@ inline int rrdvar_callback_for_all_host_variables(RRDHOST *host, int (*callback)
     return avl_traverse_lock(&host->rrdvar_root_index, callback, data);
 }
 
-static RRDVAR *rrdvar_custom_variable_create(const char *scope, avl_tree_lock *tree_lock, const char *name) {
+static RRDVAR *rrdvar_custom_variable_create(RRDHOST *host, const char *scope, avl_tree_lock *tree_lock, const char *name) {
     calculated_number *v = callocz(1, sizeof(calculated_number));
     *v = NAN;
 
-    RRDVAR *rv = rrdvar_create_and_index(scope, tree_lock, name, RRDVAR_TYPE_CALCULATED, RRDVAR_OPTION_CUSTOM_HOST_VAR|RRDVAR_OPTION_ALLOCATED, v);
+    RRDVAR *rv = rrdvar_create_and_index(host, scope, tree_lock, name, RRDVAR_TYPE_CALCULATED, RRDVAR_OPTION_CUSTOM_HOST_VAR|RRDVAR_OPTION_ALLOCATED, v);
     if(unlikely(!rv)) {
         freez(v);
         debug(D_VARIABLES, "Requested variable '%s' already exists - possibly 2 plugins are updating it at the same time.", name);
@@ -155,7 +169,7 @@ static RRDVAR *rrdvar_custom_variable_create(const char *scope, avl_tree_lock *t
 }
 
 RRDVAR *rrdvar_custom_host_variable_create(RRDHOST *host, const char *name) {
-    return rrdvar_custom_variable_create("host", &host->rrdvar_root_index, name);
+    return rrdvar_custom_variable_create(host, "host", &host->rrdvar_root_index, name);
 }
 
 void rrdvar_custom_host_variable_set(RRDHOST *host, RRDVAR *rv, calculated_number value) {
@@ -214,32 +228,24 @@ calculated_number rrdvar2number(RRDVAR *rv) {
     }
 }
 
-int health_variable_lookup(const char *variable, uint32_t hash, RRDCALC *rc, calculated_number *result) {
+// the RRDVAR returned remains valid until the variables generation of the host changes
+RRDVAR *health_variable_bind(const char *variable, uint32_t hash, RRDCALC *rc) {
     RRDSET *st = rc->rrdset;
-    if(!st) return 0;
+    if(!st) return NULL;
 
     RRDHOST *host = st->rrdhost;
     RRDVAR *rv;
 
     rv = rrdvar_index_find(&st->rrdvar_root_index, variable, hash);
-    if(rv) {
-        *result = rrdvar2number(rv);
-        return 1;
-    }
+    if(rv) return rv;
 
     rv = rrdvar_index_find(&st->rrdfamily->rrdvar_root_index, variable, hash);
-    if(rv) {
-        *result = rrdvar2number(rv);
-        return 1;
-    }
+    if(rv) return rv;
 
     rv = rrdvar_index_find(&host->rrdvar_root_index, variable, hash);
-    if(rv) {
-        *result = rrdvar2number(rv);
-        return 1;
-    }
+    if(rv) return rv;
 
-    return 0;
+    return NULL;
 }
 
 // ----------------------------------------------------------------------------
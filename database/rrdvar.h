@@ -60,7 +60,7 @@ extern int  rrdvar_callback_for_all_host_variables(RRDHOST *host, int (*callback
 
 extern calculated_number rrdvar2number(RRDVAR *rv);
 
-extern RRDVAR *rrdvar_create_and_index(const char *scope, avl_tree_lock *tree, const char *name, RRDVAR_TYPE type, RRDVAR_OPTIONS options, void *value);
+extern RRDVAR *rrdvar_create_and_index(RRDHOST *host, const char *scope, avl_tree_lock *tree, const char *name, RRDVAR_TYPE type, RRDVAR_OPTIONS options, void *value);
 extern void rrdvar_free(RRDHOST *host, avl_tree_lock *tree, RRDVAR *rv);
 
 #endif //NETDATA_RRDVAR_H
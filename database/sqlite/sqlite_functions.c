@@ -21,7 +21,6 @@ const char *database_config[] = {
     "delete from chart_active;",
     "delete from dimension_active;",
 
-    "delete from chart where chart_id not in (select chart_id from dimension);",
     "delete from host where host_id not in (select host_id from chart);",
     NULL
 };
@@ -29,6 +28,26 @@ const char *database_config[] = {
 sqlite3 *db_meta = NULL;
 
 static uv_mutex_t sqlite_transaction_lock;
+static __thread int db_locked_by_thread = 0;
+
+static void metadata_writer_start(void);
+static void metadata_writer_stop(void);
+static int metadata_find_pending_chart(uuid_t *host_uuid, const char *type, const char *id, const char *name, uuid_t *uuid);
+static int metadata_find_pending_dimension(uuid_t *chart_uuid, const char *id, const char *name, uuid_t *uuid);
+static int metadata_find_pending_delete(uuid_t *dimension_uuid);
+
+/*
+ * Take the database lock, unless this thread holds it already
+ * Return 1 when the lock was taken and has to be released with db_unlock()
+ */
+static inline int db_lock_unless_locked(void)
+{
+    if (db_locked_by_thread)
+        return 0;
+
+    db_lock();
+    return 1;
+}
 
 static int execute_insert(sqlite3_stmt *res)
 {
@@ -76,54 +95,42 @@ static int store_active_uuid_object(sqlite3_stmt **res, char *statement, uuid_t
  * Marks a chart with UUID as active
  * Input: UUID
  */
-void store_active_chart(uuid_t *chart_uuid)
+static void sql_write_active_chart(uuid_t *chart_uuid)
 {
-    sqlite3_stmt *res = NULL;
+    static __thread sqlite3_stmt *res = NULL;
     int rc;
 
-    if (unlikely(!db_meta)) {
-        error_report("Database has not been initialized");
-        return;
-    }
-
-    if (unlikely(!chart_uuid))
-        return;
-
     rc = store_active_uuid_object(&res, SQL_STORE_ACTIVE_CHART, chart_uuid);
     if (rc != SQLITE_DONE)
         error_report("Failed to store active chart, rc = %d", rc);
 
-    rc = sqlite3_finalize(res);
+    if (unlikely(!res))
+        return;
+
+    rc = sqlite3_reset(res);
     if (unlikely(rc != SQLITE_OK))
-        error_report("Failed to finalize statement in store active chart, rc = %d", rc);
-    return;
+        error_report("Failed to reset statement in store active chart, rc = %d", rc);
 }
 
 /*
  * Marks a dimension with UUID as active
  * Input: UUID
  */
-void store_active_dimension(uuid_t *dimension_uuid)
+static void sql_write_active_dimension(uuid_t *dimension_uuid)
 {
-    sqlite3_stmt *res = NULL;
+    static __thread sqlite3_stmt *res = NULL;
     int rc;
 
-    if (unlikely(!db_meta)) {
-        error_report("Database has not been initialized");
-        return;
-    }
-
-    if (unlikely(!dimension_uuid))
-        return;
-
     rc = store_active_uuid_object(&res, SQL_STORE_ACTIVE_DIMENSION, dimension_uuid);
     if (rc != SQLITE_DONE)
         error_report("Failed to store active dimension, rc = %d", rc);
 
-    rc = sqlite3_finalize(res);
+    if (unlikely(!res))
+        return;
+
+    rc = sqlite3_reset(res);
     if (unlikely(rc != SQLITE_OK))
-        error_report("Failed to finalize statement in store active dimension, rc = %d", rc);
-    return;
+        error_report("Failed to reset statement in store active dimension, rc = %d", rc);
 }
 
 /*
@@ -136,12 +143,16 @@ int sql_init_database(void)
     char sqlite_database[FILENAME_MAX + 1];
     int rc;
 
+    usec_t started_ut = now_monotonic_usec();
+
     fatal_assert(0 == uv_mutex_init(&sqlite_transaction_lock));
 
     snprintfz(sqlite_database, FILENAME_MAX, "%s/netdata-meta.db", netdata_configured_cache_dir);
     rc = sqlite3_open(sqlite_database, &db_meta);
     if (rc != SQLITE_OK) {
         error_report("Failed to initialize database at %s", sqlite_database);
+        sqlite3_close(db_meta);
+        db_meta = NULL;
         return 1;
     }
 
@@ -154,10 +165,14 @@ int sql_init_database(void)
             error_report("SQLite error during database setup, rc = %d (%s)", rc, err_msg);
             error_report("SQLite failed statement %s", database_config[i]);
             sqlite3_free(err_msg);
+            sqlite3_close(db_meta);
+            db_meta = NULL;
             return 1;
         }
     }
-    info("SQLite database initialization completed");
+    info("SQLite database initialization completed in %llu ms", (now_monotonic_usec() - started_ut) / USEC_PER_MS);
+
+    metadata_writer_start();
     return 0;
 }
 
@@ -171,10 +186,13 @@ void sql_close_database(void)
     if (unlikely(!db_meta))
         return;
 
+    metadata_writer_stop();
+
     info("Closing SQLite database");
-    rc = sqlite3_close(db_meta);
+    rc = sqlite3_close_v2(db_meta);
     if (unlikely(rc != SQLITE_OK))
         error_report("Error %d while closing the SQLite database", rc);
+    db_meta = NULL;
     return;
 }
 
@@ -218,6 +236,13 @@ uuid_t *find_dimension_uuid(RRDSET *st, RRDDIM *rd)
     uuid_t *uuid = NULL;
     int rc;
 
+    uuid_t pending_uuid;
+    if (metadata_find_pending_dimension(st->chart_uuid, rd->id, rd->name, &pending_uuid)) {
+        uuid = mallocz(sizeof(uuid_t));
+        uuid_copy(*uuid, pending_uuid);
+        return uuid;
+    }
+
     if (unlikely(!res)) {
         rc = sqlite3_prepare_v2(db_meta, SQL_FIND_DIMENSION_UUID, -1, &res, 0);
         if (rc != SQLITE_OK) {
@@ -248,6 +273,11 @@ uuid_t *find_dimension_uuid(RRDSET *st, RRDDIM *rd)
     if (unlikely(rc != SQLITE_OK))
         error_report("Failed to reset statement find dimension uuid, rc = %d", rc);
 
+    if (uuid && unlikely(metadata_find_pending_delete(uuid))) {
+        freez(uuid);
+        uuid = NULL;
+    }
+
 #ifdef NETDATA_INTERNAL_CHECKS
     char  uuid_str[GUID_LEN + 1];
     if (likely(uuid)) {
@@ -287,7 +317,7 @@ uuid_t *create_dimension_uuid(RRDSET *st, RRDDIM *rd)
 
 #define DELETE_DIMENSION_UUID   "delete from dimension where dim_id = @uuid;"
 
-void delete_dimension_uuid(uuid_t *dimension_uuid)
+static void sql_write_delete_dimension(uuid_t *dimension_uuid)
 {
     static __thread sqlite3_stmt *res = NULL;
     int rc;
@@ -331,6 +361,13 @@ uuid_t *find_chart_uuid(RRDHOST *host, const char *type, const char *id, const c
     uuid_t *uuid = NULL;
     int rc;
 
+    uuid_t pending_uuid;
+    if (metadata_find_pending_chart(&host->host_uuid, type, id, name, &pending_uuid)) {
+        uuid = mallocz(sizeof(uuid_t));
+        uuid_copy(*uuid, pending_uuid);
+        return uuid;
+    }
+
     if (unlikely(!res)) {
         rc = sqlite3_prepare_v2(db_meta, SQL_FIND_CHART_UUID, -1, &res, 0);
         if (rc != SQLITE_OK) {
@@ -467,7 +504,10 @@ int sql_store_host(
     if (unlikely(rc != SQLITE_OK))
         goto bind_fail;
 
+    int locked = db_lock_unless_locked();
     int store_rc = sqlite3_step(res);
+    if (locked)
+        db_unlock();
     if (unlikely(store_rc != SQLITE_DONE))
         error_report("Failed to store host %s, rc = %d", hostname, rc);
 
@@ -488,7 +528,7 @@ int sql_store_host(
  * Store a chart in the database
  */
 
-int sql_store_chart(
+static int sql_write_chart(
     uuid_t *chart_uuid, uuid_t *host_uuid, const char *type, const char *id, const char *name, const char *family,
     const char *context, const char *title, const char *units, const char *plugin, const char *module, long priority,
     int update_every, int chart_type, int memory_mode, long history_entries)
@@ -612,7 +652,7 @@ int sql_store_chart(
 /*
  * Store a dimension
  */
-int sql_store_dimension(
+static int sql_write_dimension(
     uuid_t *dim_uuid, uuid_t *chart_uuid, const char *id, const char *name, collected_number multiplier,
     collected_number divisor, int algorithm)
 {
@@ -678,6 +718,955 @@ int sql_store_dimension(
 }
 
 
+//
+// Asynchronous metadata writer
+//
+// Charts and dimensions are stored by the collector and the streaming receiver threads. Instead of an autocommit
+// INSERT for every one of them, the writes are queued to the metadata writer thread, that executes them in order,
+// in transactions of up to "metadata writer max batch" writes, waiting up to "metadata writer max delay ms" for
+// a batch to fill. The chart and dimension writes that have not been executed yet are indexed, so that the UUID
+// lookups find them.
+//
+// A thread that holds the database lock (i.e. it has started a transaction on its own) writes synchronously.
+// The writes that are not queued (the hosts, and every write when the writer is not running) take the database
+// lock too, because the writer shares the connection, and they would otherwise end up in its transaction.
+//
+// While it is idle, the writer also compacts the database every "metadata compaction every seconds": it deletes
+// up to "metadata compaction max rows" charts that are not collected and have no dimensions left (they used to be
+// deleted only at startup) and returns up to "metadata compaction max pages" free pages to the filesystem, so the
+// database and its write-ahead log stay proportional to the charts and dimensions that are still in use.
+//
+
+typedef enum metadata_cmd_type {
+    METADATA_CMD_STORE_CHART,
+    METADATA_CMD_STORE_DIMENSION,
+    METADATA_CMD_STORE_ACTIVE_CHART,
+    METADATA_CMD_STORE_ACTIVE_DIMENSION,
+    METADATA_CMD_DELETE_DIMENSION
+} METADATA_CMD_TYPE;
+
+struct metadata_cmd {
+    avl avl;                            // the index of pending chart or dimension writes, has to be first
+
+    METADATA_CMD_TYPE type;
+    int indexed;
+    usec_t queued_ut;
+
+    uuid_t uuid;                        // the chart or the dimension
+    uuid_t parent_uuid;                 // the host of a chart, the chart of a dimension
+
+    const char *id;
+    const char *name;
+
+    union {
+        struct {
+            const char *type;
+            const char *family;
+            const char *context;
+            const char *title;
+            const char *units;
+            const char *plugin;
+            const char *module;
+            long priority;
+            int update_every;
+            int chart_type;
+            int memory_mode;
+            long history_entries;
+        } chart;
+
+        struct {
+            collected_number multiplier;
+            collected_number divisor;
+            int algorithm;
+        } dimension;
+    };
+
+    struct metadata_cmd *next;
+
+    char strings[];
+};
+
+static struct metadata_writer {
+    uv_mutex_t lock;
+    uv_cond_t cond;
+    netdata_thread_t thread;
+
+    int running;
+    int exit;
+
+    size_t max_batch;
+    usec_t max_delay_ut;
+
+    struct metadata_cmd *first;
+    struct metadata_cmd *last;
+
+    avl_tree_type charts;
+    avl_tree_type dimensions;
+    avl_tree_type deleted_dimensions;
+
+    usec_t compaction_every_ut;
+    usec_t next_compaction_ut;
+    int compaction_max_rows;
+    int compaction_max_pages;
+
+    // statistics
+    size_t queued;
+    size_t written;
+    size_t transactions;
+
+    size_t compactions;
+    size_t compaction_rows;
+    size_t compaction_pages;
+    usec_t compaction_ut;
+} metadata_writer = {
+    .running = 0,
+    .first = NULL,
+    .last = NULL,
+};
+
+/*
+ * Check if the metadata writer is running, without its lock
+ * The lock is initialized only when the writer is started, and the writer clears the flag when it exits
+ */
+static inline int metadata_writer_is_running(void)
+{
+    return __atomic_load_n(&metadata_writer.running, __ATOMIC_ACQUIRE);
+}
+
+static inline int metadata_strcmp(const char *a, const char *b)
+{
+    return strcmp(a ? a : "", b ? b : "");
+}
+
+static int metadata_chart_compare(void *a, void *b)
+{
+    struct metadata_cmd *c1 = a, *c2 = b;
+    int rc;
+
+    if ((rc = uuid_compare(c1->parent_uuid, c2->parent_uuid)))
+        return rc;
+
+    if ((rc = metadata_strcmp(c1->chart.type, c2->chart.type)))
+        return rc;
+
+    return metadata_strcmp(c1->id, c2->id);
+}
+
+static int metadata_dimension_compare(void *a, void *b)
+{
+    struct metadata_cmd *c1 = a, *c2 = b;
+    int rc;
+
+    if ((rc = uuid_compare(c1->parent_uuid, c2->parent_uuid)))
+        return rc;
+
+    if ((rc = metadata_strcmp(c1->id, c2->id)))
+        return rc;
+
+    return metadata_strcmp(c1->name, c2->name);
+}
+
+static int metadata_deleted_dimension_compare(void *a, void *b)
+{
+    return uuid_compare(((struct metadata_cmd *)a)->uuid, ((struct metadata_cmd *)b)->uuid);
+}
+
+static inline avl_tree_type *metadata_cmd_index(struct metadata_cmd *cmd)
+{
+    switch (cmd->type) {
+        case METADATA_CMD_STORE_CHART:
+            return &metadata_writer.charts;
+        case METADATA_CMD_STORE_DIMENSION:
+            return &metadata_writer.dimensions;
+        case METADATA_CMD_DELETE_DIMENSION:
+            return &metadata_writer.deleted_dimensions;
+        default:
+            return NULL;
+    }
+}
+
+// the lock of the writer has to be held
+static void metadata_cmd_unindex(struct metadata_cmd *cmd)
+{
+    if (!cmd->indexed)
+        return;
+
+    if (unlikely(avl_remove(metadata_cmd_index(cmd), &cmd->avl) != &cmd->avl))
+        error_report("Pending metadata write was not found in its index");
+
+    cmd->indexed = 0;
+}
+
+// the lock of the writer has to be held
+static void metadata_cmd_index_add(struct metadata_cmd *cmd)
+{
+    avl_tree_type *index = metadata_cmd_index(cmd);
+    if (!index)
+        return;
+
+    // the latest write of a chart or a dimension replaces the previous one in the index
+    struct metadata_cmd *old = (struct metadata_cmd *)avl_insert(index, &cmd->avl);
+    if (old != cmd) {
+        metadata_cmd_unindex(old);
+        avl_insert(index, &cmd->avl);
+    }
+
+    cmd->indexed = 1;
+}
+
+static inline size_t metadata_strlen(const char *s)
+{
+    return s ? strlen(s) + 1 : 0;
+}
+
+static inline const char *metadata_strcpy(char **dst, const char *s)
+{
+    if (!s)
+        return NULL;
+
+    char *r = *dst;
+    size_t len = strlen(s) + 1;
+    memcpy(r, s, len);
+    *dst += len;
+    return r;
+}
+
+static struct metadata_cmd *metadata_cmd_create(METADATA_CMD_TYPE type, uuid_t *uuid, size_t strings)
+{
+    struct metadata_cmd *cmd = callocz(1, sizeof(struct metadata_cmd) + strings);
+    cmd->type = type;
+    uuid_copy(cmd->uuid, *uuid);
+    return cmd;
+}
+
+static void metadata_cmd_execute(struct metadata_cmd *cmd)
+{
+    switch (cmd->type) {
+        case METADATA_CMD_STORE_CHART:
+            (void)sql_write_chart(
+                &cmd->uuid, &cmd->parent_uuid, cmd->chart.type, cmd->id, cmd->name, cmd->chart.family,
+                cmd->chart.context, cmd->chart.title, cmd->chart.units, cmd->chart.plugin, cmd->chart.module,
+                cmd->chart.priority, cmd->chart.update_every, cmd->chart.chart_type, cmd->chart.memory_mode,
+                cmd->chart.history_entries);
+            break;
+
+        case METADATA_CMD_STORE_DIMENSION:
+            (void)sql_write_dimension(
+                &cmd->uuid, &cmd->parent_uuid, cmd->id, cmd->name, cmd->dimension.multiplier,
+                cmd->dimension.divisor, cmd->dimension.algorithm);
+            break;
+
+        case METADATA_CMD_STORE_ACTIVE_CHART:
+            sql_write_active_chart(&cmd->uuid);
+            break;
+
+        case METADATA_CMD_STORE_ACTIVE_DIMENSION:
+            sql_write_active_dimension(&cmd->uuid);
+            break;
+
+        case METADATA_CMD_DELETE_DIMENSION:
+            sql_write_delete_dimension(&cmd->uuid);
+            break;
+    }
+}
+
+/*
+ * Queue a write to the metadata writer
+ * Return 0 when it was queued, 1 when the caller has to execute it
+ */
+static int metadata_cmd_queue(struct metadata_cmd *cmd)
+{
+    if (unlikely(db_locked_by_thread))
+        return 1;
+
+    uv_mutex_lock(&metadata_writer.lock);
+
+    if (unlikely(!metadata_writer.running || metadata_writer.exit)) {
+        uv_mutex_unlock(&metadata_writer.lock);
+        return 1;
+    }
+
+    cmd->queued_ut = now_monotonic_usec();
+    metadata_cmd_index_add(cmd);
+
+    int was_empty = !metadata_writer.first;
+    if (metadata_writer.last)
+        metadata_writer.last->next = cmd;
+    else
+        metadata_writer.first = cmd;
+    metadata_writer.last = cmd;
+
+    metadata_writer.queued++;
+
+    if (was_empty || metadata_writer.queued == metadata_writer.max_batch)
+        uv_cond_signal(&metadata_writer.cond);
+
+    uv_mutex_unlock(&metadata_writer.lock);
+    return 0;
+}
+
+static void metadata_cmd_submit(struct metadata_cmd *cmd)
+{
+    if (metadata_cmd_queue(cmd)) {
+        int locked = db_lock_unless_locked();
+        metadata_cmd_execute(cmd);
+        if (locked)
+            db_unlock();
+        freez(cmd);
+    }
+}
+
+static void metadata_writer_commit(size_t writes)
+{
+    int rc, retries = 0;
+
+    while ((rc = sqlite3_exec(db_meta, "COMMIT TRANSACTION;", 0, 0, NULL)) == SQLITE_BUSY && retries++ < 100)
+        usleep(SQLITE_INSERT_DELAY * USEC_PER_MS);
+
+    if (unlikely(rc != SQLITE_OK)) {
+        error_report("Failed to commit %zu metadata writes, rc = %d", writes, rc);
+        db_execute("ROLLBACK TRANSACTION;");
+    }
+}
+
+#define SQL_DELETE_UNUSED_CHARTS                                                                                       \
+    "delete from chart where chart_id in (select chart_id from chart where "                                          \
+    "chart_id not in (select chart_id from dimension) and chart_id not in (select chart_id from chart_active) "        \
+    "limit @rows);"
+
+static int metadata_freelist_count(void)
+{
+    static __thread sqlite3_stmt *res = NULL;
+    int rc, pages = 0;
+
+    if (unlikely(!res)) {
+        rc = sqlite3_prepare_v2(db_meta, "PRAGMA freelist_count;", -1, &res, 0);
+        if (unlikely(rc != SQLITE_OK)) {
+            error_report("Failed to prepare statement to count the free pages, rc = %d", rc);
+            return 0;
+        }
+    }
+
+    rc = sqlite3_step(res);
+    if (likely(rc == SQLITE_ROW))
+        pages = sqlite3_column_int(res, 0);
+
+    rc = sqlite3_reset(res);
+    if (unlikely(rc != SQLITE_OK))
+        error_report("Failed to reset statement to count the free pages, rc = %d", rc);
+
+    return pages;
+}
+
+/*
+ * Delete a bounded number of unused charts, release a bounded number of free pages
+ * and checkpoint the write-ahead log
+ */
+static void metadata_compaction_run(void)
+{
+    static __thread sqlite3_stmt *res = NULL;
+    char sql[64];
+    int rc, rows = 0, pages;
+    usec_t started_ut = now_monotonic_usec();
+
+    db_lock();
+
+    if (unlikely(!res)) {
+        rc = sqlite3_prepare_v2(db_meta, SQL_DELETE_UNUSED_CHARTS, -1, &res, 0);
+        if (unlikely(rc != SQLITE_OK))
+            error_report("Failed to prepare statement to delete unused charts, rc = %d", rc);
+    }
+
+    if (likely(res)) {
+        rc = sqlite3_bind_int(res, 1, metadata_writer.compaction_max_rows);
+        if (unlikely(rc != SQLITE_OK))
+            error_report("Failed to bind input parameter to delete unused charts, rc = %d", rc);
+        else if (likely((rc = sqlite3_step(res)) == SQLITE_DONE))
+            rows = sqlite3_changes(db_meta);
+        else
+            error_report("Failed to delete unused charts, rc = %d", rc);
+
+        rc = sqlite3_reset(res);
+        if (unlikely(rc != SQLITE_OK))
+            error_report("Failed to reset statement to delete unused charts, rc = %d", rc);
+    }
+
+    pages = metadata_freelist_count();
+    if (pages) {
+        snprintfz(sql, 63, "PRAGMA incremental_vacuum(%d);", metadata_writer.compaction_max_pages);
+        db_execute(sql);
+        pages -= metadata_freelist_count();
+    }
+
+    rc = sqlite3_wal_checkpoint_v2(db_meta, NULL, SQLITE_CHECKPOINT_PASSIVE, NULL, NULL);
+    if (unlikely(rc != SQLITE_OK && rc != SQLITE_BUSY))
+        error_report("Failed to checkpoint the SQLite write-ahead log, rc = %d", rc);
+
+    db_unlock();
+
+    usec_t duration_ut = now_monotonic_usec() - started_ut;
+    debug(D_METADATALOG, "SQLite compaction deleted %d unused charts and released %d pages in %llu usec",
+          rows, pages, duration_ut);
+
+    uv_mutex_lock(&metadata_writer.lock);
+    metadata_writer.compactions++;
+    metadata_writer.compaction_rows += rows;
+    metadata_writer.compaction_pages += (pages > 0) ? pages : 0;
+    metadata_writer.compaction_ut += duration_ut;
+    uv_mutex_unlock(&metadata_writer.lock);
+}
+
+static void *metadata_writer_main(void *ptr)
+{
+    (void)ptr;
+
+    uv_mutex_lock(&metadata_writer.lock);
+
+    for (;;) {
+        while (!metadata_writer.first && !metadata_writer.exit) {
+            if (!metadata_writer.compaction_every_ut) {
+                uv_cond_wait(&metadata_writer.cond, &metadata_writer.lock);
+                continue;
+            }
+
+            usec_t now_ut = now_monotonic_usec();
+            if (now_ut < metadata_writer.next_compaction_ut) {
+                (void)uv_cond_timedwait(
+                    &metadata_writer.cond, &metadata_writer.lock,
+                    (metadata_writer.next_compaction_ut - now_ut) * NSEC_PER_USEC);
+                continue;
+            }
+
+            metadata_writer.next_compaction_ut = now_ut + metadata_writer.compaction_every_ut;
+            uv_mutex_unlock(&metadata_writer.lock);
+            metadata_compaction_run();
+            uv_mutex_lock(&metadata_writer.lock);
+        }
+
+        if (!metadata_writer.first)
+            break;
+
+        // wait for the batch to fill, or for its oldest write to wait long enough
+        while (!metadata_writer.exit && metadata_writer.queued < metadata_writer.max_batch) {
+            usec_t now_ut = now_monotonic_usec();
+            usec_t due_ut = metadata_writer.first->queued_ut + metadata_writer.max_delay_ut;
+
+            if (now_ut >= due_ut)
+                break;
+
+            (void)uv_cond_timedwait(&metadata_writer.cond, &metadata_writer.lock, (due_ut - now_ut) * NSEC_PER_USEC);
+        }
+
+        // detach the batch, the writes stay in the index until they are executed
+        struct metadata_cmd *batch = metadata_writer.first, *cmd = batch;
+        size_t writes = 1;
+
+        while (writes < metadata_writer.max_batch && cmd->next) {
+            cmd = cmd->next;
+            writes++;
+        }
+
+        metadata_writer.first = cmd->next;
+        if (!metadata_writer.first)
+            metadata_writer.last = NULL;
+        cmd->next = NULL;
+        metadata_writer.queued -= writes;
+
+        uv_mutex_unlock(&metadata_writer.lock);
+
+        db_lock();
+        db_execute("BEGIN TRANSACTION;");
+        for (cmd = batch; cmd; cmd = cmd->next)
+            metadata_cmd_execute(cmd);
+        metadata_writer_commit(writes);
+        db_unlock();
+
+        uv_mutex_lock(&metadata_writer.lock);
+
+        while (batch) {
+            cmd = batch;
+            batch = batch->next;
+
+            metadata_cmd_unindex(cmd);
+            freez(cmd);
+        }
+
+        metadata_writer.written += writes;
+        metadata_writer.transactions++;
+    }
+
+    __atomic_store_n(&metadata_writer.running, 0, __ATOMIC_RELEASE);
+    uv_mutex_unlock(&metadata_writer.lock);
+
+    return NULL;
+}
+
+static void metadata_writer_start(void)
+{
+    metadata_writer.max_batch = (size_t)config_get_number(CONFIG_SECTION_GLOBAL, "metadata writer max batch", 1000);
+    if (metadata_writer.max_batch < 1)
+        metadata_writer.max_batch = 1;
+
+    long long max_delay_ms = config_get_number(CONFIG_SECTION_GLOBAL, "metadata writer max delay ms", 100);
+    metadata_writer.max_delay_ut = (max_delay_ms > 0) ? (usec_t)max_delay_ms * USEC_PER_MS : 0;
+
+    long long compaction_every = config_get_number(CONFIG_SECTION_GLOBAL, "metadata compaction every seconds", 60);
+    metadata_writer.compaction_every_ut = (compaction_every > 0) ? (usec_t)compaction_every * USEC_PER_SEC : 0;
+    metadata_writer.next_compaction_ut = now_monotonic_usec() + metadata_writer.compaction_every_ut;
+
+    metadata_writer.compaction_max_rows = (int)config_get_number(CONFIG_SECTION_GLOBAL, "metadata compaction max rows", 1000);
+    if (metadata_writer.compaction_max_rows < 0)
+        metadata_writer.compaction_max_rows = 0;
+
+    metadata_writer.compaction_max_pages = (int)config_get_number(CONFIG_SECTION_GLOBAL, "metadata compaction max pages", 256);
+    if (metadata_writer.compaction_max_pages < 1)
+        metadata_writer.compaction_max_pages = 1;
+
+    fatal_assert(0 == uv_mutex_init(&metadata_writer.lock));
+    fatal_assert(0 == uv_cond_init(&metadata_writer.cond));
+
+    avl_init(&metadata_writer.charts, metadata_chart_compare);
+    avl_init(&metadata_writer.dimensions, metadata_dimension_compare);
+    avl_init(&metadata_writer.deleted_dimensions, metadata_deleted_dimension_compare);
+
+    __atomic_store_n(&metadata_writer.running, 1, __ATOMIC_RELEASE);
+    if (netdata_thread_create(
+            &metadata_writer.thread, "SQLITE_WRITER", NETDATA_THREAD_OPTION_JOINABLE, metadata_writer_main, NULL)) {
+        error_report("Failed to create the metadata writer thread, metadata will be written synchronously");
+        __atomic_store_n(&metadata_writer.running, 0, __ATOMIC_RELEASE);
+    }
+}
+
+/*
+ * Write the queued metadata and stop the metadata writer
+ */
+static void metadata_writer_stop(void)
+{
+    uv_mutex_lock(&metadata_writer.lock);
+    int running = metadata_writer.running;
+    metadata_writer.exit = 1;
+    uv_cond_signal(&metadata_writer.cond);
+    uv_mutex_unlock(&metadata_writer.lock);
+
+    if (running) {
+        info("Waiting for the metadata writer to write %zu queued metadata...", metadata_writer.queued);
+        netdata_thread_join(metadata_writer.thread, NULL);
+    }
+}
+
+void sql_metadata_writer_statistics(size_t *queued, size_t *written, size_t *transactions)
+{
+    if (unlikely(!metadata_writer_is_running())) {
+        *queued = *written = *transactions = 0;
+        return;
+    }
+
+    uv_mutex_lock(&metadata_writer.lock);
+    *queued = metadata_writer.queued;
+    *written = metadata_writer.written;
+    *transactions = metadata_writer.transactions;
+    uv_mutex_unlock(&metadata_writer.lock);
+}
+
+void sql_metadata_compaction_statistics(size_t *compactions, size_t *rows, size_t *pages, usec_t *duration_ut)
+{
+    if (unlikely(!metadata_writer_is_running())) {
+        *compactions = *rows = *pages = 0;
+        *duration_ut = 0;
+        return;
+    }
+
+    uv_mutex_lock(&metadata_writer.lock);
+    *compactions = metadata_writer.compactions;
+    *rows = metadata_writer.compaction_rows;
+    *pages = metadata_writer.compaction_pages;
+    *duration_ut = metadata_writer.compaction_ut;
+    uv_mutex_unlock(&metadata_writer.lock);
+}
+
+/*
+ * Find the UUID of a chart that is waiting to be written
+ * Return 1 when it was found
+ */
+static int metadata_find_pending_chart(uuid_t *host_uuid, const char *type, const char *id, const char *name, uuid_t *uuid)
+{
+    if (!metadata_writer_is_running())
+        return 0;
+
+    struct metadata_cmd tmp = { .id = id, .chart.type = type };
+    uuid_copy(tmp.parent_uuid, *host_uuid);
+
+    uv_mutex_lock(&metadata_writer.lock);
+
+    struct metadata_cmd *cmd = (struct metadata_cmd *)avl_search(&metadata_writer.charts, &tmp.avl);
+    int found = (cmd && cmd->name && !strcmp(cmd->name, name ? name : id));
+    if (found)
+        uuid_copy(*uuid, cmd->uuid);
+
+    uv_mutex_unlock(&metadata_writer.lock);
+
+    return found;
+}
+
+/*
+ * Find the UUID of a dimension that is waiting to be written
+ * Return 1 when it was found
+ */
+static int metadata_find_pending_dimension(uuid_t *chart_uuid, const char *id, const char *name, uuid_t *uuid)
+{
+    if (!metadata_writer_is_running())
+        return 0;
+
+    struct metadata_cmd tmp = { .id = id, .name = name };
+    uuid_copy(tmp.parent_uuid, *chart_uuid);
+
+    uv_mutex_lock(&metadata_writer.lock);
+
+    struct metadata_cmd *cmd = (struct metadata_cmd *)avl_search(&metadata_writer.dimensions, &tmp.avl);
+    if (cmd)
+        uuid_copy(*uuid, cmd->uuid);
+
+    uv_mutex_unlock(&metadata_writer.lock);
+
+    return (cmd != NULL);
+}
+
+/*
+ * Check if the deletion of a dimension is waiting to be written
+ * Return 1 when it is
+ */
+static int metadata_find_pending_delete(uuid_t *dimension_uuid)
+{
+    if (!metadata_writer_is_running())
+        return 0;
+
+    struct metadata_cmd tmp;
+    uuid_copy(tmp.uuid, *dimension_uuid);
+
+    uv_mutex_lock(&metadata_writer.lock);
+    int found = (avl_search(&metadata_writer.deleted_dimensions, &tmp.avl) != NULL);
+    uv_mutex_unlock(&metadata_writer.lock);
+
+    return found;
+}
+
+struct metadata_deleted_dimension {
+    uuid_t uuid;
+    struct metadata_cmd *cmd;
+};
+
+static int metadata_find_deleted_dimension(void *entry, void *data)
+{
+    struct metadata_cmd *cmd = entry;
+    struct metadata_deleted_dimension *deleted = data;
+
+    if (!uuid_compare(cmd->uuid, deleted->uuid)) {
+        deleted->cmd = cmd;
+        return -1;
+    }
+
+    return 0;
+}
+
+int sql_store_chart(
+    uuid_t *chart_uuid, uuid_t *host_uuid, const char *type, const char *id, const char *name, const char *family,
+    const char *context, const char *title, const char *units, const char *plugin, const char *module, long priority,
+    int update_every, int chart_type, int memory_mode, long history_entries)
+{
+    if (unlikely(!db_meta)) {
+        error_report("Database has not been initialized");
+        return 1;
+    }
+
+    size_t strings = metadata_strlen(type) + metadata_strlen(id) + metadata_strlen(name) + metadata_strlen(family) +
+                     metadata_strlen(context) + metadata_strlen(title) + metadata_strlen(units) +
+                     metadata_strlen(plugin) + metadata_strlen(module);
+
+    struct metadata_cmd *cmd = metadata_cmd_create(METADATA_CMD_STORE_CHART, chart_uuid, strings);
+    char *dst = cmd->strings;
+
+    uuid_copy(cmd->parent_uuid, *host_uuid);
+    cmd->chart.type = metadata_strcpy(&dst, type);
+    cmd->id = metadata_strcpy(&dst, id);
+    cmd->name = metadata_strcpy(&dst, name);
+    cmd->chart.family = metadata_strcpy(&dst, family);
+    cmd->chart.context = metadata_strcpy(&dst, context);
+    cmd->chart.title = metadata_strcpy(&dst, title);
+    cmd->chart.units = metadata_strcpy(&dst, units);
+    cmd->chart.plugin = metadata_strcpy(&dst, plugin);
+    cmd->chart.module = metadata_strcpy(&dst, module);
+    cmd->chart.priority = priority;
+    cmd->chart.update_every = update_every;
+    cmd->chart.chart_type = chart_type;
+    cmd->chart.memory_mode = memory_mode;
+    cmd->chart.history_entries = history_entries;
+
+    if (!metadata_cmd_queue(cmd))
+        return 0;
+
+    int rc = sql_write_chart(
+        chart_uuid, host_uuid, type, id, name, family, context, title, units, plugin, module, priority, update_every,
+        chart_type, memory_mode, history_entries);
+    freez(cmd);
+    return rc;
+}
+
+int sql_store_dimension(
+    uuid_t *dim_uuid, uuid_t *chart_uuid, const char *id, const char *name, collected_number multiplier,
+    collected_number divisor, int algorithm)
+{
+    if (unlikely(!db_meta)) {
+        error_report("Database has not been initialized");
+        return 1;
+    }
+
+    struct metadata_cmd *cmd =
+        metadata_cmd_create(METADATA_CMD_STORE_DIMENSION, dim_uuid, metadata_strlen(id) + metadata_strlen(name));
+    char *dst = cmd->strings;
+
+    uuid_copy(cmd->parent_uuid, *chart_uuid);
+    cmd->id = metadata_strcpy(&dst, id);
+    cmd->name = metadata_strcpy(&dst, name);
+    cmd->dimension.multiplier = multiplier;
+    cmd->dimension.divisor = divisor;
+    cmd->dimension.algorithm = algorithm;
+
+    if (!metadata_cmd_queue(cmd))
+        return 0;
+
+    int rc = sql_write_dimension(dim_uuid, chart_uuid, id, name, multiplier, divisor, algorithm);
+    freez(cmd);
+    return rc;
+}
+
+void store_active_chart(uuid_t *chart_uuid)
+{
+    if (unlikely(!db_meta)) {
+        error_report("Database has not been initialized");
+        return;
+    }
+
+    if (unlikely(!chart_uuid))
+        return;
+
+    metadata_cmd_submit(metadata_cmd_create(METADATA_CMD_STORE_ACTIVE_CHART, chart_uuid, 0));
+}
+
+void store_active_dimension(uuid_t *dimension_uuid)
+{
+    if (unlikely(!db_meta)) {
+        error_report("Database has not been initialized");
+        return;
+    }
+
+    if (unlikely(!dimension_uuid))
+        return;
+
+    metadata_cmd_submit(metadata_cmd_create(METADATA_CMD_STORE_ACTIVE_DIMENSION, dimension_uuid, 0));
+}
+
+void delete_dimension_uuid(uuid_t *dimension_uuid)
+{
+    if (metadata_writer_is_running()) {
+        // a pending write of the dimension should not be found by the lookups any more
+        struct metadata_deleted_dimension deleted = { .cmd = NULL };
+        uuid_copy(deleted.uuid, *dimension_uuid);
+
+        uv_mutex_lock(&metadata_writer.lock);
+        (void)avl_traverse(&metadata_writer.dimensions, metadata_find_deleted_dimension, &deleted);
+        if (deleted.cmd)
+            metadata_cmd_unindex(deleted.cmd);
+        uv_mutex_unlock(&metadata_writer.lock);
+    }
+
+    metadata_cmd_submit(metadata_cmd_create(METADATA_CMD_DELETE_DIMENSION, dimension_uuid, 0));
+}
+
+/*
+ * Keep the writes queued from now on pending, until metadata_writer_unittest_flush()
+ */
+static void metadata_writer_unittest_hold(void)
+{
+    uv_mutex_lock(&metadata_writer.lock);
+    metadata_writer.max_delay_ut = 3600 * USEC_PER_SEC;
+    metadata_writer.max_batch = SIZE_MAX;
+    uv_mutex_unlock(&metadata_writer.lock);
+}
+
+/*
+ * Let the writer execute the pending writes, and wait until they are committed
+ * The charts, dimensions and deletions stay indexed until their batch is committed
+ */
+static void metadata_writer_unittest_flush(void)
+{
+    int pending;
+
+    uv_mutex_lock(&metadata_writer.lock);
+    metadata_writer.max_delay_ut = 0;
+    uv_cond_signal(&metadata_writer.cond);
+    uv_mutex_unlock(&metadata_writer.lock);
+
+    do {
+        sleep_usec(USEC_PER_MS);
+
+        uv_mutex_lock(&metadata_writer.lock);
+        pending = (metadata_writer.first || metadata_writer.charts.root || metadata_writer.dimensions.root ||
+                   metadata_writer.deleted_dimensions.root);
+        uv_mutex_unlock(&metadata_writer.lock);
+    } while (pending);
+}
+
+/*
+ * Run a statement with one UUID parameter on its own connection
+ * Return the first column of the first row, 0 when there are no rows, or -1 on error
+ */
+static int metadata_writer_unittest_query(sqlite3 *db, const char *sql, uuid_t *uuid)
+{
+    sqlite3_stmt *res = NULL;
+    int ret = -1;
+
+    if (sqlite3_prepare_v2(db, sql, -1, &res, 0) != SQLITE_OK)
+        return -1;
+
+    if (sqlite3_bind_blob(res, 1, uuid, sizeof(*uuid), SQLITE_STATIC) == SQLITE_OK) {
+        int rc = sqlite3_step(res);
+        if (rc == SQLITE_ROW)
+            ret = sqlite3_column_int(res, 0);
+        else if (rc == SQLITE_DONE)
+            ret = 0;
+    }
+
+    sqlite3_finalize(res);
+    return ret;
+}
+
+/*
+ * Check the lookup of a dimension against the UUID it should find, or NULL when it should not be found
+ * Return the number of errors
+ */
+static int metadata_writer_unittest_dimension(RRDSET *st, const char *id, const char *name, uuid_t *expected, const char *when)
+{
+    RRDDIM rd = { .id = id, .name = name };
+
+    uuid_t *uuid = find_dimension_uuid(st, &rd);
+    int failed = (expected ? (!uuid || uuid_compare(*uuid, *expected)) : (uuid != NULL));
+    freez(uuid);
+
+    if (failed)
+        fprintf(stderr, "    dimension %s %s, was %s ### E R R O R ###\n", id, when, expected ? "not found" : "found");
+
+    return failed;
+}
+
+int sql_metadata_writer_unittest(void)
+{
+    fprintf(stderr, "\nRunning test 'metadata writer':\nchecks that the pending writes are found by the lookups, and executed in order\n");
+
+    if (!db_meta || !metadata_writer_is_running()) {
+        fprintf(stderr, "    the metadata writer is not running ### E R R O R ###\n");
+        return 1;
+    }
+
+    int errors = 0;
+    char uuid_str[GUID_LEN + 1], id[RRD_ID_LENGTH_MAX + 1];
+    uuid_t chart_uuid, dim1_uuid, dim2_uuid, dim3_uuid, dim4_uuid, *uuid;
+
+    uuid_generate(chart_uuid);
+    uuid_generate(dim1_uuid);
+    uuid_generate(dim2_uuid);
+    uuid_generate(dim3_uuid);
+    uuid_generate(dim4_uuid);
+
+    // the chart is new on every run, so the lookups cannot find the rows of a previous one
+    uuid_unparse_lower(chart_uuid, uuid_str);
+    snprintfz(id, RRD_ID_LENGTH_MAX, "metadata_writer_%s", uuid_str);
+    RRDSET st = { .chart_uuid = &chart_uuid };
+
+    metadata_writer_unittest_hold();
+
+    // a pending chart and pending dimensions are found
+    sql_store_chart(
+        &chart_uuid, &localhost->host_uuid, "unittest", id, id, "family", "context", "title", "units", "plugin",
+        "module", 1, 1, RRDSET_TYPE_LINE, RRD_MEMORY_MODE_DBENGINE, 5);
+    sql_store_dimension(&dim1_uuid, &chart_uuid, "dim1", "dim1", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    sql_store_dimension(&dim2_uuid, &chart_uuid, "dim2", "dim2", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+
+    uuid = find_chart_uuid(localhost, "unittest", id, id);
+    if (!uuid || uuid_compare(*uuid, chart_uuid)) {
+        fprintf(stderr, "    the pending chart was not found ### E R R O R ###\n");
+        errors++;
+    }
+    freez(uuid);
+
+    errors += metadata_writer_unittest_dimension(&st, "dim1", "dim1", &dim1_uuid, "pending");
+    errors += metadata_writer_unittest_dimension(&st, "dim2", "dim2", &dim2_uuid, "pending");
+    errors += metadata_writer_unittest_dimension(&st, "dim1", "other", NULL, "pending, with another name");
+
+    // a pending delete hides a stored dimension
+    metadata_writer_unittest_flush();
+    metadata_writer_unittest_hold();
+
+    errors += metadata_writer_unittest_dimension(&st, "dim2", "dim2", &dim2_uuid, "stored");
+    delete_dimension_uuid(&dim2_uuid);
+    errors += metadata_writer_unittest_dimension(&st, "dim2", "dim2", NULL, "stored, with a pending delete");
+
+    // a delete queued after a store hides the pending store
+    sql_store_dimension(&dim3_uuid, &chart_uuid, "dim3", "dim3", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    delete_dimension_uuid(&dim3_uuid);
+    errors += metadata_writer_unittest_dimension(&st, "dim3", "dim3", NULL, "pending, with a pending delete");
+
+    // the latest pending store of a dimension is found
+    sql_store_dimension(&dim4_uuid, &chart_uuid, "dim4", "dim4", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    sql_store_dimension(&dim4_uuid, &chart_uuid, "dim4", "renamed", 1, 1, RRD_ALGORITHM_ABSOLUTE);
+    errors += metadata_writer_unittest_dimension(&st, "dim4", "renamed", &dim4_uuid, "renamed while pending");
+
+    // closing the database executes the pending writes in the order they were queued
+    char sqlite_database[FILENAME_MAX + 1];
+    snprintfz(sqlite_database, FILENAME_MAX, "%s/netdata-meta.db", netdata_configured_cache_dir);
+    sql_close_database();
+
+    if (metadata_writer_is_running()) {
+        fprintf(stderr, "    the metadata writer is still running after the database was closed ### E R R O R ###\n");
+        errors++;
+    }
+
+    sqlite3 *db = NULL;
+    if (sqlite3_open(sqlite_database, &db) != SQLITE_OK) {
+        fprintf(stderr, "    cannot open the database %s ### E R R O R ###\n", sqlite_database);
+        sqlite3_close(db);
+        return errors + 1;
+    }
+
+    struct {
+        const char *sql;
+        uuid_t *uuid;
+        int expected;
+    } checks[] = {
+        { "select count(*) from chart where chart_id = @uuid;", &chart_uuid, 1 },
+        { "select count(*) from dimension where chart_id = @uuid;", &chart_uuid, 2 },
+        { "select count(*) from dimension where dim_id = @uuid and name = 'dim1';", &dim1_uuid, 1 },
+        { "select count(*) from dimension where dim_id = @uuid;", &dim2_uuid, 0 },
+        { "select count(*) from dimension where dim_id = @uuid;", &dim3_uuid, 0 },
+        { "select count(*) from dimension where dim_id = @uuid and name = 'renamed';", &dim4_uuid, 1 },
+        { NULL, NULL, 0 }
+    };
+
+    for (int i = 0; checks[i].sql; i++) {
+        int rows = metadata_writer_unittest_query(db, checks[i].sql, checks[i].uuid);
+        if (rows != checks[i].expected) {
+            fprintf(stderr, "    '%s' gave %d, expected %d ### E R R O R ###\n", checks[i].sql, rows, checks[i].expected);
+            errors++;
+        }
+    }
+
+    (void)metadata_writer_unittest_query(db, "delete from dimension where chart_id = @uuid;", &chart_uuid);
+    (void)metadata_writer_unittest_query(db, "delete from chart where chart_id = @uuid;", &chart_uuid);
+    sqlite3_close(db);
+
+    fprintf(stderr, "    metadata writer: %d errors\n", errors);
+    return errors;
+}
+
 //
 // Support for archived charts
 //
@@ -948,11 +1937,13 @@ void db_execute(char *cmd)
 void db_lock(void)
 {
     uv_mutex_lock(&sqlite_transaction_lock);
+    db_locked_by_thread = 1;
     return;
 }
 
 void db_unlock(void)
 {
+    db_locked_by_thread = 0;
     uv_mutex_unlock(&sqlite_transaction_lock);
     return;
 }
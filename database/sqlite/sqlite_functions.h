@@ -58,5 +58,8 @@ extern void add_migrated_file(char *path, uint64_t file_size);
 extern void db_unlock(void);
 extern void db_lock(void);
 extern void delete_dimension_uuid(uuid_t *dimension_uuid);
+extern void sql_metadata_writer_statistics(size_t *queued, size_t *written, size_t *transactions);
+extern void sql_metadata_compaction_statistics(size_t *compactions, size_t *rows, size_t *pages, usec_t *duration_ut);
+extern int sql_metadata_writer_unittest(void);
 
 #endif //NETDATA_SQLITE_FUNCTIONS_H
@@ -2,6 +2,34 @@
 
 #include "exporting_engine.h"
 
+/**
+ * Get the exporting flags of a host or a chart
+ *
+ * The flags of all the instances are allocated together, the first time any instance needs them. The instances are
+ * formatted in parallel, so the array is installed atomically.
+ *
+ * @param exporting_flags a pointer to the array of flags of a host or a chart.
+ * @param instance_num the number of connector instances.
+ * @return Returns the array of flags.
+ */
+static void *exporting_flags_get(void **exporting_flags, size_t instance_num)
+{
+    void *flags = __atomic_load_n(exporting_flags, __ATOMIC_ACQUIRE);
+
+    if (unlikely(!flags)) {
+        void *expected = NULL;
+
+        flags = callocz(instance_num, sizeof(size_t));
+        if (!__atomic_compare_exchange_n(exporting_flags, &expected, flags, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            // another formatting thread was faster
+            freez(flags);
+            flags = expected;
+        }
+    }
+
+    return flags;
+}
+
 /**
  * Check if the connector instance should export the host metrics
  *
@@ -11,10 +39,9 @@
  */
 int rrdhost_is_exportable(struct instance *instance, RRDHOST *host)
 {
-    if (host->exporting_flags == NULL)
-        host->exporting_flags = callocz(instance->engine->instance_num, sizeof(size_t));
-
-    RRDHOST_FLAGS *flags = &host->exporting_flags[instance->index];
+    RRDHOST_FLAGS *flags =
+        (RRDHOST_FLAGS *)exporting_flags_get((void **)&host->exporting_flags, instance->engine->instance_num) +
+        instance->index;
 
     if (unlikely((*flags & (RRDHOST_FLAG_BACKEND_SEND | RRDHOST_FLAG_BACKEND_DONT_SEND)) == 0)) {
         char *host_name = (host == localhost) ? "localhost" : host->hostname;
@@ -45,10 +72,8 @@ int rrdset_is_exportable(struct instance *instance, RRDSET *st)
 {
     RRDHOST *host = st->rrdhost;
 
-    if (st->exporting_flags == NULL)
-        st->exporting_flags = callocz(instance->engine->instance_num, sizeof(size_t));
-
-    RRDSET_FLAGS *flags = &st->exporting_flags[instance->index];
+    RRDSET_FLAGS *flags =
+        (RRDSET_FLAGS *)exporting_flags_get((void **)&st->exporting_flags, instance->engine->instance_num) + instance->index;
 
     if(unlikely(*flags & RRDSET_FLAG_BACKEND_IGNORE))
         return 0;
@@ -63,6 +63,9 @@ void simple_connector_cleanup(struct instance *instance)
         freez(current_buffer);
     }
 
+    exporting_spool_free(simple_connector_data->spool);
+    buffer_free(simple_connector_data->response);
+
 #ifdef ENABLE_HTTPS
     if (simple_connector_data->conn)
         SSL_free(simple_connector_data->conn);
@@ -59,6 +59,8 @@ static void exporting_main_cleanup(void *ptr)
 
     engine->exit = 1;
 
+    stop_formatting_threads(engine);
+
     int found = 0;
     usec_t max = 2 * USEC_PER_SEC, step = 50000;
 
@@ -59,6 +59,7 @@ typedef enum exporting_connector_types {
 } EXPORTING_CONNECTOR_TYPE;
 
 struct engine;
+struct exporting_spool;
 
 struct instance_config {
     EXPORTING_CONNECTOR_TYPE type;
@@ -73,6 +74,9 @@ struct instance_config {
     int buffer_on_failures;
     long timeoutms;
 
+    size_t spool_size;
+    int spool_replay_batches;
+
     EXPORTING_OPTIONS options;
     SIMPLE_PATTERN *charts_pattern;
     SIMPLE_PATTERN *hosts_pattern;
@@ -110,6 +114,10 @@ struct simple_connector_data {
     struct simple_connector_buffer *first_buffer;
     struct simple_connector_buffer *last_buffer;
 
+    struct exporting_spool *spool;
+
+    BUFFER *response;
+
 #ifdef ENABLE_HTTPS
     SSL *conn; //SSL connection
     int flags; //The flags for SSL connection
@@ -118,6 +126,8 @@ struct simple_connector_data {
 
 struct prometheus_remote_write_specific_config {
     char *remote_write_path;
+    size_t max_samples_per_request;
+    size_t max_requests_in_flight;
 };
 
 struct aws_kinesis_specific_config {
@@ -155,6 +165,11 @@ struct stats {
     collected_number reconnects;
     collected_number transmission_failures;
     collected_number receptions;
+    collected_number formatting_time;
+    collected_number spool_bytes;
+    collected_number spool_written_batches;
+    collected_number spool_replayed_batches;
+    collected_number spool_dropped_batches;
 
     int initialized;
 
@@ -179,6 +194,17 @@ struct stats {
     RRDSET *st_rusage;
     RRDDIM *rd_user;
     RRDDIM *rd_system;
+
+    RRDSET *st_formatting;
+    RRDDIM *rd_formatting_time;
+
+    RRDSET *st_spool;
+    RRDDIM *rd_spool_bytes;
+
+    RRDSET *st_spool_ops;
+    RRDDIM *rd_spool_written;
+    RRDDIM *rd_spool_replayed;
+    RRDDIM *rd_spool_dropped;
 };
 
 struct instance {
@@ -202,6 +228,13 @@ struct instance {
     uv_cond_t cond_var;
     int data_is_ready;
 
+    netdata_thread_t formatting_thread;
+    uv_mutex_t formatting_mutex;
+    uv_cond_t formatting_cond_var;
+    int formatting_thread_created;
+    int formatting_requested;
+    int formatting_in_thread;
+
     int (*start_batch_formatting)(struct instance *instance);
     int (*start_host_formatting)(struct instance *instance, RRDHOST *host);
     int (*start_chart_formatting)(struct instance *instance, RRDSET *st);
@@ -248,7 +281,9 @@ int init_connectors(struct engine *engine);
 void simple_connector_init(struct instance *instance);
 
 int mark_scheduled_instances(struct engine *engine);
+void prepare_instance_buffers(struct instance *instance);
 void prepare_buffers(struct engine *engine);
+void stop_formatting_threads(struct engine *engine);
 
 size_t exporting_name_copy(char *dst, const char *src, size_t max_len);
 
@@ -260,13 +295,13 @@ calculated_number exporting_calculate_value_from_stored_data(
     RRDDIM *rd,
     time_t *last_timestamp);
 
-void start_batch_formatting(struct engine *engine);
-void start_host_formatting(struct engine *engine, RRDHOST *host);
-void start_chart_formatting(struct engine *engine, RRDSET *st);
-void metric_formatting(struct engine *engine, RRDDIM *rd);
-void end_chart_formatting(struct engine *engine, RRDSET *st);
-void end_host_formatting(struct engine *engine, RRDHOST *host);
-void end_batch_formatting(struct engine *engine);
+void start_batch_formatting(struct instance *instance);
+void start_host_formatting(struct instance *instance, RRDHOST *host);
+void start_chart_formatting(struct instance *instance, RRDSET *st);
+void metric_formatting(struct instance *instance, RRDDIM *rd);
+void end_chart_formatting(struct instance *instance, RRDSET *st);
+void end_host_formatting(struct instance *instance, RRDHOST *host);
+void end_batch_formatting(struct instance *instance);
 int flush_host_labels(struct instance *instance, RRDHOST *host);
 int simple_connector_end_batch(struct instance *instance);
 
@@ -276,6 +311,14 @@ void simple_connector_send_buffer(
     int *sock, int *failures, struct instance *instance, BUFFER *header, BUFFER *buffer, size_t buffered_metrics);
 void simple_connector_worker(void *instance_p);
 
+struct exporting_spool *exporting_spool_init(struct instance *instance);
+void exporting_spool_free(struct exporting_spool *spool);
+size_t exporting_spool_batches(struct exporting_spool *spool);
+void exporting_spool_statistics(struct exporting_spool *spool, struct stats *stats);
+int exporting_spool_write(struct exporting_spool *spool, BUFFER *header, BUFFER *buffer, size_t metrics);
+int exporting_spool_read(struct exporting_spool *spool, BUFFER *header, BUFFER *buffer, size_t *metrics);
+void exporting_spool_consume(struct exporting_spool *spool);
+
 void create_main_rusage_chart(RRDSET **st_rusage, RRDDIM **rd_user, RRDDIM **rd_system);
 void send_main_rusage(RRDSET *st_rusage, RRDDIM *rd_user, RRDDIM *rd_system);
 void send_internal_metrics(struct instance *instance);
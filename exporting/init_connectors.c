@@ -35,6 +35,10 @@ int init_connectors(struct engine *engine)
         instance->index = engine->instance_num++;
         instance->after = engine->now;
 
+        // keep running sums of the stored values, instead of querying the database on every export
+        if (EXPORTING_OPTIONS_DATA_SOURCE(instance->config.options) != EXPORTING_SOURCE_DATA_AS_COLLECTED)
+            rrddim_accumulators_enabled = 1;
+
         switch (instance->config.type) {
             case EXPORTING_CONNECTOR_TYPE_GRAPHITE:
                 if (init_graphite_instance(instance) != 0)
@@ -141,5 +145,8 @@ void simple_connector_init(struct instance *instance)
     first_buffer->next = connector_specific_data->first_buffer;
     connector_specific_data->last_buffer = connector_specific_data->first_buffer;
 
+    if (instance->config.spool_size)
+        connector_specific_data->spool = exporting_spool_init(instance);
+
     return;
 }
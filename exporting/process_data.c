@@ -54,9 +54,41 @@ int mark_scheduled_instances(struct engine *engine)
     return instances_were_scheduled;
 }
 
+/**
+ * Get the cursor of an instance in the running sums of a dimension
+ *
+ * The cursors of all the instances are allocated together, the first time any instance needs them.
+ *
+ * @param instance an instance data structure.
+ * @param rd a dimension(metric) in the Netdata database.
+ * @return Returns the cursor.
+ */
+static struct rrddim_accumulator_cursor *exporting_accumulator_cursor(struct instance *instance, RRDDIM *rd)
+{
+    struct rrddim_accumulator_cursor *cursors = __atomic_load_n(&rd->state->exporting_cursors, __ATOMIC_ACQUIRE);
+
+    if (unlikely(!cursors)) {
+        struct rrddim_accumulator_cursor *expected = NULL;
+
+        cursors = callocz(instance->engine->instance_num, sizeof(struct rrddim_accumulator_cursor));
+        if (!__atomic_compare_exchange_n(
+                &rd->state->exporting_cursors, &expected, cursors, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            // another formatting thread was faster
+            freez(cursors);
+            cursors = expected;
+        }
+    }
+
+    return &cursors[instance->index];
+}
+
 /**
  * Calculate the SUM or AVERAGE of a dimension, for any timeframe
  *
+ * The running sums of the dimension are used when they cover the timeframe, which is the case when the
+ * previous timeframe of the instance ended right before this one. Otherwise, e.g. after a restart or a gap,
+ * the values are read from the database.
+ *
  * May return NAN if the database does not have any value in the give timeframe.
  *
  * @param instance an instance data structure.
@@ -124,21 +156,25 @@ calculated_number exporting_calculate_value_from_stored_data(
     size_t counter = 0;
     calculated_number sum = 0;
 
-    for (rd->state->query_ops.init(rd, &handle, after, before); !rd->state->query_ops.is_finished(&handle);) {
-        time_t curr_t;
-        n = rd->state->query_ops.next_metric(&handle, &curr_t);
+    if (!rrddim_accumulators_enabled || !instance->engine ||
+        !rrddim_accumulator_read(rd, exporting_accumulator_cursor(instance, rd), after, before, &sum, &counter)) {
+        for (rd->state->query_ops.init(rd, &handle, after, before); !rd->state->query_ops.is_finished(&handle);) {
+            time_t curr_t;
+            n = rd->state->query_ops.next_metric(&handle, &curr_t);
 
-        if (unlikely(!does_storage_number_exist(n))) {
-            // not collected
-            continue;
-        }
+            if (unlikely(!does_storage_number_exist(n))) {
+                // not collected
+                continue;
+            }
 
-        calculated_number value = unpack_storage_number(n);
-        sum += value;
+            calculated_number value = unpack_storage_number(n);
+            sum += value;
 
-        counter++;
+            counter++;
+        }
+        rd->state->query_ops.finalize(&handle);
     }
-    rd->state->query_ops.finalize(&handle);
+
     if (unlikely(!counter)) {
         debug(
             D_BACKEND,
@@ -158,191 +194,331 @@ calculated_number exporting_calculate_value_from_stored_data(
 }
 
 /**
- * Start batch formatting for every connector instance's buffer
+ * Start batch formatting for a connector instance's buffer
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  */
-void start_batch_formatting(struct engine *engine)
+void start_batch_formatting(struct instance *instance)
 {
-    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
-        if (instance->scheduled) {
-            uv_mutex_lock(&instance->mutex);
-            if (instance->start_batch_formatting && instance->start_batch_formatting(instance) != 0) {
-                error("EXPORTING: cannot start batch formatting for %s", instance->config.name);
-                disable_instance(instance);
-            }
-        }
+    uv_mutex_lock(&instance->mutex);
+    if (instance->start_batch_formatting && instance->start_batch_formatting(instance) != 0) {
+        error("EXPORTING: cannot start batch formatting for %s", instance->config.name);
+        disable_instance(instance);
     }
 }
 
 /**
- * Start host formatting for every connector instance's buffer
+ * Start host formatting for a connector instance's buffer
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  * @param host a data collecting host.
  */
-void start_host_formatting(struct engine *engine, RRDHOST *host)
+void start_host_formatting(struct instance *instance, RRDHOST *host)
 {
-    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
-        if (instance->scheduled) {
-            if (rrdhost_is_exportable(instance, host)) {
-                if (instance->start_host_formatting && instance->start_host_formatting(instance, host) != 0) {
-                    error("EXPORTING: cannot start host formatting for %s", instance->config.name);
-                    disable_instance(instance);
-                }
-            } else {
-                instance->skip_host = 1;
+    if (instance->scheduled) {
+        if (rrdhost_is_exportable(instance, host)) {
+            if (instance->start_host_formatting && instance->start_host_formatting(instance, host) != 0) {
+                error("EXPORTING: cannot start host formatting for %s", instance->config.name);
+                disable_instance(instance);
             }
+        } else {
+            instance->skip_host = 1;
         }
     }
 }
 
 /**
- * Start chart formatting for every connector instance's buffer
+ * Start chart formatting for a connector instance's buffer
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  * @param st a chart.
  */
-void start_chart_formatting(struct engine *engine, RRDSET *st)
+void start_chart_formatting(struct instance *instance, RRDSET *st)
 {
-    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
-        if (instance->scheduled && !instance->skip_host) {
-            if (rrdset_is_exportable(instance, st)) {
-                if (instance->start_chart_formatting && instance->start_chart_formatting(instance, st) != 0) {
-                    error("EXPORTING: cannot start chart formatting for %s", instance->config.name);
-                    disable_instance(instance);
-                }
-            } else {
-                instance->skip_chart = 1;
+    if (instance->scheduled && !instance->skip_host) {
+        if (rrdset_is_exportable(instance, st)) {
+            if (instance->start_chart_formatting && instance->start_chart_formatting(instance, st) != 0) {
+                error("EXPORTING: cannot start chart formatting for %s", instance->config.name);
+                disable_instance(instance);
             }
+        } else {
+            instance->skip_chart = 1;
         }
     }
 }
 
 /**
- * Format metric for every connector instance's buffer
+ * Format metric for a connector instance's buffer
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  * @param rd a dimension(metric) in the Netdata database.
  */
-void metric_formatting(struct engine *engine, RRDDIM *rd)
+void metric_formatting(struct instance *instance, RRDDIM *rd)
 {
-    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
-        if (instance->scheduled && !instance->skip_host && !instance->skip_chart) {
-            if (instance->metric_formatting && instance->metric_formatting(instance, rd) != 0) {
-                error("EXPORTING: cannot format metric for %s", instance->config.name);
-                disable_instance(instance);
-                continue;
-            }
-            instance->stats.buffered_metrics++;
+    if (instance->scheduled && !instance->skip_host && !instance->skip_chart) {
+        if (instance->metric_formatting && instance->metric_formatting(instance, rd) != 0) {
+            error("EXPORTING: cannot format metric for %s", instance->config.name);
+            disable_instance(instance);
+            return;
         }
+        instance->stats.buffered_metrics++;
     }
 }
 
 /**
- * End chart formatting for every connector instance's buffer
+ * End chart formatting for a connector instance's buffer
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  * @param a chart.
  */
-void end_chart_formatting(struct engine *engine, RRDSET *st)
+void end_chart_formatting(struct instance *instance, RRDSET *st)
 {
-    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
-        if (instance->scheduled && !instance->skip_host && !instance->skip_chart) {
-            if (instance->end_chart_formatting && instance->end_chart_formatting(instance, st) != 0) {
-                error("EXPORTING: cannot end chart formatting for %s", instance->config.name);
-                disable_instance(instance);
-                continue;
-            }
+    if (instance->scheduled && !instance->skip_host && !instance->skip_chart) {
+        if (instance->end_chart_formatting && instance->end_chart_formatting(instance, st) != 0) {
+            error("EXPORTING: cannot end chart formatting for %s", instance->config.name);
+            disable_instance(instance);
         }
-        instance->skip_chart = 0;
     }
+    instance->skip_chart = 0;
 }
 
 /**
- * End host formatting for every connector instance's buffer
+ * End host formatting for a connector instance's buffer
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  * @param host a data collecting host.
  */
-void end_host_formatting(struct engine *engine, RRDHOST *host)
+void end_host_formatting(struct instance *instance, RRDHOST *host)
 {
-    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
-        if (instance->scheduled && !instance->skip_host) {
-            if (instance->end_host_formatting && instance->end_host_formatting(instance, host) != 0) {
-                error("EXPORTING: cannot end host formatting for %s", instance->config.name);
-                disable_instance(instance);
-                continue;
-            }
+    if (instance->scheduled && !instance->skip_host) {
+        if (instance->end_host_formatting && instance->end_host_formatting(instance, host) != 0) {
+            error("EXPORTING: cannot end host formatting for %s", instance->config.name);
+            disable_instance(instance);
         }
-        instance->skip_host = 0;
     }
+    instance->skip_host = 0;
 }
 
 /**
- * End batch formatting for every connector instance's buffer
+ * End batch formatting for a connector instance's buffer
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  */
-void end_batch_formatting(struct engine *engine)
+void end_batch_formatting(struct instance *instance)
 {
-    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
-        if (instance->scheduled) {
-            if (instance->end_batch_formatting && instance->end_batch_formatting(instance) != 0) {
-                error("EXPORTING: cannot end batch formatting for %s", instance->config.name);
-                disable_instance(instance);
-                continue;
-            }
-            uv_mutex_unlock(&instance->mutex);
-            instance->data_is_ready = 1;
-            uv_cond_signal(&instance->cond_var);
-
-            instance->scheduled = 0;
-            instance->after = instance->before;
+    if (instance->scheduled) {
+        if (instance->end_batch_formatting && instance->end_batch_formatting(instance) != 0) {
+            error("EXPORTING: cannot end batch formatting for %s", instance->config.name);
+            disable_instance(instance);
+            return;
         }
+        uv_mutex_unlock(&instance->mutex);
+        instance->data_is_ready = 1;
+        uv_cond_signal(&instance->cond_var);
+
+        instance->scheduled = 0;
+        instance->after = instance->before;
     }
 }
 
 /**
- * Prepare buffers
+ * Prepare instance buffers
  *
- * Walk through the Netdata database and fill buffers for every scheduled exporting connector instance according to
+ * Walk through the Netdata database and fill the buffers of a scheduled exporting connector instance according to
  * configured rules.
  *
- * @param engine an engine data structure.
+ * @param instance an instance data structure.
  */
-void prepare_buffers(struct engine *engine)
+void prepare_instance_buffers(struct instance *instance)
 {
+    usec_t started = now_monotonic_usec();
+
     netdata_thread_disable_cancelability();
-    start_batch_formatting(engine);
+    start_batch_formatting(instance);
 
     rrd_rdlock();
     RRDHOST *host;
     rrdhost_foreach_read(host)
     {
+        if (!instance->scheduled)
+            break;
+
         rrdhost_rdlock(host);
-        start_host_formatting(engine, host);
+        start_host_formatting(instance, host);
         RRDSET *st;
         rrdset_foreach_read(st, host)
         {
             rrdset_rdlock(st);
-            start_chart_formatting(engine, st);
+            start_chart_formatting(instance, st);
 
             RRDDIM *rd;
             rrddim_foreach_read(rd, st)
-                metric_formatting(engine, rd);
+                metric_formatting(instance, rd);
 
-            end_chart_formatting(engine, st);
+            end_chart_formatting(instance, st);
             rrdset_unlock(st);
         }
 
-        end_host_formatting(engine, host);
+        end_host_formatting(instance, host);
         rrdhost_unlock(host);
     }
     rrd_unlock();
     netdata_thread_enable_cancelability();
 
-    end_batch_formatting(engine);
+    end_batch_formatting(instance);
+
+    instance->stats.formatting_time = (collected_number)(now_monotonic_usec() - started);
+}
+
+/**
+ * Formatting thread of an instance
+ *
+ * Prepares the buffers of the instance every time the main exporting thread asks for it, so that the instances are
+ * formatted in parallel.
+ *
+ * @param ptr an instance data structure.
+ * @return It always returns NULL.
+ */
+static void *instance_formatting_main(void *ptr)
+{
+    struct instance *instance = (struct instance *)ptr;
+
+    uv_mutex_lock(&instance->formatting_mutex);
+    while (!instance->engine->exit) {
+        if (!instance->formatting_requested) {
+            uv_cond_wait(&instance->formatting_cond_var, &instance->formatting_mutex);
+            continue;
+        }
+        uv_mutex_unlock(&instance->formatting_mutex);
+
+        prepare_instance_buffers(instance);
+
+        uv_mutex_lock(&instance->formatting_mutex);
+        instance->formatting_requested = 0;
+        uv_cond_broadcast(&instance->formatting_cond_var);
+    }
+    uv_mutex_unlock(&instance->formatting_mutex);
+
+    return NULL;
+}
+
+/**
+ * Request the formatting of an instance from its formatting thread
+ *
+ * @param instance an instance data structure.
+ * @return Returns 0 on success, 1 when the instance has no formatting thread.
+ */
+static int request_instance_formatting(struct instance *instance)
+{
+    if (!instance->formatting_thread_created) {
+        char tag[NETDATA_THREAD_TAG_MAX + 1];
+        snprintfz(tag, NETDATA_THREAD_TAG_MAX, "EXPORTING_FORMAT[%s]", instance->config.name);
+
+        if (uv_mutex_init(&instance->formatting_mutex))
+            return 1;
+        if (uv_cond_init(&instance->formatting_cond_var)) {
+            uv_mutex_destroy(&instance->formatting_mutex);
+            return 1;
+        }
+
+        if (netdata_thread_create(
+                &instance->formatting_thread, tag, NETDATA_THREAD_OPTION_JOINABLE, instance_formatting_main, instance)) {
+            uv_cond_destroy(&instance->formatting_cond_var);
+            uv_mutex_destroy(&instance->formatting_mutex);
+            return 1;
+        }
+
+        instance->formatting_thread_created = 1;
+    }
+
+    uv_mutex_lock(&instance->formatting_mutex);
+    instance->formatting_requested = 1;
+    uv_cond_broadcast(&instance->formatting_cond_var);
+    uv_mutex_unlock(&instance->formatting_mutex);
+
+    return 0;
+}
+
+/**
+ * Wait for the formatting thread of an instance to finish
+ *
+ * @param instance an instance data structure.
+ */
+static void wait_instance_formatting(struct instance *instance)
+{
+    uv_mutex_lock(&instance->formatting_mutex);
+    while (instance->formatting_requested)
+        uv_cond_wait(&instance->formatting_cond_var, &instance->formatting_mutex);
+    uv_mutex_unlock(&instance->formatting_mutex);
+}
+
+/**
+ * Prepare buffers
+ *
+ * Fill buffers for every scheduled exporting connector instance. When more than one instance is scheduled, every
+ * instance but the last is formatted by its own formatting thread, while this thread formats the last one, so that
+ * the time needed is the time of the slowest instance instead of the sum of all.
+ *
+ * @param engine an engine data structure.
+ */
+void prepare_buffers(struct engine *engine)
+{
+    struct instance *instance, *last = NULL;
+    size_t scheduled = 0;
+
+    for (instance = engine->instance_root; instance; instance = instance->next) {
+        if (instance->scheduled) {
+            scheduled++;
+            last = instance;
+        }
+    }
+
+    if (!scheduled)
+        return;
+
+    netdata_thread_disable_cancelability();
+
+    for (instance = engine->instance_root; scheduled > 1 && instance; instance = instance->next) {
+        if (instance->scheduled && instance != last) {
+            instance->formatting_in_thread = !request_instance_formatting(instance);
+            if (!instance->formatting_in_thread)
+                prepare_instance_buffers(instance);
+        }
+    }
+
+    prepare_instance_buffers(last);
+
+    for (instance = engine->instance_root; instance; instance = instance->next) {
+        if (instance->formatting_in_thread) {
+            wait_instance_formatting(instance);
+            instance->formatting_in_thread = 0;
+        }
+    }
+
+    netdata_thread_enable_cancelability();
+}
+
+/**
+ * Stop the formatting threads of all instances
+ *
+ * @param engine an engine data structure.
+ */
+void stop_formatting_threads(struct engine *engine)
+{
+    for (struct instance *instance = engine->instance_root; instance; instance = instance->next) {
+        if (!instance->formatting_thread_created)
+            continue;
+
+        uv_mutex_lock(&instance->formatting_mutex);
+        uv_cond_broadcast(&instance->formatting_cond_var);
+        uv_mutex_unlock(&instance->formatting_mutex);
+
+        netdata_thread_join(instance->formatting_thread, NULL);
+
+        uv_cond_destroy(&instance->formatting_cond_var);
+        uv_mutex_destroy(&instance->formatting_mutex);
+        instance->formatting_thread_created = 0;
+    }
 }
 
 /**
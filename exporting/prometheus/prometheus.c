@@ -71,6 +71,12 @@ static struct prometheus_server {
 
 static netdata_mutex_t prometheus_server_root_mutex = NETDATA_MUTEX_INITIALIZER;
 
+// the scrapes are rendered one at a time, since they share the time range of the exporter instance
+// and the cached metric names of the dimensions
+static netdata_mutex_t prometheus_render_mutex = NETDATA_MUTEX_INITIALIZER;
+
+LATENCY_HISTOGRAM prometheus_scrape_histogram = LATENCY_HISTOGRAM_INITIALIZER("prometheus_scrape");
+
 /**
  * Clean server root local structure
  */
@@ -382,6 +388,133 @@ static int print_host_variables(RRDVAR *rv, void *data)
     return 0;
 }
 
+// the output options that change the metric names and labels of the dimensions
+#define PROMETHEUS_CACHED_OUTPUT_OPTIONS \
+    (PROMETHEUS_OUTPUT_NAMES | PROMETHEUS_OUTPUT_OLDUNITS | PROMETHEUS_OUTPUT_HIDEUNITS)
+
+// the sanitized chart strings, prepared only when a dimension of the chart has to be rendered again
+struct prometheus_chart_names {
+    int ready;
+    char chart[PROMETHEUS_ELEMENT_MAX + 1];
+    char context[PROMETHEUS_ELEMENT_MAX + 1];
+    char family[PROMETHEUS_ELEMENT_MAX + 1];
+    char units[PROMETHEUS_ELEMENT_MAX + 1];
+};
+
+/**
+ * Prepare the sanitized strings of a chart, once per chart.
+ *
+ * @param names the structure to fill.
+ * @param st a chart.
+ * @param exporting_options options to configure what data is exported.
+ * @param output_options options to configure the format of the output.
+ */
+static inline void prometheus_chart_names_prepare(
+    struct prometheus_chart_names *names,
+    RRDSET *st,
+    EXPORTING_OPTIONS exporting_options,
+    PROMETHEUS_OUTPUT_OPTIONS output_options)
+{
+    if (names->ready)
+        return;
+
+    prometheus_label_copy(
+        names->chart, (output_options & PROMETHEUS_OUTPUT_NAMES && st->name) ? st->name : st->id, PROMETHEUS_ELEMENT_MAX);
+    prometheus_label_copy(names->family, st->family, PROMETHEUS_ELEMENT_MAX);
+    prometheus_name_copy(names->context, st->context, PROMETHEUS_ELEMENT_MAX);
+
+    names->units[0] = '\0';
+    if (EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) == EXPORTING_SOURCE_DATA_AVERAGE &&
+        !(output_options & PROMETHEUS_OUTPUT_HIDEUNITS))
+        prometheus_units_copy(
+            names->units, st->units, PROMETHEUS_ELEMENT_MAX, output_options & PROMETHEUS_OUTPUT_OLDUNITS);
+
+    names->ready = 1;
+}
+
+/**
+ * Get the rendered metric name and labels of a dimension, if they are still valid.
+ *
+ * @param rd a dimension.
+ * @param version the metadata version of the chart.
+ * @param key the output options and the data source of the request.
+ * @param prefix the prefix of the request.
+ * @param prefix_len the length of the prefix.
+ * @return Returns the cached line, or NULL if it has to be rendered again.
+ */
+static inline struct prometheus_dimension_cache *prometheus_dimension_cache_get(
+    RRDDIM *rd, size_t version, uint32_t key, const char *prefix, size_t prefix_len)
+{
+    struct prometheus_dimension_cache *pc = rd->state->prometheus_cache;
+
+    if (likely(
+            pc && pc->version == version && pc->key == key && pc->prefix_len == prefix_len &&
+            !strncmp(pc->line, prefix, prefix_len)))
+        return pc;
+
+    return NULL;
+}
+
+/**
+ * Save the rendered metric name and labels of a dimension.
+ *
+ * @param rd a dimension.
+ * @param version the metadata version of the chart.
+ * @param key the output options and the data source of the request.
+ * @param prefix_len the length of the prefix.
+ * @param line the rendered line. It is flushed.
+ * @return Returns the cached line.
+ */
+static struct prometheus_dimension_cache *prometheus_dimension_cache_set(
+    RRDDIM *rd, size_t version, uint32_t key, size_t prefix_len, BUFFER *line)
+{
+    const char *s = buffer_tostring(line);
+    size_t len = buffer_strlen(line);
+
+    struct prometheus_dimension_cache *pc = rd->state->prometheus_cache;
+    if (!pc || pc->size < len + 1) {
+        freez(pc);
+        pc = mallocz(sizeof(struct prometheus_dimension_cache) + len + 1);
+        pc->size = len + 1;
+        rd->state->prometheus_cache = pc;
+    }
+
+    memcpy(pc->line, s, len + 1);
+    pc->len = len;
+    pc->metric_len = strchr(s, '{') - s;
+    pc->prefix_len = prefix_len;
+    pc->key = key;
+    pc->version = version;
+
+    buffer_flush(line);
+    return pc;
+}
+
+/**
+ * Write the metric name and the labels of a dimension, leaving the buffer ready for the value.
+ *
+ * @param wb the buffer to write to.
+ * @param pc the cached metric name and labels of the dimension.
+ * @param labels the labels of the host.
+ * @param labels_len the length of the labels of the host.
+ */
+static inline void prometheus_print_metric(
+    BUFFER *wb, struct prometheus_dimension_cache *pc, const char *labels, size_t labels_len)
+{
+    buffer_need_bytes(wb, pc->len + labels_len + 3);
+
+    char *s = &wb->buffer[wb->len];
+    memcpy(s, pc->line, pc->len);
+    s += pc->len;
+    memcpy(s, labels, labels_len);
+    s += labels_len;
+    *s++ = '}';
+    *s++ = ' ';
+    *s = '\0';
+
+    wb->len += pc->len + labels_len + 2;
+}
+
 /**
  * Write metrics in Prometheus format to a buffer.
  *
@@ -494,6 +627,10 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
         foreach_host_variable_callback(host, print_host_variables, &opts);
     }
 
+    size_t prefix_len = strlen(prefix);
+    size_t labels_len = strlen(labels);
+    BUFFER *line = NULL;
+
     // for each chart
     RRDSET *st;
     rrdset_foreach_read(st, host)
@@ -502,15 +639,7 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
         if (likely(can_send_rrdset(instance, st))) {
             rrdset_rdlock(st);
 
-            char chart[PROMETHEUS_ELEMENT_MAX + 1];
-            char context[PROMETHEUS_ELEMENT_MAX + 1];
-            char family[PROMETHEUS_ELEMENT_MAX + 1];
-            char units[PROMETHEUS_ELEMENT_MAX + 1] = "";
-
-            prometheus_label_copy(
-                chart, (output_options & PROMETHEUS_OUTPUT_NAMES && st->name) ? st->name : st->id, PROMETHEUS_ELEMENT_MAX);
-            prometheus_label_copy(family, st->family, PROMETHEUS_ELEMENT_MAX);
-            prometheus_name_copy(context, st->context, PROMETHEUS_ELEMENT_MAX);
+            struct prometheus_chart_names names = { .ready = 0 };
 
             int as_collected = (EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) == EXPORTING_SOURCE_DATA_AS_COLLECTED);
             int homogeneous = 1;
@@ -520,13 +649,12 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
 
                 if (rrdset_flag_check(st, RRDSET_FLAG_HETEROGENEOUS))
                     homogeneous = 0;
-            } else {
-                if (EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) == EXPORTING_SOURCE_DATA_AVERAGE &&
-                    !(output_options & PROMETHEUS_OUTPUT_HIDEUNITS))
-                    prometheus_units_copy(
-                        units, st->units, PROMETHEUS_ELEMENT_MAX, output_options & PROMETHEUS_OUTPUT_OLDUNITS);
             }
 
+            uint32_t key = (uint32_t)(output_options & PROMETHEUS_CACHED_OUTPUT_OPTIONS) |
+                           ((uint32_t)EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) << 16) |
+                           (homogeneous ? (1U << 24) : 0);
+
             if (unlikely(output_options & PROMETHEUS_OUTPUT_HELP))
                 buffer_sprintf(
                     wb,
@@ -544,6 +672,7 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
                 if (rd->collections_counter && !rrddim_flag_check(rd, RRDDIM_FLAG_OBSOLETE)) {
                     char dimension[PROMETHEUS_ELEMENT_MAX + 1];
                     char *suffix = "";
+                    struct prometheus_dimension_cache *pc;
 
                     if (as_collected) {
                         // we need as-collected / raw data
@@ -559,121 +688,82 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
                             suffix = "_total";
                         }
 
-                        if (homogeneous) {
-                            // all the dimensions of the chart, has the same algorithm, multiplier and divisor
-                            // we add all dimensions as labels
+                        pc = prometheus_dimension_cache_get(rd, st->metadata_version, key, prefix, prefix_len);
+                        if (unlikely(!pc)) {
+                            prometheus_chart_names_prepare(&names, st, exporting_options, output_options);
+                            if (!line)
+                                line = buffer_create(PROMETHEUS_ELEMENT_MAX * 4);
 
-                            prometheus_label_copy(
-                                dimension,
-                                (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
-                                PROMETHEUS_ELEMENT_MAX);
+                            if (homogeneous) {
+                                // all the dimensions of the chart, has the same algorithm, multiplier and divisor
+                                // we add all dimensions as labels
 
-                            if (unlikely(output_options & PROMETHEUS_OUTPUT_HELP))
-                                buffer_sprintf(
-                                    wb,
-                                    "# COMMENT %s_%s%s: chart \"%s\", context \"%s\", family \"%s\", dimension \"%s\", value * " COLLECTED_NUMBER_FORMAT
-                                    " / " COLLECTED_NUMBER_FORMAT " %s %s (%s)\n",
-                                    prefix,
-                                    context,
-                                    suffix,
-                                    (output_options & PROMETHEUS_OUTPUT_NAMES && st->name) ? st->name : st->id,
-                                    st->context,
-                                    st->family,
+                                prometheus_label_copy(
+                                    dimension,
                                     (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
-                                    rd->multiplier,
-                                    rd->divisor,
-                                    h,
-                                    st->units,
-                                    t);
+                                    PROMETHEUS_ELEMENT_MAX);
 
-                            if (unlikely(output_options & PROMETHEUS_OUTPUT_TYPES))
-                                buffer_sprintf(wb, "# TYPE %s_%s%s %s\n", prefix, context, suffix, t);
-
-                            if (output_options & PROMETHEUS_OUTPUT_TIMESTAMPS)
-                                buffer_sprintf(
-                                    wb,
-                                    "%s_%s%s{chart=\"%s\",family=\"%s\",dimension=\"%s\"%s} " COLLECTED_NUMBER_FORMAT
-                                    " %llu\n",
-                                    prefix,
-                                    context,
-                                    suffix,
-                                    chart,
-                                    family,
-                                    dimension,
-                                    labels,
-                                    rd->last_collected_value,
-                                    timeval_msec(&rd->last_collected_time));
-                            else
                                 buffer_sprintf(
-                                    wb,
-                                    "%s_%s%s{chart=\"%s\",family=\"%s\",dimension=\"%s\"%s} " COLLECTED_NUMBER_FORMAT
-                                    "\n",
+                                    line,
+                                    "%s_%s%s{chart=\"%s\",family=\"%s\",dimension=\"%s\"",
                                     prefix,
-                                    context,
+                                    names.context,
                                     suffix,
-                                    chart,
-                                    family,
-                                    dimension,
-                                    labels,
-                                    rd->last_collected_value);
-                        } else {
-                            // the dimensions of the chart, do not have the same algorithm, multiplier or divisor
-                            // we create a metric per dimension
-
-                            prometheus_name_copy(
-                                dimension,
-                                (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
-                                PROMETHEUS_ELEMENT_MAX);
-
-                            if (unlikely(output_options & PROMETHEUS_OUTPUT_HELP))
-                                buffer_sprintf(
-                                    wb,
-                                    "# COMMENT %s_%s_%s%s: chart \"%s\", context \"%s\", family \"%s\", dimension \"%s\", value * " COLLECTED_NUMBER_FORMAT
-                                    " / " COLLECTED_NUMBER_FORMAT " %s %s (%s)\n",
-                                    prefix,
-                                    context,
+                                    names.chart,
+                                    names.family,
+                                    dimension);
+                            } else {
+                                // the dimensions of the chart, do not have the same algorithm, multiplier or divisor
+                                // we create a metric per dimension
+
+                                prometheus_name_copy(
                                     dimension,
-                                    suffix,
-                                    (output_options & PROMETHEUS_OUTPUT_NAMES && st->name) ? st->name : st->id,
-                                    st->context,
-                                    st->family,
                                     (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
-                                    rd->multiplier,
-                                    rd->divisor,
-                                    h,
-                                    st->units,
-                                    t);
-
-                            if (unlikely(output_options & PROMETHEUS_OUTPUT_TYPES))
-                                buffer_sprintf(
-                                    wb, "# TYPE %s_%s_%s%s %s\n", prefix, context, dimension, suffix, t);
+                                    PROMETHEUS_ELEMENT_MAX);
 
-                            if (output_options & PROMETHEUS_OUTPUT_TIMESTAMPS)
                                 buffer_sprintf(
-                                    wb,
-                                    "%s_%s_%s%s{chart=\"%s\",family=\"%s\"%s} " COLLECTED_NUMBER_FORMAT " %llu\n",
+                                    line,
+                                    "%s_%s_%s%s{chart=\"%s\",family=\"%s\"",
                                     prefix,
-                                    context,
+                                    names.context,
                                     dimension,
                                     suffix,
-                                    chart,
-                                    family,
-                                    labels,
-                                    rd->last_collected_value,
-                                    timeval_msec(&rd->last_collected_time));
-                            else
-                                buffer_sprintf(
-                                    wb,
-                                    "%s_%s_%s%s{chart=\"%s\",family=\"%s\"%s} " COLLECTED_NUMBER_FORMAT "\n",
-                                    prefix,
-                                    context,
-                                    dimension,
-                                    suffix,
-                                    chart,
-                                    family,
-                                    labels,
-                                    rd->last_collected_value);
+                                    names.chart,
+                                    names.family);
+                            }
+
+                            pc = prometheus_dimension_cache_set(rd, st->metadata_version, key, prefix_len, line);
                         }
+
+                        if (unlikely(output_options & PROMETHEUS_OUTPUT_HELP))
+                            buffer_sprintf(
+                                wb,
+                                "# COMMENT %.*s: chart \"%s\", context \"%s\", family \"%s\", dimension \"%s\", value * " COLLECTED_NUMBER_FORMAT
+                                " / " COLLECTED_NUMBER_FORMAT " %s %s (%s)\n",
+                                (int)pc->metric_len,
+                                pc->line,
+                                (output_options & PROMETHEUS_OUTPUT_NAMES && st->name) ? st->name : st->id,
+                                st->context,
+                                st->family,
+                                (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
+                                rd->multiplier,
+                                rd->divisor,
+                                h,
+                                st->units,
+                                t);
+
+                        if (unlikely(output_options & PROMETHEUS_OUTPUT_TYPES))
+                            buffer_sprintf(wb, "# TYPE %.*s %s\n", (int)pc->metric_len, pc->line, t);
+
+                        prometheus_print_metric(wb, pc, labels, labels_len);
+                        if (output_options & PROMETHEUS_OUTPUT_TIMESTAMPS)
+                            buffer_sprintf(
+                                wb,
+                                COLLECTED_NUMBER_FORMAT " %llu\n",
+                                rd->last_collected_value,
+                                timeval_msec(&rd->last_collected_time));
+                        else
+                            buffer_sprintf(wb, COLLECTED_NUMBER_FORMAT "\n", rd->last_collected_value);
                     } else {
                         // we need average or sum of the data
 
@@ -682,61 +772,56 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
                         calculated_number value = exporting_calculate_value_from_stored_data(instance, rd, &last_time);
 
                         if (!isnan(value) && !isinf(value)) {
-                            if (EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) == EXPORTING_SOURCE_DATA_AVERAGE)
-                                suffix = "_average";
-                            else if (EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) == EXPORTING_SOURCE_DATA_SUM)
-                                suffix = "_sum";
+                            pc = prometheus_dimension_cache_get(rd, st->metadata_version, key, prefix, prefix_len);
+                            if (unlikely(!pc)) {
+                                prometheus_chart_names_prepare(&names, st, exporting_options, output_options);
+                                if (!line)
+                                    line = buffer_create(PROMETHEUS_ELEMENT_MAX * 4);
+
+                                if (EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) == EXPORTING_SOURCE_DATA_AVERAGE)
+                                    suffix = "_average";
+                                else if (EXPORTING_OPTIONS_DATA_SOURCE(exporting_options) == EXPORTING_SOURCE_DATA_SUM)
+                                    suffix = "_sum";
+
+                                prometheus_label_copy(
+                                    dimension,
+                                    (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
+                                    PROMETHEUS_ELEMENT_MAX);
 
-                            prometheus_label_copy(
-                                dimension,
-                                (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
-                                PROMETHEUS_ELEMENT_MAX);
+                                buffer_sprintf(
+                                    line,
+                                    "%s_%s%s%s{chart=\"%s\",family=\"%s\",dimension=\"%s\"",
+                                    prefix,
+                                    names.context,
+                                    names.units,
+                                    suffix,
+                                    names.chart,
+                                    names.family,
+                                    dimension);
+
+                                pc = prometheus_dimension_cache_set(rd, st->metadata_version, key, prefix_len, line);
+                            }
 
                             if (unlikely(output_options & PROMETHEUS_OUTPUT_HELP))
                                 buffer_sprintf(
                                     wb,
-                                    "# COMMENT %s_%s%s%s: dimension \"%s\", value is %s, gauge, dt %llu to %llu inclusive\n",
-                                    prefix,
-                                    context,
-                                    units,
-                                    suffix,
+                                    "# COMMENT %.*s: dimension \"%s\", value is %s, gauge, dt %llu to %llu inclusive\n",
+                                    (int)pc->metric_len,
+                                    pc->line,
                                     (output_options & PROMETHEUS_OUTPUT_NAMES && rd->name) ? rd->name : rd->id,
                                     st->units,
                                     (unsigned long long)first_time,
                                     (unsigned long long)last_time);
 
                             if (unlikely(output_options & PROMETHEUS_OUTPUT_TYPES))
-                                buffer_sprintf(wb, "# TYPE %s_%s%s%s gauge\n", prefix, context, units, suffix);
+                                buffer_sprintf(wb, "# TYPE %.*s gauge\n", (int)pc->metric_len, pc->line);
 
+                            prometheus_print_metric(wb, pc, labels, labels_len);
                             if (output_options & PROMETHEUS_OUTPUT_TIMESTAMPS)
                                 buffer_sprintf(
-                                    wb,
-                                    "%s_%s%s%s{chart=\"%s\",family=\"%s\",dimension=\"%s\"%s} " CALCULATED_NUMBER_FORMAT
-                                    " %llu\n",
-                                    prefix,
-                                    context,
-                                    units,
-                                    suffix,
-                                    chart,
-                                    family,
-                                    dimension,
-                                    labels,
-                                    value,
-                                    last_time * MSEC_PER_SEC);
+                                    wb, CALCULATED_NUMBER_FORMAT " %llu\n", value, last_time * MSEC_PER_SEC);
                             else
-                                buffer_sprintf(
-                                    wb,
-                                    "%s_%s%s%s{chart=\"%s\",family=\"%s\",dimension=\"%s\"%s} " CALCULATED_NUMBER_FORMAT
-                                    "\n",
-                                    prefix,
-                                    context,
-                                    units,
-                                    suffix,
-                                    chart,
-                                    family,
-                                    dimension,
-                                    labels,
-                                    value);
+                                buffer_sprintf(wb, CALCULATED_NUMBER_FORMAT "\n", value);
                         }
                     }
                 }
@@ -747,6 +832,8 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(
     }
 
     rrdhost_unlock(host);
+
+    buffer_free(line);
 }
 
 /**
@@ -834,6 +921,9 @@ void rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(
     if (unlikely(!prometheus_exporter_instance))
         return;
 
+    usec_t started_ut = now_monotonic_high_precision_usec();
+    netdata_mutex_lock(&prometheus_render_mutex);
+
     prometheus_exporter_instance->before = now_realtime_sec();
 
     // we start at the point we had stopped before
@@ -848,6 +938,9 @@ void rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(
 
     rrd_stats_api_v1_charts_allmetrics_prometheus(
         prometheus_exporter_instance, host, wb, prefix, exporting_options, 0, output_options);
+
+    netdata_mutex_unlock(&prometheus_render_mutex);
+    latency_histogram_add(&prometheus_scrape_histogram, now_monotonic_high_precision_usec() - started_ut);
 }
 
 /**
@@ -871,6 +964,9 @@ void rrd_stats_api_v1_charts_allmetrics_prometheus_all_hosts(
     if (unlikely(!prometheus_exporter_instance))
         return;
 
+    usec_t started_ut = now_monotonic_high_precision_usec();
+    netdata_mutex_lock(&prometheus_render_mutex);
+
     prometheus_exporter_instance->before = now_realtime_sec();
 
     // we start at the point we had stopped before
@@ -890,4 +986,7 @@ void rrd_stats_api_v1_charts_allmetrics_prometheus_all_hosts(
             prometheus_exporter_instance, host, wb, prefix, exporting_options, 1, output_options);
     }
     rrd_unlock();
+
+    netdata_mutex_unlock(&prometheus_render_mutex);
+    latency_histogram_add(&prometheus_scrape_histogram, now_monotonic_high_precision_usec() - started_ut);
 }
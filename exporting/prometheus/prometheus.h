@@ -3,12 +3,13 @@
 #ifndef NETDATA_EXPORTING_PROMETHEUS_H
 #define NETDATA_EXPORTING_PROMETHEUS_H 1
 
-#include "exporting/exporting_engine.h"
-
+// defined before the includes, the remote write connector data, included by the exporting engine, needs them
 #define PROMETHEUS_ELEMENT_MAX  256
 #define PROMETHEUS_LABELS_MAX   1024
 #define PROMETHEUS_VARIABLE_MAX 256
 
+#include "exporting/exporting_engine.h"
+
 #define PROMETHEUS_LABELS_MAX_NUMBER 128
 
 typedef enum prometheus_output_flags {
@@ -22,6 +23,20 @@ typedef enum prometheus_output_flags {
 	PROMETHEUS_OUTPUT_HIDEUNITS  = (1 << 6)
 } PROMETHEUS_OUTPUT_OPTIONS;
 
+// the metric name and the labels of a dimension, up to the labels of the host
+// e.g. 'netdata_system_cpu_percentage_average{chart="system.cpu",family="cpu",dimension="user"'
+struct prometheus_dimension_cache {
+    size_t version;                 // the metadata version of the chart, when the line was rendered
+    uint32_t key;                   // the output options and the data source the line was rendered with
+    size_t prefix_len;              // the length of the prefix at the beginning of the line
+    size_t metric_len;              // the length of the metric name at the beginning of the line
+    size_t len;                     // the length of the line
+    size_t size;                    // the space allocated for the line
+    char line[];
+};
+
+extern LATENCY_HISTOGRAM prometheus_scrape_histogram;
+
 extern void rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(
     RRDHOST *host, BUFFER *wb, const char *server, const char *prefix,
     EXPORTING_OPTIONS exporting_options, PROMETHEUS_OUTPUT_OPTIONS output_options);
@@ -2,26 +2,20 @@
 
 #include "remote_write.h"
 
-static int as_collected;
-static int homogeneous;
-char context[PROMETHEUS_ELEMENT_MAX + 1];
-char chart[PROMETHEUS_ELEMENT_MAX + 1];
-char family[PROMETHEUS_ELEMENT_MAX + 1];
-char units[PROMETHEUS_ELEMENT_MAX + 1] = "";
-
 /**
- * Prepare HTTP header
+ * Write an HTTP header for a remote write request
  *
  * @param instance an instance data structure.
+ * @param wb the buffer to write the header to.
+ * @param content_length the size of the compressed write request.
  */
-void prometheus_remote_write_prepare_header(struct instance *instance)
+static void prometheus_remote_write_header(struct instance *instance, BUFFER *wb, size_t content_length)
 {
     struct prometheus_remote_write_specific_config *connector_specific_config =
         instance->config.connector_specific_config;
-    struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
 
     buffer_sprintf(
-        simple_connector_data->last_buffer->header,
+        wb,
         "POST %s HTTP/1.1\r\n"
         "Host: %s\r\n"
         "Accept: */*\r\n"
@@ -30,12 +24,36 @@ void prometheus_remote_write_prepare_header(struct instance *instance)
         "Content-Type: application/x-www-form-urlencoded\r\n\r\n",
         connector_specific_config->remote_write_path,
         instance->config.destination,
-        buffer_strlen(simple_connector_data->last_buffer->buffer));
+        content_length);
+}
+
+/**
+ * Prepare HTTP header
+ *
+ * @param instance an instance data structure.
+ */
+void prometheus_remote_write_prepare_header(struct instance *instance)
+{
+    struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        simple_connector_data->connector_specific_data;
+
+    // the requests of a split batch already have their headers in the buffer
+    if (connector_specific_data && connector_specific_data->batch_requests) {
+        connector_specific_data->batch_requests = 0;
+        return;
+    }
+
+    prometheus_remote_write_header(
+        instance, simple_connector_data->last_buffer->header, buffer_strlen(simple_connector_data->last_buffer->buffer));
 }
 
 /**
  * Process a responce received after Prometheus remote write connector had sent data
  *
+ * Requests are pipelined, so the buffer can contain several responses, and the beginning of a response, which
+ * is kept in the buffer until the rest of it is received. Every complete response releases a request in flight.
+ *
  * @param buffer a response from a remote service.
  * @param instance an instance data structure.
  * @return Returns 0 on success, 1 on failure.
@@ -45,22 +63,218 @@ int process_prometheus_remote_write_response(BUFFER *buffer, struct instance *in
     if (unlikely(!buffer))
         return 1;
 
+    struct prometheus_remote_write_specific_data *connector_specific_data = NULL;
+    if (likely(instance && instance->connector_specific_data))
+        connector_specific_data =
+            ((struct simple_connector_data *)instance->connector_specific_data)->connector_specific_data;
+
+    // a response shorter than its status line prefix is incomplete, the rest of it will follow
+    while (buffer_strlen(buffer) >= 5) {
+        const char *s = buffer_tostring(buffer);
+
+        if (unlikely(strncmp(s, "HTTP/", 5))) {
+            // we cannot find where the responses begin, the requests in flight will not be released
+            if (connector_specific_data)
+                connector_specific_data->requests_in_flight = 0;
+            return exporting_discard_response(buffer, instance);
+        }
+
+        const char *body = strstr(s, "\r\n\r\n");
+        if (!body)
+            break;
+        body += 4;
+
+        size_t content_length = 0;
+        int chunked = 0;
+        for (const char *line = strstr(s, "\r\n") + 2; line < body - 2; line = strstr(line, "\r\n") + 2) {
+            if (!strncasecmp(line, "Content-Length:", 15))
+                content_length = strtoul(line + 15, NULL, 10);
+            else if (!strncasecmp(line, "Transfer-Encoding:", 18)) {
+                const char *value = strstr(line, "chunked");
+                chunked = (value && value < strstr(line, "\r\n"));
+            }
+        }
+
+        const char *end = body + content_length;
+        if (unlikely(chunked)) {
+            if (!strncmp(body, "0\r\n\r\n", 5))
+                end = body + 5;
+            else if ((end = strstr(body, "\r\n0\r\n\r\n")))
+                end += 7;
+            else
+                break;
+        }
+
+        size_t response_len = end - s;
+        if (response_len > buffer_strlen(buffer))
+            break;
+
+        // do nothing with HTTP responses 2xx
+
+        const char *status = s;
+        while (*status && !isspace(*status))
+            status++;
+        while (*status == ' ')
+            status++;
+        int code = str2i(status);
+
+        if (unlikely(code < 200 || code > 299)) {
+            const char *eol = strstr(s, "\r\n");
+            error(
+                "EXPORTING: '%s' did not accept a remote write request: %.*s",
+                instance ? instance->config.destination : "",
+                (int)(eol - s),
+                s);
+        }
+
+        if (connector_specific_data && connector_specific_data->requests_in_flight)
+            connector_specific_data->requests_in_flight--;
+
+        buffer->len -= response_len;
+        memmove(buffer->buffer, &buffer->buffer[response_len], buffer->len);
+    }
+
+    return 0;
+}
+
+/**
+ * Count the requests in a batch
+ *
+ * A batch is either a single write request, with its header in a separate buffer, or a series of complete
+ * HTTP requests, when it was split by the max samples per request limit.
+ *
+ * @param header the header of the batch.
+ * @param buffer the batch.
+ * @return Returns the number of HTTP requests.
+ */
+size_t prometheus_remote_write_count_requests(BUFFER *header, BUFFER *buffer)
+{
+    if (buffer_strlen(header))
+        return 1;
+
+    size_t requests = 0;
+    const char *s = buffer_tostring(buffer);
+    const char *end = s + buffer_strlen(buffer);
+
+    while (s < end) {
+        const char *body = strstr(s, "\r\n\r\n");
+        const char *content_length = strstr(s, "Content-Length: ");
+
+        if (unlikely(!body || !content_length || content_length > body))
+            break;
+
+        s = body + 4 + strtoul(content_length + 16, NULL, 10);
+        requests++;
+    }
+
+    return requests;
+}
+
+/**
+ * Measure the first requests of a split batch
+ *
+ * @param buffer a batch split into complete HTTP requests.
+ * @param requests the number of requests to measure.
+ * @return Returns the length of the first requests, or of the whole batch when it has fewer requests.
+ */
+size_t prometheus_remote_write_requests_length(BUFFER *buffer, size_t requests)
+{
     const char *s = buffer_tostring(buffer);
-    int len = buffer_strlen(buffer);
+    const char *end = s + buffer_strlen(buffer);
 
-    // do nothing with HTTP responses 200 or 204
+    for (; requests && s < end; requests--) {
+        const char *body = strstr(s, "\r\n\r\n");
+        const char *content_length = strstr(s, "Content-Length: ");
 
-    while (!isspace(*s) && len) {
-        s++;
-        len--;
+        if (unlikely(!body || !content_length || content_length > body))
+            return buffer_strlen(buffer);
+
+        s = body + 4 + strtoul(content_length + 16, NULL, 10);
     }
-    s++;
-    len--;
 
-    if (likely(len > 4 && (!strncmp(s, "200 ", 4) || !strncmp(s, "204 ", 4))))
-        return 0;
-    else
-        return exporting_discard_response(buffer, instance);
+    return (s < end) ? (size_t)(s - buffer_tostring(buffer)) : buffer_strlen(buffer);
+}
+
+/**
+ * Forget the requests in flight
+ *
+ * Called when the connection is re-opened, since the responses to the requests sent on the previous one will never
+ * arrive.
+ *
+ * @param instance an instance data structure.
+ */
+void prometheus_remote_write_connection_reset(struct instance *instance)
+{
+    struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        simple_connector_data->connector_specific_data;
+
+    connector_specific_data->requests_in_flight = 0;
+}
+
+/**
+ * Wait for responses, until requests can be sent
+ *
+ * The requests are pipelined: the next ones are sent on the connection without waiting for the responses to the
+ * previous ones, as long as there are fewer than the configured number of requests in flight. Batches, and the
+ * requests they are split to, are sent in order over a single connection, so the samples of every series reach
+ * the server in the order they were collected.
+ *
+ * @param sock communication socket.
+ * @param instance an instance data structure.
+ * @param requests the number of requests to send, at most the number of requests allowed in flight.
+ * @return Returns 0 when the requests can be sent, 1 when the server did not respond in time.
+ */
+int prometheus_remote_write_wait_for_responses(int *sock, struct instance *instance, size_t requests)
+{
+    struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        simple_connector_data->connector_specific_data;
+    struct prometheus_remote_write_specific_config *connector_specific_config =
+        instance->config.connector_specific_config;
+
+    size_t max_requests_in_flight = connector_specific_config->max_requests_in_flight;
+
+    usec_t timeout_ut = (usec_t)instance->config.timeoutms * USEC_PER_MS;
+    usec_t started_ut = now_monotonic_usec();
+
+    while (max_requests_in_flight && *sock != -1 && connector_specific_data->requests_in_flight &&
+           connector_specific_data->requests_in_flight + requests > max_requests_in_flight) {
+        usec_t waited_ut = now_monotonic_usec() - started_ut;
+
+        if (unlikely(waited_ut >= timeout_ut || instance->engine->exit)) {
+            error(
+                "EXPORTING: '%s' did not respond to %zu remote write requests in time. Will re-connect.",
+                instance->config.destination,
+                connector_specific_data->requests_in_flight);
+            close(*sock);
+            *sock = -1;
+            break;
+        }
+
+        int pending = 0;
+#ifdef ENABLE_HTTPS
+        if (simple_connector_data->conn && simple_connector_data->flags == NETDATA_SSL_HANDSHAKE_COMPLETE)
+            pending = SSL_pending(simple_connector_data->conn);
+#endif
+        if (!pending) {
+            struct pollfd fd = { .fd = *sock, .events = POLLIN };
+            int timeout_ms = (int)((timeout_ut - waited_ut) / USEC_PER_MS) + 1;
+
+            // check for the exit flag at least once per second
+            if (poll(&fd, 1, (timeout_ms < 1000) ? timeout_ms : 1000) <= 0)
+                continue;
+        }
+
+        simple_connector_receive_response(sock, instance);
+    }
+
+    if (unlikely(*sock == -1))
+        return 1;
+
+    connector_specific_data->requests_in_flight += requests;
+
+    return 0;
 }
 
 /**
@@ -71,7 +285,12 @@ int process_prometheus_remote_write_response(BUFFER *buffer, struct instance *in
 void clean_prometheus_remote_write(struct instance *instance)
 {
     struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
-    freez(simple_connector_data->connector_specific_data);
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        simple_connector_data->connector_specific_data;
+
+    free_write_request(connector_specific_data->write_request);
+    buffer_free(connector_specific_data->payload);
+    freez(connector_specific_data);
 
     struct prometheus_remote_write_specific_config *connector_specific_config =
         instance->config.connector_specific_config;
@@ -184,6 +403,16 @@ int format_host_prometheus_remote_write(struct instance *instance, RRDHOST *host
  */
 int format_chart_prometheus_remote_write(struct instance *instance, RRDSET *st)
 {
+    struct simple_connector_data *simple_connector_data =
+        (struct simple_connector_data *)instance->connector_specific_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        (struct prometheus_remote_write_specific_data *)simple_connector_data->connector_specific_data;
+
+    char *chart = connector_specific_data->chart;
+    char *family = connector_specific_data->family;
+    char *context = connector_specific_data->context;
+    char *units = connector_specific_data->units;
+
     prometheus_label_copy(
         chart,
         (instance->config.options & EXPORTING_OPTION_SEND_NAMES && st->name) ? st->name : st->id,
@@ -191,14 +420,15 @@ int format_chart_prometheus_remote_write(struct instance *instance, RRDSET *st)
     prometheus_label_copy(family, st->family, PROMETHEUS_ELEMENT_MAX);
     prometheus_name_copy(context, st->context, PROMETHEUS_ELEMENT_MAX);
 
-    as_collected = (EXPORTING_OPTIONS_DATA_SOURCE(instance->config.options) == EXPORTING_SOURCE_DATA_AS_COLLECTED);
-    homogeneous = 1;
-    if (as_collected) {
+    connector_specific_data->as_collected =
+        (EXPORTING_OPTIONS_DATA_SOURCE(instance->config.options) == EXPORTING_SOURCE_DATA_AS_COLLECTED);
+    connector_specific_data->homogeneous = 1;
+    if (connector_specific_data->as_collected) {
         if (rrdset_flag_check(st, RRDSET_FLAG_HOMOGENEOUS_CHECK))
             rrdset_update_heterogeneous_flag(st);
 
         if (rrdset_flag_check(st, RRDSET_FLAG_HETEROGENEOUS))
-            homogeneous = 0;
+            connector_specific_data->homogeneous = 0;
     } else {
         if (EXPORTING_OPTIONS_DATA_SOURCE(instance->config.options) == EXPORTING_SOURCE_DATA_AVERAGE)
             prometheus_units_copy(units, st->units, PROMETHEUS_ELEMENT_MAX, 0);
@@ -207,6 +437,55 @@ int format_chart_prometheus_remote_write(struct instance *instance, RRDSET *st)
     return 0;
 }
 
+/**
+ * Pack the samples added so far into a complete HTTP request
+ *
+ * The request, with its header, is appended to the buffer of the batch. It is used when the batch has more samples
+ * than allowed per request.
+ *
+ * @param instance an instance data structure.
+ * @return Returns 0 on success, 1 on failure.
+ */
+static int prometheus_remote_write_pack_request(struct instance *instance)
+{
+    struct simple_connector_data *simple_connector_data =
+        (struct simple_connector_data *)instance->connector_specific_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        (struct prometheus_remote_write_specific_data *)simple_connector_data->connector_specific_data;
+
+    size_t data_size = get_write_request_size(connector_specific_data->write_request);
+
+    if (unlikely(!data_size)) {
+        error("EXPORTING: write request size is out of range");
+        return 1;
+    }
+
+    // the compressed request is kept in a buffer, reused by all the requests of the instance
+    if (unlikely(!connector_specific_data->payload))
+        connector_specific_data->payload = buffer_create(data_size);
+
+    BUFFER *payload = connector_specific_data->payload;
+
+    buffer_flush(payload);
+    buffer_need_bytes(payload, data_size);
+    if (unlikely(pack_and_clear_write_request(connector_specific_data->write_request, payload->buffer, &data_size))) {
+        error("EXPORTING: cannot pack write request");
+        return 1;
+    }
+    payload->len = data_size;
+
+    BUFFER *buffer = instance->buffer;
+
+    prometheus_remote_write_header(instance, buffer, data_size);
+    buffer_need_bytes(buffer, data_size);
+    memcpy(&buffer->buffer[buffer->len], payload->buffer, data_size);
+    buffer->len += data_size;
+
+    connector_specific_data->batch_requests++;
+
+    return 0;
+}
+
 /**
  * Format dimension data for Prometheus Remote Write connector
  *
@@ -221,13 +500,20 @@ int format_dimension_prometheus_remote_write(struct instance *instance, RRDDIM *
     struct prometheus_remote_write_specific_data *connector_specific_data =
         (struct prometheus_remote_write_specific_data *)simple_connector_data->connector_specific_data;
 
+    struct prometheus_remote_write_specific_config *connector_specific_config =
+        instance->config.connector_specific_config;
+
     if (rd->collections_counter && !rrddim_flag_check(rd, RRDDIM_FLAG_OBSOLETE)) {
+        char *chart = connector_specific_data->chart;
+        char *family = connector_specific_data->family;
+        char *context = connector_specific_data->context;
+        char *units = connector_specific_data->units;
         char name[PROMETHEUS_LABELS_MAX + 1];
         char dimension[PROMETHEUS_ELEMENT_MAX + 1];
         char *suffix = "";
         RRDHOST *host = rd->rrdset->rrdhost;
 
-        if (as_collected) {
+        if (connector_specific_data->as_collected) {
             // we need as-collected / raw data
 
             if (unlikely(rd->last_collected_time.tv_sec < instance->after)) {
@@ -243,7 +529,7 @@ int format_dimension_prometheus_remote_write(struct instance *instance, RRDDIM *
                 return 0;
             }
 
-            if (homogeneous) {
+            if (connector_specific_data->homogeneous) {
                 // all the dimensions of the chart, has the same algorithm, multiplier and divisor
                 // we add all dimensions as labels
 
@@ -302,6 +588,12 @@ int format_dimension_prometheus_remote_write(struct instance *instance, RRDDIM *
                     value, last_t * MSEC_PER_SEC);
             }
         }
+
+        if (unlikely(
+                connector_specific_config && connector_specific_config->max_samples_per_request &&
+                get_write_request_samples(connector_specific_data->write_request) >=
+                    connector_specific_config->max_samples_per_request))
+            return prometheus_remote_write_pack_request(instance);
     }
 
     return 0;
@@ -320,21 +612,33 @@ int format_batch_prometheus_remote_write(struct instance *instance)
     struct prometheus_remote_write_specific_data *connector_specific_data =
         (struct prometheus_remote_write_specific_data *)simple_connector_data->connector_specific_data;
 
-    size_t data_size = get_write_request_size(connector_specific_data->write_request);
+    BUFFER *buffer = instance->buffer;
 
-    if (unlikely(!data_size)) {
-        error("EXPORTING: write request size is out of range");
-        return 1;
-    }
+    if (connector_specific_data->batch_requests) {
+        // the batch has been split, the rest of the samples go to its last request
+        if (get_write_request_samples(connector_specific_data->write_request) &&
+            unlikely(prometheus_remote_write_pack_request(instance))) {
+            connector_specific_data->batch_requests = 0;
+            buffer_flush(buffer);
+            return 1;
+        }
+    } else {
+        size_t data_size = get_write_request_size(connector_specific_data->write_request);
 
-    BUFFER *buffer = instance->buffer;
+        if (unlikely(!data_size)) {
+            error("EXPORTING: write request size is out of range");
+            return 1;
+        }
 
-    buffer_need_bytes(buffer, data_size);
-    if (unlikely(pack_and_clear_write_request(connector_specific_data->write_request, buffer->buffer, &data_size))) {
-        error("EXPORTING: cannot pack write request");
-        return 1;
+        buffer_need_bytes(buffer, data_size);
+        if (unlikely(
+                pack_and_clear_write_request(connector_specific_data->write_request, buffer->buffer, &data_size))) {
+            error("EXPORTING: cannot pack write request");
+            return 1;
+        }
+        buffer->len = data_size;
     }
-    buffer->len = data_size;
+
     instance->stats.buffered_bytes = (collected_number)buffer_strlen(buffer);
 
     simple_connector_end_batch(instance);
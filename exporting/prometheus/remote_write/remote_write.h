@@ -9,6 +9,21 @@
 
 struct prometheus_remote_write_specific_data {
     void *write_request;
+
+    // the state of the chart being formatted
+    int as_collected;
+    int homogeneous;
+    char context[PROMETHEUS_ELEMENT_MAX + 1];
+    char chart[PROMETHEUS_ELEMENT_MAX + 1];
+    char family[PROMETHEUS_ELEMENT_MAX + 1];
+    char units[PROMETHEUS_ELEMENT_MAX + 1];
+
+    // a batch with more samples than allowed per request is split into complete HTTP requests
+    BUFFER *payload;
+    size_t batch_requests;
+
+    // the requests sent on the connection, which have not been answered yet
+    size_t requests_in_flight;
 };
 
 int init_prometheus_remote_write_instance(struct instance *instance);
@@ -21,5 +36,9 @@ int format_batch_prometheus_remote_write(struct instance *instance);
 
 void prometheus_remote_write_prepare_header(struct instance *instance);
 int process_prometheus_remote_write_response(BUFFER *buffer, struct instance *instance);
+size_t prometheus_remote_write_count_requests(BUFFER *header, BUFFER *buffer);
+size_t prometheus_remote_write_requests_length(BUFFER *buffer, size_t requests);
+void prometheus_remote_write_connection_reset(struct instance *instance);
+int prometheus_remote_write_wait_for_responses(int *sock, struct instance *instance, size_t requests);
 
 #endif //NETDATA_EXPORTING_PROMETHEUS_REMOTE_WRITE_H
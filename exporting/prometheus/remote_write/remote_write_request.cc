@@ -6,7 +6,17 @@
 
 using namespace prometheus;
 
-google::protobuf::Arena arena;
+// Every connector instance owns its arena. The write request is cleared after it is packed, so the timeseries,
+// labels and samples allocated on the arena, and the buffer for the serialized request, are reused by the next
+// requests instead of being allocated again.
+struct write_request_data {
+    google::protobuf::Arena *arena;
+    WriteRequest *write_request;
+    std::string uncompressed_write_request;
+    size_t samples;
+};
+
+#define WRITE_REQUEST(write_request_p) (((struct write_request_data *)(write_request_p))->write_request)
 
 /**
  * Initialize a write request
@@ -16,8 +26,34 @@ google::protobuf::Arena arena;
 void *init_write_request()
 {
     GOOGLE_PROTOBUF_VERIFY_VERSION;
-    WriteRequest *write_request = google::protobuf::Arena::CreateMessage<WriteRequest>(&arena);
-    return (void *)write_request;
+
+    google::protobuf::ArenaOptions arena_options;
+    arena_options.start_block_size = 64 * 1024;
+    arena_options.max_block_size = 1024 * 1024;
+
+    struct write_request_data *write_request_data = new struct write_request_data;
+    write_request_data->arena = new google::protobuf::Arena(arena_options);
+    write_request_data->write_request =
+        google::protobuf::Arena::CreateMessage<WriteRequest>(write_request_data->arena);
+    write_request_data->samples = 0;
+
+    return (void *)write_request_data;
+}
+
+/**
+ * Free a write request and the memory allocated for it
+ *
+ * @param write_request_p the write request
+ */
+void free_write_request(void *write_request_p)
+{
+    struct write_request_data *write_request_data = (struct write_request_data *)write_request_p;
+
+    if (!write_request_data)
+        return;
+
+    delete write_request_data->arena;
+    delete write_request_data;
 }
 
 /**
@@ -34,11 +70,13 @@ void add_host_info(
     void *write_request_p,
     const char *name, const char *instance, const char *application, const char *version, const int64_t timestamp)
 {
-    WriteRequest *write_request = (WriteRequest *)write_request_p;
+    WriteRequest *write_request = WRITE_REQUEST(write_request_p);
     TimeSeries *timeseries;
     Sample *sample;
     Label *label;
 
+    ((struct write_request_data *)write_request_p)->samples++;
+
     timeseries = write_request->add_timeseries();
 
     label = timeseries->add_labels();
@@ -75,7 +113,7 @@ void add_host_info(
  */
 void add_label(void *write_request_p, char *key, char *value)
 {
-    WriteRequest *write_request = (WriteRequest *)write_request_p;
+    WriteRequest *write_request = WRITE_REQUEST(write_request_p);
     TimeSeries *timeseries;
     Label *label;
 
@@ -103,11 +141,13 @@ void add_metric(
     const char *name, const char *chart, const char *family, const char *dimension, const char *instance,
     const double value, const int64_t timestamp)
 {
-    WriteRequest *write_request = (WriteRequest *)write_request_p;
+    WriteRequest *write_request = WRITE_REQUEST(write_request_p);
     TimeSeries *timeseries;
     Sample *sample;
     Label *label;
 
+    ((struct write_request_data *)write_request_p)->samples++;
+
     timeseries = write_request->add_timeseries();
 
     label = timeseries->add_labels();
@@ -137,6 +177,17 @@ void add_metric(
     sample->set_timestamp(timestamp);
 }
 
+/**
+ * Gets the number of samples added to a write request since it was packed last time
+ *
+ * @param write_request_p the write request
+ * @return Returns the number of samples
+ */
+size_t get_write_request_samples(void *write_request_p)
+{
+    return ((struct write_request_data *)write_request_p)->samples;
+}
+
 /**
  * Gets the size of a write request
  *
@@ -145,7 +196,7 @@ void add_metric(
  */
 size_t get_write_request_size(void *write_request_p)
 {
-    WriteRequest *write_request = (WriteRequest *)write_request_p;
+    WriteRequest *write_request = WRITE_REQUEST(write_request_p);
 
 #if GOOGLE_PROTOBUF_VERSION < 3001000
     size_t size = (size_t)snappy::MaxCompressedLength(write_request->ByteSize());
@@ -166,12 +217,16 @@ size_t get_write_request_size(void *write_request_p)
  */
 int pack_and_clear_write_request(void *write_request_p, char *buffer, size_t *size)
 {
-    WriteRequest *write_request = (WriteRequest *)write_request_p;
-    std::string uncompressed_write_request;
+    struct write_request_data *write_request_data = (struct write_request_data *)write_request_p;
+    WriteRequest *write_request = write_request_data->write_request;
+    std::string &uncompressed_write_request = write_request_data->uncompressed_write_request;
 
-    if (write_request->SerializeToString(&uncompressed_write_request) == false)
+    // the string keeps its capacity, so it is not reallocated for every request
+    uncompressed_write_request.clear();
+    if (write_request->AppendToString(&uncompressed_write_request) == false)
         return 1;
     write_request->clear_timeseries();
+    write_request_data->samples = 0;
     snappy::RawCompress(uncompressed_write_request.data(), uncompressed_write_request.size(), buffer, size);
 
     return 0;
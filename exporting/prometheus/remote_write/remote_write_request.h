@@ -8,6 +8,7 @@ extern "C" {
 #endif
 
 void *init_write_request();
+void free_write_request(void *write_request_p);
 
 void add_host_info(
     void *write_request_p,
@@ -20,6 +21,7 @@ void add_metric(
     const char *name, const char *chart, const char *family, const char *dimension,
     const char *instance, const double value, const int64_t timestamp);
 
+size_t get_write_request_samples(void *write_request_p);
 size_t get_write_request_size(void *write_request_p);
 
 int pack_and_clear_write_request(void *write_request_p, char *buffer, size_t *size);
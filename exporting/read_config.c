@@ -358,6 +358,13 @@ struct engine *read_exporting_config()
 
         tmp_instance->config.buffer_on_failures = exporter_get_number(instance_name, "buffer on failures", 10);
 
+        long spool_size_mb = exporter_get_number(instance_name, "spool size MB", 0);
+        tmp_instance->config.spool_size = spool_size_mb > 0 ? (size_t)spool_size_mb * 1024 * 1024 : 0;
+
+        tmp_instance->config.spool_replay_batches = exporter_get_number(instance_name, "spool replay batches", 10);
+        if (tmp_instance->config.spool_replay_batches < 1)
+            tmp_instance->config.spool_replay_batches = 1;
+
         tmp_instance->config.timeoutms = exporter_get_number(instance_name, "timeout ms", 10000);
 
         tmp_instance->config.charts_pattern =
@@ -399,6 +406,14 @@ struct engine *read_exporting_config()
 
             connector_specific_config->remote_write_path =
                 strdupz(exporter_get(instance_name, "remote write URL path", "/receive"));
+
+            long max_samples_per_request = exporter_get_number(instance_name, "max samples per request", 0);
+            connector_specific_config->max_samples_per_request =
+                (max_samples_per_request > 0) ? (size_t)max_samples_per_request : 0;
+
+            long max_requests_in_flight = exporter_get_number(instance_name, "max requests in flight", 16);
+            connector_specific_config->max_requests_in_flight =
+                (max_requests_in_flight > 0) ? (size_t)max_requests_in_flight : 0;
         }
 
         if (tmp_instance->config.type == EXPORTING_CONNECTOR_TYPE_KINESIS) {
@@ -470,10 +485,11 @@ struct engine *read_exporting_config()
 
 #ifdef NETDATA_INTERNAL_CHECKS
         info(
-            "     Dest=[%s], upd=[%d], buffer=[%d] timeout=[%ld] options=[%u]",
+            "     Dest=[%s], upd=[%d], buffer=[%d] spool=[%zu] timeout=[%ld] options=[%u]",
             tmp_instance->config.destination,
             tmp_instance->config.update_every,
             tmp_instance->config.buffer_on_failures,
+            tmp_instance->config.spool_size,
             tmp_instance->config.timeoutms,
             tmp_instance->config.options);
 #endif
@@ -62,14 +62,17 @@ int exporting_discard_response(BUFFER *buffer, struct instance *instance) {
  */
 void simple_connector_receive_response(int *sock, struct instance *instance)
 {
-    static BUFFER *response = NULL;
-    if (!response)
-        response = buffer_create(4096);
+    struct simple_connector_data *connector_specific_data = instance->connector_specific_data;
+
+    // every instance has its own response buffer, since a response can be received in parts
+    if (unlikely(!connector_specific_data->response))
+        connector_specific_data->response = buffer_create(4096);
+
+    BUFFER *response = connector_specific_data->response;
 
     struct stats *stats = &instance->stats;
 #ifdef ENABLE_HTTPS
     uint32_t options = (uint32_t)instance->config.options;
-    struct simple_connector_data *connector_specific_data = instance->connector_specific_data;
 
     if (options & EXPORTING_OPTION_USE_TLS)
         ERR_clear_error();
@@ -80,6 +83,8 @@ void simple_connector_receive_response(int *sock, struct instance *instance)
     // loop through to collect all data
     while (*sock != -1 && errno != EWOULDBLOCK) {
         ssize_t r;
+
+        buffer_need_bytes(response, 1024);
 #ifdef ENABLE_HTTPS
         if (exporting_tls_is_enabled(instance->config.type, options) &&
             connector_specific_data->conn &&
@@ -145,14 +150,15 @@ void simple_connector_receive_response(int *sock, struct instance *instance)
 }
 
 /**
- * Send buffer to a server
+ * Send data to a server
  *
  * @param sock communication socket.
- * @param failures the number of communication failures.
  * @param instance an instance data structure.
+ * @param data the data to send.
+ * @param len the length of the data.
+ * @return Returns the number of bytes sent, or -1 on failure.
  */
-void simple_connector_send_buffer(
-    int *sock, int *failures, struct instance *instance, BUFFER *header, BUFFER *buffer, size_t buffered_metrics)
+static ssize_t simple_connector_send(int *sock, struct instance *instance, const char *data, size_t len)
 {
     int flags = 0;
 #ifdef MSG_NOSIGNAL
@@ -163,6 +169,87 @@ void simple_connector_send_buffer(
     uint32_t options = (uint32_t)instance->config.options;
     struct simple_connector_data *connector_specific_data = instance->connector_specific_data;
 
+    if (exporting_tls_is_enabled(instance->config.type, options) &&
+        connector_specific_data->conn &&
+        connector_specific_data->flags == NETDATA_SSL_HANDSHAKE_COMPLETE)
+        return (ssize_t)SSL_write(connector_specific_data->conn, data, len);
+#else
+    UNUSED(instance);
+#endif
+
+    return send(*sock, data, len, flags);
+}
+
+#if ENABLE_PROMETHEUS_REMOTE_WRITE
+/**
+ * Send the requests of a split batch, which do not fit in flight together
+ *
+ * The requests are sent a few at a time, as many as are allowed in flight, waiting for responses in between. The
+ * requests sent are removed from the buffer, so that only the rest of them are sent again after a failure.
+ *
+ * @param sock communication socket.
+ * @param instance an instance data structure.
+ * @param header the header of the batch.
+ * @param buffer the batch.
+ * @return Returns 0 when the rest of the batch can be sent, 1 on failure.
+ */
+static int prometheus_remote_write_send_requests(int *sock, struct instance *instance, BUFFER *header, BUFFER *buffer)
+{
+    struct prometheus_remote_write_specific_config *connector_specific_config =
+        instance->config.connector_specific_config;
+    struct stats *stats = &instance->stats;
+
+    size_t max_requests_in_flight = connector_specific_config->max_requests_in_flight;
+    size_t requests = prometheus_remote_write_count_requests(header, buffer);
+
+    while (max_requests_in_flight && requests > max_requests_in_flight) {
+        if (prometheus_remote_write_wait_for_responses(sock, instance, max_requests_in_flight))
+            return 1;
+
+        size_t len = prometheus_remote_write_requests_length(buffer, max_requests_in_flight);
+        ssize_t sent_bytes = simple_connector_send(sock, instance, buffer_tostring(buffer), len);
+
+        if ((size_t)sent_bytes != len) {
+            error(
+                "EXPORTING: failed to write data to '%s'. Willing to write %zu bytes, wrote %zd bytes. Will re-connect.",
+                instance->config.destination,
+                len,
+                sent_bytes);
+
+            if (sent_bytes != -1)
+                stats->sent_bytes += sent_bytes;
+
+            close(*sock);
+            *sock = -1;
+            return 1;
+        }
+
+        stats->sent_bytes += sent_bytes;
+
+        buffer->len -= len;
+        memmove(buffer->buffer, &buffer->buffer[len], buffer->len);
+        buffer->buffer[buffer->len] = '\0';
+
+        requests -= max_requests_in_flight;
+    }
+
+    return prometheus_remote_write_wait_for_responses(sock, instance, requests);
+}
+#endif
+
+/**
+ * Send buffer to a server
+ *
+ * @param sock communication socket.
+ * @param failures the number of communication failures.
+ * @param instance an instance data structure.
+ */
+void simple_connector_send_buffer(
+    int *sock, int *failures, struct instance *instance, BUFFER *header, BUFFER *buffer, size_t buffered_metrics)
+{
+#ifdef ENABLE_HTTPS
+    uint32_t options = (uint32_t)instance->config.options;
+
     if (options & EXPORTING_OPTION_USE_TLS)
         ERR_clear_error();
 #endif
@@ -170,29 +257,23 @@ void simple_connector_send_buffer(
     struct stats *stats = &instance->stats;
     ssize_t header_sent_bytes = 0;
     ssize_t buffer_sent_bytes = 0;
+
+#if ENABLE_PROMETHEUS_REMOTE_WRITE
+    if (instance->config.type == EXPORTING_CONNECTOR_TYPE_PROMETHEUS_REMOTE_WRITE &&
+        unlikely(prometheus_remote_write_send_requests(sock, instance, header, buffer))) {
+        stats->transmission_failures++;
+        (*failures)++;
+        return;
+    }
+#endif
+
     size_t header_len = buffer_strlen(header);
     size_t buffer_len = buffer_strlen(buffer);
 
-#ifdef ENABLE_HTTPS
-    if (exporting_tls_is_enabled(instance->config.type, options) &&
-        connector_specific_data->conn &&
-        connector_specific_data->flags == NETDATA_SSL_HANDSHAKE_COMPLETE) {
-        if (header_len)
-            header_sent_bytes = (ssize_t)SSL_write(connector_specific_data->conn, buffer_tostring(header), header_len);
-        if ((size_t)header_sent_bytes == header_len)
-            buffer_sent_bytes = (ssize_t)SSL_write(connector_specific_data->conn, buffer_tostring(buffer), buffer_len);
-    } else {
-        if (header_len)
-            header_sent_bytes = send(*sock, buffer_tostring(header), header_len, flags);
-        if ((size_t)header_sent_bytes == header_len)
-            buffer_sent_bytes = send(*sock, buffer_tostring(buffer), buffer_len, flags);
-    }
-#else
     if (header_len)
-        header_sent_bytes = send(*sock, buffer_tostring(header), header_len, flags);
+        header_sent_bytes = simple_connector_send(sock, instance, buffer_tostring(header), header_len);
     if ((size_t)header_sent_bytes == header_len)
-        buffer_sent_bytes = send(*sock, buffer_tostring(buffer), buffer_len, flags);
-#endif
+        buffer_sent_bytes = simple_connector_send(sock, instance, buffer_tostring(buffer), buffer_len);
 
     if ((size_t)buffer_sent_bytes == buffer_len) {
         // we sent the data successfully
@@ -315,6 +396,15 @@ void simple_connector_worker(void *instance_p)
 
             sock = connect_to_one_of(
                 instance->config.destination, connector_specific_config->default_port, &timeout, &reconnects, NULL, 0);
+
+            // the responses to what was sent on the previous connection will never arrive
+            if (connector_specific_data->response)
+                buffer_flush(connector_specific_data->response);
+#if ENABLE_PROMETHEUS_REMOTE_WRITE
+            if (instance->config.type == EXPORTING_CONNECTOR_TYPE_PROMETHEUS_REMOTE_WRITE)
+                prometheus_remote_write_connection_reset(instance);
+#endif
+
 #ifdef ENABLE_HTTPS
             if (exporting_tls_is_enabled(instance->config.type, options) && sock != -1) {
                 if (netdata_exporting_ctx) {
@@ -375,7 +465,13 @@ void simple_connector_worker(void *instance_p)
 
         failures = 0;
 
-        if (likely(sock != -1)) {
+        struct exporting_spool *spool = connector_specific_data->spool;
+        int spooled = 0;
+
+        if (spool && exporting_spool_batches(spool)) {
+            // older batches are waiting in the spool, this one has to be sent after them
+            spooled = 1;
+        } else if (likely(sock != -1)) {
             simple_connector_send_buffer(
                 &sock,
                 &failures,
@@ -383,7 +479,9 @@ void simple_connector_worker(void *instance_p)
                 connector_specific_data->header,
                 connector_specific_data->buffer,
                 buffered_metrics);
-        } else {
+        }
+
+        if (unlikely(sock == -1 && !failures)) {
             error("EXPORTING: failed to update '%s'", instance->config.destination);
             stats->transmission_failures++;
 
@@ -391,7 +489,46 @@ void simple_connector_worker(void *instance_p)
             failures++;
         }
 
-        if (!failures) {
+        if (spool) {
+            // keep the batch on disk, instead of retrying it from memory
+            if (failures)
+                spooled = 1;
+
+            if (spooled) {
+                if (buffer_strlen(connector_specific_data->buffer))
+                    exporting_spool_write(
+                        spool, connector_specific_data->header, connector_specific_data->buffer, buffered_metrics);
+
+                buffer_flush(connector_specific_data->header);
+                buffer_flush(connector_specific_data->buffer);
+            }
+
+            // replay the spool in order, a few batches per iteration
+            for (int i = 0; !failures && i < instance->config.spool_replay_batches; i++) {
+                size_t spooled_metrics;
+
+                if (!exporting_spool_read(
+                        spool, connector_specific_data->header, connector_specific_data->buffer, &spooled_metrics))
+                    break;
+
+                simple_connector_send_buffer(
+                    &sock,
+                    &failures,
+                    instance,
+                    connector_specific_data->header,
+                    connector_specific_data->buffer,
+                    spooled_metrics);
+
+                if (!failures)
+                    exporting_spool_consume(spool);
+
+                // on failures the batch stays in the spool
+                buffer_flush(connector_specific_data->header);
+                buffer_flush(connector_specific_data->buffer);
+            }
+        }
+
+        if (!failures || spooled) {
             connector_specific_data->first_buffer->buffered_metrics =
                 connector_specific_data->first_buffer->buffered_bytes = connector_specific_data->first_buffer->used = 0;
             connector_specific_data->first_buffer = connector_specific_data->first_buffer->next;
@@ -404,6 +541,8 @@ void simple_connector_worker(void *instance_p)
             uv_mutex_lock(&instance->mutex);
 
             stats->buffered_metrics = connector_specific_data->total_buffered_metrics;
+            if (connector_specific_data->spool)
+                exporting_spool_statistics(connector_specific_data->spool, stats);
 
             send_internal_metrics(instance);
 
@@ -421,7 +560,10 @@ void simple_connector_worker(void *instance_p)
             stats->reconnects =
             stats->data_lost_events =
             stats->lost_metrics =
-            stats->lost_bytes = 0;
+            stats->lost_bytes =
+            stats->spool_written_batches =
+            stats->spool_replayed_batches =
+            stats->spool_dropped_batches = 0;
 
             uv_mutex_unlock(&instance->mutex);
         }
@@ -115,6 +115,41 @@ void send_internal_metrics(struct instance *instance)
         stats->rd_user   = rrddim_add(stats->st_rusage, "user", NULL, 1, 1000, RRD_ALGORITHM_INCREMENTAL);
         stats->rd_system = rrddim_add(stats->st_rusage, "system", NULL, 1, 1000, RRD_ALGORITHM_INCREMENTAL);
 
+        // ------------------------------------------------------------------------
+
+        snprintf(id, RRD_ID_LENGTH_MAX, "exporting_%s_formatting", instance->config.name);
+        netdata_fix_chart_id(id);
+
+        stats->st_formatting = rrdset_create_localhost(
+            "netdata", id, NULL, buffer_tostring(family), "exporting_formatting", "Netdata Exporting Formatting Time",
+            "milliseconds", "exporting", NULL, 130650, instance->config.update_every, RRDSET_TYPE_LINE);
+
+        stats->rd_formatting_time = rrddim_add(stats->st_formatting, "formatting", NULL, 1, 1000, RRD_ALGORITHM_ABSOLUTE);
+
+        // ------------------------------------------------------------------------
+
+        if (instance->config.spool_size) {
+            snprintf(id, RRD_ID_LENGTH_MAX, "exporting_%s_spool", instance->config.name);
+            netdata_fix_chart_id(id);
+
+            stats->st_spool = rrdset_create_localhost(
+                "netdata", id, NULL, buffer_tostring(family), "exporting_spool", "Netdata Exporting Spool Depth", "KiB",
+                "exporting", NULL, 130660, instance->config.update_every, RRDSET_TYPE_AREA);
+
+            stats->rd_spool_bytes = rrddim_add(stats->st_spool, "spooled", NULL, 1, 1024, RRD_ALGORITHM_ABSOLUTE);
+
+            snprintf(id, RRD_ID_LENGTH_MAX, "exporting_%s_spool_ops", instance->config.name);
+            netdata_fix_chart_id(id);
+
+            stats->st_spool_ops = rrdset_create_localhost(
+                "netdata", id, NULL, buffer_tostring(family), "exporting_spool_operations", "Netdata Exporting Spool Operations",
+                "batches", "exporting", NULL, 130670, instance->config.update_every, RRDSET_TYPE_LINE);
+
+            stats->rd_spool_written  = rrddim_add(stats->st_spool_ops, "spooled", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+            stats->rd_spool_replayed = rrddim_add(stats->st_spool_ops, "replayed", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+            stats->rd_spool_dropped  = rrddim_add(stats->st_spool_ops, "dropped", NULL, 1, 1, RRD_ALGORITHM_ABSOLUTE);
+        }
+
         buffer_free(family);
 
         stats->initialized = 1;
@@ -169,4 +204,33 @@ void send_internal_metrics(struct instance *instance)
     rrddim_set_by_pointer(stats->st_rusage, stats->rd_system, thread.ru_stime.tv_sec * 1000000ULL + thread.ru_stime.tv_usec);
 
     rrdset_done(stats->st_rusage);
+
+    // ------------------------------------------------------------------------
+
+    if (likely(stats->st_formatting->counter_done))
+        rrdset_next(stats->st_formatting);
+
+    rrddim_set_by_pointer(stats->st_formatting, stats->rd_formatting_time, stats->formatting_time);
+
+    rrdset_done(stats->st_formatting);
+
+    // ------------------------------------------------------------------------
+
+    if (stats->st_spool) {
+        if (likely(stats->st_spool->counter_done))
+            rrdset_next(stats->st_spool);
+
+        rrddim_set_by_pointer(stats->st_spool, stats->rd_spool_bytes, stats->spool_bytes);
+
+        rrdset_done(stats->st_spool);
+
+        if (likely(stats->st_spool_ops->counter_done))
+            rrdset_next(stats->st_spool_ops);
+
+        rrddim_set_by_pointer(stats->st_spool_ops, stats->rd_spool_written,  stats->spool_written_batches);
+        rrddim_set_by_pointer(stats->st_spool_ops, stats->rd_spool_replayed, stats->spool_replayed_batches);
+        rrddim_set_by_pointer(stats->st_spool_ops, stats->rd_spool_dropped,  stats->spool_dropped_batches);
+
+        rrdset_done(stats->st_spool_ops);
+    }
 }
@@ -0,0 +1,568 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "exporting_engine.h"
+#include <sys/uio.h>
+
+#ifdef NETDATA_WITH_ZLIB
+#include <zlib.h>
+#endif
+
+// ----------------------------------------------------------------------------
+// disk spool for exporting connector instances
+//
+// Batches that cannot be sent are appended to segment files in the cache
+// directory, and replayed in order when the external database is reachable
+// again. Every batch is saved as a record with a checksum. When the spool
+// reaches its maximum size, the oldest segment is dropped.
+//
+// The spool is used only by the worker thread of the instance, so it
+// needs no locking.
+
+#define SPOOL_RECORD_MAGIC 0x4e445350 // "NDSP"
+#define SPOOL_SEGMENTS_PER_SPOOL 8
+#define SPOOL_SEGMENT_SIZE_MIN (64 * 1024)
+
+struct spool_record {
+    uint32_t magic;
+    uint32_t header_len;
+    uint32_t buffer_len;
+    uint32_t metrics;
+    uint32_t crc;
+};
+
+struct spool_segment {
+    uint32_t id;
+
+    size_t size;        // the size of the segment file
+    size_t batches;     // the batches not replayed yet
+    size_t metrics;     // the metrics not replayed yet
+
+    struct spool_segment *next;
+};
+
+struct exporting_spool {
+    char *path;
+
+    size_t max_size;
+    size_t segment_size;
+
+    struct spool_segment *first;
+    struct spool_segment *last;
+    uint32_t next_id;
+
+    size_t size;        // the size of all segment files
+    size_t bytes;       // the bytes not replayed yet
+    size_t batches;     // the batches not replayed yet
+
+    int write_fd;       // the last segment, when we append to it
+
+    int read_fd;        // the first segment, when we read from it
+    size_t read_offset;
+    struct spool_record pending;
+
+    // statistics, since the last call of exporting_spool_statistics()
+    size_t written_batches;
+    size_t replayed_batches;
+    size_t dropped_batches;
+    size_t lost_events;
+    size_t lost_metrics;
+    size_t lost_bytes;
+};
+
+static uint32_t spool_record_crc(struct spool_record *record, const char *header, const char *buffer)
+{
+#ifdef NETDATA_WITH_ZLIB
+    uLong crc = crc32(0L, Z_NULL, 0);
+    crc = crc32(crc, (const Bytef *)&record->header_len, sizeof(record->header_len));
+    crc = crc32(crc, (const Bytef *)&record->buffer_len, sizeof(record->buffer_len));
+    crc = crc32(crc, (const Bytef *)&record->metrics, sizeof(record->metrics));
+    crc = crc32(crc, (const Bytef *)header, record->header_len);
+    crc = crc32(crc, (const Bytef *)buffer, record->buffer_len);
+    return (uint32_t)crc;
+#else
+    UNUSED(record);
+    UNUSED(header);
+    UNUSED(buffer);
+    return 0;
+#endif
+}
+
+static void spool_segment_filename(struct exporting_spool *spool, uint32_t id, char *filename, size_t len)
+{
+    snprintfz(filename, len, "%s/%010u.spool", spool->path, id);
+}
+
+/**
+ * Read a record from a segment file
+ *
+ * @param fd the segment file.
+ * @param offset where the record starts.
+ * @param size the size of the segment file.
+ * @param record the record header is returned here.
+ * @param header the header of the batch is loaded here.
+ * @param buffer the batch is loaded here.
+ * @return Returns 0 on success, 1 when the record is truncated or corrupted.
+ */
+static int spool_read_record(
+    int fd, size_t offset, size_t size, struct spool_record *record, BUFFER *header, BUFFER *buffer)
+{
+    if (offset + sizeof(*record) > size ||
+        pread(fd, record, sizeof(*record), (off_t)offset) != (ssize_t)sizeof(*record) ||
+        record->magic != SPOOL_RECORD_MAGIC ||
+        offset + sizeof(*record) + record->header_len + record->buffer_len > size)
+        return 1;
+
+    offset += sizeof(*record);
+
+    buffer_flush(header);
+    buffer_need_bytes(header, record->header_len + 1);
+    if (pread(fd, header->buffer, record->header_len, (off_t)offset) != (ssize_t)record->header_len)
+        return 1;
+    header->len = record->header_len;
+    header->buffer[header->len] = '\0';
+
+    offset += record->header_len;
+
+    buffer_flush(buffer);
+    buffer_need_bytes(buffer, record->buffer_len + 1);
+    if (pread(fd, buffer->buffer, record->buffer_len, (off_t)offset) != (ssize_t)record->buffer_len)
+        return 1;
+    buffer->len = record->buffer_len;
+    buffer->buffer[buffer->len] = '\0';
+
+    if (spool_record_crc(record, header->buffer, buffer->buffer) != record->crc)
+        return 1;
+
+    return 0;
+}
+
+/**
+ * Drop the first segment of a spool
+ *
+ * The batches of the segment not replayed yet are accounted as lost.
+ *
+ * @param spool the spool of an instance.
+ */
+static void spool_drop_first_segment(struct exporting_spool *spool)
+{
+    struct spool_segment *segment = spool->first;
+    char filename[FILENAME_MAX + 1];
+
+    if (segment->batches) {
+        size_t lost_bytes = segment->size - spool->read_offset;
+
+        spool->lost_events++;
+        spool->lost_metrics += segment->metrics;
+        spool->lost_bytes += lost_bytes;
+        spool->dropped_batches += segment->batches;
+
+        spool->bytes -= lost_bytes;
+        spool->batches -= segment->batches;
+    }
+
+    if (spool->read_fd != -1) {
+        close(spool->read_fd);
+        spool->read_fd = -1;
+    }
+    spool->read_offset = 0;
+
+    if (segment == spool->last) {
+        if (spool->write_fd != -1) {
+            close(spool->write_fd);
+            spool->write_fd = -1;
+        }
+        spool->last = NULL;
+    }
+
+    spool_segment_filename(spool, segment->id, filename, FILENAME_MAX);
+    if (unlink(filename) == -1)
+        error("EXPORTING: cannot delete spool segment '%s'", filename);
+
+    spool->size -= segment->size;
+    spool->first = segment->next;
+    freez(segment);
+}
+
+/**
+ * Load the segments left by a previous run
+ *
+ * Every segment is verified, and truncated at the first record that is not valid.
+ *
+ * @param spool the spool of an instance.
+ */
+static void spool_load_segments(struct exporting_spool *spool)
+{
+    DIR *dir = opendir(spool->path);
+    if (!dir)
+        return;
+
+    // collect the ids of the segments, in order
+    size_t ids_num = 0, ids_size = 0;
+    uint32_t *ids = NULL;
+
+    struct dirent *de;
+    while ((de = readdir(dir))) {
+        unsigned id;
+        char suffix[7];
+        if (sscanf(de->d_name, "%10u.%6s", &id, suffix) != 2 || strcmp(suffix, "spool"))
+            continue;
+
+        if (ids_num == ids_size) {
+            ids_size = ids_size ? ids_size * 2 : 16;
+            ids = reallocz(ids, ids_size * sizeof(uint32_t));
+        }
+
+        size_t i = ids_num++;
+        for (; i && ids[i - 1] > id; i--)
+            ids[i] = ids[i - 1];
+        ids[i] = id;
+    }
+    closedir(dir);
+
+    BUFFER *header = buffer_create(0);
+    BUFFER *buffer = buffer_create(0);
+
+    for (size_t i = 0; i < ids_num; i++) {
+        char filename[FILENAME_MAX + 1];
+        spool_segment_filename(spool, ids[i], filename, FILENAME_MAX);
+
+        int fd = open(filename, O_RDWR);
+        struct stat statbuf;
+        if (fd == -1 || fstat(fd, &statbuf) == -1) {
+            error("EXPORTING: cannot open spool segment '%s'", filename);
+            if (fd != -1)
+                close(fd);
+            continue;
+        }
+
+        struct spool_segment *segment = callocz(1, sizeof(struct spool_segment));
+        segment->id = ids[i];
+
+        struct spool_record record;
+        size_t offset = 0;
+        while (!spool_read_record(fd, offset, (size_t)statbuf.st_size, &record, header, buffer)) {
+            offset += sizeof(record) + record.header_len + record.buffer_len;
+            segment->batches++;
+            segment->metrics += record.metrics;
+        }
+
+        if (offset != (size_t)statbuf.st_size) {
+            error(
+                "EXPORTING: spool segment '%s' is not valid after offset %zu, truncating it to that size",
+                filename,
+                offset);
+
+            if (ftruncate(fd, (off_t)offset) == -1)
+                error("EXPORTING: cannot truncate spool segment '%s'", filename);
+        }
+        close(fd);
+
+        segment->size = offset;
+
+        if (!segment->batches) {
+            unlink(filename);
+            freez(segment);
+            continue;
+        }
+
+        if (spool->last)
+            spool->last->next = segment;
+        else
+            spool->first = segment;
+        spool->last = segment;
+
+        spool->size += segment->size;
+        spool->bytes += segment->size;
+        spool->batches += segment->batches;
+    }
+
+    if (ids_num)
+        spool->next_id = ids[ids_num - 1] + 1;
+
+    buffer_free(header);
+    buffer_free(buffer);
+    freez(ids);
+
+    if (spool->batches)
+        info(
+            "EXPORTING: instance spool '%s' has %zu batches (%zu bytes) from a previous run, they will be replayed",
+            spool->path,
+            spool->batches,
+            spool->bytes);
+}
+
+/**
+ * Initialize the disk spool of an instance
+ *
+ * @param instance an instance data structure.
+ * @return Returns the spool, or NULL if it cannot be created.
+ */
+struct exporting_spool *exporting_spool_init(struct instance *instance)
+{
+#ifndef NETDATA_WITH_ZLIB
+    error("EXPORTING: the spool of instance %s needs zlib, which is not available", instance->config.name);
+    return NULL;
+#endif
+
+    char path[FILENAME_MAX + 1];
+
+    snprintfz(path, FILENAME_MAX, "%s/exporting", netdata_configured_cache_dir);
+    if (mkdir(path, 0775) == -1 && errno != EEXIST) {
+        error("EXPORTING: cannot create directory '%s'", path);
+        return NULL;
+    }
+
+    snprintfz(path, FILENAME_MAX, "%s/exporting/%s", netdata_configured_cache_dir, instance->config.name);
+    for (char *s = &path[strlen(netdata_configured_cache_dir) + sizeof("/exporting/") - 1]; *s; s++)
+        if (*s == '/')
+            *s = '_';
+
+    if (mkdir(path, 0775) == -1 && errno != EEXIST) {
+        error("EXPORTING: cannot create directory '%s'", path);
+        return NULL;
+    }
+
+    struct exporting_spool *spool = callocz(1, sizeof(struct exporting_spool));
+    spool->path = strdupz(path);
+    spool->max_size = instance->config.spool_size;
+    spool->segment_size = spool->max_size / SPOOL_SEGMENTS_PER_SPOOL;
+    if (spool->segment_size < SPOOL_SEGMENT_SIZE_MIN)
+        spool->segment_size = SPOOL_SEGMENT_SIZE_MIN;
+    spool->next_id = 1;
+    spool->write_fd = -1;
+    spool->read_fd = -1;
+
+    spool_load_segments(spool);
+
+    info(
+        "EXPORTING: instance %s spools up to %zu bytes in '%s'",
+        instance->config.name,
+        spool->max_size,
+        spool->path);
+
+    return spool;
+}
+
+/**
+ * Free the spool of an instance
+ *
+ * The segment files are kept, to be replayed on the next run.
+ *
+ * @param spool the spool of an instance.
+ */
+void exporting_spool_free(struct exporting_spool *spool)
+{
+    if (!spool)
+        return;
+
+    if (spool->write_fd != -1)
+        close(spool->write_fd);
+    if (spool->read_fd != -1)
+        close(spool->read_fd);
+
+    while (spool->first) {
+        struct spool_segment *segment = spool->first;
+        spool->first = segment->next;
+        freez(segment);
+    }
+
+    freez(spool->path);
+    freez(spool);
+}
+
+/**
+ * Get the number of batches in the spool
+ *
+ * @param spool the spool of an instance.
+ * @return Returns the number of batches not replayed yet.
+ */
+size_t exporting_spool_batches(struct exporting_spool *spool)
+{
+    return spool->batches;
+}
+
+/**
+ * Add the statistics of the spool to the statistics of its instance
+ *
+ * The statistics of the spool are reset.
+ *
+ * @param spool the spool of an instance.
+ * @param stats the statistics of the instance.
+ */
+void exporting_spool_statistics(struct exporting_spool *spool, struct stats *stats)
+{
+    stats->spool_bytes = (collected_number)spool->bytes;
+    stats->spool_written_batches += (collected_number)spool->written_batches;
+    stats->spool_replayed_batches += (collected_number)spool->replayed_batches;
+    stats->spool_dropped_batches += (collected_number)spool->dropped_batches;
+    stats->data_lost_events += (collected_number)spool->lost_events;
+    stats->lost_metrics += (collected_number)spool->lost_metrics;
+    stats->lost_bytes += (collected_number)spool->lost_bytes;
+
+    spool->written_batches = spool->replayed_batches = spool->dropped_batches = 0;
+    spool->lost_events = spool->lost_metrics = spool->lost_bytes = 0;
+}
+
+/**
+ * Append a batch to the spool
+ *
+ * The oldest segments are dropped, when there is no space for the batch.
+ *
+ * @param spool the spool of an instance.
+ * @param header the header of the batch.
+ * @param buffer the batch.
+ * @param metrics the number of metrics in the batch.
+ * @return Returns 0 on success, 1 when the batch is lost.
+ */
+int exporting_spool_write(struct exporting_spool *spool, BUFFER *header, BUFFER *buffer, size_t metrics)
+{
+    struct spool_record record = { .magic = SPOOL_RECORD_MAGIC,
+                                   .header_len = (uint32_t)buffer_strlen(header),
+                                   .buffer_len = (uint32_t)buffer_strlen(buffer),
+                                   .metrics = (uint32_t)metrics };
+    size_t len = sizeof(record) + record.header_len + record.buffer_len;
+
+    if (unlikely(len > spool->max_size)) {
+        error("EXPORTING: a batch of %zu bytes does not fit in spool '%s'", len, spool->path);
+        goto lost;
+    }
+
+    while (spool->first && spool->size + len > spool->max_size) {
+        error("EXPORTING: spool '%s' is full, dropping its oldest segment", spool->path);
+        spool_drop_first_segment(spool);
+    }
+
+    if (spool->write_fd == -1 || spool->last->size + len > spool->segment_size) {
+        char filename[FILENAME_MAX + 1];
+
+        if (spool->write_fd != -1) {
+            close(spool->write_fd);
+            spool->write_fd = -1;
+        }
+
+        struct spool_segment *segment = callocz(1, sizeof(struct spool_segment));
+        segment->id = spool->next_id++;
+
+        spool_segment_filename(spool, segment->id, filename, FILENAME_MAX);
+        spool->write_fd = open(filename, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND, 0664);
+        if (spool->write_fd == -1) {
+            error("EXPORTING: cannot create spool segment '%s'", filename);
+            freez(segment);
+            goto lost;
+        }
+
+        if (spool->last)
+            spool->last->next = segment;
+        else
+            spool->first = segment;
+        spool->last = segment;
+    }
+
+    record.crc = spool_record_crc(&record, buffer_tostring(header), buffer_tostring(buffer));
+
+    struct iovec iov[3] = { { .iov_base = &record, .iov_len = sizeof(record) },
+                            { .iov_base = header->buffer, .iov_len = record.header_len },
+                            { .iov_base = buffer->buffer, .iov_len = record.buffer_len } };
+
+    ssize_t written = writev(spool->write_fd, iov, 3);
+    if (written != (ssize_t)len) {
+        error("EXPORTING: cannot write %zu bytes to spool '%s'", len, spool->path);
+
+        // do not leave a partial record behind
+        if (written > 0 && ftruncate(spool->write_fd, (off_t)spool->last->size) == -1)
+            error("EXPORTING: cannot truncate the last segment of spool '%s'", spool->path);
+
+        goto lost;
+    }
+
+    spool->last->size += len;
+    spool->last->batches++;
+    spool->last->metrics += metrics;
+
+    spool->size += len;
+    spool->bytes += len;
+    spool->batches++;
+
+    spool->written_batches++;
+
+    return 0;
+
+lost:
+    spool->lost_events++;
+    spool->lost_metrics += metrics;
+    spool->lost_bytes += record.buffer_len;
+    return 1;
+}
+
+/**
+ * Load the oldest batch of the spool
+ *
+ * Corrupted segments are dropped. The batch is removed from the spool with exporting_spool_consume(),
+ * after it has been sent.
+ *
+ * @param spool the spool of an instance.
+ * @param header the header of the batch is loaded here.
+ * @param buffer the batch is loaded here.
+ * @param metrics the number of metrics in the batch is returned here.
+ * @return Returns 1 when a batch has been loaded, 0 when the spool is empty.
+ */
+int exporting_spool_read(struct exporting_spool *spool, BUFFER *header, BUFFER *buffer, size_t *metrics)
+{
+    while (spool->first && spool->batches) {
+        struct spool_segment *segment = spool->first;
+
+        if (!segment->batches) {
+            // fully replayed
+            spool_drop_first_segment(spool);
+            continue;
+        }
+
+        char filename[FILENAME_MAX + 1];
+        spool_segment_filename(spool, segment->id, filename, FILENAME_MAX);
+
+        if (spool->read_fd == -1) {
+            spool->read_fd = open(filename, O_RDONLY);
+            if (spool->read_fd == -1)
+                error("EXPORTING: cannot open spool segment '%s'", filename);
+        }
+
+        if (spool->read_fd == -1 ||
+            spool_read_record(spool->read_fd, spool->read_offset, segment->size, &spool->pending, header, buffer)) {
+            error(
+                "EXPORTING: spool segment '%s' is corrupted at offset %zu, dropping %zu batches",
+                filename,
+                spool->read_offset,
+                segment->batches);
+            spool_drop_first_segment(spool);
+            continue;
+        }
+
+        *metrics = spool->pending.metrics;
+        return 1;
+    }
+
+    return 0;
+}
+
+/**
+ * Remove the batch loaded by exporting_spool_read() from the spool
+ *
+ * @param spool the spool of an instance.
+ */
+void exporting_spool_consume(struct exporting_spool *spool)
+{
+    struct spool_segment *segment = spool->first;
+    size_t len = sizeof(spool->pending) + spool->pending.header_len + spool->pending.buffer_len;
+
+    spool->read_offset += len;
+    segment->batches--;
+    segment->metrics -= spool->pending.metrics;
+
+    spool->bytes -= len;
+    spool->batches--;
+
+    spool->replayed_batches++;
+
+    if (!segment->batches)
+        spool_drop_first_segment(spool);
+}
@@ -99,8 +99,14 @@ int __wrap_send_internal_metrics(struct instance *instance)
     return mock_type(int);
 }
 
+// the mocks are not thread safe, the tests which format instances in parallel use the real functions
+int exporting_doubles_in_parallel = 0;
+
 int __wrap_rrdhost_is_exportable(struct instance *instance, RRDHOST *host)
 {
+    if (exporting_doubles_in_parallel)
+        return __real_rrdhost_is_exportable(instance, host);
+
     function_called();
     check_expected_ptr(instance);
     check_expected_ptr(host);
@@ -109,6 +115,9 @@ int __wrap_rrdhost_is_exportable(struct instance *instance, RRDHOST *host)
 
 int __wrap_rrdset_is_exportable(struct instance *instance, RRDSET *st)
 {
+    if (exporting_doubles_in_parallel)
+        return __real_rrdset_is_exportable(instance, st);
+
     function_called();
     check_expected_ptr(instance);
     check_expected_ptr(st);
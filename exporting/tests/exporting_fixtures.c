@@ -86,6 +86,7 @@ int teardown_rrdhost()
     RRDDIM *rd = localhost->rrdset_root->dimensions;
     free((void *)rd->name);
     free((void *)rd->id);
+    freez(rd->state->prometheus_cache);
     free(rd->state);
     free(rd);
 
@@ -11,6 +11,7 @@ struct config netdata_config;
 char *netdata_configured_user_config_dir = ".";
 char *netdata_configured_stock_config_dir = ".";
 char *netdata_configured_hostname = "test_global_host";
+char *netdata_configured_cache_dir = ".";
 
 char log_line[MAX_LOG_LINE + 1];
 
@@ -402,6 +403,95 @@ static void test_prepare_buffers(void **state)
     assert_int_equal(instance->after, 2);
 }
 
+static void test_prepare_buffers_in_parallel(void **state)
+{
+    (void)state;
+
+    struct engine *engine = callocz(1, sizeof(struct engine));
+    struct instance *instances = callocz(2, sizeof(struct instance));
+
+    for (size_t n = 0; n < 2; n++) {
+        struct instance *instance = &instances[n];
+        instance->engine = engine;
+        instance->index = n;
+        instance->config.name = n ? "names" : "ids";
+        instance->config.prefix = n ? "names" : "ids";
+        instance->config.hostname = "test-host";
+        instance->config.options = EXPORTING_SOURCE_DATA_AS_COLLECTED | (n ? EXPORTING_OPTION_SEND_NAMES : 0);
+        instance->config.charts_pattern = simple_pattern_create("*", NULL, SIMPLE_PATTERN_EXACT);
+        instance->metric_formatting = format_dimension_collected_graphite_plaintext;
+        instance->buffer = buffer_create(0);
+        uv_mutex_init(&instance->mutex);
+        uv_cond_init(&instance->cond_var);
+
+        if (n)
+            instances[n - 1].next = instance;
+    }
+    engine->instance_root = &instances[0];
+    engine->instance_num = 2;
+
+    // the host is not checked again, so the threads don't log concurrently
+    localhost->exporting_flags = callocz(2, sizeof(RRDHOST_FLAGS));
+    localhost->exporting_flags[0] = localhost->exporting_flags[1] = RRDHOST_FLAG_BACKEND_SEND;
+
+    RRDSET *st = localhost->rrdset_root;
+    exporting_doubles_in_parallel = 1;
+
+    char *alone[2];
+    for (size_t n = 0; n < 2; n++) {
+        instances[n].scheduled = 1;
+        __real_prepare_buffers(engine);
+        BUFFER *buffer = instances[n].buffer;
+        alone[n] = strdupz(buffer_tostring(buffer));
+        buffer_flush(buffer);
+    }
+
+    assert_string_equal(alone[0], "ids.test-host.chart_id.dimension_id;TAG1=VALUE1 TAG2=VALUE2 123000321 15051\n");
+    assert_string_equal(
+        alone[1], "names.test-host.chart_name.dimension_name;TAG1=VALUE1 TAG2=VALUE2 123000321 15051\n");
+
+    for (int round = 0; round < 50; round++) {
+        // the formatting threads race to allocate the exporting flags
+        freez(st->exporting_flags);
+        st->exporting_flags = NULL;
+
+        for (size_t n = 0; n < 2; n++)
+            instances[n].scheduled = 1;
+
+        __real_prepare_buffers(engine);
+
+        for (size_t n = 0; n < 2; n++) {
+            BUFFER *buffer = instances[n].buffer;
+            assert_string_equal(buffer_tostring(buffer), alone[n]);
+            buffer_flush(buffer);
+        }
+
+        assert_true(st->exporting_flags[0] & RRDSET_FLAG_BACKEND_SEND);
+        assert_true(st->exporting_flags[1] & RRDSET_FLAG_BACKEND_SEND);
+    }
+
+    assert_int_equal(instances[0].formatting_thread_created, 1);
+    assert_int_equal(instances[1].formatting_thread_created, 0);
+
+    engine->exit = 1;
+    stop_formatting_threads(engine);
+    exporting_doubles_in_parallel = 0;
+
+    for (size_t n = 0; n < 2; n++) {
+        freez(alone[n]);
+        buffer_free(instances[n].buffer);
+        simple_pattern_free(instances[n].config.charts_pattern);
+        uv_cond_destroy(&instances[n].cond_var);
+        uv_mutex_destroy(&instances[n].mutex);
+    }
+    freez(st->exporting_flags);
+    st->exporting_flags = NULL;
+    freez(localhost->exporting_flags);
+    localhost->exporting_flags = NULL;
+    freez(instances);
+    freez(engine);
+}
+
 static void test_exporting_name_copy(void **state)
 {
     (void)state;
@@ -662,6 +752,82 @@ static void test_simple_connector_worker(void **state)
     assert_int_equal(stats->reconnects, 0);
 }
 
+static void test_exporting_spool(void **state)
+{
+    struct engine *engine = *state;
+    struct instance *instance = engine->instance_root;
+
+    char path[] = "/tmp/netdata-exporting-spool-XXXXXX";
+    assert_ptr_not_equal(mkdtemp(path), NULL);
+    netdata_configured_cache_dir = path;
+    instance->config.spool_size = 1024 * 1024;
+
+    expect_function_call(__wrap_info_int);
+    struct exporting_spool *spool = exporting_spool_init(instance);
+    assert_ptr_not_equal(spool, NULL);
+
+    BUFFER *header = buffer_create(0);
+    BUFFER *buffer = buffer_create(0);
+
+    buffer_strcat(header, "test header 1");
+    buffer_strcat(buffer, "test buffer 1");
+    assert_int_equal(exporting_spool_write(spool, header, buffer, 1), 0);
+
+    buffer_flush(header);
+    buffer_flush(buffer);
+    buffer_strcat(buffer, "test buffer 2");
+    assert_int_equal(exporting_spool_write(spool, header, buffer, 2), 0);
+
+    assert_int_equal(exporting_spool_batches(spool), 2);
+
+    // the spool is replayed after a restart
+    exporting_spool_free(spool);
+
+    expect_function_call(__wrap_info_int);
+    expect_function_call(__wrap_info_int);
+    spool = exporting_spool_init(instance);
+    assert_ptr_not_equal(spool, NULL);
+    assert_int_equal(exporting_spool_batches(spool), 2);
+
+    size_t metrics = 0;
+    assert_int_equal(exporting_spool_read(spool, header, buffer, &metrics), 1);
+    assert_string_equal(buffer_tostring(header), "test header 1");
+    assert_string_equal(buffer_tostring(buffer), "test buffer 1");
+    assert_int_equal(metrics, 1);
+    exporting_spool_consume(spool);
+
+    assert_int_equal(exporting_spool_read(spool, header, buffer, &metrics), 1);
+    assert_string_equal(buffer_tostring(header), "");
+    assert_string_equal(buffer_tostring(buffer), "test buffer 2");
+    assert_int_equal(metrics, 2);
+    exporting_spool_consume(spool);
+
+    assert_int_equal(exporting_spool_read(spool, header, buffer, &metrics), 0);
+    assert_int_equal(exporting_spool_batches(spool), 0);
+
+    struct stats stats = { .spool_written_batches = 0 };
+    exporting_spool_statistics(spool, &stats);
+    assert_int_equal(stats.spool_bytes, 0);
+    assert_int_equal(stats.spool_written_batches, 0);
+    assert_int_equal(stats.spool_replayed_batches, 2);
+    assert_int_equal(stats.spool_dropped_batches, 0);
+    assert_int_equal(stats.lost_metrics, 0);
+
+    exporting_spool_free(spool);
+    buffer_free(header);
+    buffer_free(buffer);
+
+    // the segments have been deleted
+    char spool_path[FILENAME_MAX + 1];
+    snprintfz(spool_path, FILENAME_MAX, "%s/exporting/instance_name", path);
+    assert_int_equal(rmdir(spool_path), 0);
+    snprintfz(spool_path, FILENAME_MAX, "%s/exporting", path);
+    assert_int_equal(rmdir(spool_path), 0);
+    assert_int_equal(rmdir(path), 0);
+
+    netdata_configured_cache_dir = ".";
+}
+
 static void test_sanitize_json_string(void **state)
 {
     (void)state;
@@ -833,6 +999,8 @@ static void test_send_internal_metrics(void **state)
     stats->st_ops->counter_done = 1;
     stats->st_rusage = calloc(1, sizeof(RRDSET));
     stats->st_rusage->counter_done = 1;
+    stats->st_formatting = calloc(1, sizeof(RRDSET));
+    stats->st_formatting->counter_done = 1;
 
     // ------------------------------------------------------------------------
 
@@ -932,6 +1100,30 @@ static void test_send_internal_metrics(void **state)
 
     // ------------------------------------------------------------------------
 
+    expect_function_call(rrdset_create_custom);
+    expect_value(rrdset_create_custom, host, localhost);
+    expect_string(rrdset_create_custom, type, "netdata");
+    expect_string(rrdset_create_custom, id, "exporting_test_instance_formatting");
+    expect_value(rrdset_create_custom, name, NULL);
+    expect_string(rrdset_create_custom, family, "exporting_test_instance");
+    expect_string(rrdset_create_custom, context, "exporting_formatting");
+    expect_string(rrdset_create_custom, units, "milliseconds");
+    expect_string(rrdset_create_custom, plugin, "exporting");
+    expect_value(rrdset_create_custom, module, NULL);
+    expect_value(rrdset_create_custom, priority, 130650);
+    expect_value(rrdset_create_custom, update_every, 2);
+    expect_value(rrdset_create_custom, chart_type, RRDSET_TYPE_LINE);
+    will_return(rrdset_create_custom, stats->st_formatting);
+
+    expect_function_call(rrddim_add_custom);
+    expect_value(rrddim_add_custom, st, stats->st_formatting);
+    expect_value(rrddim_add_custom, name, NULL);
+    expect_value(rrddim_add_custom, multiplier, 1);
+    expect_value(rrddim_add_custom, divisor, 1000);
+    expect_value(rrddim_add_custom, algorithm, RRD_ALGORITHM_ABSOLUTE);
+
+    // ------------------------------------------------------------------------
+
     expect_function_call(rrdset_next_usec);
     expect_value(rrdset_next_usec, st, stats->st_metrics);
 
@@ -976,12 +1168,24 @@ static void test_send_internal_metrics(void **state)
 
     // ------------------------------------------------------------------------
 
+    expect_function_call(rrdset_next_usec);
+    expect_value(rrdset_next_usec, st, stats->st_formatting);
+
+    expect_function_call(rrddim_set_by_pointer);
+    expect_value(rrddim_set_by_pointer, st, stats->st_formatting);
+
+    expect_function_call(rrdset_done);
+    expect_value(rrdset_done, st, stats->st_formatting);
+
+    // ------------------------------------------------------------------------
+
     __real_send_internal_metrics(instance);
 
     free(stats->st_metrics);
     free(stats->st_bytes);
     free(stats->st_ops);
     free(stats->st_rusage);
+    free(stats->st_formatting);
     free((void *)instance->config.name);
     free(instance);
 }
@@ -1120,6 +1324,70 @@ static void rrd_stats_api_v1_charts_allmetrics_prometheus(void **state)
     buffer_free(buffer);
 }
 
+static void test_prometheus_dimension_cache(void **state)
+{
+    (void)state;
+
+    BUFFER *buffer = buffer_create(0);
+
+    localhost->hostname = strdupz("test_hostname");
+    localhost->rrdset_root->family = strdupz("test_family");
+    localhost->rrdset_root->context = strdupz("test_context");
+
+    RRDSET *st = localhost->rrdset_root;
+    RRDDIM *rd = st->dimensions;
+
+    for (int i = 0; i < 2; i++) {
+        expect_function_call(__wrap_now_realtime_sec);
+        will_return(__wrap_now_realtime_sec, 2);
+
+        expect_function_call(__wrap_exporting_calculate_value_from_stored_data);
+        will_return(__wrap_exporting_calculate_value_from_stored_data, pack_storage_number(27, SN_EXISTS));
+
+        rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(
+            localhost, buffer, "test_server", "test_prefix", 0, PROMETHEUS_OUTPUT_NAMES);
+
+        assert_string_equal(
+            buffer_tostring(buffer),
+            "netdata_info{instance=\"test_hostname\",application=\"(null)\",version=\"(null)\"} 1\n"
+            "netdata_host_tags_info{key1=\"value1\",key2=\"value2\"} 1\n"
+            "netdata_host_tags{key1=\"value1\",key2=\"value2\"} 1\n"
+            "test_prefix_test_context{chart=\"chart_name\",family=\"test_family\",dimension=\"dimension_name\"} 690565856.0000000\n");
+
+        buffer_flush(buffer);
+    }
+
+    assert_non_null(rd->state->prometheus_cache);
+    assert_int_equal(rd->state->prometheus_cache->version, st->metadata_version);
+
+    // the cached line is rendered again when the chart is renamed
+    free((void *)st->name);
+    st->name = strdupz("new_chart_name");
+    st->metadata_version++;
+
+    expect_function_call(__wrap_now_realtime_sec);
+    will_return(__wrap_now_realtime_sec, 2);
+
+    expect_function_call(__wrap_exporting_calculate_value_from_stored_data);
+    will_return(__wrap_exporting_calculate_value_from_stored_data, pack_storage_number(27, SN_EXISTS));
+
+    rrd_stats_api_v1_charts_allmetrics_prometheus_single_host(
+        localhost, buffer, "test_server", "test_prefix", 0, PROMETHEUS_OUTPUT_NAMES | PROMETHEUS_OUTPUT_TYPES);
+
+    assert_string_equal(
+        buffer_tostring(buffer),
+        "netdata_info{instance=\"test_hostname\",application=\"(null)\",version=\"(null)\"} 1\n"
+        "netdata_host_tags_info{key1=\"value1\",key2=\"value2\"} 1\n"
+        "netdata_host_tags{key1=\"value1\",key2=\"value2\"} 1\n"
+        "# TYPE test_prefix_test_context gauge\n"
+        "test_prefix_test_context{chart=\"new_chart_name\",family=\"test_family\",dimension=\"dimension_name\"} 690565856.0000000\n");
+
+    free(localhost->rrdset_root->context);
+    free(localhost->rrdset_root->family);
+    free(localhost->hostname);
+    buffer_free(buffer);
+}
+
 #if ENABLE_PROMETHEUS_REMOTE_WRITE
 static void test_init_prometheus_remote_write_instance(void **state)
 {
@@ -1199,6 +1467,332 @@ static void test_process_prometheus_remote_write_response(void **state)
     buffer_free(buffer);
 }
 
+static void test_process_pipelined_prometheus_remote_write_responses(void **state)
+{
+    struct engine *engine = *state;
+    struct instance *instance = engine->instance_root;
+
+    struct simple_connector_data *simple_connector_data = callocz(1, sizeof(struct simple_connector_data));
+    instance->connector_specific_data = simple_connector_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        callocz(1, sizeof(struct prometheus_remote_write_specific_data));
+    simple_connector_data->connector_specific_data = (void *)connector_specific_data;
+    connector_specific_data->requests_in_flight = 4;
+
+    BUFFER *buffer = buffer_create(0);
+
+    buffer_sprintf(
+        buffer,
+        "HTTP/1.1 204 No Content\r\n"
+        "Date: Mon, 01 Jan 2021 00:00:00 GMT\r\n\r\n"
+        "HTTP/1.1 400 Bad Request\r\n"
+        "Content-Length: 11\r\n\r\n"
+        "bad request"
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Length: 4\r\n\r\n"
+        "ab");
+    assert_int_equal(process_prometheus_remote_write_response(buffer, instance), 0);
+
+    assert_int_equal(connector_specific_data->requests_in_flight, 2);
+    assert_string_equal(buffer_tostring(buffer), "HTTP/1.1 200 OK\r\nContent-Length: 4\r\n\r\nab");
+
+    buffer_strcat(buffer, "cd");
+    assert_int_equal(process_prometheus_remote_write_response(buffer, instance), 0);
+
+    assert_int_equal(connector_specific_data->requests_in_flight, 1);
+    assert_int_equal(buffer_strlen(buffer), 0);
+
+    // the beginning of a status line is kept until the rest of it arrives
+    buffer_strcat(buffer, "HTT");
+    assert_int_equal(process_prometheus_remote_write_response(buffer, instance), 0);
+
+    assert_int_equal(connector_specific_data->requests_in_flight, 1);
+    assert_string_equal(buffer_tostring(buffer), "HTT");
+
+    buffer_strcat(buffer, "P/1.1 204 No Content\r\n\r\n");
+    assert_int_equal(process_prometheus_remote_write_response(buffer, instance), 0);
+
+    assert_int_equal(connector_specific_data->requests_in_flight, 0);
+    assert_int_equal(buffer_strlen(buffer), 0);
+
+    buffer_free(buffer);
+    freez(connector_specific_data);
+    freez(simple_connector_data);
+}
+
+static void test_prometheus_remote_write_count_requests(void **state)
+{
+    (void)state;
+    BUFFER *header = buffer_create(0);
+    BUFFER *buffer = buffer_create(0);
+
+    assert_int_equal(prometheus_remote_write_count_requests(header, buffer), 0);
+
+    buffer_strcat(header, "POST /receive HTTP/1.1\r\nContent-Length: 4\r\n\r\n");
+    buffer_strcat(buffer, "\r\n\r\n");
+    assert_int_equal(prometheus_remote_write_count_requests(header, buffer), 1);
+
+    buffer_flush(header);
+    buffer_flush(buffer);
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 4\r\n\r\n\r\n\r\n");
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc");
+    assert_int_equal(prometheus_remote_write_count_requests(header, buffer), 2);
+
+    buffer_free(header);
+    buffer_free(buffer);
+}
+
+static void test_prometheus_remote_write_requests_length(void **state)
+{
+    (void)state;
+    BUFFER *buffer = buffer_create(0);
+
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 4\r\n\r\nabcd");
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc");
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 2\r\n\r\nab");
+
+    assert_int_equal(prometheus_remote_write_requests_length(buffer, 1), 49);
+    assert_int_equal(prometheus_remote_write_requests_length(buffer, 2), 97);
+    assert_int_equal(prometheus_remote_write_requests_length(buffer, 3), buffer_strlen(buffer));
+    assert_int_equal(prometheus_remote_write_requests_length(buffer, 4), buffer_strlen(buffer));
+
+    buffer_free(buffer);
+}
+
+/*
+ * Releases a request in flight for every reception, instead of parsing a response
+ */
+static int test_check_prometheus_remote_write_response(BUFFER *buffer, struct instance *instance)
+{
+    struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        simple_connector_data->connector_specific_data;
+
+    connector_specific_data->requests_in_flight--;
+    buffer_flush(buffer);
+
+    return 0;
+}
+
+static struct prometheus_remote_write_specific_data *
+setup_prometheus_remote_write_requests(struct instance *instance, size_t max_requests_in_flight)
+{
+    instance->config.type = EXPORTING_CONNECTOR_TYPE_PROMETHEUS_REMOTE_WRITE;
+    instance->check_response = test_check_prometheus_remote_write_response;
+
+    struct prometheus_remote_write_specific_config *connector_specific_config =
+        callocz(1, sizeof(struct prometheus_remote_write_specific_config));
+    instance->config.connector_specific_config = connector_specific_config;
+    connector_specific_config->max_requests_in_flight = max_requests_in_flight;
+
+    struct simple_connector_data *simple_connector_data = callocz(1, sizeof(struct simple_connector_data));
+    instance->connector_specific_data = simple_connector_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        callocz(1, sizeof(struct prometheus_remote_write_specific_data));
+    simple_connector_data->connector_specific_data = (void *)connector_specific_data;
+
+    return connector_specific_data;
+}
+
+static void teardown_prometheus_remote_write_requests(struct instance *instance)
+{
+    struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
+
+    buffer_free(simple_connector_data->response);
+    freez(simple_connector_data->connector_specific_data);
+    freez(simple_connector_data);
+    freez(instance->config.connector_specific_config);
+}
+
+static void test_prometheus_remote_write_wait_for_responses(void **state)
+{
+    struct engine *engine = *state;
+    struct instance *instance = engine->instance_root;
+
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        setup_prometheus_remote_write_requests(instance, 2);
+
+    int fds[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int sock = fds[0];
+
+    // there is room for the requests
+    connector_specific_data->requests_in_flight = 1;
+    assert_int_equal(prometheus_remote_write_wait_for_responses(&sock, instance, 1), 0);
+    assert_int_equal(connector_specific_data->requests_in_flight, 2);
+
+    // both requests in flight have to be answered, before two more are sent
+    assert_int_equal(write(fds[1], "x", 1), 1);
+
+    expect_function_calls(__wrap_recv, 2);
+    expect_value_count(__wrap_recv, sockfd, sock, 2);
+    expect_not_value_count(__wrap_recv, buf, 0, 2);
+    expect_value_count(__wrap_recv, len, 4096, 2);
+    expect_value_count(__wrap_recv, flags, MSG_DONTWAIT, 2);
+
+    assert_int_equal(prometheus_remote_write_wait_for_responses(&sock, instance, 2), 0);
+    assert_int_equal(connector_specific_data->requests_in_flight, 2);
+    assert_int_equal(sock, fds[0]);
+
+    close(fds[0]);
+    close(fds[1]);
+    teardown_prometheus_remote_write_requests(instance);
+}
+
+static void test_prometheus_remote_write_wait_for_responses_timeout(void **state)
+{
+    struct engine *engine = *state;
+    struct instance *instance = engine->instance_root;
+
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        setup_prometheus_remote_write_requests(instance, 2);
+    instance->config.timeoutms = 10;
+
+    int fds[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int sock = fds[0];
+
+    // nothing is received, the connection is closed
+    connector_specific_data->requests_in_flight = 2;
+    assert_int_equal(prometheus_remote_write_wait_for_responses(&sock, instance, 1), 1);
+    assert_int_equal(sock, -1);
+
+    close(fds[1]);
+    teardown_prometheus_remote_write_requests(instance);
+}
+
+static void test_prometheus_remote_write_send_split_batch(void **state)
+{
+    struct engine *engine = *state;
+    struct instance *instance = engine->instance_root;
+    struct stats *stats = &instance->stats;
+
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        setup_prometheus_remote_write_requests(instance, 2);
+
+    int fds[2];
+    assert_int_equal(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+    int sock = fds[0];
+    int failures = 0;
+
+    BUFFER *header = buffer_create(0);
+    BUFFER *buffer = buffer_create(0);
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 4\r\n\r\nabcd");
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc");
+    buffer_strcat(buffer, "POST /receive HTTP/1.1\r\nContent-Length: 2\r\n\r\nab");
+
+    // the first two requests fit in flight
+    expect_function_call(__wrap_send);
+    expect_value(__wrap_send, sockfd, sock);
+    expect_value(__wrap_send, buf, buffer_tostring(buffer));
+    expect_memory(
+        __wrap_send, buf,
+        "POST /receive HTTP/1.1\r\nContent-Length: 4\r\n\r\nabcd"
+        "POST /receive HTTP/1.1\r\nContent-Length: 3\r\n\r\nabc",
+        97);
+    expect_value(__wrap_send, len, 97);
+    expect_value(__wrap_send, flags, MSG_NOSIGNAL);
+
+    // the third one waits for a response
+    assert_int_equal(write(fds[1], "x", 1), 1);
+
+    expect_function_call(__wrap_recv);
+    expect_value(__wrap_recv, sockfd, sock);
+    expect_not_value(__wrap_recv, buf, 0);
+    expect_value(__wrap_recv, len, 4096);
+    expect_value(__wrap_recv, flags, MSG_DONTWAIT);
+
+    expect_function_call(__wrap_send);
+    expect_value(__wrap_send, sockfd, sock);
+    expect_value(__wrap_send, buf, buffer_tostring(buffer));
+    expect_string(__wrap_send, buf, "POST /receive HTTP/1.1\r\nContent-Length: 2\r\n\r\nab");
+    expect_value(__wrap_send, len, 47);
+    expect_value(__wrap_send, flags, MSG_NOSIGNAL);
+
+    simple_connector_send_buffer(&sock, &failures, instance, header, buffer, 3);
+
+    assert_int_equal(failures, 0);
+    assert_int_equal(stats->transmission_successes, 1);
+    assert_int_equal(stats->transmission_failures, 0);
+    assert_int_equal(stats->sent_bytes, 144);
+    assert_int_equal(stats->sent_metrics, 3);
+    assert_int_equal(buffer_strlen(buffer), 0);
+    assert_int_equal(connector_specific_data->requests_in_flight, 2);
+    assert_int_equal(sock, fds[0]);
+
+    buffer_free(header);
+    buffer_free(buffer);
+    close(fds[0]);
+    close(fds[1]);
+    teardown_prometheus_remote_write_requests(instance);
+}
+
+static void test_prometheus_remote_write_reconnect(void **state)
+{
+    struct engine *engine = *state;
+    struct instance *instance = engine->instance_root;
+
+    __real_mark_scheduled_instances(engine);
+
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        setup_prometheus_remote_write_requests(instance, 2);
+
+    struct simple_connector_data *simple_connector_data = instance->connector_specific_data;
+    simple_connector_data->last_buffer = callocz(1, sizeof(struct simple_connector_buffer));
+    simple_connector_data->first_buffer = simple_connector_data->last_buffer;
+    simple_connector_data->header = buffer_create(0);
+    simple_connector_data->buffer = buffer_create(0);
+    simple_connector_data->last_buffer->header = buffer_create(0);
+    simple_connector_data->last_buffer->buffer = buffer_create(0);
+
+    buffer_sprintf(simple_connector_data->last_buffer->header, "test header");
+    buffer_sprintf(simple_connector_data->last_buffer->buffer, "test buffer");
+
+    // left over from the previous connection
+    connector_specific_data->requests_in_flight = 2;
+    simple_connector_data->response = buffer_create(0);
+    buffer_strcat(simple_connector_data->response, "HTTP/1.1 20");
+
+    expect_function_call(__wrap_connect_to_one_of);
+    expect_string(__wrap_connect_to_one_of, destination, "localhost");
+    expect_any(__wrap_connect_to_one_of, default_port);
+    expect_not_value(__wrap_connect_to_one_of, reconnects_counter, 0);
+    expect_value(__wrap_connect_to_one_of, connected_to, 0);
+    expect_value(__wrap_connect_to_one_of, connected_to_size, 0);
+    will_return(__wrap_connect_to_one_of, 2);
+
+    // the batch is sent without waiting for the responses of the previous connection
+    expect_function_call(__wrap_send);
+    expect_value(__wrap_send, sockfd, 2);
+    expect_not_value(__wrap_send, buf, buffer_tostring(simple_connector_data->last_buffer->buffer));
+    expect_string(__wrap_send, buf, "test header");
+    expect_value(__wrap_send, len, 11);
+    expect_value(__wrap_send, flags, MSG_NOSIGNAL);
+
+    expect_function_call(__wrap_send);
+    expect_value(__wrap_send, sockfd, 2);
+    expect_value(__wrap_send, buf, buffer_tostring(simple_connector_data->last_buffer->buffer));
+    expect_string(__wrap_send, buf, "test buffer");
+    expect_value(__wrap_send, len, 11);
+    expect_value(__wrap_send, flags, MSG_NOSIGNAL);
+
+    expect_function_call(__wrap_send_internal_metrics);
+    expect_value(__wrap_send_internal_metrics, instance, instance);
+    will_return(__wrap_send_internal_metrics, 0);
+
+    simple_connector_worker(instance);
+
+    assert_int_equal(connector_specific_data->requests_in_flight, 1);
+    assert_int_equal(buffer_strlen(simple_connector_data->response), 0);
+
+    buffer_free(simple_connector_data->header);
+    buffer_free(simple_connector_data->buffer);
+    buffer_free(simple_connector_data->last_buffer->header);
+    buffer_free(simple_connector_data->last_buffer->buffer);
+    freez(simple_connector_data->last_buffer);
+    teardown_prometheus_remote_write_requests(instance);
+}
+
 static void test_format_host_prometheus_remote_write(void **state)
 {
     struct engine *engine = *state;
@@ -1207,10 +1801,10 @@ static void test_format_host_prometheus_remote_write(void **state)
     instance->config.options |= EXPORTING_OPTION_SEND_CONFIGURED_LABELS;
     instance->config.options |= EXPORTING_OPTION_SEND_AUTOMATIC_LABELS;
 
-    struct simple_connector_data *simple_connector_data = mallocz(sizeof(struct simple_connector_data *));
+    struct simple_connector_data *simple_connector_data = callocz(1, sizeof(struct simple_connector_data));
     instance->connector_specific_data = simple_connector_data;
     struct prometheus_remote_write_specific_data *connector_specific_data =
-        mallocz(sizeof(struct prometheus_remote_write_specific_data *));
+        callocz(1, sizeof(struct prometheus_remote_write_specific_data));
     simple_connector_data->connector_specific_data = (void *)connector_specific_data;
     connector_specific_data->write_request = (void *)0xff;
 
@@ -1249,10 +1843,10 @@ static void test_format_dimension_prometheus_remote_write(void **state)
     struct engine *engine = *state;
     struct instance *instance = engine->instance_root;
 
-    struct simple_connector_data *simple_connector_data = mallocz(sizeof(struct simple_connector_data *));
+    struct simple_connector_data *simple_connector_data = callocz(1, sizeof(struct simple_connector_data));
     instance->connector_specific_data = simple_connector_data;
     struct prometheus_remote_write_specific_data *connector_specific_data =
-        mallocz(sizeof(struct prometheus_remote_write_specific_data *));
+        callocz(1, sizeof(struct prometheus_remote_write_specific_data));
     simple_connector_data->connector_specific_data = (void *)connector_specific_data;
     connector_specific_data->write_request = (void *)0xff;
 
@@ -1274,15 +1868,177 @@ static void test_format_dimension_prometheus_remote_write(void **state)
     assert_int_equal(format_dimension_prometheus_remote_write(instance, rd), 0);
 }
 
+static void test_format_dimension_prometheus_remote_write_split(void **state)
+{
+    struct engine *engine = *state;
+    struct instance *instance = engine->instance_root;
+
+    struct prometheus_remote_write_specific_config *connector_specific_config =
+        callocz(1, sizeof(struct prometheus_remote_write_specific_config));
+    instance->config.connector_specific_config = connector_specific_config;
+    connector_specific_config->remote_write_path = strdupz("/receive");
+    connector_specific_config->max_samples_per_request = 1;
+
+    struct simple_connector_data *simple_connector_data = callocz(1, sizeof(struct simple_connector_data));
+    instance->connector_specific_data = simple_connector_data;
+    struct prometheus_remote_write_specific_data *connector_specific_data =
+        callocz(1, sizeof(struct prometheus_remote_write_specific_data));
+    simple_connector_data->connector_specific_data = (void *)connector_specific_data;
+    connector_specific_data->write_request = __real_init_write_request();
+
+    // the sample the dimension adds is already in the write request
+    __real_add_metric(
+        connector_specific_data->write_request,
+        "test_name", "test chart", "test_family", "test_dimension", "test_instance",
+        123000321, 15052);
+
+    RRDDIM *rd = localhost->rrdset_root->dimensions;
+
+    expect_function_call(__wrap_exporting_calculate_value_from_stored_data);
+    will_return(__wrap_exporting_calculate_value_from_stored_data, pack_storage_number(27, SN_EXISTS));
+
+    expect_function_call(__wrap_add_metric);
+    expect_value(__wrap_add_metric, write_request_p, connector_specific_data->write_request);
+    expect_string(__wrap_add_metric, name, "netdata_");
+    expect_string(__wrap_add_metric, chart, "");
+    expect_string(__wrap_add_metric, family, "");
+    expect_string(__wrap_add_metric, dimension, "dimension_name");
+    expect_string(__wrap_add_metric, instance, "test-host");
+    expect_value(__wrap_add_metric, value, 0x292932e0);
+    expect_value(__wrap_add_metric, timestamp, 15052 * MSEC_PER_SEC);
+
+    // the request is full, it is packed with its header
+    assert_int_equal(format_dimension_prometheus_remote_write(instance, rd), 0);
+
+    BUFFER *buffer = instance->buffer;
+    size_t len = buffer_strlen(buffer);
+
+    assert_int_equal(connector_specific_data->batch_requests, 1);
+    assert_int_equal(get_write_request_samples(connector_specific_data->write_request), 0);
+    assert_int_equal(strncmp(buffer_tostring(buffer), "POST /receive HTTP/1.1\r\nHost: localhost\r\n", 41), 0);
+    assert_int_equal(prometheus_remote_write_requests_length(buffer, 1), len);
+
+    // there are no more samples, the batch ends with the request
+    expect_function_call(__wrap_simple_connector_end_batch);
+    expect_value(__wrap_simple_connector_end_batch, instance, instance);
+    will_return(__wrap_simple_connector_end_batch, 0);
+
+    assert_int_equal(format_batch_prometheus_remote_write(instance), 0);
+    assert_int_equal(buffer_strlen(buffer), len);
+
+    // the requests already have their headers
+    BUFFER *header = buffer_create(0);
+    simple_connector_data->last_buffer = callocz(1, sizeof(struct simple_connector_buffer));
+    simple_connector_data->last_buffer->header = header;
+    simple_connector_data->last_buffer->buffer = buffer;
+
+    prometheus_remote_write_prepare_header(instance);
+
+    assert_int_equal(connector_specific_data->batch_requests, 0);
+    assert_int_equal(buffer_strlen(header), 0);
+    assert_int_equal(prometheus_remote_write_count_requests(header, buffer), 1);
+
+    buffer_free(header);
+    freez(simple_connector_data->last_buffer);
+    buffer_free(connector_specific_data->payload);
+    free_write_request(connector_specific_data->write_request);
+    freez(connector_specific_data);
+    freez(simple_connector_data);
+    free(connector_specific_config->remote_write_path);
+    freez(connector_specific_config);
+    protocol_buffers_shutdown();
+}
+
+static void test_format_chart_prometheus_remote_write_in_parallel(void **state)
+{
+    (void)state;
+
+    struct engine *engine = callocz(1, sizeof(struct engine));
+    struct instance *instances = callocz(2, sizeof(struct instance));
+
+    for (size_t n = 0; n < 2; n++) {
+        struct instance *instance = &instances[n];
+        instance->engine = engine;
+        instance->index = n;
+        instance->config.name = n ? "sum" : "collected";
+        instance->config.options =
+            n ? EXPORTING_SOURCE_DATA_SUM : (EXPORTING_SOURCE_DATA_AS_COLLECTED | EXPORTING_OPTION_SEND_NAMES);
+        instance->config.charts_pattern = simple_pattern_create("*", NULL, SIMPLE_PATTERN_EXACT);
+        instance->start_chart_formatting = format_chart_prometheus_remote_write;
+
+        struct simple_connector_data *simple_connector_data = callocz(1, sizeof(struct simple_connector_data));
+        instance->connector_specific_data = simple_connector_data;
+        simple_connector_data->connector_specific_data =
+            callocz(1, sizeof(struct prometheus_remote_write_specific_data));
+        uv_mutex_init(&instance->mutex);
+        uv_cond_init(&instance->cond_var);
+
+        if (n)
+            instances[n - 1].next = instance;
+    }
+    engine->instance_root = &instances[0];
+    engine->instance_num = 2;
+
+    // the host is not checked again, so the threads don't log concurrently
+    localhost->exporting_flags = callocz(2, sizeof(RRDHOST_FLAGS));
+    localhost->exporting_flags[0] = localhost->exporting_flags[1] = RRDHOST_FLAG_BACKEND_SEND;
+
+    RRDSET *st = localhost->rrdset_root;
+    st->family = "test_family";
+    st->context = "test_context";
+
+    exporting_doubles_in_parallel = 1;
+
+    // every instance keeps the state of the chart it formats in its own connector data
+    for (int round = 0; round < 10; round++) {
+        for (size_t n = 0; n < 2; n++)
+            instances[n].scheduled = 1;
+
+        __real_prepare_buffers(engine);
+
+        for (size_t n = 0; n < 2; n++) {
+            struct simple_connector_data *simple_connector_data = instances[n].connector_specific_data;
+            struct prometheus_remote_write_specific_data *connector_specific_data =
+                simple_connector_data->connector_specific_data;
+
+            assert_int_equal(connector_specific_data->as_collected, !n);
+            assert_string_equal(connector_specific_data->chart, n ? "chart_id" : "chart_name");
+            assert_string_equal(connector_specific_data->family, "test_family");
+            assert_string_equal(connector_specific_data->context, "test_context");
+        }
+    }
+
+    engine->exit = 1;
+    stop_formatting_threads(engine);
+    exporting_doubles_in_parallel = 0;
+
+    for (size_t n = 0; n < 2; n++) {
+        struct simple_connector_data *simple_connector_data = instances[n].connector_specific_data;
+        freez(simple_connector_data->connector_specific_data);
+        freez(simple_connector_data);
+        simple_pattern_free(instances[n].config.charts_pattern);
+        uv_cond_destroy(&instances[n].cond_var);
+        uv_mutex_destroy(&instances[n].mutex);
+    }
+    st->family = NULL;
+    st->context = NULL;
+    freez(st->exporting_flags);
+    st->exporting_flags = NULL;
+    freez(localhost->exporting_flags);
+    localhost->exporting_flags = NULL;
+    freez(instances);
+    freez(engine);
+}
+
 static void test_format_batch_prometheus_remote_write(void **state)
 {
     struct engine *engine = *state;
     struct instance *instance = engine->instance_root;
 
-    struct simple_connector_data *simple_connector_data = mallocz(sizeof(struct simple_connector_data *));
+    struct simple_connector_data *simple_connector_data = callocz(1, sizeof(struct simple_connector_data));
     instance->connector_specific_data = simple_connector_data;
     struct prometheus_remote_write_specific_data *connector_specific_data =
-        mallocz(sizeof(struct prometheus_remote_write_specific_data *));
+        callocz(1, sizeof(struct prometheus_remote_write_specific_data));
     simple_connector_data->connector_specific_data = (void *)connector_specific_data;
     connector_specific_data->write_request = __real_init_write_request();
 
@@ -1812,6 +2568,7 @@ int main(void)
         cmocka_unit_test_setup_teardown(
             test_exporting_calculate_value_from_stored_data, setup_initialized_engine, teardown_initialized_engine),
         cmocka_unit_test_setup_teardown(test_prepare_buffers, setup_initialized_engine, teardown_initialized_engine),
+        cmocka_unit_test_setup_teardown(test_prepare_buffers_in_parallel, setup_rrdhost, teardown_rrdhost),
         cmocka_unit_test(test_exporting_name_copy),
         cmocka_unit_test_setup_teardown(
             test_format_dimension_collected_graphite_plaintext, setup_initialized_engine, teardown_initialized_engine),
@@ -1837,6 +2594,7 @@ int main(void)
             test_simple_connector_send_buffer, setup_initialized_engine, teardown_initialized_engine),
         cmocka_unit_test_setup_teardown(
             test_simple_connector_worker, setup_initialized_engine, teardown_initialized_engine),
+        cmocka_unit_test_setup_teardown(test_exporting_spool, setup_configured_engine, teardown_configured_engine),
     };
 
     const struct CMUnitTest label_tests[] = {
@@ -1874,6 +2632,7 @@ int main(void)
             test_format_host_labels_prometheus, setup_configured_engine, teardown_configured_engine),
         cmocka_unit_test_setup_teardown(
             rrd_stats_api_v1_charts_allmetrics_prometheus, setup_prometheus, teardown_prometheus),
+        cmocka_unit_test_setup_teardown(test_prometheus_dimension_cache, setup_prometheus, teardown_prometheus),
     };
 
     test_res += cmocka_run_group_tests_name("prometheus_web_api", prometheus_web_api_tests, NULL, NULL);
@@ -1885,10 +2644,32 @@ int main(void)
         cmocka_unit_test_setup_teardown(
             test_prometheus_remote_write_prepare_header, setup_initialized_engine, teardown_initialized_engine),
         cmocka_unit_test(test_process_prometheus_remote_write_response),
+        cmocka_unit_test_setup_teardown(
+            test_process_pipelined_prometheus_remote_write_responses,
+            setup_initialized_engine,
+            teardown_initialized_engine),
+        cmocka_unit_test(test_prometheus_remote_write_count_requests),
+        cmocka_unit_test(test_prometheus_remote_write_requests_length),
+        cmocka_unit_test_setup_teardown(
+            test_prometheus_remote_write_wait_for_responses, setup_initialized_engine, teardown_initialized_engine),
+        cmocka_unit_test_setup_teardown(
+            test_prometheus_remote_write_wait_for_responses_timeout,
+            setup_initialized_engine,
+            teardown_initialized_engine),
+        cmocka_unit_test_setup_teardown(
+            test_prometheus_remote_write_send_split_batch, setup_initialized_engine, teardown_initialized_engine),
+        cmocka_unit_test_setup_teardown(
+            test_prometheus_remote_write_reconnect, setup_initialized_engine, teardown_initialized_engine),
         cmocka_unit_test_setup_teardown(
             test_format_host_prometheus_remote_write, setup_initialized_engine, teardown_initialized_engine),
         cmocka_unit_test_setup_teardown(
             test_format_dimension_prometheus_remote_write, setup_initialized_engine, teardown_initialized_engine),
+        cmocka_unit_test_setup_teardown(
+            test_format_dimension_prometheus_remote_write_split,
+            setup_initialized_engine,
+            teardown_initialized_engine),
+        cmocka_unit_test_setup_teardown(
+            test_format_chart_prometheus_remote_write_in_parallel, setup_rrdhost, teardown_rrdhost),
         cmocka_unit_test_setup_teardown(
             test_format_batch_prometheus_remote_write, setup_initialized_engine, teardown_initialized_engine),
     };
@@ -35,9 +35,12 @@
 #define MAX_LOG_LINE 1024
 extern char log_line[];
 
+extern int exporting_doubles_in_parallel;
+
 // -----------------------------------------------------------------------
 // doubles for Netdata functions
 
+char *__real_strdupz(const char *s);
 const char *__wrap_strdupz(const char *s);
 void __wrap_info_int(const char *file, const char *function, const unsigned long line, const char *fmt, ...);
 int __wrap_connect_to_one_of(
@@ -61,9 +64,13 @@ void __mock_rrddim_query_finalize(struct rrddim_query_handle *handle);
 // wraps for system functions
 
 void __wrap_uv_thread_create(uv_thread_t thread, void (*worker)(void *arg), void *arg);
+void __real_uv_mutex_lock(uv_mutex_t *mutex);
 void __wrap_uv_mutex_lock(uv_mutex_t *mutex);
+void __real_uv_mutex_unlock(uv_mutex_t *mutex);
 void __wrap_uv_mutex_unlock(uv_mutex_t *mutex);
+void __real_uv_cond_signal(uv_cond_t *cond_var);
 void __wrap_uv_cond_signal(uv_cond_t *cond_var);
+void __real_uv_cond_wait(uv_cond_t *cond_var, uv_mutex_t *mutex);
 void __wrap_uv_cond_wait(uv_cond_t *cond_var, uv_mutex_t *mutex);
 ssize_t __wrap_recv(int sockfd, void *buf, size_t len, int flags);
 ssize_t __wrap_send(int sockfd, const void *buf, size_t len, int flags);
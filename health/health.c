@@ -12,28 +12,55 @@ unsigned int default_health_enabled = 1;
 char *silencers_filename;
 
 // the queue of executed alarm notifications that haven't been waited for yet
-static struct {
+struct alarm_notifications_queue {
     ALARM_ENTRY *head; // oldest
     ALARM_ENTRY *tail; // latest
-} alarm_notifications_in_progress = {NULL, NULL};
+};
+
+// ----------------------------------------------------------------------------
+// health workers
+//
+// every host with health enabled is pinned to one worker thread, which keeps
+// its hosts in a min-heap ordered by the time their alarms have to run next
+
+struct health_worker {
+    int id;
+    netdata_thread_t thread;
+
+    netdata_mutex_t mutex;                  // protects the heap
+    pthread_cond_t cond;                    // signaled when a host is added to the heap
+
+    RRDHOST **heap;
+    size_t heap_used;
+    size_t heap_size;
+
+    size_t hosts;                           // the number of hosts pinned to this worker
+
+    struct alarm_notifications_queue notifications_in_progress;
+};
 
-static inline void enqueue_alarm_notify_in_progress(ALARM_ENTRY *ae)
+static int health_workers_count = 0;
+static struct health_worker *health_workers = NULL;
+
+static int health_min_run_every = 10;
+
+static inline void enqueue_alarm_notify_in_progress(struct alarm_notifications_queue *queue, ALARM_ENTRY *ae)
 {
     ae->prev_in_progress = NULL;
     ae->next_in_progress = NULL;
 
-    if (NULL != alarm_notifications_in_progress.tail) {
-        ae->prev_in_progress = alarm_notifications_in_progress.tail;
-        alarm_notifications_in_progress.tail->next_in_progress = ae;
+    if (NULL != queue->tail) {
+        ae->prev_in_progress = queue->tail;
+        queue->tail->next_in_progress = ae;
     }
-    if (NULL == alarm_notifications_in_progress.head) {
-        alarm_notifications_in_progress.head = ae;
+    if (NULL == queue->head) {
+        queue->head = ae;
     }
-    alarm_notifications_in_progress.tail = ae;
+    queue->tail = ae;
 
 }
 
-static inline void unlink_alarm_notify_in_progress(ALARM_ENTRY *ae)
+static inline void unlink_alarm_notify_in_progress(struct alarm_notifications_queue *queue, ALARM_ENTRY *ae)
 {
     struct alarm_entry *prev = ae->prev_in_progress;
     struct alarm_entry *next = ae->next_in_progress;
@@ -44,13 +71,79 @@ static inline void unlink_alarm_notify_in_progress(ALARM_ENTRY *ae)
     if (NULL != next) {
         next->prev_in_progress = prev;
     }
-    if (ae == alarm_notifications_in_progress.head) {
-        alarm_notifications_in_progress.head = next;
+    if (ae == queue->head) {
+        queue->head = next;
+    }
+    if (ae == queue->tail) {
+        queue->tail = prev;
+    }
+}
+
+static inline void health_heap_swap(struct health_worker *w, size_t a, size_t b) {
+    RRDHOST *t = w->heap[a];
+    w->heap[a] = w->heap[b];
+    w->heap[b] = t;
+
+    w->heap[a]->health_heap_index = a;
+    w->heap[b]->health_heap_index = b;
+}
+
+static void health_heap_up(struct health_worker *w, size_t i) {
+    while(i) {
+        size_t parent = (i - 1) / 2;
+        if(w->heap[parent]->health_next_run <= w->heap[i]->health_next_run)
+            break;
+
+        health_heap_swap(w, i, parent);
+        i = parent;
+    }
+}
+
+static void health_heap_down(struct health_worker *w, size_t i) {
+    for(;;) {
+        size_t smallest = i, left = i * 2 + 1, right = i * 2 + 2;
+
+        if(left < w->heap_used && w->heap[left]->health_next_run < w->heap[smallest]->health_next_run)
+            smallest = left;
+
+        if(right < w->heap_used && w->heap[right]->health_next_run < w->heap[smallest]->health_next_run)
+            smallest = right;
+
+        if(smallest == i)
+            break;
+
+        health_heap_swap(w, i, smallest);
+        i = smallest;
+    }
+}
+
+// must be called with the worker mutex locked
+static void health_heap_push(struct health_worker *w, RRDHOST *host) {
+    if(unlikely(w->heap_used == w->heap_size)) {
+        w->heap_size = (w->heap_size) ? w->heap_size * 2 : 16;
+        w->heap = reallocz(w->heap, w->heap_size * sizeof(RRDHOST *));
     }
-    if (ae == alarm_notifications_in_progress.tail) {
-        alarm_notifications_in_progress.tail = prev;
+
+    host->health_heap_index = w->heap_used;
+    w->heap[w->heap_used++] = host;
+    health_heap_up(w, host->health_heap_index);
+}
+
+// must be called with the worker mutex locked
+static void health_heap_remove(struct health_worker *w, size_t i) {
+    w->heap_used--;
+
+    if(i != w->heap_used) {
+        health_heap_swap(w, i, w->heap_used);
+        health_heap_up(w, i);
+        health_heap_down(w, i);
     }
 }
+
+static inline int health_heap_contains(struct health_worker *w, RRDHOST *host) {
+    return host->health_heap_index < w->heap_used && w->heap[host->health_heap_index] == host;
+}
+
 // ----------------------------------------------------------------------------
 // health initialization
 
@@ -251,7 +344,7 @@ static inline RRDCALC_STATUS rrdcalc_value2status(calculated_number n) {
 
 #define ALARM_EXEC_COMMAND_LENGTH 8192
 
-static inline void health_alarm_execute(RRDHOST *host, ALARM_ENTRY *ae) {
+static inline void health_alarm_execute(struct health_worker *w, RRDHOST *host, ALARM_ENTRY *ae) {
     ae->flags |= HEALTH_ENTRY_FLAG_PROCESSED;
 
     if(unlikely(ae->new_status < RRDCALC_STATUS_CLEAR)) {
@@ -306,7 +399,7 @@ static inline void health_alarm_execute(RRDHOST *host, ALARM_ENTRY *ae) {
         goto done;
     }
 
-    static char command_to_run[ALARM_EXEC_COMMAND_LENGTH + 1];
+    char command_to_run[ALARM_EXEC_COMMAND_LENGTH + 1];
 
     const char *exec      = (ae->exec)      ? ae->exec      : host->health_default_exec;
     const char *recipient = (ae->recipient) ? ae->recipient : host->health_default_recipient;
@@ -356,7 +449,7 @@ static inline void health_alarm_execute(RRDHOST *host, ALARM_ENTRY *ae) {
               ae->new_value_string,
               ae->old_value_string,
               (expr && expr->source)?expr->source:"NOSOURCE",
-              (expr && expr->error_msg)?buffer_tostring(expr->error_msg):"NOERRMSG",
+              (expr && expr->error_msg)?expression_error_msg(expr):"NOERRMSG",
               n_warn,
               n_crit
     );
@@ -367,14 +460,14 @@ static inline void health_alarm_execute(RRDHOST *host, ALARM_ENTRY *ae) {
     debug(D_HEALTH, "executing command '%s'", command_to_run);
     ae->flags |= HEALTH_ENTRY_FLAG_EXEC_IN_PROGRESS;
     ae->exec_spawn_serial = spawn_enq_cmd(command_to_run);
-    enqueue_alarm_notify_in_progress(ae);
+    enqueue_alarm_notify_in_progress(&w->notifications_in_progress, ae);
 
     return; //health_alarm_wait_for_execution
 done:
     health_alarm_log_save(host, ae);
 }
 
-static inline void health_alarm_wait_for_execution(ALARM_ENTRY *ae) {
+static inline void health_alarm_wait_for_execution(struct health_worker *w, ALARM_ENTRY *ae) {
     if (!(ae->flags & HEALTH_ENTRY_FLAG_EXEC_IN_PROGRESS))
         return;
 
@@ -385,10 +478,10 @@ static inline void health_alarm_wait_for_execution(ALARM_ENTRY *ae) {
     if(ae->exec_code != 0)
         ae->flags |= HEALTH_ENTRY_FLAG_EXEC_FAILED;
 
-    unlink_alarm_notify_in_progress(ae);
+    unlink_alarm_notify_in_progress(&w->notifications_in_progress, ae);
 }
 
-static inline void health_process_notifications(RRDHOST *host, ALARM_ENTRY *ae) {
+static inline void health_process_notifications(struct health_worker *w, RRDHOST *host, ALARM_ENTRY *ae) {
     debug(D_HEALTH, "Health alarm '%s.%s' = " CALCULATED_NUMBER_FORMAT_AUTO " - changed status from %s to %s",
          ae->chart?ae->chart:"NOCHART", ae->name,
          ae->new_value,
@@ -396,10 +489,10 @@ static inline void health_process_notifications(RRDHOST *host, ALARM_ENTRY *ae)
          rrdcalc_status2string(ae->new_status)
     );
 
-    health_alarm_execute(host, ae);
+    health_alarm_execute(w, host, ae);
 }
 
-static inline void health_alarm_log_process(RRDHOST *host) {
+static inline void health_alarm_log_process(struct health_worker *w, RRDHOST *host) {
     uint32_t first_waiting = (host->health_log.alarms)?host->health_log.alarms->unique_id:0;
     time_t now = now_realtime_sec();
 
@@ -416,7 +509,7 @@ static inline void health_alarm_log_process(RRDHOST *host) {
                     first_waiting = ae->unique_id;
 
                 if(likely(now >= ae->delay_up_to_timestamp))
-                    health_process_notifications(host, ae);
+                    health_process_notifications(w, host, ae);
             }
         }
     }
@@ -447,7 +540,7 @@ static inline void health_alarm_log_process(RRDHOST *host) {
         ALARM_ENTRY *t = ae->next;
 
         if(likely(!alarm_entry_isrepeating(host, ae))) {
-            health_alarm_wait_for_execution(ae);
+            health_alarm_wait_for_execution(w, ae);
             health_alarm_log_free_one_nochecks_nounlink(ae);
             host->health_log.count--;
         }
@@ -458,6 +551,20 @@ static inline void health_alarm_log_process(RRDHOST *host) {
     netdata_rwlock_unlock(&host->health_log.alarm_log_rwlock);
 }
 
+// the expressions keep pointers to the variables they use
+// when variables are added or removed on the host, they have to look them up again
+static inline void health_rrdcalc_check_variables(RRDHOST *host, RRDCALC *rc) {
+    size_t generation = __atomic_load_n(&host->rrdvar_generation, __ATOMIC_ACQUIRE);
+
+    if(likely(rc->rrdvar_generation == generation))
+        return;
+
+    expression_unbind_variables(rc->calculation);
+    expression_unbind_variables(rc->warning);
+    expression_unbind_variables(rc->critical);
+    rc->rrdvar_generation = generation;
+}
+
 static inline int rrdcalc_isrunnable(RRDCALC *rc, time_t now, time_t *next_run) {
     if(unlikely(!rc->rrdset)) {
         debug(D_HEALTH, "Health not running alarm '%s.%s'. It is not linked to a chart.", rc->chart?rc->chart:"NOCHART", rc->name);
@@ -546,15 +653,6 @@ static inline int check_if_resumed_from_suspention(void) {
     return ret;
 }
 
-static void health_main_cleanup(void *ptr) {
-    struct netdata_static_thread *static_thread = (struct netdata_static_thread *)ptr;
-    static_thread->enabled = NETDATA_MAIN_THREAD_EXITING;
-
-    info("cleaning up...");
-
-    static_thread->enabled = NETDATA_MAIN_THREAD_EXITED;
-}
-
 SILENCE_TYPE check_silenced(RRDCALC *rc, char* host, SILENCERS *silencers) {
     SILENCER *s;
     debug(D_HEALTH, "Checking if alarm was silenced via the command API. Alarm info name:%s context:%s chart:%s host:%s family:%s",
@@ -627,424 +725,648 @@ int update_disabled_silenced(RRDHOST *host, RRDCALC *rc) {
 }
 
 /**
- * Health Main
+ * Health Host Evaluate
  *
- * The main thread of the health system. In this function all the alarms will be processed.
+ * Evaluates the alarms of a host that are due and processes its repeating alarms.
  *
- * @param ptr is a pointer to the netdata_static_thread structure.
+ * @param w the worker the host is pinned to.
+ * @param host the host to evaluate.
+ * @param now the current time.
  *
- * @return It always returns NULL
+ * @return the next time the alarms of the host should be evaluated.
  */
-void *health_main(void *ptr) {
-    netdata_thread_cleanup_push(health_main_cleanup, ptr);
+static time_t health_host_evaluate(struct health_worker *w, RRDHOST *host, time_t now) {
+    int runnable = 0;
+    time_t next_run = now + health_min_run_every;
+    RRDCALC *rc;
 
-    int min_run_every = (int)config_get_number(CONFIG_SECTION_HEALTH, "run at least every seconds", 10);
-    if(min_run_every < 1) min_run_every = 1;
+    time_t delay_up_to = __atomic_load_n(&host->health_delay_up_to, __ATOMIC_ACQUIRE);
+    if (unlikely(delay_up_to)) {
+        if (unlikely(now < delay_up_to))
+            return delay_up_to;
 
-    time_t now                = now_realtime_sec();
-    time_t hibernation_delay  = config_get_number(CONFIG_SECTION_HEALTH, "postpone alarms during hibernation for seconds", 60);
+        info("Resuming health checks on host '%s'.", host->hostname);
+        __atomic_compare_exchange_n(&host->health_delay_up_to, &delay_up_to, 0, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+    }
 
-    rrdcalc_labels_unlink();
+    rrdhost_rdlock(host);
 
-    unsigned int loop = 0;
-    while(!netdata_exit) {
-        loop++;
-        debug(D_HEALTH, "Health monitoring iteration no %u started", loop);
+    // the first loop is to lookup values from the db
+    for (rc = host->alarms; rc; rc = rc->next) {
 
-        int runnable = 0, apply_hibernation_delay = 0;
-        time_t next_run = now + min_run_every;
-        RRDCALC *rc;
+        if (update_disabled_silenced(host, rc))
+            continue;
 
-        if (unlikely(check_if_resumed_from_suspention())) {
-            apply_hibernation_delay = 1;
+        if (unlikely(!rrdcalc_isrunnable(rc, now, &next_run))) {
+            if (unlikely(rc->rrdcalc_flags & RRDCALC_FLAG_RUNNABLE))
+                rc->rrdcalc_flags &= ~RRDCALC_FLAG_RUNNABLE;
+            continue;
+        }
 
-            info("Postponing alarm checks for %ld seconds, because it seems that the system was just resumed from suspension.",
-                 hibernation_delay
+        runnable++;
+        rc->old_value = rc->value;
+        rc->rrdcalc_flags |= RRDCALC_FLAG_RUNNABLE;
+
+        health_rrdcalc_check_variables(host, rc);
+
+        // ------------------------------------------------------------
+        // if there is database lookup, do it
+
+        if (unlikely(RRDCALC_HAS_DB_LOOKUP(rc))) {
+            /* time_t old_db_timestamp = rc->db_before; */
+            int value_is_null = 0;
+
+            int ret = rrdset2value_api_v1(rc->rrdset, NULL, &rc->value, rc->dimensions, 1, rc->after,
+                                          rc->before, rc->group, 0, rc->options, &rc->db_after,
+                                          &rc->db_before, &value_is_null, &rc->window
             );
-        }
 
-        if (unlikely(silencers->all_alarms && silencers->stype == STYPE_DISABLE_ALARMS)) {
-            static int logged=0;
-            if (!logged) {
-                info("Skipping health checks, because all alarms are disabled via a %s command.",
-                     HEALTH_CMDAPI_CMD_DISABLEALL);
-                logged = 1;
+            if (unlikely(ret != 200)) {
+                // database lookup failed
+                rc->value = NAN;
+                rc->rrdcalc_flags |= RRDCALC_FLAG_DB_ERROR;
+
+                debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': database lookup returned error %d",
+                      host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name, ret
+                );
+            } else
+                rc->rrdcalc_flags &= ~RRDCALC_FLAG_DB_ERROR;
+
+            /* - RRDCALC_FLAG_DB_STALE not currently used
+            if (unlikely(old_db_timestamp == rc->db_before)) {
+                // database is stale
+
+                debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': database is stale", host->hostname, rc->chart?rc->chart:"NOCHART", rc->name);
+
+                if (unlikely(!(rc->rrdcalc_flags & RRDCALC_FLAG_DB_STALE))) {
+                    rc->rrdcalc_flags |= RRDCALC_FLAG_DB_STALE;
+                    error("Health on host '%s', alarm '%s.%s': database is stale", host->hostname, rc->chart?rc->chart:"NOCHART", rc->name);
+                }
             }
+            else if (unlikely(rc->rrdcalc_flags & RRDCALC_FLAG_DB_STALE))
+                rc->rrdcalc_flags &= ~RRDCALC_FLAG_DB_STALE;
+            */
+
+            if (unlikely(value_is_null)) {
+                // collected value is null
+                rc->value = NAN;
+                rc->rrdcalc_flags |= RRDCALC_FLAG_DB_NAN;
+
+                debug(D_HEALTH,
+                      "Health on host '%s', alarm '%s.%s': database lookup returned empty value (possibly value is not collected yet)",
+                      host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name
+                );
+            } else
+                rc->rrdcalc_flags &= ~RRDCALC_FLAG_DB_NAN;
+
+            debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': database lookup gave value "
+                  CALCULATED_NUMBER_FORMAT, host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
+                  rc->value
+            );
         }
 
-        rrd_rdlock();
+        // ------------------------------------------------------------
+        // if there is calculation expression, run it
 
-        RRDHOST *host;
-        rrdhost_foreach_read(host) {
-            if (unlikely(!host->health_enabled))
-                continue;
+        if (unlikely(rc->calculation)) {
+            if (unlikely(!expression_evaluate(rc->calculation))) {
+                // calculation failed
+                rc->value = NAN;
+                rc->rrdcalc_flags |= RRDCALC_FLAG_CALC_ERROR;
 
-            if (unlikely(apply_hibernation_delay)) {
+                debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': expression '%s' failed: %s",
+                      host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
+                      rc->calculation->parsed_as, expression_error_msg(rc->calculation)
+                );
+            } else {
+                rc->rrdcalc_flags &= ~RRDCALC_FLAG_CALC_ERROR;
 
-                info("Postponing health checks for %ld seconds, on host '%s'.", hibernation_delay, host->hostname
+                debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': expression '%s' gave value "
+                      CALCULATED_NUMBER_FORMAT
+                      ": %s (source: %s)", host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
+                      rc->calculation->parsed_as, rc->calculation->result,
+                      expression_error_msg(rc->calculation), rc->source
                 );
 
-                host->health_delay_up_to = now + hibernation_delay;
+                rc->value = rc->calculation->result;
+
+                if (rc->local) rc->local->last_updated = now;
+                if (rc->family) rc->family->last_updated = now;
+                if (rc->hostid) rc->hostid->last_updated = now;
+                if (rc->hostname) rc->hostname->last_updated = now;
             }
+        }
+    }
+
+    rrdhost_unlock(host);
 
-            if (unlikely(host->health_delay_up_to)) {
-                if (unlikely(now < host->health_delay_up_to))
-                    continue;
+    if (unlikely(runnable && !netdata_exit)) {
+        rrdhost_rdlock(host);
 
-                info("Resuming health checks on host '%s'.", host->hostname);
-                host->health_delay_up_to = 0;
+        for (rc = host->alarms; rc; rc = rc->next) {
+            if (unlikely(!(rc->rrdcalc_flags & RRDCALC_FLAG_RUNNABLE)))
+                continue;
+
+            if (rc->rrdcalc_flags & RRDCALC_FLAG_DISABLED) {
+                continue;
             }
 
-            rrdhost_rdlock(host);
+            health_rrdcalc_check_variables(host, rc);
 
-            // the first loop is to lookup values from the db
-            for (rc = host->alarms; rc; rc = rc->next) {
+            RRDCALC_STATUS warning_status = RRDCALC_STATUS_UNDEFINED;
+            RRDCALC_STATUS critical_status = RRDCALC_STATUS_UNDEFINED;
 
-                if (update_disabled_silenced(host, rc))
-                    continue;
+            // --------------------------------------------------------
+            // check the warning expression
 
-                if (unlikely(!rrdcalc_isrunnable(rc, now, &next_run))) {
-                    if (unlikely(rc->rrdcalc_flags & RRDCALC_FLAG_RUNNABLE))
-                        rc->rrdcalc_flags &= ~RRDCALC_FLAG_RUNNABLE;
-                    continue;
-                }
+            if (likely(rc->warning)) {
+                if (unlikely(!expression_evaluate(rc->warning))) {
+                    // calculation failed
+                    rc->rrdcalc_flags |= RRDCALC_FLAG_WARN_ERROR;
 
-                runnable++;
-                rc->old_value = rc->value;
-                rc->rrdcalc_flags |= RRDCALC_FLAG_RUNNABLE;
+                    debug(D_HEALTH,
+                          "Health on host '%s', alarm '%s.%s': warning expression failed with error: %s",
+                          host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
+                          expression_error_msg(rc->warning)
+                    );
+                } else {
+                    rc->rrdcalc_flags &= ~RRDCALC_FLAG_WARN_ERROR;
+                    debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': warning expression gave value "
+                          CALCULATED_NUMBER_FORMAT
+                          ": %s (source: %s)", host->hostname, rc->chart ? rc->chart : "NOCHART",
+                          rc->name, rc->warning->result, expression_error_msg(rc->warning), rc->source
+                    );
+                    warning_status = rrdcalc_value2status(rc->warning->result);
+                }
+            }
 
-                // ------------------------------------------------------------
-                // if there is database lookup, do it
+            // --------------------------------------------------------
+            // check the critical expression
 
-                if (unlikely(RRDCALC_HAS_DB_LOOKUP(rc))) {
-                    /* time_t old_db_timestamp = rc->db_before; */
-                    int value_is_null = 0;
+            if (likely(rc->critical)) {
+                if (unlikely(!expression_evaluate(rc->critical))) {
+                    // calculation failed
+                    rc->rrdcalc_flags |= RRDCALC_FLAG_CRIT_ERROR;
 
-                    int ret = rrdset2value_api_v1(rc->rrdset, NULL, &rc->value, rc->dimensions, 1, rc->after,
-                                                  rc->before, rc->group, 0, rc->options, &rc->db_after,
-                                                  &rc->db_before, &value_is_null
+                    debug(D_HEALTH,
+                          "Health on host '%s', alarm '%s.%s': critical expression failed with error: %s",
+                          host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
+                          expression_error_msg(rc->critical)
+                    );
+                } else {
+                    rc->rrdcalc_flags &= ~RRDCALC_FLAG_CRIT_ERROR;
+                    debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': critical expression gave value "
+                          CALCULATED_NUMBER_FORMAT
+                          ": %s (source: %s)", host->hostname, rc->chart ? rc->chart : "NOCHART",
+                          rc->name, rc->critical->result, expression_error_msg(rc->critical),
+                          rc->source
                     );
+                    critical_status = rrdcalc_value2status(rc->critical->result);
+                }
+            }
 
-                    if (unlikely(ret != 200)) {
-                        // database lookup failed
-                        rc->value = NAN;
-                        rc->rrdcalc_flags |= RRDCALC_FLAG_DB_ERROR;
+            // --------------------------------------------------------
+            // decide the final alarm status
 
-                        debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': database lookup returned error %d",
-                              host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name, ret
-                        );
-                    } else
-                        rc->rrdcalc_flags &= ~RRDCALC_FLAG_DB_ERROR;
+            RRDCALC_STATUS status = RRDCALC_STATUS_UNDEFINED;
 
-                    /* - RRDCALC_FLAG_DB_STALE not currently used
-                    if (unlikely(old_db_timestamp == rc->db_before)) {
-                        // database is stale
+            switch (warning_status) {
+                case RRDCALC_STATUS_CLEAR:
+                    status = RRDCALC_STATUS_CLEAR;
+                    break;
 
-                        debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': database is stale", host->hostname, rc->chart?rc->chart:"NOCHART", rc->name);
+                case RRDCALC_STATUS_RAISED:
+                    status = RRDCALC_STATUS_WARNING;
+                    break;
 
-                        if (unlikely(!(rc->rrdcalc_flags & RRDCALC_FLAG_DB_STALE))) {
-                            rc->rrdcalc_flags |= RRDCALC_FLAG_DB_STALE;
-                            error("Health on host '%s', alarm '%s.%s': database is stale", host->hostname, rc->chart?rc->chart:"NOCHART", rc->name);
-                        }
-                    }
-                    else if (unlikely(rc->rrdcalc_flags & RRDCALC_FLAG_DB_STALE))
-                        rc->rrdcalc_flags &= ~RRDCALC_FLAG_DB_STALE;
-                    */
-
-                    if (unlikely(value_is_null)) {
-                        // collected value is null
-                        rc->value = NAN;
-                        rc->rrdcalc_flags |= RRDCALC_FLAG_DB_NAN;
-
-                        debug(D_HEALTH,
-                              "Health on host '%s', alarm '%s.%s': database lookup returned empty value (possibly value is not collected yet)",
-                              host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name
-                        );
-                    } else
-                        rc->rrdcalc_flags &= ~RRDCALC_FLAG_DB_NAN;
+                default:
+                    break;
+            }
 
-                    debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': database lookup gave value "
-                          CALCULATED_NUMBER_FORMAT, host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
-                          rc->value
-                    );
-                }
+            switch (critical_status) {
+                case RRDCALC_STATUS_CLEAR:
+                    if (status == RRDCALC_STATUS_UNDEFINED)
+                       status = RRDCALC_STATUS_CLEAR;
+                    break;
 
-                // ------------------------------------------------------------
-                // if there is calculation expression, run it
+                case RRDCALC_STATUS_RAISED:
+                    status = RRDCALC_STATUS_CRITICAL;
+                    break;
 
-                if (unlikely(rc->calculation)) {
-                    if (unlikely(!expression_evaluate(rc->calculation))) {
-                        // calculation failed
-                        rc->value = NAN;
-                        rc->rrdcalc_flags |= RRDCALC_FLAG_CALC_ERROR;
+                default:
+                    break;
+            }
 
-                        debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': expression '%s' failed: %s",
-                              host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
-                              rc->calculation->parsed_as, buffer_tostring(rc->calculation->error_msg)
-                        );
-                    } else {
-                        rc->rrdcalc_flags &= ~RRDCALC_FLAG_CALC_ERROR;
-
-                        debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': expression '%s' gave value "
-                              CALCULATED_NUMBER_FORMAT
-                              ": %s (source: %s)", host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
-                              rc->calculation->parsed_as, rc->calculation->result,
-                              buffer_tostring(rc->calculation->error_msg), rc->source
-                        );
+            // --------------------------------------------------------
+            // check if the new status and the old differ
 
-                        rc->value = rc->calculation->result;
+            if (status != rc->status) {
+                int delay = 0;
 
-                        if (rc->local) rc->local->last_updated = now;
-                        if (rc->family) rc->family->last_updated = now;
-                        if (rc->hostid) rc->hostid->last_updated = now;
-                        if (rc->hostname) rc->hostname->last_updated = now;
-                    }
+                // apply trigger hysteresis
+
+                if (now > rc->delay_up_to_timestamp) {
+                    rc->delay_up_current = rc->delay_up_duration;
+                    rc->delay_down_current = rc->delay_down_duration;
+                    rc->delay_last = 0;
+                    rc->delay_up_to_timestamp = 0;
+                } else {
+                    rc->delay_up_current = (int) (rc->delay_up_current * rc->delay_multiplier);
+                    if (rc->delay_up_current > rc->delay_max_duration)
+                        rc->delay_up_current = rc->delay_max_duration;
+
+                    rc->delay_down_current = (int) (rc->delay_down_current * rc->delay_multiplier);
+                    if (rc->delay_down_current > rc->delay_max_duration)
+                        rc->delay_down_current = rc->delay_max_duration;
                 }
-            }
 
-            rrdhost_unlock(host);
+                if (status > rc->status)
+                    delay = rc->delay_up_current;
+                else
+                    delay = rc->delay_down_current;
+
+                // COMMENTED: because we do need to send raising alarms
+                // if(now + delay < rc->delay_up_to_timestamp)
+                //      delay = (int)(rc->delay_up_to_timestamp - now);
+
+                rc->delay_last = delay;
+                rc->delay_up_to_timestamp = now + delay;
+
+                if(likely(!rrdcalc_isrepeating(rc))) {
+                    ALARM_ENTRY *ae = health_create_alarm_entry(
+                            host, rc->id, rc->next_event_id++, now, rc->name, rc->rrdset->id,
+                            rc->rrdset->family, rc->exec, rc->recipient, now - rc->last_status_change,
+                            rc->old_value, rc->value, rc->status, status, rc->source, rc->units, rc->info,
+                            rc->delay_last,
+                            (
+                                    ((rc->options & RRDCALC_FLAG_NO_CLEAR_NOTIFICATION)? HEALTH_ENTRY_FLAG_NO_CLEAR_NOTIFICATION : 0) |
+                                    ((rc->rrdcalc_flags & RRDCALC_FLAG_SILENCED)? HEALTH_ENTRY_FLAG_SILENCED : 0)
+                            )
+                    );
+                    health_alarm_log(host, ae);
+                }
+                rc->last_status_change = now;
+                rc->old_status = rc->status;
+                rc->status = status;
+            }
 
-            if (unlikely(runnable && !netdata_exit)) {
-                rrdhost_rdlock(host);
+            rc->last_updated = now;
+            rc->next_update = now + rc->update_every;
 
-                for (rc = host->alarms; rc; rc = rc->next) {
-                    if (unlikely(!(rc->rrdcalc_flags & RRDCALC_FLAG_RUNNABLE)))
-                        continue;
+            if (next_run > rc->next_update)
+                next_run = rc->next_update;
+        }
 
-                    if (rc->rrdcalc_flags & RRDCALC_FLAG_DISABLED) {
-                        continue;
-                    }
-                    RRDCALC_STATUS warning_status = RRDCALC_STATUS_UNDEFINED;
-                    RRDCALC_STATUS critical_status = RRDCALC_STATUS_UNDEFINED;
-
-                    // --------------------------------------------------------
-                    // check the warning expression
-
-                    if (likely(rc->warning)) {
-                        if (unlikely(!expression_evaluate(rc->warning))) {
-                            // calculation failed
-                            rc->rrdcalc_flags |= RRDCALC_FLAG_WARN_ERROR;
-
-                            debug(D_HEALTH,
-                                  "Health on host '%s', alarm '%s.%s': warning expression failed with error: %s",
-                                  host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
-                                  buffer_tostring(rc->warning->error_msg)
-                            );
-                        } else {
-                            rc->rrdcalc_flags &= ~RRDCALC_FLAG_WARN_ERROR;
-                            debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': warning expression gave value "
-                                  CALCULATED_NUMBER_FORMAT
-                                  ": %s (source: %s)", host->hostname, rc->chart ? rc->chart : "NOCHART",
-                                  rc->name, rc->warning->result, buffer_tostring(rc->warning->error_msg), rc->source
-                            );
-                            warning_status = rrdcalc_value2status(rc->warning->result);
+        // process repeating alarms
+        RRDCALC *rc;
+        for(rc = host->alarms; rc ; rc = rc->next) {
+            int repeat_every = 0;
+            if(unlikely(rrdcalc_isrepeating(rc))) {
+                if(unlikely(rc->status == RRDCALC_STATUS_WARNING)) {
+                    rc->rrdcalc_flags &= ~RRDCALC_FLAG_RUN_ONCE;
+                    repeat_every = rc->warn_repeat_every;
+                } else if(unlikely(rc->status == RRDCALC_STATUS_CRITICAL)) {
+                    rc->rrdcalc_flags &= ~RRDCALC_FLAG_RUN_ONCE;
+                    repeat_every = rc->crit_repeat_every;
+                } else if(unlikely(rc->status == RRDCALC_STATUS_CLEAR)) {
+                    if(!(rc->rrdcalc_flags & RRDCALC_FLAG_RUN_ONCE)) {
+                        if(rc->old_status == RRDCALC_STATUS_CRITICAL) {
+                            repeat_every = rc->crit_repeat_every;
+                        } else if (rc->old_status == RRDCALC_STATUS_WARNING) {
+                            repeat_every = rc->warn_repeat_every;
                         }
                     }
+                }
+            }
 
-                    // --------------------------------------------------------
-                    // check the critical expression
-
-                    if (likely(rc->critical)) {
-                        if (unlikely(!expression_evaluate(rc->critical))) {
-                            // calculation failed
-                            rc->rrdcalc_flags |= RRDCALC_FLAG_CRIT_ERROR;
-
-                            debug(D_HEALTH,
-                                  "Health on host '%s', alarm '%s.%s': critical expression failed with error: %s",
-                                  host->hostname, rc->chart ? rc->chart : "NOCHART", rc->name,
-                                  buffer_tostring(rc->critical->error_msg)
-                            );
-                        } else {
-                            rc->rrdcalc_flags &= ~RRDCALC_FLAG_CRIT_ERROR;
-                            debug(D_HEALTH, "Health on host '%s', alarm '%s.%s': critical expression gave value "
-                                  CALCULATED_NUMBER_FORMAT
-                                  ": %s (source: %s)", host->hostname, rc->chart ? rc->chart : "NOCHART",
-                                  rc->name, rc->critical->result, buffer_tostring(rc->critical->error_msg),
-                                  rc->source
-                            );
-                            critical_status = rrdcalc_value2status(rc->critical->result);
-                        }
-                    }
+            if(unlikely(repeat_every > 0 && (rc->last_repeat + repeat_every) <= now)) {
+                rc->last_repeat = now;
+                ALARM_ENTRY *ae = health_create_alarm_entry(
+                        host, rc->id, rc->next_event_id++, now, rc->name, rc->rrdset->id,
+                        rc->rrdset->family, rc->exec, rc->recipient, now - rc->last_status_change,
+                        rc->old_value, rc->value, rc->old_status, rc->status, rc->source, rc->units, rc->info,
+                        rc->delay_last,
+                        (
+                                ((rc->options & RRDCALC_FLAG_NO_CLEAR_NOTIFICATION)? HEALTH_ENTRY_FLAG_NO_CLEAR_NOTIFICATION : 0) |
+                                ((rc->rrdcalc_flags & RRDCALC_FLAG_SILENCED)? HEALTH_ENTRY_FLAG_SILENCED : 0)
+                        )
+                );
+                ae->last_repeat = rc->last_repeat;
+                if (!(rc->rrdcalc_flags & RRDCALC_FLAG_RUN_ONCE) && rc->status == RRDCALC_STATUS_CLEAR) {
+                    ae->flags |= HEALTH_ENTRY_RUN_ONCE;
+                }
+                rc->rrdcalc_flags |= RRDCALC_FLAG_RUN_ONCE;
+                health_process_notifications(w, host, ae);
+                debug(D_HEALTH, "Notification sent for the repeating alarm %u.", ae->alarm_id);
+                health_alarm_wait_for_execution(w, ae);
+                health_alarm_log_free_one_nochecks_nounlink(ae);
+            }
+        }
 
-                    // --------------------------------------------------------
-                    // decide the final alarm status
+        rrdhost_unlock(host);
+    }
 
-                    RRDCALC_STATUS status = RRDCALC_STATUS_UNDEFINED;
+    return next_run;
+}
 
-                    switch (warning_status) {
-                        case RRDCALC_STATUS_CLEAR:
-                            status = RRDCALC_STATUS_CLEAR;
-                            break;
+static int health_workers_exit = 0;
 
-                        case RRDCALC_STATUS_RAISED:
-                            status = RRDCALC_STATUS_WARNING;
-                            break;
+static void *health_worker_main(void *ptr) {
+    struct health_worker *w = (struct health_worker *)ptr;
 
-                        default:
-                            break;
-                    }
+    while(!netdata_exit && !__atomic_load_n(&health_workers_exit, __ATOMIC_ACQUIRE)) {
+        rrd_rdlock();
+        netdata_mutex_lock(&w->mutex);
 
-                    switch (critical_status) {
-                        case RRDCALC_STATUS_CLEAR:
-                            if (status == RRDCALC_STATUS_UNDEFINED)
-                               status = RRDCALC_STATUS_CLEAR;
-                            break;
+        time_t now = now_realtime_sec();
+        RRDHOST *host = (w->heap_used) ? w->heap[0] : NULL;
 
-                        case RRDCALC_STATUS_RAISED:
-                            status = RRDCALC_STATUS_CRITICAL;
-                            break;
+        if(!host || host->health_next_run > now) {
+            // the run times are in seconds, so when nothing is due we have at least
+            // one second to wait - wake up then, or earlier if a host is added
+            struct timespec ts = { .tv_sec = now + 1, .tv_nsec = 0 };
 
-                        default:
-                            break;
-                    }
+            rrd_unlock();
+            pthread_cond_timedwait(&w->cond, &w->mutex, &ts);
+            netdata_mutex_unlock(&w->mutex);
+            continue;
+        }
 
-                    // --------------------------------------------------------
-                    // check if the new status and the old differ
+        health_heap_remove(w, 0);
+        netdata_mutex_unlock(&w->mutex);
 
-                    if (status != rc->status) {
-                        int delay = 0;
+        // the host cannot be freed while we hold the read lock of the hosts,
+        // so it is safe to use it until we put it back in the heap
+        __atomic_store_n(&host->health_lag_usec, now_realtime_usec() - (usec_t)host->health_next_run * USEC_PER_SEC, __ATOMIC_RELAXED);
 
-                        // apply trigger hysteresis
+        usec_t started = now_monotonic_high_precision_usec();
+        time_t next_run = health_host_evaluate(w, host, now);
+        __atomic_store_n(&host->health_evaluation_usec, now_monotonic_high_precision_usec() - started, __ATOMIC_RELAXED);
 
-                        if (now > rc->delay_up_to_timestamp) {
-                            rc->delay_up_current = rc->delay_up_duration;
-                            rc->delay_down_current = rc->delay_down_duration;
-                            rc->delay_last = 0;
-                            rc->delay_up_to_timestamp = 0;
-                        } else {
-                            rc->delay_up_current = (int) (rc->delay_up_current * rc->delay_multiplier);
-                            if (rc->delay_up_current > rc->delay_max_duration)
-                                rc->delay_up_current = rc->delay_max_duration;
+        // execute notifications
+        // and cleanup
+        if (likely(!netdata_exit))
+            health_alarm_log_process(w, host);
 
-                            rc->delay_down_current = (int) (rc->delay_down_current * rc->delay_multiplier);
-                            if (rc->delay_down_current > rc->delay_max_duration)
-                                rc->delay_down_current = rc->delay_max_duration;
-                        }
+        // wait for all notifications to finish before allowing the host to be freed
+        ALARM_ENTRY *ae;
+        while (NULL != (ae = w->notifications_in_progress.head)) {
+            health_alarm_wait_for_execution(w, ae);
+        }
 
-                        if (status > rc->status)
-                            delay = rc->delay_up_current;
-                        else
-                            delay = rc->delay_down_current;
-
-                        // COMMENTED: because we do need to send raising alarms
-                        // if(now + delay < rc->delay_up_to_timestamp)
-                        //      delay = (int)(rc->delay_up_to_timestamp - now);
-
-                        rc->delay_last = delay;
-                        rc->delay_up_to_timestamp = now + delay;
-
-                        if(likely(!rrdcalc_isrepeating(rc))) {
-                            ALARM_ENTRY *ae = health_create_alarm_entry(
-                                    host, rc->id, rc->next_event_id++, now, rc->name, rc->rrdset->id,
-                                    rc->rrdset->family, rc->exec, rc->recipient, now - rc->last_status_change,
-                                    rc->old_value, rc->value, rc->status, status, rc->source, rc->units, rc->info,
-                                    rc->delay_last,
-                                    (
-                                            ((rc->options & RRDCALC_FLAG_NO_CLEAR_NOTIFICATION)? HEALTH_ENTRY_FLAG_NO_CLEAR_NOTIFICATION : 0) |
-                                            ((rc->rrdcalc_flags & RRDCALC_FLAG_SILENCED)? HEALTH_ENTRY_FLAG_SILENCED : 0)
-                                    )
-                            );
-                            health_alarm_log(host, ae);
-                        }
-                        rc->last_status_change = now;
-                        rc->old_status = rc->status;
-                        rc->status = status;
-                    }
+        debug(D_HEALTH, "Health worker %d evaluated host '%s'. Next evaluation in %d secs", w->id, host->hostname, (int) (next_run - now));
 
-                    rc->last_updated = now;
-                    rc->next_update = now + rc->update_every;
+        netdata_mutex_lock(&w->mutex);
+        host->health_next_run = next_run;
+        health_heap_push(w, host);
+        netdata_mutex_unlock(&w->mutex);
 
-                    if (next_run > rc->next_update)
-                        next_run = rc->next_update;
-                }
+        rrd_unlock();
+    }
 
-                // process repeating alarms
-                RRDCALC *rc;
-                for(rc = host->alarms; rc ; rc = rc->next) {
-                    int repeat_every = 0;
-                    if(unlikely(rrdcalc_isrepeating(rc))) {
-                        if(unlikely(rc->status == RRDCALC_STATUS_WARNING)) {
-                            rc->rrdcalc_flags &= ~RRDCALC_FLAG_RUN_ONCE;
-                            repeat_every = rc->warn_repeat_every;
-                        } else if(unlikely(rc->status == RRDCALC_STATUS_CRITICAL)) {
-                            rc->rrdcalc_flags &= ~RRDCALC_FLAG_RUN_ONCE;
-                            repeat_every = rc->crit_repeat_every;
-                        } else if(unlikely(rc->status == RRDCALC_STATUS_CLEAR)) {
-                            if(!(rc->rrdcalc_flags & RRDCALC_FLAG_RUN_ONCE)) {
-                                if(rc->old_status == RRDCALC_STATUS_CRITICAL) {
-                                    repeat_every = rc->crit_repeat_every;
-                                } else if (rc->old_status == RRDCALC_STATUS_WARNING) {
-                                    repeat_every = rc->warn_repeat_every;
-                                }
-                            }
-                        }
-                    }
+    return NULL;
+}
 
-                    if(unlikely(repeat_every > 0 && (rc->last_repeat + repeat_every) <= now)) {
-                        rc->last_repeat = now;
-                        ALARM_ENTRY *ae = health_create_alarm_entry(
-                                host, rc->id, rc->next_event_id++, now, rc->name, rc->rrdset->id,
-                                rc->rrdset->family, rc->exec, rc->recipient, now - rc->last_status_change,
-                                rc->old_value, rc->value, rc->old_status, rc->status, rc->source, rc->units, rc->info,
-                                rc->delay_last,
-                                (
-                                        ((rc->options & RRDCALC_FLAG_NO_CLEAR_NOTIFICATION)? HEALTH_ENTRY_FLAG_NO_CLEAR_NOTIFICATION : 0) |
-                                        ((rc->rrdcalc_flags & RRDCALC_FLAG_SILENCED)? HEALTH_ENTRY_FLAG_SILENCED : 0)
-                                )
-                        );
-                        ae->last_repeat = rc->last_repeat;
-                        if (!(rc->rrdcalc_flags & RRDCALC_FLAG_RUN_ONCE) && rc->status == RRDCALC_STATUS_CLEAR) {
-                            ae->flags |= HEALTH_ENTRY_RUN_ONCE;
-                        }
-                        rc->rrdcalc_flags |= RRDCALC_FLAG_RUN_ONCE;
-                        health_process_notifications(host, ae);
-                        debug(D_HEALTH, "Notification sent for the repeating alarm %u.", ae->alarm_id);
-                        health_alarm_wait_for_execution(ae);
-                        health_alarm_log_free_one_nochecks_nounlink(ae);
-                    }
-                }
+// must be called with the hosts read locked
+static void health_host_schedule(RRDHOST *host, time_t now) {
+    // pin the host to the worker with the fewest hosts
+    struct health_worker *w = &health_workers[0];
+    int i;
+    for(i = 1; i < health_workers_count; i++) {
+        if(health_workers[i].hosts < w->hosts)
+            w = &health_workers[i];
+    }
 
-                rrdhost_unlock(host);
-            }
+    debug(D_HEALTH, "Health scheduling host '%s' on worker %d.", host->hostname, w->id);
 
-            if (unlikely(netdata_exit))
-                break;
+    netdata_mutex_lock(&w->mutex);
+    host->health_worker = w;
+    host->health_next_run = now;
+    w->hosts++;
+    health_heap_push(w, host);
+    pthread_cond_signal(&w->cond);
+    netdata_mutex_unlock(&w->mutex);
+}
 
-            // execute notifications
-            // and cleanup
-            health_alarm_log_process(host);
+static RRDSET *st_health_evaluation_time = NULL;
+static RRDSET *st_health_lag = NULL;
 
-            if (unlikely(netdata_exit)) {
-                // wait for all notifications to finish before allowing health to be cleaned up
-                ALARM_ENTRY *ae;
-                while (NULL != (ae = alarm_notifications_in_progress.head)) {
-                    health_alarm_wait_for_execution(ae);
-                }
-                break;
-            }
+/**
+ * Health Host Unschedule
+ *
+ * Removes a host from its health worker. It is called while the host is freed,
+ * with the hosts write locked, so no worker is evaluating it.
+ *
+ * @param host the host to remove.
+ */
+void health_host_unschedule(RRDHOST *host) {
+    struct health_worker *w = host->health_worker;
+    if(!w) return;
 
-        } /* rrdhost_foreach */
+    netdata_mutex_lock(&w->mutex);
+    if(health_heap_contains(w, host))
+        health_heap_remove(w, host->health_heap_index);
+    w->hosts--;
+    netdata_mutex_unlock(&w->mutex);
 
-        // wait for all notifications to finish before allowing health to be cleaned up
-        ALARM_ENTRY *ae;
-        while (NULL != (ae = alarm_notifications_in_progress.head)) {
-            health_alarm_wait_for_execution(ae);
+    host->health_worker = NULL;
+
+    if(host != localhost) {
+        if(host->health_rd_evaluation_time)
+            rrddim_is_obsolete(st_health_evaluation_time, host->health_rd_evaluation_time);
+
+        if(host->health_rd_lag)
+            rrddim_is_obsolete(st_health_lag, host->health_rd_lag);
+    }
+
+    host->health_rd_evaluation_time = NULL;
+    host->health_rd_lag = NULL;
+}
+
+// must be called with the hosts read locked
+static void health_update_charts(int update_every) {
+    if(unlikely(!st_health_evaluation_time)) {
+        st_health_evaluation_time = rrdset_create_localhost(
+                "netdata"
+                , "health_evaluation_time"
+                , NULL
+                , "health"
+                , NULL
+                , "Health Alarms Evaluation Time per Host"
+                , "milliseconds"
+                , "netdata"
+                , "stats"
+                , 131500
+                , update_every
+                , RRDSET_TYPE_LINE
+        );
+    }
+    else
+        rrdset_next(st_health_evaluation_time);
+
+    if(unlikely(!st_health_lag)) {
+        st_health_lag = rrdset_create_localhost(
+                "netdata"
+                , "health_lag"
+                , NULL
+                , "health"
+                , NULL
+                , "Health Alarms Evaluation Lag per Host"
+                , "milliseconds"
+                , "netdata"
+                , "stats"
+                , 131501
+                , update_every
+                , RRDSET_TYPE_LINE
+        );
+    }
+    else
+        rrdset_next(st_health_lag);
+
+    RRDHOST *host;
+    rrdhost_foreach_read(host) {
+        if(unlikely(!host->health_worker))
+            continue;
+
+        if(unlikely(!host->health_rd_evaluation_time)) {
+            host->health_rd_evaluation_time = rrddim_add(st_health_evaluation_time, host->machine_guid, host->hostname, 1, 1000, RRD_ALGORITHM_ABSOLUTE);
+            rrddim_isnot_obsolete(st_health_evaluation_time, host->health_rd_evaluation_time);
         }
 
-        rrd_unlock();
+        if(unlikely(!host->health_rd_lag)) {
+            host->health_rd_lag = rrddim_add(st_health_lag, host->machine_guid, host->hostname, 1, 1000, RRD_ALGORITHM_ABSOLUTE);
+            rrddim_isnot_obsolete(st_health_lag, host->health_rd_lag);
+        }
 
+        rrddim_set_by_pointer(st_health_evaluation_time, host->health_rd_evaluation_time, (collected_number)__atomic_load_n(&host->health_evaluation_usec, __ATOMIC_RELAXED));
+        rrddim_set_by_pointer(st_health_lag, host->health_rd_lag, (collected_number)__atomic_load_n(&host->health_lag_usec, __ATOMIC_RELAXED));
+    }
+
+    rrdset_done(st_health_evaluation_time);
+    rrdset_done(st_health_lag);
+}
+
+static void health_main_cleanup(void *ptr) {
+    struct netdata_static_thread *static_thread = (struct netdata_static_thread *)ptr;
+    static_thread->enabled = NETDATA_MAIN_THREAD_EXITING;
+
+    info("cleaning up...");
 
+    // the workers finish the host they evaluate and wait for its notifications,
+    // so they are not cancelled - they are asked to exit and we wait for them.
+    // The workers are not freed, the hosts still point to them.
+    __atomic_store_n(&health_workers_exit, 1, __ATOMIC_RELEASE);
+
+    int i;
+    for(i = 0; i < health_workers_count; i++) {
+        info("HEALTH: waiting for worker thread %d to finish...", i + 1);
+        netdata_thread_join(health_workers[i].thread, NULL);
+    }
+
+    static_thread->enabled = NETDATA_MAIN_THREAD_EXITED;
+}
+
+/**
+ * Health Main
+ *
+ * The main thread of the health system. It starts the worker threads that evaluate the alarms,
+ * pins the hosts to them, postpones the alarms after hibernation and updates the health charts.
+ *
+ * @param ptr is a pointer to the netdata_static_thread structure.
+ *
+ * @return It always returns NULL
+ */
+void *health_main(void *ptr) {
+    netdata_thread_cleanup_push(health_main_cleanup, ptr);
+
+    int min_run_every = (int)config_get_number(CONFIG_SECTION_HEALTH, "run at least every seconds", 10);
+    if(min_run_every < 1) min_run_every = 1;
+    health_min_run_every = min_run_every;
+
+    time_t hibernation_delay  = config_get_number(CONFIG_SECTION_HEALTH, "postpone alarms during hibernation for seconds", 60);
+
+    int workers = (int)config_get_number(CONFIG_SECTION_HEALTH, "worker threads", 1);
+    if(workers < 1) workers = 1;
+
+    rrdcalc_labels_unlink();
+
+    health_workers = callocz((size_t)workers, sizeof(struct health_worker));
+
+    int i;
+    for(i = 0; i < workers; i++) {
+        struct health_worker *w = &health_workers[i];
+        w->id = i + 1;
+        netdata_mutex_init(&w->mutex);
+        pthread_cond_init(&w->cond, NULL);
+
+        char tag[NETDATA_THREAD_TAG_MAX + 1];
+        snprintfz(tag, NETDATA_THREAD_TAG_MAX, "HEALTH[%d]", i + 1);
+        if(netdata_thread_create(&w->thread, tag, NETDATA_THREAD_OPTION_JOINABLE, health_worker_main, w) != 0)
+            break;
+
+        health_workers_count++;
+    }
+
+    if(unlikely(!health_workers_count))
+        fatal("HEALTH: cannot start any health worker thread");
+
+    info("HEALTH: evaluating alarms with %d worker threads", health_workers_count);
+
+    int update_every = localhost->rrd_update_every;
+    heartbeat_t hb;
+    heartbeat_init(&hb);
+    while(!netdata_exit) {
+        heartbeat_next(&hb, update_every * USEC_PER_SEC);
         if(unlikely(netdata_exit))
             break;
 
-        now = now_realtime_sec();
-        if(now < next_run) {
-            debug(D_HEALTH, "Health monitoring iteration no %u done. Next iteration in %d secs", loop, (int) (next_run - now));
-            sleep_usec(USEC_PER_SEC * (usec_t) (next_run - now));
-            now = now_realtime_sec();
+        time_t now = now_realtime_sec();
+        int apply_hibernation_delay = 0;
+
+        if (unlikely(check_if_resumed_from_suspention())) {
+            apply_hibernation_delay = 1;
+
+            info("Postponing alarm checks for %ld seconds, because it seems that the system was just resumed from suspension.",
+                 hibernation_delay
+            );
+        }
+
+        if (unlikely(silencers->all_alarms && silencers->stype == STYPE_DISABLE_ALARMS)) {
+            static int logged=0;
+            if (!logged) {
+                info("Skipping health checks, because all alarms are disabled via a %s command.",
+                     HEALTH_CMDAPI_CMD_DISABLEALL);
+                logged = 1;
+            }
         }
-        else
-            debug(D_HEALTH, "Health monitoring iteration no %u done. Next iteration now", loop);
+
+        size_t hosts = 0;
+
+        rrd_rdlock();
+
+        RRDHOST *host;
+        rrdhost_foreach_read(host) {
+            if (unlikely(!host->health_enabled))
+                continue;
+
+            if (unlikely(apply_hibernation_delay)) {
+
+                info("Postponing health checks for %ld seconds, on host '%s'.", hibernation_delay, host->hostname
+                );
+
+                __atomic_store_n(&host->health_delay_up_to, now + hibernation_delay, __ATOMIC_RELEASE);
+            }
+
+            if (unlikely(!host->health_worker))
+                health_host_schedule(host, now);
+
+            hosts++;
+        }
+
+        if (likely(hosts))
+            health_update_charts(update_every);
+
+        rrd_unlock();
 
     } // forever
 
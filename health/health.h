@@ -59,8 +59,9 @@ extern void health_init(void);
 extern void *health_main(void *ptr);
 
 extern void health_reload(void);
+extern void health_host_unschedule(RRDHOST *host);
 
-extern int health_variable_lookup(const char *variable, uint32_t hash, RRDCALC *rc, calculated_number *result);
+extern RRDVAR *health_variable_bind(const char *variable, uint32_t hash, RRDCALC *rc);
 extern void health_aggregate_alarms(RRDHOST *host, BUFFER *wb, BUFFER* context, RRDCALC_STATUS status);
 extern void health_alarms2json(RRDHOST *host, BUFFER *wb, int all);
 extern void health_alarms_values2json(RRDHOST *host, BUFFER *wb, int all);
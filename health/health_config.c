@@ -843,10 +843,10 @@ static int health_readfile(const char *filename, void *data) {
                         error("Health configuration at line %zu of file '%s' for template '%s' has key '%s' twice, once with value '%s' and later with value '%s'. Using ('%s').",
                                 line, filename, rt->name, key, rt->context, value, value);
 
-                    freez(rt->context);
+                    string_freez(rt->context);
                 }
-                rt->context = strdupz(value);
-                rt->hash_context = simple_hash(rt->context);
+                rt->context = (char *)string_strdupz(value);
+                rt->hash_context = string_hash(rt->context);
             }
             else if(hash == hash_families && !strcasecmp(key, HEALTH_FAMILIES_KEY)) {
                 freez(rt->family_match);
@@ -267,14 +267,15 @@ void health_aggregate_alarms(RRDHOST *host, BUFFER *wb, BUFFER* contexts, RRDCAL
         while(p && *p && (tok = mystrsep(&p, ", |"))) {
             if(!*tok) continue;
 
+            const char *context = string_strdupz(tok);
             for(rc = host->alarms; rc ; rc = rc->next) {
                 if(unlikely(!rc->rrdset || !rc->rrdset->last_collected_time.tv_sec))
                     continue;
-                if(unlikely(rc->rrdset && rc->rrdset->hash_context == simple_hash(tok)
-                            && !strcmp(rc->rrdset->context, tok)
+                if(unlikely(rc->rrdset && rc->rrdset->context == context
                             && ((status==RRDCALC_STATUS_RAISED)?(rc->status >= RRDCALC_STATUS_WARNING):rc->status == status)))
                     numberOfAlarms++;
             }
+            string_freez(context);
         }
     }
     else {
@@ -70,6 +70,121 @@ static inline NAME_VALUE *dictionary_name_value_index_find_nolock(DICTIONARY *di
     return (NAME_VALUE *)avl_search(&(dict->values_index), (avl *) &tmp);
 }
 
+// ----------------------------------------------------------------------------
+// hash table index
+//
+// open addressing with linear probing. Deleted entries leave a tombstone
+// behind, so that probing goes on past them.
+// The table is replaced by a new one when it gets 3/4 full.
+
+#define DICTIONARY_HASH_TABLE_MIN_SIZE 16
+
+static NAME_VALUE dictionary_deleted_slot;
+#define DICTIONARY_SLOT_DELETED (&dictionary_deleted_slot)
+
+struct dictionary_hash_table {
+    size_t size;                    // a power of 2
+    size_t used;                    // the slots with entries and tombstones
+    size_t entries;
+    NAME_VALUE **slots;
+};
+
+static struct dictionary_hash_table *dictionary_hash_table_create(size_t size) {
+    struct dictionary_hash_table *t = callocz(1, sizeof(struct dictionary_hash_table) + size * sizeof(NAME_VALUE *));
+    t->size = size;
+    t->slots = (NAME_VALUE **)(t + 1);
+    return t;
+}
+
+static inline NAME_VALUE *dictionary_hash_table_find_nolock(DICTIONARY *dict, const char *name, uint32_t hash, size_t *slot) {
+    struct dictionary_hash_table *t = dict->hash_table;
+    if(unlikely(!t)) return NULL;
+
+    NETDATA_DICTIONARY_STATS_SEARCHES_PLUS1(dict);
+
+    size_t mask = t->size - 1, i;
+    for(i = hash & mask; ; i = (i + 1) & mask) {
+        NAME_VALUE *nv = t->slots[i];
+
+        if(!nv)
+            return NULL;
+
+        if(nv != DICTIONARY_SLOT_DELETED && nv->hash == hash && !strcmp(nv->name, name)) {
+            if(slot) *slot = i;
+            return nv;
+        }
+    }
+}
+
+// must be called with the dictionary write locked
+static void dictionary_hash_table_resize_nolock(DICTIONARY *dict) {
+    struct dictionary_hash_table *old = dict->hash_table;
+
+    size_t size = DICTIONARY_HASH_TABLE_MIN_SIZE;
+    while(old && size < (old->entries + 1) * 2)
+        size <<= 1;
+
+    struct dictionary_hash_table *t = dictionary_hash_table_create(size);
+
+    NAME_VALUE *nv;
+    for(nv = dict->first; nv ; nv = nv->list.next) {
+        size_t i;
+        for(i = nv->hash & (size - 1); t->slots[i] ; i = (i + 1) & (size - 1)) ;
+        t->slots[i] = nv;
+        t->used++;
+        t->entries++;
+    }
+
+    dict->hash_table = t;
+    freez(old);
+}
+
+// must be called with the dictionary write locked
+static void dictionary_hash_table_insert_nolock(DICTIONARY *dict, NAME_VALUE *nv) {
+    struct dictionary_hash_table *t = dict->hash_table;
+
+    if(unlikely(!t || (t->used + 1) * 4 > t->size * 3)) {
+        dictionary_hash_table_resize_nolock(dict);
+        t = dict->hash_table;
+    }
+
+    // the entry is not in the table, so the first free slot is the right one
+    size_t mask = t->size - 1, i;
+    for(i = nv->hash & mask; t->slots[i] && t->slots[i] != DICTIONARY_SLOT_DELETED ; i = (i + 1) & mask) ;
+
+    if(!t->slots[i])
+        t->used++;
+
+    t->entries++;
+
+    t->slots[i] = nv;
+
+    // link it at the end of the list
+    nv->list.next = NULL;
+    nv->list.prev = dict->last;
+    if(dict->last)
+        dict->last->list.next = nv;
+    else
+        dict->first = nv;
+    dict->last = nv;
+}
+
+// must be called with the dictionary write locked
+static void dictionary_hash_table_delete_nolock(DICTIONARY *dict, NAME_VALUE *nv, size_t slot) {
+    dict->hash_table->slots[slot] = DICTIONARY_SLOT_DELETED;
+    dict->hash_table->entries--;
+
+    if(nv->list.prev)
+        nv->list.prev->list.next = nv->list.next;
+    else
+        dict->first = nv->list.next;
+
+    if(nv->list.next)
+        nv->list.next->list.prev = nv->list.prev;
+    else
+        dict->last = nv->list.prev;
+}
+
 // ----------------------------------------------------------------------------
 // internal methods
 
@@ -95,7 +210,9 @@ static NAME_VALUE *dictionary_name_value_create_nolock(DICTIONARY *dict, const c
 
     // index it
     NETDATA_DICTIONARY_STATS_INSERTS_PLUS1(dict);
-    if(unlikely(avl_insert(&((dict)->values_index), (avl *)(nv)) != (avl *)nv))
+    if(dict->flags & DICTIONARY_FLAG_HASH_TABLE)
+        dictionary_hash_table_insert_nolock(dict, nv);
+    else if(unlikely(avl_insert(&((dict)->values_index), (avl *)(nv)) != (avl *)nv))
         error("dictionary: INTERNAL ERROR: duplicate insertion to dictionary.");
 
     NETDATA_DICTIONARY_STATS_ENTRIES_PLUS1(dict);
@@ -103,15 +220,7 @@ static NAME_VALUE *dictionary_name_value_create_nolock(DICTIONARY *dict, const c
     return nv;
 }
 
-static void dictionary_name_value_destroy_nolock(DICTIONARY *dict, NAME_VALUE *nv) {
-    debug(D_DICTIONARY, "Destroying name value entry for name '%s'.", nv->name);
-
-    NETDATA_DICTIONARY_STATS_DELETES_PLUS1(dict);
-    if(unlikely(avl_remove(&(dict->values_index), (avl *)(nv)) != (avl *)nv))
-        error("dictionary: INTERNAL ERROR: dictionary invalid removal of node.");
-
-    NETDATA_DICTIONARY_STATS_ENTRIES_MINUS1(dict);
-
+static void dictionary_name_value_free_nolock(DICTIONARY *dict, NAME_VALUE *nv) {
     if(!(dict->flags & DICTIONARY_FLAG_VALUE_LINK_DONT_CLONE)) {
         debug(D_REGISTRY, "Dictionary freeing value of '%s'", nv->name);
         freez(nv->value);
@@ -125,6 +234,28 @@ static void dictionary_name_value_destroy_nolock(DICTIONARY *dict, NAME_VALUE *n
     freez(nv);
 }
 
+static void dictionary_name_value_destroy_nolock(DICTIONARY *dict, NAME_VALUE *nv, size_t slot) {
+    debug(D_DICTIONARY, "Destroying name value entry for name '%s'.", nv->name);
+
+    NETDATA_DICTIONARY_STATS_DELETES_PLUS1(dict);
+
+    if(dict->flags & DICTIONARY_FLAG_HASH_TABLE)
+        dictionary_hash_table_delete_nolock(dict, nv, slot);
+    else if(unlikely(avl_remove(&(dict->values_index), (avl *)(nv)) != (avl *)nv))
+        error("dictionary: INTERNAL ERROR: dictionary invalid removal of node.");
+
+    NETDATA_DICTIONARY_STATS_ENTRIES_MINUS1(dict);
+
+    dictionary_name_value_free_nolock(dict, nv);
+}
+
+static inline NAME_VALUE *dictionary_name_value_find_nolock(DICTIONARY *dict, const char *name, uint32_t hash, size_t *slot) {
+    if(dict->flags & DICTIONARY_FLAG_HASH_TABLE)
+        return dictionary_hash_table_find_nolock(dict, name, (hash)?hash:simple_hash(name), slot);
+
+    return dictionary_name_value_index_find_nolock(dict, name, hash);
+}
+
 // ----------------------------------------------------------------------------
 // API - basic methods
 
@@ -152,8 +283,21 @@ void dictionary_destroy(DICTIONARY *dict) {
 
     dictionary_write_lock(dict);
 
-    while(dict->values_index.root)
-        dictionary_name_value_destroy_nolock(dict, (NAME_VALUE *)dict->values_index.root);
+    if(dict->flags & DICTIONARY_FLAG_HASH_TABLE) {
+        while(dict->first) {
+            NAME_VALUE *nv = dict->first;
+            dict->first = nv->list.next;
+            dictionary_name_value_free_nolock(dict, nv);
+        }
+        dict->last = NULL;
+
+        freez(dict->hash_table);
+        dict->hash_table = NULL;
+    }
+    else {
+        while(dict->values_index.root)
+            dictionary_name_value_destroy_nolock(dict, (NAME_VALUE *)dict->values_index.root, 0);
+    }
 
     dictionary_unlock(dict);
 
@@ -177,7 +321,7 @@ void *dictionary_set(DICTIONARY *dict, const char *name, void *value, size_t val
 
     dictionary_write_lock(dict);
 
-    NAME_VALUE *nv = dictionary_name_value_index_find_nolock(dict, name, hash);
+    NAME_VALUE *nv = dictionary_name_value_find_nolock(dict, name, hash, NULL);
     if(unlikely(!nv)) {
         debug(D_DICTIONARY, "Dictionary entry with name '%s' not found. Creating a new one.", name);
 
@@ -208,16 +352,21 @@ void *dictionary_set(DICTIONARY *dict, const char *name, void *value, size_t val
         }
     }
 
+    void *ret = nv->value;
+
     dictionary_unlock(dict);
 
-    return nv->value;
+    return ret;
 }
 
 void *dictionary_get(DICTIONARY *dict, const char *name) {
     debug(D_DICTIONARY, "GET dictionary entry with name '%s'.", name);
 
+    void *value = NULL;
+
     dictionary_read_lock(dict);
-    NAME_VALUE *nv = dictionary_name_value_index_find_nolock(dict, name, 0);
+    NAME_VALUE *nv = dictionary_name_value_find_nolock(dict, name, 0, NULL);
+    if(likely(nv)) value = nv->value;
     dictionary_unlock(dict);
 
     if(unlikely(!nv)) {
@@ -226,7 +375,7 @@ void *dictionary_get(DICTIONARY *dict, const char *name) {
     }
 
     debug(D_DICTIONARY, "Found dictionary entry with name '%s'.", name);
-    return nv->value;
+    return value;
 }
 
 int dictionary_del(DICTIONARY *dict, const char *name) {
@@ -236,14 +385,15 @@ int dictionary_del(DICTIONARY *dict, const char *name) {
 
     dictionary_write_lock(dict);
 
-    NAME_VALUE *nv = dictionary_name_value_index_find_nolock(dict, name, 0);
+    size_t slot = 0;
+    NAME_VALUE *nv = dictionary_name_value_find_nolock(dict, name, 0, &slot);
     if(unlikely(!nv)) {
         debug(D_DICTIONARY, "Not found dictionary entry with name '%s'.", name);
         ret = -1;
     }
     else {
         debug(D_DICTIONARY, "Found dictionary entry with name '%s'.", name);
-        dictionary_name_value_destroy_nolock(dict, nv);
+        dictionary_name_value_destroy_nolock(dict, nv, slot);
         ret = 0;
     }
 
@@ -257,6 +407,8 @@ int dictionary_del(DICTIONARY *dict, const char *name) {
 // API - walk through the dictionary
 // the dictionary is locked for reading while this happens
 // do not user other dictionary calls while walking the dictionary - deadlock!
+//
+// hash table dictionaries are walked in insertion order
 
 static int dictionary_walker(avl *a, int (*callback)(void *entry, void *data), void *data) {
     int total = 0, ret = 0;
@@ -280,9 +432,34 @@ static int dictionary_walker(avl *a, int (*callback)(void *entry, void *data), v
     return total;
 }
 
+static int dictionary_walker_list(DICTIONARY *dict, int (*callback)(char *name, void *entry, void *data), int (*callback_value)(void *entry, void *data), void *data) {
+    int total = 0, ret = 0;
+
+    dictionary_read_lock(dict);
+
+    NAME_VALUE *nv;
+    for(nv = dict->first; nv ; nv = nv->list.next) {
+        if(callback) ret = callback(nv->name, nv->value, data);
+        else ret = callback_value(nv->value, data);
+
+        if(ret < 0) {
+            total = ret;
+            break;
+        }
+        total += ret;
+    }
+
+    dictionary_unlock(dict);
+
+    return total;
+}
+
 int dictionary_get_all(DICTIONARY *dict, int (*callback)(void *entry, void *data), void *data) {
     int ret = 0;
 
+    if(dict->flags & DICTIONARY_FLAG_HASH_TABLE)
+        return dictionary_walker_list(dict, NULL, callback, data);
+
     dictionary_read_lock(dict);
 
     if(likely(dict->values_index.root))
@@ -318,6 +495,9 @@ static int dictionary_walker_name_value(avl *a, int (*callback)(char *name, void
 int dictionary_get_all_name_value(DICTIONARY *dict, int (*callback)(char *name, void *entry, void *data), void *data) {
     int ret = 0;
 
+    if(dict->flags & DICTIONARY_FLAG_HASH_TABLE)
+        return dictionary_walker_list(dict, callback, NULL, data);
+
     dictionary_read_lock(dict);
 
     if(likely(dict->values_index.root))
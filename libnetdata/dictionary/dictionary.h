@@ -13,7 +13,14 @@ struct dictionary_stats {
 };
 
 typedef struct name_value {
-    avl avl_node;           // the index - this has to be first!
+    union {
+        avl avl_node;       // the index, with the AVL backend - this has to be first!
+
+        struct {
+            struct name_value *next;
+            struct name_value *prev;
+        } list;             // the insertion order, with the hash table backend
+    };
 
     uint32_t hash;          // a simple hash to speed up searching
                             // we first compare hashes, and only if the hashes are equal we do string comparisons
@@ -22,6 +29,8 @@ typedef struct name_value {
     void *value;
 } NAME_VALUE;
 
+struct dictionary_hash_table;
+
 typedef struct dictionary {
     avl_tree_type values_index;
 
@@ -29,6 +38,10 @@ typedef struct dictionary {
 
     struct dictionary_stats *stats;
     netdata_rwlock_t *rwlock;
+
+    struct dictionary_hash_table *hash_table;
+    NAME_VALUE *first;              // the entries of the hash table, in insertion order
+    NAME_VALUE *last;
 } DICTIONARY;
 
 #define DICTIONARY_FLAG_DEFAULT                 0x00000000
@@ -36,6 +49,7 @@ typedef struct dictionary {
 #define DICTIONARY_FLAG_VALUE_LINK_DONT_CLONE   0x00000002
 #define DICTIONARY_FLAG_NAME_LINK_DONT_CLONE    0x00000004
 #define DICTIONARY_FLAG_WITH_STATISTICS         0x00000008
+#define DICTIONARY_FLAG_HASH_TABLE              0x00000010 // index with a hash table, walk in insertion order
 
 extern DICTIONARY *dictionary_create(uint8_t flags);
 extern void dictionary_destroy(DICTIONARY *dict);
@@ -48,160 +48,230 @@ typedef struct eval_node {
 #define EVAL_OPERATOR_ABS                   'A'
 #define EVAL_OPERATOR_IF_THEN_ELSE          '?'
 
+// these are used for EVAL_INSTRUCTION.opcode
+// the expression tree is compiled to a flat program for a stack machine
+// (i.e. the operators follow their operands), so that the evaluation
+// does not walk the tree and does not search for variables
+typedef enum eval_opcode {
+    EVAL_OPCODE_NONE = 0,               // the operator does not need an instruction (e.g. parenthesis)
+    EVAL_OPCODE_PUSH_NUMBER,            // push a constant
+    EVAL_OPCODE_PUSH_VARIABLE,          // push the value of a variable
+    EVAL_OPCODE_NOT,
+    EVAL_OPCODE_SIGN_MINUS,
+    EVAL_OPCODE_ABS,
+    EVAL_OPCODE_BOOLEAN,                // convert the top of the stack to 0 or 1
+    EVAL_OPCODE_GREATER_THAN_OR_EQUAL,
+    EVAL_OPCODE_LESS_THAN_OR_EQUAL,
+    EVAL_OPCODE_NOT_EQUAL,
+    EVAL_OPCODE_EQUAL,
+    EVAL_OPCODE_LESS,
+    EVAL_OPCODE_GREATER,
+    EVAL_OPCODE_PLUS,
+    EVAL_OPCODE_MINUS,
+    EVAL_OPCODE_MULTIPLY,
+    EVAL_OPCODE_DIVIDE,
+    EVAL_OPCODE_JUMP_IF_FALSE_OR_PUSH,  // && - if the top is false, replace it with 0 and jump, otherwise pop it
+    EVAL_OPCODE_JUMP_IF_TRUE_OR_PUSH,   // || - if the top is true, replace it with 1 and jump, otherwise pop it
+    EVAL_OPCODE_JUMP_IF_FALSE,          // pop the top and jump if it is false
+    EVAL_OPCODE_JUMP
+} EVAL_OPCODE;
+
+typedef struct eval_instruction {
+    EVAL_OPCODE opcode;
+
+    union {
+        calculated_number number;       // EVAL_OPCODE_PUSH_NUMBER
+        size_t variable;                // EVAL_OPCODE_PUSH_VARIABLE, the slot of the variable
+        size_t jump;                    // EVAL_OPCODE_JUMP_*, the instruction to continue from
+    };
+} EVAL_INSTRUCTION;
+
+// the variables provided by the expression itself
+typedef enum eval_builtin {
+    EVAL_BUILTIN_NONE = 0,              // a variable of the charts, families or hosts
+    EVAL_BUILTIN_THIS,
+    EVAL_BUILTIN_AFTER,
+    EVAL_BUILTIN_BEFORE,
+    EVAL_BUILTIN_NOW,
+    EVAL_BUILTIN_STATUS,
+    EVAL_BUILTIN_REMOVED,
+    EVAL_BUILTIN_UNINITIALIZED,
+    EVAL_BUILTIN_UNDEFINED,
+    EVAL_BUILTIN_CLEAR,
+    EVAL_BUILTIN_WARNING,
+    EVAL_BUILTIN_CRITICAL
+} EVAL_BUILTIN;
+
+static struct {
+    const char *name;
+    EVAL_BUILTIN builtin;
+} eval_builtins[] = {
+        { "this",          EVAL_BUILTIN_THIS          },
+        { "after",         EVAL_BUILTIN_AFTER         },
+        { "before",        EVAL_BUILTIN_BEFORE        },
+        { "now",           EVAL_BUILTIN_NOW           },
+        { "status",        EVAL_BUILTIN_STATUS        },
+        { "REMOVED",       EVAL_BUILTIN_REMOVED       },
+        { "UNINITIALIZED", EVAL_BUILTIN_UNINITIALIZED },
+        { "UNDEFINED",     EVAL_BUILTIN_UNDEFINED     },
+        { "CLEAR",         EVAL_BUILTIN_CLEAR         },
+        { "WARNING",       EVAL_BUILTIN_WARNING       },
+        { "CRITICAL",      EVAL_BUILTIN_CRITICAL      },
+
+        // terminator
+        { NULL,            EVAL_BUILTIN_NONE          }
+};
+
+typedef enum eval_binding {
+    EVAL_BINDING_UNBOUND = 0,           // the variable has to be looked up
+    EVAL_BINDING_BOUND,                 // the variable is the RRDVAR found
+    EVAL_BINDING_NOT_FOUND              // the variable was looked up, but it does not exist
+} EVAL_BINDING;
+
+// each variable used by an expression gets a slot, no matter how many times it appears in it
+typedef struct eval_variable_slot {
+    char *name;
+    uint32_t hash;
+
+    EVAL_BUILTIN builtin;
+    EVAL_BINDING binding;
+    struct rrdvar *rrdvar;
+} EVAL_VARIABLE_SLOT;
+
+// the values of the variables used by the last evaluation, in the order they were used
+// the error message of the expression is generated from these, only when it is needed
+typedef struct eval_trace {
+    size_t variable;
+    int found;
+    calculated_number value;
+} EVAL_TRACE;
+
+typedef struct eval_program {
+    EVAL_INSTRUCTION *instructions;
+    size_t instructions_used;
+    size_t instructions_size;
+
+    EVAL_VARIABLE_SLOT *variables;
+    size_t variables_used;
+
+    // there are no loops, so every variable instruction is executed at most once
+    EVAL_TRACE *trace;
+    size_t trace_used;
+    size_t trace_size;
+    int error_msg_generated;
+
+    int depth;                          // the depth of the stack, while compiling
+    int stack_size;                     // the max depth of the stack
+    calculated_number *stack;
+} EVAL_PROGRAM;
+
 // ----------------------------------------------------------------------------
 // forward function definitions
 
 static inline void eval_node_free(EVAL_NODE *op);
 static inline EVAL_NODE *parse_full_expression(const char **string, int *error);
 static inline EVAL_NODE *parse_one_full_operand(const char **string, int *error);
-static inline calculated_number eval_node(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error);
 static inline void print_parsed_as_node(BUFFER *out, EVAL_NODE *op, int *error);
 static inline void print_parsed_as_constant(BUFFER *out, calculated_number n);
 
 // ----------------------------------------------------------------------------
 // evaluation of expressions
 
-static inline calculated_number eval_variable(EVAL_EXPRESSION *exp, EVAL_VARIABLE *v, int *error) {
-    static uint32_t this_hash = 0, now_hash = 0, after_hash = 0, before_hash = 0, status_hash = 0, removed_hash = 0, uninitialized_hash = 0, undefined_hash = 0, clear_hash = 0, warning_hash = 0, critical_hash = 0;
-    calculated_number n;
-
-    if(unlikely(this_hash == 0)) {
-        this_hash = simple_hash("this");
-        now_hash = simple_hash("now");
-        after_hash = simple_hash("after");
-        before_hash = simple_hash("before");
-        status_hash = simple_hash("status");
-        removed_hash = simple_hash("REMOVED");
-        uninitialized_hash = simple_hash("UNINITIALIZED");
-        undefined_hash = simple_hash("UNDEFINED");
-        clear_hash = simple_hash("CLEAR");
-        warning_hash = simple_hash("WARNING");
-        critical_hash = simple_hash("CRITICAL");
-    }
+static inline calculated_number eval_builtin(EVAL_EXPRESSION *exp, EVAL_BUILTIN builtin) {
+    switch(builtin) {
+        case EVAL_BUILTIN_THIS:
+            return (exp->myself)?*exp->myself:NAN;
 
-    if(unlikely(v->hash == this_hash && !strcmp(v->name, "this"))) {
-        n = (exp->myself)?*exp->myself:NAN;
-        buffer_strcat(exp->error_msg, "[ $this = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_AFTER:
+            return (exp->after && *exp->after)?*exp->after:NAN;
 
-    if(unlikely(v->hash == after_hash && !strcmp(v->name, "after"))) {
-        n = (exp->after && *exp->after)?*exp->after:NAN;
-        buffer_strcat(exp->error_msg, "[ $after = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_BEFORE:
+            return (exp->before && *exp->before)?*exp->before:NAN;
 
-    if(unlikely(v->hash == before_hash && !strcmp(v->name, "before"))) {
-        n = (exp->before && *exp->before)?*exp->before:NAN;
-        buffer_strcat(exp->error_msg, "[ $before = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_NOW:
+            return now_realtime_sec();
 
-    if(unlikely(v->hash == now_hash && !strcmp(v->name, "now"))) {
-        n = now_realtime_sec();
-        buffer_strcat(exp->error_msg, "[ $now = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_STATUS:
+            return (exp->status)?*exp->status:RRDCALC_STATUS_UNINITIALIZED;
 
-    if(unlikely(v->hash == status_hash && !strcmp(v->name, "status"))) {
-        n = (exp->status)?*exp->status:RRDCALC_STATUS_UNINITIALIZED;
-        buffer_strcat(exp->error_msg, "[ $status = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_REMOVED:
+            return RRDCALC_STATUS_REMOVED;
 
-    if(unlikely(v->hash == removed_hash && !strcmp(v->name, "REMOVED"))) {
-        n = RRDCALC_STATUS_REMOVED;
-        buffer_strcat(exp->error_msg, "[ $REMOVED = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_UNINITIALIZED:
+            return RRDCALC_STATUS_UNINITIALIZED;
 
-    if(unlikely(v->hash == uninitialized_hash && !strcmp(v->name, "UNINITIALIZED"))) {
-        n = RRDCALC_STATUS_UNINITIALIZED;
-        buffer_strcat(exp->error_msg, "[ $UNINITIALIZED = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_UNDEFINED:
+            return RRDCALC_STATUS_UNDEFINED;
 
-    if(unlikely(v->hash == undefined_hash && !strcmp(v->name, "UNDEFINED"))) {
-        n = RRDCALC_STATUS_UNDEFINED;
-        buffer_strcat(exp->error_msg, "[ $UNDEFINED = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_CLEAR:
+            return RRDCALC_STATUS_CLEAR;
 
-    if(unlikely(v->hash == clear_hash && !strcmp(v->name, "CLEAR"))) {
-        n = RRDCALC_STATUS_CLEAR;
-        buffer_strcat(exp->error_msg, "[ $CLEAR = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
+        case EVAL_BUILTIN_WARNING:
+            return RRDCALC_STATUS_WARNING;
 
-    if(unlikely(v->hash == warning_hash && !strcmp(v->name, "WARNING"))) {
-        n = RRDCALC_STATUS_WARNING;
-        buffer_strcat(exp->error_msg, "[ $WARNING = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
+        case EVAL_BUILTIN_CRITICAL:
+            return RRDCALC_STATUS_CRITICAL;
+
+        default:
+            return NAN;
     }
+}
+
+static inline calculated_number eval_variable(EVAL_EXPRESSION *exp, EVAL_PROGRAM *p, size_t variable, int *error) {
+    EVAL_VARIABLE_SLOT *v = &p->variables[variable];
+    EVAL_TRACE *t = &p->trace[p->trace_used++];
+    t->variable = variable;
+    t->found = 1;
 
-    if(unlikely(v->hash == critical_hash && !strcmp(v->name, "CRITICAL"))) {
-        n = RRDCALC_STATUS_CRITICAL;
-        buffer_strcat(exp->error_msg, "[ $CRITICAL = ");
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
-    }
-
-    if(exp->rrdcalc && health_variable_lookup(v->name, v->hash, exp->rrdcalc, &n)) {
-        buffer_sprintf(exp->error_msg, "[ ${%s} = ", v->name);
-        print_parsed_as_constant(exp->error_msg, n);
-        buffer_strcat(exp->error_msg, " ] ");
-        return n;
+    if(unlikely(v->builtin != EVAL_BUILTIN_NONE))
+        return t->value = eval_builtin(exp, v->builtin);
+
+    // the lookup is done only the first time the variable is needed,
+    // and again after expression_unbind_variables()
+    if(unlikely(v->binding == EVAL_BINDING_UNBOUND)) {
+        v->rrdvar = (exp->rrdcalc)?health_variable_bind(v->name, v->hash, exp->rrdcalc):NULL;
+        v->binding = (v->rrdvar)?EVAL_BINDING_BOUND:EVAL_BINDING_NOT_FOUND;
     }
 
+    if(likely(v->binding == EVAL_BINDING_BOUND))
+        return t->value = rrdvar2number(v->rrdvar);
+
     *error = EVAL_ERROR_UNKNOWN_VARIABLE;
-    buffer_sprintf(exp->error_msg, "[ undefined variable '%s' ] ", v->name);
-    return NAN;
+    t->found = 0;
+    return t->value = NAN;
 }
 
-static inline calculated_number eval_value(EVAL_EXPRESSION *exp, EVAL_VALUE *v, int *error) {
-    calculated_number n;
+static inline void eval_error_msg_generate(EVAL_EXPRESSION *exp, EVAL_PROGRAM *p) {
+    BUFFER *wb = exp->error_msg;
+    buffer_reset(wb);
 
-    switch(v->type) {
-        case EVAL_VALUE_EXPRESSION:
-            n = eval_node(exp, v->expression, error);
-            break;
+    size_t i;
+    for(i = 0; i < p->trace_used ;i++) {
+        EVAL_TRACE *t = &p->trace[i];
+        EVAL_VARIABLE_SLOT *v = &p->variables[t->variable];
 
-        case EVAL_VALUE_NUMBER:
-            n = v->number;
-            break;
+        if(unlikely(!t->found)) {
+            buffer_sprintf(wb, "[ undefined variable '%s' ] ", v->name);
+            continue;
+        }
 
-        case EVAL_VALUE_VARIABLE:
-            n = eval_variable(exp, v->variable, error);
-            break;
+        if(v->builtin != EVAL_BUILTIN_NONE)
+            buffer_sprintf(wb, "[ $%s = ", v->name);
+        else
+            buffer_sprintf(wb, "[ ${%s} = ", v->name);
 
-        default:
-            *error = EVAL_ERROR_INVALID_VALUE;
-            n = 0;
-            break;
+        print_parsed_as_constant(wb, t->value);
+        buffer_strcat(wb, " ] ");
+    }
+
+    if(exp->error != EVAL_ERROR_OK) {
+        if(buffer_strlen(wb))
+            buffer_strcat(wb, "; ");
+
+        buffer_sprintf(wb, "failed to evaluate expression with error %d (%s)", exp->error, expression_strerror(exp->error));
     }
 
-    return n;
+    p->error_msg_generated = 1;
 }
 
 static inline int is_true(calculated_number n) {
@@ -211,98 +281,163 @@ static inline int is_true(calculated_number n) {
     return 1;
 }
 
-calculated_number eval_and(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    return is_true(eval_value(exp, &op->ops[0], error)) && is_true(eval_value(exp, &op->ops[1], error));
-}
-calculated_number eval_or(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    return is_true(eval_value(exp, &op->ops[0], error)) || is_true(eval_value(exp, &op->ops[1], error));
-}
-calculated_number eval_greater_than_or_equal(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
-    return isgreaterequal(n1, n2);
-}
-calculated_number eval_less_than_or_equal(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
-    return islessequal(n1, n2);
-}
-calculated_number eval_equal(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
+static inline calculated_number eval_equal(calculated_number n1, calculated_number n2) {
     if(isnan(n1) && isnan(n2)) return 1;
     if(isinf(n1) && isinf(n2)) return 1;
     if(isnan(n1) || isnan(n2)) return 0;
     if(isinf(n1) || isinf(n2)) return 0;
     return calculated_number_equal(n1, n2);
 }
-calculated_number eval_not_equal(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    return !eval_equal(exp, op, error);
-}
-calculated_number eval_less(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
-    return isless(n1, n2);
-}
-calculated_number eval_greater(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
-    return isgreater(n1, n2);
-}
-calculated_number eval_plus(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
+static inline calculated_number eval_plus(calculated_number n1, calculated_number n2) {
     if(isnan(n1) || isnan(n2)) return NAN;
     if(isinf(n1) || isinf(n2)) return INFINITY;
     return n1 + n2;
 }
-calculated_number eval_minus(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
+static inline calculated_number eval_minus(calculated_number n1, calculated_number n2) {
     if(isnan(n1) || isnan(n2)) return NAN;
     if(isinf(n1) || isinf(n2)) return INFINITY;
     return n1 - n2;
 }
-calculated_number eval_multiply(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
+static inline calculated_number eval_multiply(calculated_number n1, calculated_number n2) {
     if(isnan(n1) || isnan(n2)) return NAN;
     if(isinf(n1) || isinf(n2)) return INFINITY;
     return n1 * n2;
 }
-calculated_number eval_divide(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
-    calculated_number n2 = eval_value(exp, &op->ops[1], error);
+static inline calculated_number eval_divide(calculated_number n1, calculated_number n2) {
     if(isnan(n1) || isnan(n2)) return NAN;
     if(isinf(n1) || isinf(n2)) return INFINITY;
     return n1 / n2;
 }
-calculated_number eval_nop(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    return eval_value(exp, &op->ops[0], error);
-}
-calculated_number eval_not(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    return !is_true(eval_value(exp, &op->ops[0], error));
-}
-calculated_number eval_sign_plus(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    return eval_value(exp, &op->ops[0], error);
-}
-calculated_number eval_sign_minus(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
+static inline calculated_number eval_sign_minus(calculated_number n1) {
     if(isnan(n1)) return NAN;
     if(isinf(n1)) return INFINITY;
     return -n1;
 }
-calculated_number eval_abs(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    calculated_number n1 = eval_value(exp, &op->ops[0], error);
+static inline calculated_number eval_abs(calculated_number n1) {
     if(isnan(n1)) return NAN;
     if(isinf(n1)) return INFINITY;
     return abs(n1);
 }
-calculated_number eval_if_then_else(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
-    if(is_true(eval_value(exp, &op->ops[0], error)))
-        return eval_value(exp, &op->ops[1], error);
-    else
-        return eval_value(exp, &op->ops[2], error);
+
+static inline calculated_number eval_program(EVAL_EXPRESSION *exp, EVAL_PROGRAM *p, int *error) {
+    calculated_number *stack = p->stack;
+    size_t sp = 0, i = 0;
+
+    p->trace_used = 0;
+    p->error_msg_generated = 0;
+
+    while(i < p->instructions_used) {
+        EVAL_INSTRUCTION *ins = &p->instructions[i++];
+
+        switch(ins->opcode) {
+            case EVAL_OPCODE_PUSH_NUMBER:
+                stack[sp++] = ins->number;
+                break;
+
+            case EVAL_OPCODE_PUSH_VARIABLE:
+                stack[sp++] = eval_variable(exp, p, ins->variable, error);
+                break;
+
+            case EVAL_OPCODE_NOT:
+                stack[sp - 1] = !is_true(stack[sp - 1]);
+                break;
+
+            case EVAL_OPCODE_SIGN_MINUS:
+                stack[sp - 1] = eval_sign_minus(stack[sp - 1]);
+                break;
+
+            case EVAL_OPCODE_ABS:
+                stack[sp - 1] = eval_abs(stack[sp - 1]);
+                break;
+
+            case EVAL_OPCODE_BOOLEAN:
+                stack[sp - 1] = is_true(stack[sp - 1]);
+                break;
+
+            case EVAL_OPCODE_GREATER_THAN_OR_EQUAL:
+                sp--;
+                stack[sp - 1] = isgreaterequal(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_LESS_THAN_OR_EQUAL:
+                sp--;
+                stack[sp - 1] = islessequal(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_NOT_EQUAL:
+                sp--;
+                stack[sp - 1] = !eval_equal(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_EQUAL:
+                sp--;
+                stack[sp - 1] = eval_equal(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_LESS:
+                sp--;
+                stack[sp - 1] = isless(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_GREATER:
+                sp--;
+                stack[sp - 1] = isgreater(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_PLUS:
+                sp--;
+                stack[sp - 1] = eval_plus(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_MINUS:
+                sp--;
+                stack[sp - 1] = eval_minus(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_MULTIPLY:
+                sp--;
+                stack[sp - 1] = eval_multiply(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_DIVIDE:
+                sp--;
+                stack[sp - 1] = eval_divide(stack[sp - 1], stack[sp]);
+                break;
+
+            case EVAL_OPCODE_JUMP_IF_FALSE_OR_PUSH:
+                if(!is_true(stack[sp - 1])) {
+                    stack[sp - 1] = 0;
+                    i = ins->jump;
+                }
+                else
+                    sp--;
+                break;
+
+            case EVAL_OPCODE_JUMP_IF_TRUE_OR_PUSH:
+                if(is_true(stack[sp - 1])) {
+                    stack[sp - 1] = 1;
+                    i = ins->jump;
+                }
+                else
+                    sp--;
+                break;
+
+            case EVAL_OPCODE_JUMP_IF_FALSE:
+                if(!is_true(stack[--sp]))
+                    i = ins->jump;
+                break;
+
+            case EVAL_OPCODE_JUMP:
+                i = ins->jump;
+                break;
+
+            default:
+                *error = EVAL_ERROR_INVALID_VALUE;
+                return 0;
+        }
+    }
+
+    return stack[0];
 }
 
 static struct operator {
@@ -310,46 +445,183 @@ static struct operator {
     char precedence;
     char parameters;
     char isfunction;
-    calculated_number (*eval)(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error);
+    EVAL_OPCODE opcode;
 } operators[256] = {
         // this is a random access array
         // we always access it with a known EVAL_OPERATOR_X
 
-        [EVAL_OPERATOR_AND]                   = { "&&", 2, 2, 0, eval_and },
-        [EVAL_OPERATOR_OR]                    = { "||", 2, 2, 0, eval_or },
-        [EVAL_OPERATOR_GREATER_THAN_OR_EQUAL] = { ">=", 3, 2, 0, eval_greater_than_or_equal },
-        [EVAL_OPERATOR_LESS_THAN_OR_EQUAL]    = { "<=", 3, 2, 0, eval_less_than_or_equal },
-        [EVAL_OPERATOR_NOT_EQUAL]             = { "!=", 3, 2, 0, eval_not_equal },
-        [EVAL_OPERATOR_EQUAL]                 = { "==", 3, 2, 0, eval_equal },
-        [EVAL_OPERATOR_LESS]                  = { "<",  3, 2, 0, eval_less },
-        [EVAL_OPERATOR_GREATER]               = { ">",  3, 2, 0, eval_greater },
-        [EVAL_OPERATOR_PLUS]                  = { "+",  4, 2, 0, eval_plus },
-        [EVAL_OPERATOR_MINUS]                 = { "-",  4, 2, 0, eval_minus },
-        [EVAL_OPERATOR_MULTIPLY]              = { "*",  5, 2, 0, eval_multiply },
-        [EVAL_OPERATOR_DIVIDE]                = { "/",  5, 2, 0, eval_divide },
-        [EVAL_OPERATOR_NOT]                   = { "!",  6, 1, 0, eval_not },
-        [EVAL_OPERATOR_SIGN_PLUS]             = { "+",  6, 1, 0, eval_sign_plus },
-        [EVAL_OPERATOR_SIGN_MINUS]            = { "-",  6, 1, 0, eval_sign_minus },
-        [EVAL_OPERATOR_ABS]                   = { "abs(",6,1, 1, eval_abs },
-        [EVAL_OPERATOR_IF_THEN_ELSE]          = { "?",  7, 3, 0, eval_if_then_else },
-        [EVAL_OPERATOR_NOP]                   = { NULL, 8, 1, 0, eval_nop },
-        [EVAL_OPERATOR_EXPRESSION_OPEN]       = { NULL, 8, 1, 0, eval_nop },
+        // && || and ? are compiled to jumps
+        [EVAL_OPERATOR_AND]                   = { "&&", 2, 2, 0, EVAL_OPCODE_NONE },
+        [EVAL_OPERATOR_OR]                    = { "||", 2, 2, 0, EVAL_OPCODE_NONE },
+        [EVAL_OPERATOR_GREATER_THAN_OR_EQUAL] = { ">=", 3, 2, 0, EVAL_OPCODE_GREATER_THAN_OR_EQUAL },
+        [EVAL_OPERATOR_LESS_THAN_OR_EQUAL]    = { "<=", 3, 2, 0, EVAL_OPCODE_LESS_THAN_OR_EQUAL },
+        [EVAL_OPERATOR_NOT_EQUAL]             = { "!=", 3, 2, 0, EVAL_OPCODE_NOT_EQUAL },
+        [EVAL_OPERATOR_EQUAL]                 = { "==", 3, 2, 0, EVAL_OPCODE_EQUAL },
+        [EVAL_OPERATOR_LESS]                  = { "<",  3, 2, 0, EVAL_OPCODE_LESS },
+        [EVAL_OPERATOR_GREATER]               = { ">",  3, 2, 0, EVAL_OPCODE_GREATER },
+        [EVAL_OPERATOR_PLUS]                  = { "+",  4, 2, 0, EVAL_OPCODE_PLUS },
+        [EVAL_OPERATOR_MINUS]                 = { "-",  4, 2, 0, EVAL_OPCODE_MINUS },
+        [EVAL_OPERATOR_MULTIPLY]              = { "*",  5, 2, 0, EVAL_OPCODE_MULTIPLY },
+        [EVAL_OPERATOR_DIVIDE]                = { "/",  5, 2, 0, EVAL_OPCODE_DIVIDE },
+        [EVAL_OPERATOR_NOT]                   = { "!",  6, 1, 0, EVAL_OPCODE_NOT },
+        [EVAL_OPERATOR_SIGN_PLUS]             = { "+",  6, 1, 0, EVAL_OPCODE_NONE },
+        [EVAL_OPERATOR_SIGN_MINUS]            = { "-",  6, 1, 0, EVAL_OPCODE_SIGN_MINUS },
+        [EVAL_OPERATOR_ABS]                   = { "abs(",6,1, 1, EVAL_OPCODE_ABS },
+        [EVAL_OPERATOR_IF_THEN_ELSE]          = { "?",  7, 3, 0, EVAL_OPCODE_NONE },
+        [EVAL_OPERATOR_NOP]                   = { NULL, 8, 1, 0, EVAL_OPCODE_NONE },
+        [EVAL_OPERATOR_EXPRESSION_OPEN]       = { NULL, 8, 1, 0, EVAL_OPCODE_NONE },
 
         // this should exist in our evaluation list
-        [EVAL_OPERATOR_EXPRESSION_CLOSE]      = { NULL, 99, 1, 0, eval_nop }
+        [EVAL_OPERATOR_EXPRESSION_CLOSE]      = { NULL, 99, 1, 0, EVAL_OPCODE_NONE }
 };
 
 #define eval_precedence(operator) (operators[(unsigned char)(operator)].precedence)
 
-static inline calculated_number eval_node(EVAL_EXPRESSION *exp, EVAL_NODE *op, int *error) {
+// ----------------------------------------------------------------------------
+// compilation of the expression tree
+
+static inline size_t eval_program_emit(EVAL_PROGRAM *p, EVAL_OPCODE opcode, int stack_change) {
+    if(unlikely(p->instructions_used == p->instructions_size)) {
+        p->instructions_size += 16;
+        p->instructions = reallocz(p->instructions, sizeof(EVAL_INSTRUCTION) * p->instructions_size);
+    }
+
+    size_t i = p->instructions_used++;
+    p->instructions[i].opcode = opcode;
+    p->instructions[i].jump = 0;
+
+    p->depth += stack_change;
+    if(p->depth > p->stack_size)
+        p->stack_size = p->depth;
+
+    return i;
+}
+
+static inline size_t eval_program_variable_slot(EVAL_PROGRAM *p, EVAL_VARIABLE *v) {
+    size_t i;
+    for(i = 0; i < p->variables_used ;i++)
+        if(p->variables[i].hash == v->hash && !strcmp(p->variables[i].name, v->name))
+            return i;
+
+    p->variables = reallocz(p->variables, sizeof(EVAL_VARIABLE_SLOT) * (p->variables_used + 1));
+
+    EVAL_VARIABLE_SLOT *slot = &p->variables[p->variables_used];
+    slot->name = strdupz(v->name);
+    slot->hash = v->hash;
+    slot->builtin = EVAL_BUILTIN_NONE;
+    slot->binding = EVAL_BINDING_UNBOUND;
+    slot->rrdvar = NULL;
+
+    int b;
+    for(b = 0; eval_builtins[b].name ;b++) {
+        if(!strcmp(eval_builtins[b].name, v->name)) {
+            slot->builtin = eval_builtins[b].builtin;
+            break;
+        }
+    }
+
+    return p->variables_used++;
+}
+
+static inline void eval_program_compile_node(EVAL_PROGRAM *p, EVAL_NODE *op, int *error);
+
+static inline void eval_program_compile_value(EVAL_PROGRAM *p, EVAL_VALUE *v, int *error) {
+    size_t i;
+
+    switch(v->type) {
+        case EVAL_VALUE_EXPRESSION:
+            eval_program_compile_node(p, v->expression, error);
+            break;
+
+        case EVAL_VALUE_NUMBER:
+            i = eval_program_emit(p, EVAL_OPCODE_PUSH_NUMBER, 1);
+            p->instructions[i].number = v->number;
+            break;
+
+        case EVAL_VALUE_VARIABLE: {
+            size_t slot = eval_program_variable_slot(p, v->variable);
+            i = eval_program_emit(p, EVAL_OPCODE_PUSH_VARIABLE, 1);
+            p->instructions[i].variable = slot;
+            p->trace_size++;
+            break;
+        }
+
+        default:
+            *error = EVAL_ERROR_INVALID_VALUE;
+            break;
+    }
+}
+
+static inline void eval_program_compile_node(EVAL_PROGRAM *p, EVAL_NODE *op, int *error) {
     if(unlikely(op->count != operators[op->operator].parameters)) {
         *error = EVAL_ERROR_INVALID_NUMBER_OF_OPERANDS;
-        return 0;
+        return;
+    }
+
+    size_t jump, jump_else;
+
+    switch(op->operator) {
+        case EVAL_OPERATOR_AND:
+        case EVAL_OPERATOR_OR:
+            // the second operand is evaluated only when needed
+            eval_program_compile_value(p, &op->ops[0], error);
+            jump = eval_program_emit(p, (op->operator == EVAL_OPERATOR_AND)?EVAL_OPCODE_JUMP_IF_FALSE_OR_PUSH:EVAL_OPCODE_JUMP_IF_TRUE_OR_PUSH, -1);
+            eval_program_compile_value(p, &op->ops[1], error);
+            eval_program_emit(p, EVAL_OPCODE_BOOLEAN, 0);
+            p->instructions[jump].jump = p->instructions_used;
+            break;
+
+        case EVAL_OPERATOR_IF_THEN_ELSE:
+            eval_program_compile_value(p, &op->ops[0], error);
+            jump_else = eval_program_emit(p, EVAL_OPCODE_JUMP_IF_FALSE, -1);
+            eval_program_compile_value(p, &op->ops[1], error);
+            jump = eval_program_emit(p, EVAL_OPCODE_JUMP, -1);
+            p->instructions[jump_else].jump = p->instructions_used;
+            eval_program_compile_value(p, &op->ops[2], error);
+            p->instructions[jump].jump = p->instructions_used;
+            break;
+
+        default: {
+            int i;
+            for(i = 0; i < op->count ;i++)
+                eval_program_compile_value(p, &op->ops[i], error);
+
+            if(operators[op->operator].opcode != EVAL_OPCODE_NONE)
+                eval_program_emit(p, operators[op->operator].opcode, 1 - op->count);
+            break;
+        }
     }
+}
+
+static inline void eval_program_free(EVAL_PROGRAM *p) {
+    size_t i;
+    for(i = 0; i < p->variables_used ;i++)
+        freez(p->variables[i].name);
+
+    freez(p->variables);
+    freez(p->trace);
+    freez(p->instructions);
+    freez(p->stack);
+    freez(p);
+}
+
+static inline EVAL_PROGRAM *eval_program_compile(EVAL_NODE *op, int *error) {
+    EVAL_PROGRAM *p = callocz(1, sizeof(EVAL_PROGRAM));
+
+    eval_program_compile_node(p, op, error);
+
+    // a valid program leaves exactly one value on the stack
+    if(*error == EVAL_ERROR_OK && p->depth != 1)
+        *error = EVAL_ERROR_INVALID_NUMBER_OF_OPERANDS;
 
-    calculated_number n = operators[op->operator].eval(exp, op, error);
+    if(*error != EVAL_ERROR_OK) {
+        eval_program_free(p);
+        return NULL;
+    }
 
-    return n;
+    p->stack = mallocz(sizeof(calculated_number) * p->stack_size);
+    p->trace = mallocz(sizeof(EVAL_TRACE) * (p->trace_size + 1));
+    return p;
 }
 
 // ----------------------------------------------------------------------------
@@ -1062,8 +1334,7 @@ static inline EVAL_NODE *parse_full_expression(const char **string, int *error)
 int expression_evaluate(EVAL_EXPRESSION *expression) {
     expression->error = EVAL_ERROR_OK;
 
-    buffer_reset(expression->error_msg);
-    expression->result = eval_node(expression, (EVAL_NODE *)expression->nodes, &expression->error);
+    expression->result = eval_program(expression, (EVAL_PROGRAM *)expression->program, &expression->error);
 
     if(unlikely(isnan(expression->result))) {
         if(expression->error == EVAL_ERROR_OK)
@@ -1081,17 +1352,21 @@ int expression_evaluate(EVAL_EXPRESSION *expression) {
 
     if(expression->error != EVAL_ERROR_OK) {
         expression->result = NAN;
-
-        if(buffer_strlen(expression->error_msg))
-            buffer_strcat(expression->error_msg, "; ");
-
-        buffer_sprintf(expression->error_msg, "failed to evaluate expression with error %d (%s)", expression->error, expression_strerror(expression->error));
         return 0;
     }
 
     return 1;
 }
 
+const char *expression_error_msg(EVAL_EXPRESSION *expression) {
+    EVAL_PROGRAM *p = (EVAL_PROGRAM *)expression->program;
+
+    if(!p->error_msg_generated)
+        eval_error_msg_generate(expression, p);
+
+    return buffer_tostring(expression->error_msg);
+}
+
 EVAL_EXPRESSION *expression_parse(const char *string, const char **failed_at, int *error) {
     const char *s = string;
     int err = EVAL_ERROR_OK;
@@ -1124,6 +1399,15 @@ EVAL_EXPRESSION *expression_parse(const char *string, const char **failed_at, in
         return NULL;
     }
 
+    // the tree is needed only to compile the program
+    EVAL_PROGRAM *program = eval_program_compile(op, &err);
+    eval_node_free(op);
+    if(!program) {
+        error("failed to compile expression '%s' with reason: %s", string, expression_strerror(err));
+        buffer_free(out);
+        return NULL;
+    }
+
     EVAL_EXPRESSION *exp = callocz(1, sizeof(EVAL_EXPRESSION));
 
     exp->source = strdupz(string);
@@ -1131,15 +1415,27 @@ EVAL_EXPRESSION *expression_parse(const char *string, const char **failed_at, in
     buffer_free(out);
 
     exp->error_msg = buffer_create(100);
-    exp->nodes = (void *)op;
+    exp->program = (void *)program;
 
     return exp;
 }
 
+void expression_unbind_variables(EVAL_EXPRESSION *expression) {
+    if(!expression) return;
+
+    EVAL_PROGRAM *p = (EVAL_PROGRAM *)expression->program;
+
+    size_t i;
+    for(i = 0; i < p->variables_used ;i++) {
+        p->variables[i].binding = EVAL_BINDING_UNBOUND;
+        p->variables[i].rrdvar = NULL;
+    }
+}
+
 void expression_free(EVAL_EXPRESSION *expression) {
     if(!expression) return;
 
-    if(expression->nodes) eval_node_free((EVAL_NODE *)expression->nodes);
+    if(expression->program) eval_program_free((EVAL_PROGRAM *)expression->program);
     freez((void *)expression->source);
     freez((void *)expression->parsed_as);
     buffer_free(expression->error_msg);
@@ -35,10 +35,10 @@ typedef struct eval_expression {
     calculated_number result;
 
     int error;
-    BUFFER *error_msg;
+    BUFFER *error_msg;              // use expression_error_msg() to get it
 
-    // hidden EVAL_NODE *
-    void *nodes;
+    // hidden EVAL_PROGRAM *
+    void *program;
 
     // custom data to be used for looking up variables
     struct rrdcalc *rrdcalc;
@@ -80,9 +80,20 @@ extern const char *expression_strerror(int error);
 
 // evaluate an expression and return
 // 1 = OK, the result is in: expression->result
-// 2 = FAILED, the error message is in: buffer_tostring(expression->error_msg)
+// 0 = FAILED, the error message is returned by: expression_error_msg(expression)
 extern int expression_evaluate(EVAL_EXPRESSION *expression);
 
-extern int health_variable_lookup(const char *variable, uint32_t hash, struct rrdcalc *rc, calculated_number *result);
+// the values of the variables used by the last evaluation and its error, if any
+// it is generated only when it is requested
+extern const char *expression_error_msg(EVAL_EXPRESSION *expression);
+
+// forget the variables the expression has found, so that they are looked up
+// again on the next evaluation - required when variables are added or removed
+extern void expression_unbind_variables(EVAL_EXPRESSION *expression);
+
+// callbacks required by the evaluation of expressions
+// the variables are looked up once, and then they are read directly
+extern struct rrdvar *health_variable_bind(const char *variable, uint32_t hash, struct rrdcalc *rc);
+extern calculated_number rrdvar2number(struct rrdvar *rv);
 
 #endif //NETDATA_EVAL_H
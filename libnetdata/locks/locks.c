@@ -41,6 +41,131 @@ inline void netdata_thread_enable_cancelability(void) {
         netdata_thread_lock_cancelability--;
 }
 
+// ----------------------------------------------------------------------------
+// lock contention statistics, per lock class
+//
+// A lock class is a string given by the caller: the source file taking
+// the lock, unless the lock is taken with a class of its own (like the
+// rrd, rrdhost and rrdset locks). The classes are found by the address
+// of the string in an open addressing table that is never locked for
+// reading, so that a lock costs a single trylock while it is free.
+
+int netdata_locks_statistics_enabled = 0;
+
+#define LOCK_CLASSES_SLOTS 1024
+
+static struct lock_class_slot {
+    const char *key;
+    struct netdata_lock_class *lock_class;
+} lock_classes_slots[LOCK_CLASSES_SLOTS];
+
+static struct netdata_lock_class *lock_classes = NULL;
+static pthread_mutex_t lock_classes_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+static struct netdata_lock_class lock_class_other = { .name = "other" };
+
+// keep the last two components of the paths of source files
+static const char *lock_class_name(const char *key) {
+    const char *last = strrchr(key, '/');
+    if(!last) return key;
+
+    const char *s = last;
+    while(s > key && s[-1] != '/') s--;
+    return s;
+}
+
+#define lock_class_slot(key) (((uintptr_t)(key) >> 3) & (LOCK_CLASSES_SLOTS - 1))
+#define lock_class_next_slot(slot) (((slot) + 1) & (LOCK_CLASSES_SLOTS - 1))
+
+static struct netdata_lock_class *lock_class_add(const char *key) {
+    struct netdata_lock_class *lc = NULL;
+    size_t i, slot = lock_class_slot(key);
+
+    pthread_mutex_lock(&lock_classes_mutex);
+
+    for(i = 0; i < LOCK_CLASSES_SLOTS ;i++, slot = lock_class_next_slot(slot)) {
+        struct lock_class_slot *ls = &lock_classes_slots[slot];
+
+        if(ls->key == key) {
+            // added by another thread meanwhile
+            lc = ls->lock_class;
+            break;
+        }
+
+        if(!ls->key) {
+            // the same string may be known by another address
+            const char *name = lock_class_name(key);
+            for(lc = lock_classes; lc ; lc = lc->next)
+                if(!strcmp(lc->name, name)) break;
+
+            if(!lc) {
+                lc = callocz(1, sizeof(struct netdata_lock_class));
+                lc->name = name;
+                lc->next = lock_classes;
+                __atomic_store_n(&lock_classes, lc, __ATOMIC_RELEASE);
+            }
+
+            ls->lock_class = lc;
+            __atomic_store_n(&ls->key, key, __ATOMIC_RELEASE);
+            break;
+        }
+    }
+
+    pthread_mutex_unlock(&lock_classes_mutex);
+    return lc ? lc : &lock_class_other;
+}
+
+static struct netdata_lock_class *lock_class_get(const char *key) {
+    if(unlikely(!key)) return &lock_class_other;
+
+    size_t i, slot = lock_class_slot(key);
+    for(i = 0; i < LOCK_CLASSES_SLOTS ;i++, slot = lock_class_next_slot(slot)) {
+        struct lock_class_slot *ls = &lock_classes_slots[slot];
+        const char *k = __atomic_load_n(&ls->key, __ATOMIC_ACQUIRE);
+
+        if(likely(k == key))
+            return ls->lock_class;
+
+        if(!k)
+            return lock_class_add(key);
+    }
+
+    return &lock_class_other;
+}
+
+static inline void lock_class_account(const char *key, usec_t waited) {
+    struct netdata_lock_class *lc = lock_class_get(key);
+
+    __atomic_add_fetch(&lc->acquisitions, 1, __ATOMIC_RELAXED);
+    if(waited) {
+        __atomic_add_fetch(&lc->contentions, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&lc->wait_usec, waited, __ATOMIC_RELAXED);
+    }
+}
+
+void netdata_locks_statistics(void (*callback)(struct netdata_lock_class *lc, void *data), void *data) {
+    struct netdata_lock_class *lc;
+    for(lc = __atomic_load_n(&lock_classes, __ATOMIC_ACQUIRE); lc ; lc = lc->next)
+        callback(lc, data);
+
+    if(lock_class_other.acquisitions)
+        callback(&lock_class_other, data);
+}
+
+// take the lock, measuring the time waited for it when it is not free
+#define lock_with_statistics(ret, trylock, lock, lock_class, ptr) do {        \
+    if(likely(!netdata_locks_statistics_enabled))                             \
+        (ret) = lock(ptr);                                                     \
+    else if(likely(((ret) = trylock(ptr)) == 0))                              \
+        lock_class_account(lock_class, 0);                                     \
+    else if((ret) == EBUSY) {                                                  \
+        usec_t started = now_monotonic_high_precision_usec();                  \
+        (ret) = lock(ptr);                                                     \
+        usec_t waited = now_monotonic_high_precision_usec() - started;         \
+        lock_class_account(lock_class, waited ? waited : 1);                   \
+    }                                                                          \
+} while(0)
+
 // ----------------------------------------------------------------------------
 // mutex
 
@@ -51,10 +176,11 @@ int __netdata_mutex_init(netdata_mutex_t *mutex) {
     return ret;
 }
 
-int __netdata_mutex_lock(netdata_mutex_t *mutex) {
+int __netdata_mutex_lock(netdata_mutex_t *mutex, const char *lock_class) {
     netdata_thread_disable_cancelability();
 
-    int ret = pthread_mutex_lock(mutex);
+    int ret;
+    lock_with_statistics(ret, pthread_mutex_trylock, pthread_mutex_lock, lock_class, mutex);
     if(unlikely(ret != 0)) {
         netdata_thread_enable_cancelability();
         error("MUTEX_LOCK: failed to get lock (code %d)", ret);
@@ -100,7 +226,7 @@ int netdata_mutex_init_debug(const char *file __maybe_unused, const char *functi
 }
 
 int netdata_mutex_lock_debug(const char *file __maybe_unused, const char *function __maybe_unused,
-                             const unsigned long line __maybe_unused, netdata_mutex_t *mutex) {
+                             const unsigned long line __maybe_unused, netdata_mutex_t *mutex, const char *lock_class) {
     usec_t start = 0;
     (void)start;
 
@@ -109,7 +235,7 @@ int netdata_mutex_lock_debug(const char *file __maybe_unused, const char *functi
         debug(D_LOCKS, "MUTEX_LOCK: netdata_mutex_lock(0x%p) from %lu@%s, %s()", mutex, line, file, function);
     }
 
-    int ret = __netdata_mutex_lock(mutex);
+    int ret = __netdata_mutex_lock(mutex, lock_class);
 
     debug(D_LOCKS, "MUTEX_LOCK: netdata_mutex_lock(0x%p) = %d in %llu usec, from %lu@%s, %s()", mutex, ret, now_boottime_usec() - start, line, file, function);
 
@@ -168,10 +294,11 @@ int __netdata_rwlock_init(netdata_rwlock_t *rwlock) {
     return ret;
 }
 
-int __netdata_rwlock_rdlock(netdata_rwlock_t *rwlock) {
+int __netdata_rwlock_rdlock(netdata_rwlock_t *rwlock, const char *lock_class) {
     netdata_thread_disable_cancelability();
 
-    int ret = pthread_rwlock_rdlock(rwlock);
+    int ret;
+    lock_with_statistics(ret, pthread_rwlock_tryrdlock, pthread_rwlock_rdlock, lock_class, rwlock);
     if(unlikely(ret != 0)) {
         netdata_thread_enable_cancelability();
         error("RW_LOCK: failed to obtain read lock (code %d)", ret);
@@ -180,10 +307,11 @@ int __netdata_rwlock_rdlock(netdata_rwlock_t *rwlock) {
     return ret;
 }
 
-int __netdata_rwlock_wrlock(netdata_rwlock_t *rwlock) {
+int __netdata_rwlock_wrlock(netdata_rwlock_t *rwlock, const char *lock_class) {
     netdata_thread_disable_cancelability();
 
-    int ret = pthread_rwlock_wrlock(rwlock);
+    int ret;
+    lock_with_statistics(ret, pthread_rwlock_trywrlock, pthread_rwlock_wrlock, lock_class, rwlock);
     if(unlikely(ret != 0)) {
         error("RW_LOCK: failed to obtain write lock (code %d)", ret);
         netdata_thread_enable_cancelability();
@@ -258,7 +386,7 @@ int netdata_rwlock_init_debug(const char *file __maybe_unused, const char *funct
 }
 
 int netdata_rwlock_rdlock_debug(const char *file __maybe_unused, const char *function __maybe_unused,
-                                const unsigned long line __maybe_unused, netdata_rwlock_t *rwlock) {
+                                const unsigned long line __maybe_unused, netdata_rwlock_t *rwlock, const char *lock_class) {
     usec_t start = 0;
     (void)start;
 
@@ -267,7 +395,7 @@ int netdata_rwlock_rdlock_debug(const char *file __maybe_unused, const char *fun
         debug(D_LOCKS, "RW_LOCK: netdata_rwlock_rdlock(0x%p) from %lu@%s, %s()", rwlock, line, file, function);
     }
 
-    int ret = __netdata_rwlock_rdlock(rwlock);
+    int ret = __netdata_rwlock_rdlock(rwlock, lock_class);
 
     debug(D_LOCKS, "RW_LOCK: netdata_rwlock_rdlock(0x%p) = %d in %llu usec, from %lu@%s, %s()", rwlock, ret, now_boottime_usec() - start, line, file, function);
 
@@ -275,7 +403,7 @@ int netdata_rwlock_rdlock_debug(const char *file __maybe_unused, const char *fun
 }
 
 int netdata_rwlock_wrlock_debug(const char *file __maybe_unused, const char *function __maybe_unused,
-                                const unsigned long line __maybe_unused, netdata_rwlock_t *rwlock) {
+                                const unsigned long line __maybe_unused, netdata_rwlock_t *rwlock, const char *lock_class) {
     usec_t start = 0;
     (void)start;
 
@@ -284,7 +412,7 @@ int netdata_rwlock_wrlock_debug(const char *file __maybe_unused, const char *fun
         debug(D_LOCKS, "RW_LOCK: netdata_rwlock_wrlock(0x%p) from %lu@%s, %s()", rwlock, line, file, function);
     }
 
-    int ret = __netdata_rwlock_wrlock(rwlock);
+    int ret = __netdata_rwlock_wrlock(rwlock, lock_class);
 
     debug(D_LOCKS, "RW_LOCK: netdata_rwlock_wrlock(0x%p) = %d in %llu usec, from %lu@%s, %s()", rwlock, ret, now_boottime_usec() - start, line, file, function);
 
@@ -11,28 +11,41 @@ typedef pthread_mutex_t netdata_mutex_t;
 typedef pthread_rwlock_t netdata_rwlock_t;
 #define NETDATA_RWLOCK_INITIALIZER PTHREAD_RWLOCK_INITIALIZER
 
+// the contention statistics of the locks of a class,
+// collected when netdata_locks_statistics_enabled is set
+struct netdata_lock_class {
+    const char *name;
+    size_t acquisitions;
+    size_t contentions;
+    unsigned long long wait_usec;
+    struct netdata_lock_class *next;
+};
+
+extern int netdata_locks_statistics_enabled;
+extern void netdata_locks_statistics(void (*callback)(struct netdata_lock_class *lc, void *data), void *data);
+
 extern int __netdata_mutex_init(netdata_mutex_t *mutex);
-extern int __netdata_mutex_lock(netdata_mutex_t *mutex);
+extern int __netdata_mutex_lock(netdata_mutex_t *mutex, const char *lock_class);
 extern int __netdata_mutex_trylock(netdata_mutex_t *mutex);
 extern int __netdata_mutex_unlock(netdata_mutex_t *mutex);
 
 extern int __netdata_rwlock_destroy(netdata_rwlock_t *rwlock);
 extern int __netdata_rwlock_init(netdata_rwlock_t *rwlock);
-extern int __netdata_rwlock_rdlock(netdata_rwlock_t *rwlock);
-extern int __netdata_rwlock_wrlock(netdata_rwlock_t *rwlock);
+extern int __netdata_rwlock_rdlock(netdata_rwlock_t *rwlock, const char *lock_class);
+extern int __netdata_rwlock_wrlock(netdata_rwlock_t *rwlock, const char *lock_class);
 extern int __netdata_rwlock_unlock(netdata_rwlock_t *rwlock);
 extern int __netdata_rwlock_tryrdlock(netdata_rwlock_t *rwlock);
 extern int __netdata_rwlock_trywrlock(netdata_rwlock_t *rwlock);
 
 extern int netdata_mutex_init_debug( const char *file, const char *function, const unsigned long line, netdata_mutex_t *mutex);
-extern int netdata_mutex_lock_debug( const char *file, const char *function, const unsigned long line, netdata_mutex_t *mutex);
+extern int netdata_mutex_lock_debug( const char *file, const char *function, const unsigned long line, netdata_mutex_t *mutex, const char *lock_class);
 extern int netdata_mutex_trylock_debug( const char *file, const char *function, const unsigned long line, netdata_mutex_t *mutex);
 extern int netdata_mutex_unlock_debug( const char *file, const char *function, const unsigned long line, netdata_mutex_t *mutex);
 
 extern int netdata_rwlock_destroy_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock);
 extern int netdata_rwlock_init_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock);
-extern int netdata_rwlock_rdlock_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock);
-extern int netdata_rwlock_wrlock_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock);
+extern int netdata_rwlock_rdlock_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock, const char *lock_class);
+extern int netdata_rwlock_wrlock_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock, const char *lock_class);
 extern int netdata_rwlock_unlock_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock);
 extern int netdata_rwlock_tryrdlock_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock);
 extern int netdata_rwlock_trywrlock_debug( const char *file, const char *function, const unsigned long line, netdata_rwlock_t *rwlock);
@@ -43,33 +56,41 @@ extern void netdata_thread_enable_cancelability(void);
 #ifdef NETDATA_INTERNAL_CHECKS
 
 #define netdata_mutex_init(mutex)    netdata_mutex_init_debug(__FILE__, __FUNCTION__, __LINE__, mutex)
-#define netdata_mutex_lock(mutex)    netdata_mutex_lock_debug(__FILE__, __FUNCTION__, __LINE__, mutex)
+#define netdata_mutex_lock(mutex)    netdata_mutex_lock_debug(__FILE__, __FUNCTION__, __LINE__, mutex, __FILE__)
 #define netdata_mutex_trylock(mutex) netdata_mutex_trylock_debug(__FILE__, __FUNCTION__, __LINE__, mutex)
 #define netdata_mutex_unlock(mutex)  netdata_mutex_unlock_debug(__FILE__, __FUNCTION__, __LINE__, mutex)
 
 #define netdata_rwlock_destroy(rwlock)   netdata_rwlock_destroy_debug(__FILE__, __FUNCTION__, __LINE__, rwlock)
 #define netdata_rwlock_init(rwlock)      netdata_rwlock_init_debug(__FILE__, __FUNCTION__, __LINE__, rwlock)
-#define netdata_rwlock_rdlock(rwlock)    netdata_rwlock_rdlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock)
-#define netdata_rwlock_wrlock(rwlock)    netdata_rwlock_wrlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock)
+#define netdata_rwlock_rdlock(rwlock)    netdata_rwlock_rdlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock, __FILE__)
+#define netdata_rwlock_wrlock(rwlock)    netdata_rwlock_wrlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock, __FILE__)
 #define netdata_rwlock_unlock(rwlock)    netdata_rwlock_unlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock)
 #define netdata_rwlock_tryrdlock(rwlock) netdata_rwlock_tryrdlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock)
 #define netdata_rwlock_trywrlock(rwlock) netdata_rwlock_trywrlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock)
 
+#define netdata_mutex_lock_class(mutex, lock_class)     netdata_mutex_lock_debug(__FILE__, __FUNCTION__, __LINE__, mutex, lock_class)
+#define netdata_rwlock_rdlock_class(rwlock, lock_class) netdata_rwlock_rdlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock, lock_class)
+#define netdata_rwlock_wrlock_class(rwlock, lock_class) netdata_rwlock_wrlock_debug(__FILE__, __FUNCTION__, __LINE__, rwlock, lock_class)
+
 #else // !NETDATA_INTERNAL_CHECKS
 
 #define netdata_mutex_init(mutex)    __netdata_mutex_init(mutex)
-#define netdata_mutex_lock(mutex)    __netdata_mutex_lock(mutex)
+#define netdata_mutex_lock(mutex)    __netdata_mutex_lock(mutex, __FILE__)
 #define netdata_mutex_trylock(mutex) __netdata_mutex_trylock(mutex)
 #define netdata_mutex_unlock(mutex)  __netdata_mutex_unlock(mutex)
 
 #define netdata_rwlock_destroy(rwlock)    __netdata_rwlock_destroy(rwlock)
 #define netdata_rwlock_init(rwlock)       __netdata_rwlock_init(rwlock)
-#define netdata_rwlock_rdlock(rwlock)     __netdata_rwlock_rdlock(rwlock)
-#define netdata_rwlock_wrlock(rwlock)     __netdata_rwlock_wrlock(rwlock)
+#define netdata_rwlock_rdlock(rwlock)     __netdata_rwlock_rdlock(rwlock, __FILE__)
+#define netdata_rwlock_wrlock(rwlock)     __netdata_rwlock_wrlock(rwlock, __FILE__)
 #define netdata_rwlock_unlock(rwlock)     __netdata_rwlock_unlock(rwlock)
 #define netdata_rwlock_tryrdlock(rwlock)  __netdata_rwlock_tryrdlock(rwlock)
 #define netdata_rwlock_trywrlock(rwlock)  __netdata_rwlock_trywrlock(rwlock)
 
+#define netdata_mutex_lock_class(mutex, lock_class)     __netdata_mutex_lock(mutex, lock_class)
+#define netdata_rwlock_rdlock_class(rwlock, lock_class) __netdata_rwlock_rdlock(rwlock, lock_class)
+#define netdata_rwlock_wrlock_class(rwlock, lock_class) __netdata_rwlock_wrlock(rwlock, lock_class)
+
 #endif // NETDATA_INTERNAL_CHECKS
 
 #endif //NETDATA_LOCKS_H
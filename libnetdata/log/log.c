@@ -468,7 +468,7 @@ static inline void log_date(char *buffer, size_t len) {
 
 static netdata_mutex_t log_mutex = NETDATA_MUTEX_INITIALIZER;
 static inline void log_lock() {
-    netdata_mutex_lock(&log_mutex);
+    netdata_mutex_lock_class(&log_mutex, "log");
 }
 static inline void log_unlock() {
     netdata_mutex_unlock(&log_mutex);
@@ -575,6 +575,334 @@ void open_all_log_files() {
     stdaccess = open_log_file(stdaccess_fd, stdaccess, stdaccess_filename, &access_log_syslog, 1, &stdaccess_fd);
 }
 
+// ----------------------------------------------------------------------------
+// asynchronous logging
+//
+// When enabled, info(), error() and log_access() format their lines on the
+// caller's thread and push them to a ring buffer owned by that thread, without
+// taking any lock. A writer thread drains all the rings periodically and writes
+// the lines to the log files in batches. Lines that do not fit in the ring of
+// their thread are dropped and counted.
+
+#define LOG_ASYNC_RECORD_MAX 4096
+#define LOG_ASYNC_BATCH_SIZE 65536
+#define LOG_ASYNC_FLUSH_EVERY_USEC (50 * USEC_PER_MS)
+
+typedef enum log_async_target {
+    LOG_ASYNC_TARGET_ERROR  = 0,
+    LOG_ASYNC_TARGET_ACCESS = 1
+} LOG_ASYNC_TARGET;
+
+struct log_ring {
+    char *data;
+    size_t size;                // a power of 2
+
+    size_t head;                // advanced only by the thread owning the ring
+    size_t tail;                // advanced only by the thread draining the rings
+
+    int exited;                 // the thread owning the ring has exited
+
+    struct log_ring *next;
+};
+
+struct log_batch {
+    char data[LOG_ASYNC_BATCH_SIZE];
+    size_t len;
+};
+
+size_t log_async_buffer_size = 0;
+
+static int log_async_running = 0;
+static pid_t log_async_pid = 0;
+static pid_t log_pid = 0;       // the pid of this process, refreshed after fork()
+static netdata_thread_t log_async_thread;
+static pthread_key_t log_ring_key;
+static __thread struct log_ring *log_thread_ring = NULL;
+static __thread int log_thread_exited = 0;    // the ring of this thread has been handed to the writer to free
+
+static netdata_mutex_t log_rings_mutex = NETDATA_MUTEX_INITIALIZER;
+static struct log_ring *log_rings = NULL;
+
+// only one thread drains the rings at a time
+static netdata_mutex_t log_drain_mutex = NETDATA_MUTEX_INITIALIZER;
+static struct log_batch log_batches[2];
+
+static struct {
+    uint64_t records;
+    uint64_t dropped;
+} log_async_stats = { 0, 0 };
+
+static inline int log_async_active(void) {
+    // a forked child (e.g. before exec) does not have the writer thread
+    // a thread that is exiting (e.g. in another thread specific data destructor) no longer has a ring
+    return __atomic_load_n(&log_async_running, __ATOMIC_ACQUIRE) && log_pid == log_async_pid && !log_thread_exited;
+}
+
+static void log_async_atfork_child(void) {
+    log_pid = getpid();
+}
+
+static inline void log_ring_copy_in(struct log_ring *r, size_t pos, const void *src, size_t len) {
+    size_t offset = pos & (r->size - 1);
+    size_t first = r->size - offset;
+    if(first > len) first = len;
+
+    memcpy(&r->data[offset], src, first);
+    if(len > first)
+        memcpy(r->data, (const char *)src + first, len - first);
+}
+
+static inline void log_ring_copy_out(struct log_ring *r, size_t pos, void *dst, size_t len) {
+    size_t offset = pos & (r->size - 1);
+    size_t first = r->size - offset;
+    if(first > len) first = len;
+
+    memcpy(dst, &r->data[offset], first);
+    if(len > first)
+        memcpy((char *)dst + first, r->data, len - first);
+}
+
+static void log_ring_thread_exited(void *ptr) {
+    struct log_ring *r = (struct log_ring *)ptr;
+
+    // the writer may free the ring from now on, so anything this thread logs after this is written synchronously
+    log_thread_ring = NULL;
+    log_thread_exited = 1;
+
+    __atomic_store_n(&r->exited, 1, __ATOMIC_RELEASE);
+}
+
+static struct log_ring *log_ring_get(void) {
+    if(likely(log_thread_ring))
+        return log_thread_ring;
+
+    struct log_ring *r = callocz(1, sizeof(struct log_ring));
+    r->size = log_async_buffer_size;
+    r->data = mallocz(r->size);
+
+    netdata_mutex_lock(&log_rings_mutex);
+    r->next = log_rings;
+    log_rings = r;
+    netdata_mutex_unlock(&log_rings_mutex);
+
+    // the writer frees the ring, once the thread has exited and the ring is drained
+    pthread_setspecific(log_ring_key, r);
+
+    log_thread_ring = r;
+    return r;
+}
+
+static void log_async_push(LOG_ASYNC_TARGET target, const char *record, size_t len) {
+    struct log_ring *r = log_ring_get();
+
+    uint32_t header = (uint32_t)(len << 1) | (uint32_t)target;
+    size_t head = r->head;
+    size_t tail = __atomic_load_n(&r->tail, __ATOMIC_ACQUIRE);
+
+    if(unlikely(r->size - (head - tail) < sizeof(header) + len)) {
+        __atomic_fetch_add(&log_async_stats.dropped, 1, __ATOMIC_RELAXED);
+        return;
+    }
+
+    log_ring_copy_in(r, head, &header, sizeof(header));
+    log_ring_copy_in(r, head + sizeof(header), record, len);
+    __atomic_store_n(&r->head, head + sizeof(header) + len, __ATOMIC_RELEASE);
+}
+
+static inline size_t log_record_vappend(char *record, size_t len, const char *fmt, va_list args) {
+    if(len >= LOG_ASYNC_RECORD_MAX - 1)
+        return len;
+
+    int n = vsnprintf(&record[len], LOG_ASYNC_RECORD_MAX - len, fmt, args);
+    if(n < 0)
+        return len;
+
+    len += (size_t)n;
+    return (len > LOG_ASYNC_RECORD_MAX - 1) ? LOG_ASYNC_RECORD_MAX - 1 : len;
+}
+
+static size_t log_record_append(char *record, size_t len, const char *fmt, ...) PRINTFLIKE(3, 4);
+static size_t log_record_append(char *record, size_t len, const char *fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    len = log_record_vappend(record, len, fmt, args);
+    va_end(args);
+    return len;
+}
+
+// must be called with log_drain_mutex locked
+static void log_batch_write(LOG_ASYNC_TARGET target) {
+    struct log_batch *b = &log_batches[target];
+    if(!b->len)
+        return;
+
+    log_lock();
+
+    FILE *fp = (target == LOG_ASYNC_TARGET_ACCESS) ? stdaccess : stderr;
+    if(likely(fp)) {
+        fwrite(b->data, b->len, 1, fp);
+        fflush(fp);
+    }
+
+    log_unlock();
+
+    b->len = 0;
+}
+
+// must be called with log_drain_mutex locked
+static void log_async_drain(void) {
+    uint64_t records = 0;
+
+    netdata_mutex_lock(&log_rings_mutex);
+
+    struct log_ring *r = log_rings, *last = NULL;
+    while(r) {
+        // check for exit before reading the head, so that everything
+        // the thread logged before exiting is drained below
+        int exited = __atomic_load_n(&r->exited, __ATOMIC_ACQUIRE);
+        size_t head = __atomic_load_n(&r->head, __ATOMIC_ACQUIRE);
+        size_t tail = r->tail;
+
+        while(tail != head) {
+            uint32_t header;
+            log_ring_copy_out(r, tail, &header, sizeof(header));
+
+            size_t len = header >> 1;
+            LOG_ASYNC_TARGET target = (LOG_ASYNC_TARGET)(header & 1);
+            struct log_batch *b = &log_batches[target];
+
+            if(b->len + len > LOG_ASYNC_BATCH_SIZE)
+                log_batch_write(target);
+
+            log_ring_copy_out(r, tail + sizeof(header), &b->data[b->len], len);
+            b->len += len;
+            tail += sizeof(header) + len;
+
+            records++;
+        }
+
+        __atomic_store_n(&r->tail, tail, __ATOMIC_RELEASE);
+
+        if(unlikely(exited)) {
+            struct log_ring *t = r->next;
+
+            if(last) last->next = t;
+            else log_rings = t;
+
+            freez(r->data);
+            freez(r);
+            r = t;
+            continue;
+        }
+
+        last = r;
+        r = r->next;
+    }
+
+    netdata_mutex_unlock(&log_rings_mutex);
+
+    log_batch_write(LOG_ASYNC_TARGET_ERROR);
+    log_batch_write(LOG_ASYNC_TARGET_ACCESS);
+
+    __atomic_fetch_add(&log_async_stats.records, records, __ATOMIC_RELAXED);
+}
+
+static void *log_async_main(void *ptr) {
+    (void)ptr;
+
+    while(__atomic_load_n(&log_async_running, __ATOMIC_ACQUIRE)) {
+        sleep_usec(LOG_ASYNC_FLUSH_EVERY_USEC);
+
+        netdata_mutex_lock(&log_drain_mutex);
+        log_async_drain();
+        netdata_mutex_unlock(&log_drain_mutex);
+    }
+
+    return NULL;
+}
+
+// starts the writer thread, when log_async_buffer_size is set
+// it has to be called after the process has forked
+void log_async_init(void) {
+    if(!log_async_buffer_size || __atomic_load_n(&log_async_running, __ATOMIC_ACQUIRE))
+        return;
+
+    // the ring has to fit a few records and its size has to be a power of 2
+    size_t size = LOG_ASYNC_RECORD_MAX * 4;
+    while(size < log_async_buffer_size)
+        size <<= 1;
+    log_async_buffer_size = size;
+
+    if(pthread_key_create(&log_ring_key, log_ring_thread_exited) != 0) {
+        error("LOG: cannot create the thread key for the log buffers. Logging synchronously.");
+        log_async_buffer_size = 0;
+        return;
+    }
+
+    log_async_pid = log_pid = getpid();
+
+    static int atfork_registered = 0;
+    if(!atfork_registered && pthread_atfork(NULL, NULL, log_async_atfork_child) == 0)
+        atfork_registered = 1;
+
+    if(!atfork_registered) {
+        error("LOG: cannot register the fork handler of the log buffers. Logging synchronously.");
+        log_async_buffer_size = 0;
+        return;
+    }
+
+    __atomic_store_n(&log_async_running, 1, __ATOMIC_RELEASE);
+
+    if(netdata_thread_create(&log_async_thread, "LOGS", NETDATA_THREAD_OPTION_JOINABLE, log_async_main, NULL) != 0) {
+        __atomic_store_n(&log_async_running, 0, __ATOMIC_RELEASE);
+        error("LOG: cannot start the log writer thread. Logging synchronously.");
+        return;
+    }
+
+    info("LOG: logging asynchronously, with %zu bytes of log buffer per thread", log_async_buffer_size);
+}
+
+// stops the writer thread and writes everything pending
+void log_async_stop(void) {
+    if(!log_async_active())
+        return;
+
+    // from now on, all threads log synchronously
+    __atomic_store_n(&log_async_running, 0, __ATOMIC_RELEASE);
+    netdata_thread_join(log_async_thread, NULL);
+
+    netdata_mutex_lock(&log_drain_mutex);
+    log_async_drain();
+    netdata_mutex_unlock(&log_drain_mutex);
+}
+
+// writes everything pending, waiting up to LOG_ASYNC_FLUSH_TIMEOUT_SEC for the writer thread
+// the timeout protects a fatal error raised while the rings are drained
+#define LOG_ASYNC_FLUSH_TIMEOUT_SEC 2
+
+static void log_async_flush(void) {
+    if(!log_async_active())
+        return;
+
+    struct timespec timeout;
+    clock_gettime(CLOCK_REALTIME, &timeout);
+    timeout.tv_sec += LOG_ASYNC_FLUSH_TIMEOUT_SEC;
+
+    if(pthread_mutex_timedlock(&log_drain_mutex, &timeout) == 0) {
+        log_async_drain();
+        pthread_mutex_unlock(&log_drain_mutex);
+    }
+}
+
+int log_async_enabled(void) {
+    return log_async_active();
+}
+
+void log_async_statistics(uint64_t *records, uint64_t *dropped) {
+    *records = __atomic_load_n(&log_async_stats.records, __ATOMIC_RELAXED);
+    *dropped = __atomic_load_n(&log_async_stats.dropped, __ATOMIC_RELAXED);
+}
+
 // ----------------------------------------------------------------------------
 // error log throttling
 
@@ -717,6 +1045,22 @@ void info_int( const char *file, const char *function, const unsigned long line,
     char date[LOG_DATE_LENGTH];
     log_date(date, LOG_DATE_LENGTH);
 
+    if(log_async_active()) {
+        char record[LOG_ASYNC_RECORD_MAX + 1];
+        size_t len;
+
+        if(debug_flags) len = log_record_append(record, 0, "%s: %s INFO  : %s : (%04lu@%-10.10s:%-15.15s): ", date, program_name, netdata_thread_tag(), line, file, function);
+        else            len = log_record_append(record, 0, "%s: %s INFO  : %s : ", date, program_name, netdata_thread_tag());
+
+        va_start( args, fmt );
+        len = log_record_vappend(record, len, fmt, args);
+        va_end( args );
+
+        record[len++] = '\n';
+        log_async_push(LOG_ASYNC_TARGET_ERROR, record, len);
+        return;
+    }
+
     log_lock();
 
     va_start( args, fmt );
@@ -773,6 +1117,28 @@ void error_int( const char *prefix, const char *file, const char *function, cons
     char date[LOG_DATE_LENGTH];
     log_date(date, LOG_DATE_LENGTH);
 
+    if(log_async_active()) {
+        char record[LOG_ASYNC_RECORD_MAX + 1];
+        size_t len;
+
+        if(debug_flags) len = log_record_append(record, 0, "%s: %s %-5.5s : %s : (%04lu@%-10.10s:%-15.15s): ", date, program_name, prefix, netdata_thread_tag(), line, file, function);
+        else            len = log_record_append(record, 0, "%s: %s %-5.5s : %s : ", date, program_name, prefix, netdata_thread_tag());
+
+        va_start( args, fmt );
+        len = log_record_vappend(record, len, fmt, args);
+        va_end( args );
+
+        if(__errno) {
+            char buf[1024];
+            len = log_record_append(record, len, " (errno %d, %s)", __errno, strerror_result(strerror_r(__errno, buf, 1023), buf));
+            errno = 0;
+        }
+
+        record[len++] = '\n';
+        log_async_push(LOG_ASYNC_TARGET_ERROR, record, len);
+        return;
+    }
+
     log_lock();
 
     va_start( args, fmt );
@@ -816,6 +1182,9 @@ void fatal_int( const char *file, const char *function, const unsigned long line
     char date[LOG_DATE_LENGTH];
     log_date(date, LOG_DATE_LENGTH);
 
+    // write what has been logged before, so that the fatal error is the last line
+    log_async_flush();
+
     log_lock();
 
     va_start( args, fmt );
@@ -851,7 +1220,21 @@ void log_access( const char *fmt, ... ) {
         va_end( args );
     }
 
-    if(stdaccess) {
+    if(stdaccess && log_async_active()) {
+        char record[LOG_ASYNC_RECORD_MAX + 1];
+        char date[LOG_DATE_LENGTH];
+        log_date(date, LOG_DATE_LENGTH);
+
+        size_t len = log_record_append(record, 0, "%s: ", date);
+
+        va_start( args, fmt );
+        len = log_record_vappend(record, len, fmt, args);
+        va_end( args );
+
+        record[len++] = '\n';
+        log_async_push(LOG_ASYNC_TARGET_ACCESS, record, len);
+    }
+    else if(stdaccess) {
         static netdata_mutex_t access_mutex = NETDATA_MUTEX_INITIALIZER;
 
         if(web_server_is_multithreaded)
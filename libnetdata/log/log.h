@@ -75,6 +75,12 @@ extern int error_log_limit(int reset);
 extern void open_all_log_files();
 extern void reopen_all_log_files();
 
+extern size_t log_async_buffer_size;
+extern void log_async_init(void);
+extern void log_async_stop(void);
+extern int log_async_enabled(void);
+extern void log_async_statistics(uint64_t *records, uint64_t *dropped);
+
 static inline void debug_dummy(void) {}
 
 #define error_log_limit_reset() do { error_log_errors_per_period = error_log_errors_per_period_backup; error_log_limit(1); } while(0)
@@ -391,17 +391,7 @@ void procfile_set_open_close(procfile *ff, const char *open, const char *close)
         ffs[(int)*s++] = PF_CHAR_IS_CLOSE;
 }
 
-procfile *procfile_open(const char *filename, const char *separators, uint32_t flags) {
-    debug(D_PROCFILE, PF_PREFIX ": Opening file '%s'", filename);
-
-    int fd = open(filename, procfile_open_flags, 0666);
-    if(unlikely(fd == -1)) {
-        if(unlikely(!(flags & PROCFILE_FLAG_NO_ERROR_ON_FILE_IO))) error(PF_PREFIX ": Cannot open file '%s'", filename);
-        return NULL;
-    }
-
-    // info("PROCFILE: opened '%s' on fd %d", filename, fd);
-
+static procfile *procfile_create(int fd, const char *separators, uint32_t flags) {
     size_t size = (unlikely(procfile_adaptive_initial_allocation)) ? procfile_max_allocation : PROCFILE_INCREMENT_BUFFER;
     procfile *ff = mallocz(sizeof(procfile) + size);
 
@@ -418,6 +408,22 @@ procfile *procfile_open(const char *filename, const char *separators, uint32_t f
 
     procfile_set_separators(ff, separators);
 
+    return ff;
+}
+
+procfile *procfile_open(const char *filename, const char *separators, uint32_t flags) {
+    debug(D_PROCFILE, PF_PREFIX ": Opening file '%s'", filename);
+
+    int fd = open(filename, procfile_open_flags, 0666);
+    if(unlikely(fd == -1)) {
+        if(unlikely(!(flags & PROCFILE_FLAG_NO_ERROR_ON_FILE_IO))) error(PF_PREFIX ": Cannot open file '%s'", filename);
+        return NULL;
+    }
+
+    // info("PROCFILE: opened '%s' on fd %d", filename, fd);
+
+    procfile *ff = procfile_create(fd, separators, flags);
+
     debug(D_PROCFILE, "File '%s' opened.", filename);
     return ff;
 }
@@ -448,6 +454,33 @@ procfile *procfile_reopen(procfile *ff, const char *filename, const char *separa
     return ff;
 }
 
+procfile *procfile_readall_fd(procfile *ff, int fd, const char *separators, uint32_t flags) {
+    if(unlikely(!ff))
+        ff = procfile_create(fd, separators, flags);
+
+    else {
+        if(unlikely(ff->fd != -1)) {
+            // info("PROCFILE: closing fd %d", ff->fd);
+            close(ff->fd);
+        }
+
+        ff->fd = fd;
+        ff->flags = flags;
+
+        // do not do the separators again if NULL is given
+        if(likely(separators)) procfile_set_separators(ff, separators);
+    }
+
+    ff->filename[0] = '\0';
+
+    ff = procfile_readall(ff);
+
+    // the file descriptor belongs to the caller
+    if(likely(ff)) ff->fd = -1;
+
+    return ff;
+}
+
 // ----------------------------------------------------------------------------
 // example parsing of procfile data
 
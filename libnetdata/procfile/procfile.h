@@ -72,6 +72,11 @@ extern procfile *procfile_open(const char *filename, const char *separators, uin
 // if separators == NULL, the last separators are used
 extern procfile *procfile_reopen(procfile *ff, const char *filename, const char *separators, uint32_t flags);
 
+// read and parse a file from a descriptor the caller keeps open across reads
+// the procfile does not keep the descriptor, so it can be shared by many files
+// on failure, the descriptor is closed, the procfile is freed and NULL is returned
+extern procfile *procfile_readall_fd(procfile *ff, int fd, const char *separators, uint32_t flags);
+
 // example walk-through a procfile parsed file
 extern void procfile_print(procfile *ff);
 
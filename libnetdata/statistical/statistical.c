@@ -450,3 +450,401 @@ LONG_DOUBLE holtwinters(const LONG_DOUBLE *series, size_t entries, LONG_DOUBLE a
 
     return value;
 }
+
+// --------------------------------------------------------------------------------------------------------------------
+// quantile sketch
+//
+// A DDSketch: values are counted in logarithmic buckets, so that any quantile
+// is estimated with a relative error of at most the relative accuracy given.
+// Memory depends on the range of the values, not on their number.
+
+#define QUANTILE_SKETCH_MIN_INDEXABLE_VALUE 1e-9
+
+static inline int quantile_sketch_index(QUANTILE_SKETCH *sk, LONG_DOUBLE value) {
+    return (int)ceill(logl(value) / sk->ln_gamma);
+}
+
+static inline LONG_DOUBLE quantile_sketch_value(QUANTILE_SKETCH *sk, int index) {
+    return 2.0L * powl(sk->gamma, index) / (sk->gamma + 1.0L);
+}
+
+static void quantile_sketch_store_add(QUANTILE_SKETCH_STORE *store, int index, double weight, size_t max_buckets) {
+    if(unlikely(!store->size)) {
+        store->size = 64;
+        store->offset = index - (int)(store->size / 2);
+        store->counts = callocz(store->size, sizeof(double));
+    }
+    else if(unlikely(index < store->offset || index >= store->offset + (int)store->size)) {
+        int first = (index < store->offset) ? index : store->offset;
+        int last = (index >= store->offset + (int)store->size) ? index : store->offset + (int)store->size - 1;
+
+        size_t size = store->size;
+        while(size < (size_t)(last - first + 1)) size *= 2;
+        if(size > max_buckets) size = max_buckets;
+
+        if((size_t)(last - first + 1) > size) {
+            // too many buckets - collapse the lowest ones into the first bucket kept
+            int new_first = last - (int)size + 1;
+            if(index < new_first) index = new_first;
+
+            double collapsed = 0.0;
+            int i;
+            for(i = store->offset; i < new_first && i < store->offset + (int)store->size ;i++) {
+                collapsed += store->counts[i - store->offset];
+                store->counts[i - store->offset] = 0.0;
+            }
+            first = new_first;
+
+            double *counts = callocz(size, sizeof(double));
+            for(i = first; i < store->offset + (int)store->size ;i++)
+                if(i >= store->offset) counts[i - first] = store->counts[i - store->offset];
+            counts[0] += collapsed;
+
+            freez(store->counts);
+            store->counts = counts;
+            store->offset = first;
+            store->size = size;
+        }
+        else {
+            // grow, keeping some space on the side we grew to
+            if(index < store->offset) first = last - (int)size + 1;
+            else first = store->offset;
+
+            double *counts = callocz(size, sizeof(double));
+            memcpy(&counts[store->offset - first], store->counts, store->size * sizeof(double));
+
+            freez(store->counts);
+            store->counts = counts;
+            store->offset = first;
+            store->size = size;
+        }
+    }
+
+    store->counts[index - store->offset] += weight;
+}
+
+void quantile_sketch_init(QUANTILE_SKETCH *sk, LONG_DOUBLE relative_accuracy, size_t max_buckets) {
+    if(unlikely(!(relative_accuracy > 0.0L && relative_accuracy < 1.0L)))
+        relative_accuracy = QUANTILE_SKETCH_DEFAULT_RELATIVE_ACCURACY;
+
+    if(unlikely(max_buckets < 64))
+        max_buckets = 64;
+
+    memset(sk, 0, sizeof(QUANTILE_SKETCH));
+    sk->relative_accuracy = relative_accuracy;
+    sk->gamma = (1.0L + relative_accuracy) / (1.0L - relative_accuracy);
+    sk->ln_gamma = logl(sk->gamma);
+    sk->max_buckets = max_buckets;
+}
+
+void quantile_sketch_free(QUANTILE_SKETCH *sk) {
+    freez(sk->positive.counts);
+    freez(sk->negative.counts);
+    memset(&sk->positive, 0, sizeof(QUANTILE_SKETCH_STORE));
+    memset(&sk->negative, 0, sizeof(QUANTILE_SKETCH_STORE));
+    quantile_sketch_reset(sk);
+}
+
+// forget all values, keeping the memory allocated
+void quantile_sketch_reset(QUANTILE_SKETCH *sk) {
+    if(sk->positive.counts) memset(sk->positive.counts, 0, sk->positive.size * sizeof(double));
+    if(sk->negative.counts) memset(sk->negative.counts, 0, sk->negative.size * sizeof(double));
+    sk->zeros = 0.0;
+    sk->count = 0.0;
+    sk->sum = 0.0;
+    sk->sum_of_squares = 0.0;
+    sk->min = 0.0;
+    sk->max = 0.0;
+}
+
+void quantile_sketch_add(QUANTILE_SKETCH *sk, LONG_DOUBLE value, double weight) {
+    if(unlikely(!calculated_number_isnumber(value) || !(weight > 0.0)))
+        return;
+
+    if(value > QUANTILE_SKETCH_MIN_INDEXABLE_VALUE)
+        quantile_sketch_store_add(&sk->positive, quantile_sketch_index(sk, value), weight, sk->max_buckets);
+    else if(value < -QUANTILE_SKETCH_MIN_INDEXABLE_VALUE)
+        quantile_sketch_store_add(&sk->negative, quantile_sketch_index(sk, -value), weight, sk->max_buckets);
+    else
+        sk->zeros += weight;
+
+    if(unlikely(sk->count == 0.0))
+        sk->min = sk->max = value;
+    else if(value < sk->min)
+        sk->min = value;
+    else if(value > sk->max)
+        sk->max = value;
+
+    sk->count += weight;
+    sk->sum += value * weight;
+    sk->sum_of_squares += value * value * weight;
+}
+
+// add all the values of src to dst - both must have the same relative accuracy
+void quantile_sketch_merge(QUANTILE_SKETCH *dst, QUANTILE_SKETCH *src) {
+    if(unlikely(src->count == 0.0))
+        return;
+
+    size_t i;
+    for(i = 0; i < src->positive.size ;i++)
+        if(src->positive.counts[i] > 0.0)
+            quantile_sketch_store_add(&dst->positive, src->positive.offset + (int)i, src->positive.counts[i], dst->max_buckets);
+
+    for(i = 0; i < src->negative.size ;i++)
+        if(src->negative.counts[i] > 0.0)
+            quantile_sketch_store_add(&dst->negative, src->negative.offset + (int)i, src->negative.counts[i], dst->max_buckets);
+
+    if(dst->count == 0.0) {
+        dst->min = src->min;
+        dst->max = src->max;
+    }
+    else {
+        if(src->min < dst->min) dst->min = src->min;
+        if(src->max > dst->max) dst->max = src->max;
+    }
+
+    dst->zeros += src->zeros;
+    dst->count += src->count;
+    dst->sum += src->sum;
+    dst->sum_of_squares += src->sum_of_squares;
+}
+
+// q is 0.0 to 1.0 - returns NAN when the sketch is empty
+LONG_DOUBLE quantile_sketch_quantile(QUANTILE_SKETCH *sk, LONG_DOUBLE q) {
+    if(unlikely(sk->count == 0.0)) return NAN;
+    if(unlikely(q <= 0.0L)) return sk->min;
+    if(unlikely(q >= 1.0L)) return sk->max;
+
+    LONG_DOUBLE rank = q * (sk->count - 1.0);
+    LONG_DOUBLE seen = 0.0;
+    LONG_DOUBLE value = sk->max;
+    int i;
+
+    // the negative values, from the lowest (the highest index) up
+    for(i = (int)sk->negative.size - 1; i >= 0 ;i--) {
+        seen += sk->negative.counts[i];
+        if(seen > rank) {
+            value = -quantile_sketch_value(sk, sk->negative.offset + i);
+            goto found;
+        }
+    }
+
+    seen += sk->zeros;
+    if(seen > rank) {
+        value = 0.0;
+        goto found;
+    }
+
+    for(i = 0; i < (int)sk->positive.size ;i++) {
+        seen += sk->positive.counts[i];
+        if(seen > rank) {
+            value = quantile_sketch_value(sk, sk->positive.offset + i);
+            goto found;
+        }
+    }
+
+found:
+    // the estimation may be slightly outside the values added
+    if(value < sk->min) value = sk->min;
+    if(value > sk->max) value = sk->max;
+    return value;
+}
+
+LONG_DOUBLE quantile_sketch_average(QUANTILE_SKETCH *sk) {
+    if(unlikely(sk->count == 0.0)) return NAN;
+    return sk->sum / sk->count;
+}
+
+// the population standard deviation, like standard_deviation()
+LONG_DOUBLE quantile_sketch_standard_deviation(QUANTILE_SKETCH *sk) {
+    if(unlikely(sk->count == 0.0)) return NAN;
+
+    LONG_DOUBLE average = sk->sum / sk->count;
+    LONG_DOUBLE variance = sk->sum_of_squares / sk->count - average * average;
+    if(unlikely(variance < 0.0L)) variance = 0.0L;
+
+    return sqrtl(variance);
+}
+
+size_t quantile_sketch_memory(QUANTILE_SKETCH *sk) {
+    return sizeof(QUANTILE_SKETCH) + (sk->positive.size + sk->negative.size) * sizeof(double);
+}
+
+// --------------------------------------------------------------------------------------------------------------------
+// latency histogram
+
+struct latency_histogram_shard {
+    LATENCY_HISTOGRAM *histogram;
+    struct latency_histogram_shard *next;
+    uint64_t counts[LATENCY_HISTOGRAM_BUCKETS];     // written only by the thread owning the shard
+};
+
+static netdata_mutex_t latency_histograms_mutex = NETDATA_MUTEX_INITIALIZER;
+static int latency_histograms_count = 0;
+
+static pthread_once_t latency_histogram_key_once = PTHREAD_ONCE_INIT;
+static pthread_key_t latency_histogram_key;
+
+// the shards of the calling thread, indexed by histogram id
+static __thread struct latency_histogram_shard **latency_histogram_thread_shards = NULL;
+
+static inline size_t latency_histogram_bucket(uint64_t value) {
+    if(value < LATENCY_HISTOGRAM_SUB_BUCKETS)
+        return (size_t)value;
+
+    int bits = 64 - __builtin_clzll(value);
+    if(unlikely(bits > LATENCY_HISTOGRAM_MAX_BITS))
+        return LATENCY_HISTOGRAM_BUCKETS - 1;
+
+    // the most significant bits select the sub-bucket
+    int shift = bits - LATENCY_HISTOGRAM_SUB_BUCKET_BITS - 1;
+    return (size_t)(shift + 1) * LATENCY_HISTOGRAM_SUB_BUCKETS + (size_t)((value >> shift) - LATENCY_HISTOGRAM_SUB_BUCKETS);
+}
+
+// the largest value counted in a bucket
+static inline uint64_t latency_histogram_bucket_value(size_t bucket) {
+    if(bucket < LATENCY_HISTOGRAM_SUB_BUCKETS)
+        return bucket;
+
+    int shift = (int)(bucket / LATENCY_HISTOGRAM_SUB_BUCKETS) - 1;
+    uint64_t lowest = (uint64_t)(LATENCY_HISTOGRAM_SUB_BUCKETS + bucket % LATENCY_HISTOGRAM_SUB_BUCKETS) << shift;
+    return lowest + ((uint64_t)1 << shift) - 1;
+}
+
+// runs when a thread exits - its counts are kept by the histograms
+static void latency_histogram_thread_exited(void *ptr) {
+    struct latency_histogram_shard **shards = (struct latency_histogram_shard **)ptr;
+    int i;
+
+    for(i = 0; i < LATENCY_HISTOGRAMS_MAX ;i++) {
+        struct latency_histogram_shard *s = shards[i];
+        if(!s) continue;
+
+        LATENCY_HISTOGRAM *h = s->histogram;
+        netdata_mutex_lock(&h->mutex);
+
+        size_t b;
+        for(b = 0; b < LATENCY_HISTOGRAM_BUCKETS ;b++)
+            h->retired[b] += s->counts[b];
+
+        struct latency_histogram_shard **ptr_to_s = &h->shards;
+        while(*ptr_to_s != s) ptr_to_s = &(*ptr_to_s)->next;
+        *ptr_to_s = s->next;
+
+        netdata_mutex_unlock(&h->mutex);
+        freez(s);
+    }
+
+    freez(shards);
+    latency_histogram_thread_shards = NULL;
+}
+
+static void latency_histogram_key_create(void) {
+    if(pthread_key_create(&latency_histogram_key, latency_histogram_thread_exited) != 0)
+        error("Cannot create the thread key of latency histograms. The counts of exiting threads will be lost.");
+}
+
+static int latency_histogram_register(LATENCY_HISTOGRAM *h) {
+    netdata_mutex_lock(&latency_histograms_mutex);
+
+    int id = __atomic_load_n(&h->id, __ATOMIC_ACQUIRE);
+    if(!id) {
+        if(latency_histograms_count < LATENCY_HISTOGRAMS_MAX)
+            id = ++latency_histograms_count;
+        else {
+            error("Cannot add latency histogram '%s', the maximum of %d histograms has been reached.", h->name, LATENCY_HISTOGRAMS_MAX);
+            id = -1;
+        }
+
+        __atomic_store_n(&h->id, id, __ATOMIC_RELEASE);
+    }
+
+    netdata_mutex_unlock(&latency_histograms_mutex);
+    return id;
+}
+
+static struct latency_histogram_shard *latency_histogram_shard_create(LATENCY_HISTOGRAM *h, int id) {
+    if(unlikely(!latency_histogram_thread_shards)) {
+        pthread_once(&latency_histogram_key_once, latency_histogram_key_create);
+        latency_histogram_thread_shards = callocz(LATENCY_HISTOGRAMS_MAX, sizeof(struct latency_histogram_shard *));
+        pthread_setspecific(latency_histogram_key, latency_histogram_thread_shards);
+    }
+
+    struct latency_histogram_shard *s = callocz(1, sizeof(struct latency_histogram_shard));
+    s->histogram = h;
+
+    netdata_mutex_lock(&h->mutex);
+    s->next = h->shards;
+    h->shards = s;
+    netdata_mutex_unlock(&h->mutex);
+
+    latency_histogram_thread_shards[id - 1] = s;
+    return s;
+}
+
+void latency_histogram_add(LATENCY_HISTOGRAM *h, uint64_t value) {
+    int id = __atomic_load_n(&h->id, __ATOMIC_ACQUIRE);
+    if(unlikely(id <= 0)) {
+        if(id < 0 || (id = latency_histogram_register(h)) < 0)
+            return;
+    }
+
+    struct latency_histogram_shard *s = (likely(latency_histogram_thread_shards)) ? latency_histogram_thread_shards[id - 1] : NULL;
+    if(unlikely(!s))
+        s = latency_histogram_shard_create(h, id);
+
+    // only this thread writes to its shard, readers just need to see whole values
+    size_t b = latency_histogram_bucket(value);
+    __atomic_store_n(&s->counts[b], s->counts[b] + 1, __ATOMIC_RELAXED);
+}
+
+int latency_histogram_used(LATENCY_HISTOGRAM *h) {
+    return __atomic_load_n(&h->id, __ATOMIC_ACQUIRE) > 0;
+}
+
+// returns the number of values added since the previous call,
+// and sets values[] to their percentiles[] (0 - 100)
+// a histogram should have only one reader, since every read starts a new interval
+uint64_t latency_histogram_read(LATENCY_HISTOGRAM *h, const double *percentiles, uint64_t *values, size_t count) {
+    uint64_t interval[LATENCY_HISTOGRAM_BUCKETS], samples = 0;
+    size_t b, i;
+
+    for(i = 0; i < count ;i++)
+        values[i] = 0;
+
+    if(unlikely(!latency_histogram_used(h)))
+        return 0;
+
+    netdata_mutex_lock(&h->mutex);
+    for(b = 0; b < LATENCY_HISTOGRAM_BUCKETS ;b++) {
+        uint64_t total = h->retired[b];
+
+        struct latency_histogram_shard *s;
+        for(s = h->shards; s ; s = s->next)
+            total += __atomic_load_n(&s->counts[b], __ATOMIC_RELAXED);
+
+        interval[b] = total - h->read[b];
+        h->read[b] = total;
+        samples += interval[b];
+    }
+    netdata_mutex_unlock(&h->mutex);
+
+    if(!samples)
+        return 0;
+
+    for(i = 0; i < count ;i++) {
+        uint64_t rank = (uint64_t)ceil(percentiles[i] * (double)samples / 100.0), seen = 0;
+        if(rank < 1) rank = 1;
+        if(rank > samples) rank = samples;
+
+        for(b = 0; b < LATENCY_HISTOGRAM_BUCKETS ;b++) {
+            seen += interval[b];
+            if(seen >= rank) {
+                values[i] = latency_histogram_bucket_value(b);
+                break;
+            }
+        }
+    }
+
+    return samples;
+}
@@ -23,4 +23,71 @@ extern LONG_DOUBLE median_on_sorted_series(const LONG_DOUBLE *series, size_t ent
 extern LONG_DOUBLE *copy_series(const LONG_DOUBLE *series, size_t entries);
 extern void sort_series(LONG_DOUBLE *series, size_t entries);
 
+// quantile sketch - estimates quantiles of a stream of weighted values, with bounded relative error
+#define QUANTILE_SKETCH_DEFAULT_RELATIVE_ACCURACY 0.01
+#define QUANTILE_SKETCH_DEFAULT_MAX_BUCKETS 2048
+
+typedef struct quantile_sketch_store {
+    int offset;                 // the bucket index of counts[0]
+    size_t size;                // the number of buckets allocated
+    double *counts;             // the weight of the values in each bucket
+} QUANTILE_SKETCH_STORE;
+
+typedef struct quantile_sketch {
+    LONG_DOUBLE relative_accuracy;
+    LONG_DOUBLE gamma;
+    LONG_DOUBLE ln_gamma;
+    size_t max_buckets;         // per store - above it, the lowest buckets are collapsed
+
+    QUANTILE_SKETCH_STORE positive;
+    QUANTILE_SKETCH_STORE negative;
+    double zeros;
+
+    double count;               // the total weight of the values added
+    LONG_DOUBLE sum;
+    LONG_DOUBLE sum_of_squares;
+    LONG_DOUBLE min;
+    LONG_DOUBLE max;
+} QUANTILE_SKETCH;
+
+extern void quantile_sketch_init(QUANTILE_SKETCH *sk, LONG_DOUBLE relative_accuracy, size_t max_buckets);
+extern void quantile_sketch_free(QUANTILE_SKETCH *sk);
+extern void quantile_sketch_reset(QUANTILE_SKETCH *sk);
+extern void quantile_sketch_add(QUANTILE_SKETCH *sk, LONG_DOUBLE value, double weight);
+extern void quantile_sketch_merge(QUANTILE_SKETCH *dst, QUANTILE_SKETCH *src);
+extern LONG_DOUBLE quantile_sketch_quantile(QUANTILE_SKETCH *sk, LONG_DOUBLE q);
+extern LONG_DOUBLE quantile_sketch_average(QUANTILE_SKETCH *sk);
+extern LONG_DOUBLE quantile_sketch_standard_deviation(QUANTILE_SKETCH *sk);
+extern size_t quantile_sketch_memory(QUANTILE_SKETCH *sk);
+
+// latency histogram - counts unsigned values (e.g. durations in microseconds) in log-linear buckets,
+// like HDR histograms: values below 32 are exact, larger ones are within 1/16 (6.25%) of their bucket.
+// every thread adds to its own shard, without locks - the shards are merged when the histogram is read.
+#define LATENCY_HISTOGRAM_SUB_BUCKET_BITS 4
+#define LATENCY_HISTOGRAM_SUB_BUCKETS (1 << LATENCY_HISTOGRAM_SUB_BUCKET_BITS)
+#define LATENCY_HISTOGRAM_MAX_BITS 40  // larger values are counted in the last bucket
+#define LATENCY_HISTOGRAM_BUCKETS (LATENCY_HISTOGRAM_SUB_BUCKETS * (LATENCY_HISTOGRAM_MAX_BITS - LATENCY_HISTOGRAM_SUB_BUCKET_BITS + 1))
+#define LATENCY_HISTOGRAMS_MAX 64
+
+typedef struct latency_histogram {
+    const char *name;
+    int id;                                         // 0 until first used, -1 if there were too many histograms
+
+    netdata_mutex_t mutex;                          // protects the shards list, retired and read
+    struct latency_histogram_shard *shards;         // one per thread that added values
+    uint64_t retired[LATENCY_HISTOGRAM_BUCKETS];    // the counts of the threads that exited
+    uint64_t read[LATENCY_HISTOGRAM_BUCKETS];       // the counts at the previous latency_histogram_read()
+} LATENCY_HISTOGRAM;
+
+#define LATENCY_HISTOGRAM_INITIALIZER(histogram_name) { \
+        .name = (histogram_name), \
+        .id = 0, \
+        .mutex = NETDATA_MUTEX_INITIALIZER, \
+        .shards = NULL \
+    }
+
+extern void latency_histogram_add(LATENCY_HISTOGRAM *h, uint64_t value);
+extern uint64_t latency_histogram_read(LATENCY_HISTOGRAM *h, const double *percentiles, uint64_t *values, size_t count);
+extern int latency_histogram_used(LATENCY_HISTOGRAM *h);
+
 #endif //NETDATA_STATISTICAL_H
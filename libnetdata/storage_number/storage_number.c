@@ -2,6 +2,91 @@
 
 #include "../libnetdata.h"
 
+// ----------------------------------------------------------------------------
+// powers of 10 and 100 are exact in calculated_number,
+// so the tables give the same results the loops of multiplications gave
+
+static const calculated_number storage_number_powers_of_10[8] = {
+        1.0, 10.0, 100.0, 1000.0, 10000.0, 100000.0, 1000000.0, 10000000.0
+};
+
+static const calculated_number storage_number_powers_of_100[8] = {
+        1.0, 100.0, 10000.0, 1000000.0, 100000000.0, 10000000000.0, 1000000000000.0, 100000000000000.0
+};
+
+// the largest values that fit in 24 bits after dividing them m times by 10 or 100
+static const calculated_number storage_number_divide_limits_10[8] = {
+        (calculated_number)0x00ffffff,
+        (calculated_number)0x00ffffff * 10.0,
+        (calculated_number)0x00ffffff * 100.0,
+        (calculated_number)0x00ffffff * 1000.0,
+        (calculated_number)0x00ffffff * 10000.0,
+        (calculated_number)0x00ffffff * 100000.0,
+        (calculated_number)0x00ffffff * 1000000.0,
+        (calculated_number)0x00ffffff * 10000000.0
+};
+
+static const calculated_number storage_number_divide_limits_100[8] = {
+        (calculated_number)0x00ffffff,
+        (calculated_number)0x00ffffff * 100.0,
+        (calculated_number)0x00ffffff * 10000.0,
+        (calculated_number)0x00ffffff * 1000000.0,
+        (calculated_number)0x00ffffff * 100000000.0,
+        (calculated_number)0x00ffffff * 10000000000.0,
+        (calculated_number)0x00ffffff * 1000000000000.0,
+        (calculated_number)0x00ffffff * 100000000000000.0
+};
+
+// unpacking multiplies by the first and divides by the second table,
+// indexed by the top 6 bits: sign, divide/multiply, multiplier/divider and 10/100
+// one of the two is always 1, so the result is the single multiplication
+// or division the value needs
+static const calculated_number storage_number_unpack_multipliers[64] = {
+        // positive, divide
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        // positive, multiply by 10 or 100, 0 to 7 times
+        1.0, 1.0, 10.0, 100.0,
+        100.0, 10000.0, 1000.0, 1000000.0,
+        10000.0, 100000000.0, 100000.0, 10000000000.0,
+        1000000.0, 1000000000000.0, 10000000.0, 100000000000000.0,
+        // negative, divide
+        -1.0, -1.0, -1.0, -1.0,
+        -1.0, -1.0, -1.0, -1.0,
+        -1.0, -1.0, -1.0, -1.0,
+        -1.0, -1.0, -1.0, -1.0,
+        // negative, multiply by 10 or 100, 0 to 7 times
+        -1.0, -1.0, -10.0, -100.0,
+        -100.0, -10000.0, -1000.0, -1000000.0,
+        -10000.0, -100000000.0, -100000.0, -10000000000.0,
+        -1000000.0, -1000000000000.0, -10000000.0, -100000000000000.0
+};
+
+static const calculated_number storage_number_unpack_dividers[64] = {
+        // positive, divide by 10, 0 to 7 times
+        1.0, 1.0, 10.0, 10.0,
+        100.0, 100.0, 1000.0, 1000.0,
+        10000.0, 10000.0, 100000.0, 100000.0,
+        1000000.0, 1000000.0, 10000000.0, 10000000.0,
+        // positive, multiply
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        // negative, divide by 10, 0 to 7 times
+        1.0, 1.0, 10.0, 10.0,
+        100.0, 100.0, 1000.0, 1000.0,
+        10000.0, 10000.0, 100000.0, 100000.0,
+        1000000.0, 1000000.0, 10000000.0, 10000000.0,
+        // negative, multiply
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0,
+        1.0, 1.0, 1.0, 1.0
+};
+
 storage_number pack_storage_number(calculated_number value, uint32_t flags) {
     // bit 32 = sign 0:positive, 1:negative
     // bit 31 = 0:divide, 1:multiply
@@ -14,8 +99,8 @@ storage_number pack_storage_number(calculated_number value, uint32_t flags) {
     storage_number r = get_storage_number_flags(flags);
     if(!value) return r;
 
-    int m = 0;
-    calculated_number n = value, factor = 10;
+    int m;
+    calculated_number n = value;
 
     // if the value is negative
     // add the sign bit and make it positive
@@ -24,31 +109,32 @@ storage_number pack_storage_number(calculated_number value, uint32_t flags) {
         n = -n;
     }
 
-    if(n / 10000000.0 > 0x00ffffff) {
-        factor = 100;
-        r |= SN_EXISTS_100;
-    }
+    if(n > (calculated_number)0x00ffffff) {
+        // make its integer part fit in 0x00ffffff
+        // by dividing it by 10 (or 100) up to 7 times
+        const calculated_number *limits = storage_number_divide_limits_10, *powers = storage_number_powers_of_10;
 
-    // make its integer part fit in 0x00ffffff
-    // by dividing it by 10 up to 7 times
-    // and increasing the multiplier
-    while(m < 7 && n > (calculated_number)0x00ffffff) {
-        n /= factor;
-        m++;
-    }
+        if(n > storage_number_divide_limits_10[7]) {
+            limits = storage_number_divide_limits_100;
+            powers = storage_number_powers_of_100;
+            r |= SN_EXISTS_100;
+        }
+
+        for(m = 1; m < 7 && n > limits[m] ; m++) ;
 
-    if(m) {
         // the value was too big and we divided it
         // so we add a multiplier to unpack it
         r += (1 << 30) + (m << 27); // the multiplier m
 
-        if(n > (calculated_number)0x00ffffff) {
+        if(n > limits[m]) {
             #ifdef NETDATA_INTERNAL_CHECKS
             error("Number " CALCULATED_NUMBER_FORMAT " is too big.", value);
             #endif
             r += 0x00ffffff;
             return r;
         }
+
+        n /= powers[m];
     }
     else {
         // 0x0019999e is the number that can be multiplied
@@ -56,10 +142,10 @@ storage_number pack_storage_number(calculated_number value, uint32_t flags) {
         // while the value is below 0x0019999e we can
         // multiply it by 10, up to 7 times, increasing
         // the multiplier
-        while(m < 7 && n < (calculated_number)0x0019999e) {
+        // multiplications by 10 are cheap and the sequence of them
+        // rounds differently than a single multiplication
+        for(m = 0; m < 7 && n < (calculated_number)0x0019999e ; m++)
             n *= 10;
-            m++;
-        }
 
         if (unlikely(n > (calculated_number) (0x00ffffff))) {
             n /= 10;
@@ -82,47 +168,20 @@ storage_number pack_storage_number(calculated_number value, uint32_t flags) {
 }
 
 calculated_number unpack_storage_number(storage_number value) {
-    if(!value) return 0;
-
-    int sign = 0, exp = 0;
-    int factor = 10;
-
     // bit 32 = 0:positive, 1:negative
-    if(unlikely(value & (1 << 31)))
-        sign = 1;
-
     // bit 31 = 0:divide, 1:multiply
-    if(unlikely(value & (1 << 30)))
-        exp = 1;
-
+    // bit 30, 29, 28 = (multiplier or divider) 0-7 (8 total)
     // bit 27 SN_EXISTS_100
-    if(unlikely(value & (1 << 26)))
-        factor = 100;
+    // select the scaling of the value
+    int i = (int)(value >> 26);
 
     // bit 26 SN_EXISTS_RESET
     // bit 25 SN_EXISTS
 
-    // bit 30, 29, 28 = (multiplier or divider) 0-7 (8 total)
-    int mul = (value & ((1<<29)|(1<<28)|(1<<27))) >> 27;
-
-    // bit 24 to bit 1 = the value, so remove all other bits
-    value ^= value & ((1<<31)|(1<<30)|(1<<29)|(1<<28)|(1<<27)|(1<<26)|(1<<25)|(1<<24));
-
-    calculated_number n = value;
-
-    // fprintf(stderr, "UNPACK: %08X, sign = %d, exp = %d, mul = %d, factor = %d, n = " CALCULATED_NUMBER_FORMAT "\n", value, sign, exp, mul, factor, n);
-
-    if(exp) {
-        for(; mul; mul--)
-            n *= factor;
-    }
-    else {
-        for( ; mul ; mul--)
-            n /= 10;
-    }
+    // bit 24 to bit 1 = the value
+    calculated_number n = (calculated_number)(value & 0x00ffffff);
 
-    if(sign) n = -n;
-    return n;
+    return n * storage_number_unpack_multipliers[i] / storage_number_unpack_dividers[i];
 }
 
 /*
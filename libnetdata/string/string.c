@@ -0,0 +1,186 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "../libnetdata.h"
+
+// ----------------------------------------------------------------------------
+// the interned strings are indexed in hash tables with chaining,
+// partitioned by hash, so that unrelated strings do not contend for locks
+
+#define STRING_PARTITIONS 32
+#define STRING_PARTITION_MIN_BUCKETS 64
+
+typedef struct netdata_string {
+    struct netdata_string *next;
+    uint32_t hash;
+    uint32_t length;
+    int32_t refcount;
+    char str[];
+} NETDATA_STRING;
+
+#define string_from_str(s) ((NETDATA_STRING *)((char *)(s) - offsetof(NETDATA_STRING, str)))
+
+static struct string_partition {
+    netdata_rwlock_t rwlock;
+    NETDATA_STRING **buckets;
+    size_t size;                    // a power of 2
+    size_t entries;
+} string_partitions[STRING_PARTITIONS];
+
+static pthread_once_t string_partitions_once = PTHREAD_ONCE_INIT;
+
+static size_t string_entries = 0, string_references = 0, string_memory = 0, string_duplications = 0;
+
+static void string_partitions_init(void) {
+    int i;
+    for(i = 0; i < STRING_PARTITIONS ;i++) {
+        netdata_rwlock_init(&string_partitions[i].rwlock);
+        string_partitions[i].size = STRING_PARTITION_MIN_BUCKETS;
+        string_partitions[i].buckets = callocz(STRING_PARTITION_MIN_BUCKETS, sizeof(NETDATA_STRING *));
+    }
+}
+
+static inline struct string_partition *string_partition(uint32_t hash) {
+    // the high bits select the partition, the low bits the bucket
+    return &string_partitions[(hash >> 24) & (STRING_PARTITIONS - 1)];
+}
+
+static inline NETDATA_STRING *string_find_nolock(struct string_partition *p, const char *str, size_t length, uint32_t hash) {
+    NETDATA_STRING *s;
+    for(s = p->buckets[hash & (p->size - 1)]; s ; s = s->next)
+        if(s->hash == hash && s->length == length && !memcmp(s->str, str, length))
+            return s;
+
+    return NULL;
+}
+
+static void string_partition_grow_nolock(struct string_partition *p) {
+    size_t size = p->size * 2, i;
+    NETDATA_STRING **buckets = callocz(size, sizeof(NETDATA_STRING *));
+
+    for(i = 0; i < p->size ;i++) {
+        NETDATA_STRING *s = p->buckets[i];
+        while(s) {
+            NETDATA_STRING *next = s->next;
+            s->next = buckets[s->hash & (size - 1)];
+            buckets[s->hash & (size - 1)] = s;
+            s = next;
+        }
+    }
+
+    freez(p->buckets);
+    p->buckets = buckets;
+    p->size = size;
+}
+
+const char *string_strdupz(const char *str) {
+    if(unlikely(!str))
+        return NULL;
+
+    pthread_once(&string_partitions_once, string_partitions_init);
+
+    uint32_t hash = simple_hash(str);
+    size_t length = strlen(str);
+    struct string_partition *p = string_partition(hash);
+
+    netdata_rwlock_rdlock(&p->rwlock);
+    NETDATA_STRING *s = string_find_nolock(p, str, length, hash);
+    if(likely(s))
+        __atomic_add_fetch(&s->refcount, 1, __ATOMIC_RELAXED);
+    netdata_rwlock_unlock(&p->rwlock);
+
+    if(likely(s)) {
+        __atomic_add_fetch(&string_references, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&string_duplications, 1, __ATOMIC_RELAXED);
+        return s->str;
+    }
+
+    netdata_rwlock_wrlock(&p->rwlock);
+
+    // another thread may have added it while we were not locked
+    s = string_find_nolock(p, str, length, hash);
+    if(unlikely(s)) {
+        __atomic_add_fetch(&s->refcount, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&string_duplications, 1, __ATOMIC_RELAXED);
+    }
+    else {
+        size_t size = sizeof(NETDATA_STRING) + length + 1;
+        s = mallocz(size);
+        s->hash = hash;
+        s->length = (uint32_t)length;
+        s->refcount = 1;
+        memcpy(s->str, str, length + 1);
+
+        if(unlikely(p->entries >= p->size * 2))
+            string_partition_grow_nolock(p);
+
+        s->next = p->buckets[hash & (p->size - 1)];
+        p->buckets[hash & (p->size - 1)] = s;
+        p->entries++;
+
+        __atomic_add_fetch(&string_entries, 1, __ATOMIC_RELAXED);
+        __atomic_add_fetch(&string_memory, size, __ATOMIC_RELAXED);
+    }
+
+    netdata_rwlock_unlock(&p->rwlock);
+
+    __atomic_add_fetch(&string_references, 1, __ATOMIC_RELAXED);
+    return s->str;
+}
+
+const char *string_dup(const char *string) {
+    if(unlikely(!string))
+        return NULL;
+
+    __atomic_add_fetch(&string_from_str(string)->refcount, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&string_references, 1, __ATOMIC_RELAXED);
+    return string;
+}
+
+void string_freez(const char *string) {
+    if(unlikely(!string))
+        return;
+
+    NETDATA_STRING *s = string_from_str(string);
+    __atomic_sub_fetch(&string_references, 1, __ATOMIC_RELAXED);
+
+    // while other references remain, there is no need to lock
+    int32_t refcount = __atomic_load_n(&s->refcount, __ATOMIC_RELAXED);
+    while(refcount > 1) {
+        if(__atomic_compare_exchange_n(&s->refcount, &refcount, refcount - 1, 0, __ATOMIC_RELEASE, __ATOMIC_RELAXED))
+            return;
+    }
+
+    // the last reference may go - the lock prevents others from finding it meanwhile
+    struct string_partition *p = string_partition(s->hash);
+    netdata_rwlock_wrlock(&p->rwlock);
+
+    if(__atomic_sub_fetch(&s->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        NETDATA_STRING **ptr = &p->buckets[s->hash & (p->size - 1)];
+        while(*ptr != s) ptr = &(*ptr)->next;
+        *ptr = s->next;
+        p->entries--;
+
+        __atomic_sub_fetch(&string_entries, 1, __ATOMIC_RELAXED);
+        __atomic_sub_fetch(&string_memory, sizeof(NETDATA_STRING) + s->length + 1, __ATOMIC_RELAXED);
+        freez(s);
+    }
+
+    netdata_rwlock_unlock(&p->rwlock);
+}
+
+size_t string_length(const char *string) {
+    if(unlikely(!string)) return 0;
+    return string_from_str(string)->length;
+}
+
+uint32_t string_hash(const char *string) {
+    if(unlikely(!string)) return 0;
+    return string_from_str(string)->hash;
+}
+
+void string_statistics(size_t *entries, size_t *references, size_t *memory, size_t *duplications) {
+    if(entries)      *entries      = __atomic_load_n(&string_entries, __ATOMIC_RELAXED);
+    if(references)   *references   = __atomic_load_n(&string_references, __ATOMIC_RELAXED);
+    if(memory)       *memory       = __atomic_load_n(&string_memory, __ATOMIC_RELAXED);
+    if(duplications) *duplications = __atomic_load_n(&string_duplications, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,25 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_STRING_H
+#define NETDATA_STRING_H 1
+
+#include "../libnetdata.h"
+
+// ----------------------------------------------------------------------------
+// interned strings
+//
+// Identical strings share a single immutable, reference counted copy.
+// The pointers returned are plain C strings, that must not be modified
+// and must be released with string_freez().
+// Two interned strings are equal when their pointers are equal.
+
+extern const char *string_strdupz(const char *str);
+extern const char *string_dup(const char *string);
+extern void string_freez(const char *string);
+
+extern size_t string_length(const char *string);
+extern uint32_t string_hash(const char *string);
+
+extern void string_statistics(size_t *entries, size_t *references, size_t *memory, size_t *duplications);
+
+#endif /* NETDATA_STRING_H */
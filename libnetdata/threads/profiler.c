@@ -0,0 +1,521 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#include "../libnetdata.h"
+
+#if defined(__linux__) && defined(HAVE_EXECINFO_H) && defined(HAVE_TIMER_CREATE) && defined(HAVE_DLADDR)
+#define NETDATA_PROFILER 1
+#endif
+
+#ifdef NETDATA_PROFILER
+
+#include <execinfo.h>
+#include <dlfcn.h>
+#include <link.h>
+#include <elf.h>
+
+#ifndef sigev_notify_thread_id
+#define sigev_notify_thread_id _sigev_un._tid
+#endif
+
+#if __SIZEOF_POINTER__ == 8
+#define PROFILER_ELF_ST_TYPE(info) ELF64_ST_TYPE(info)
+#else
+#define PROFILER_ELF_ST_TYPE(info) ELF32_ST_TYPE(info)
+#endif
+
+#define PROFILER_MAX_DEPTH 64
+#define PROFILER_SKIP_FRAMES 2      // the signal handler and the signal trampoline
+#define PROFILER_RING_SAMPLES 32    // a power of 2
+#define PROFILER_DRAIN_USEC (100 * USEC_PER_MS)
+
+struct profiler_sample {
+    int depth;
+    void *pc[PROFILER_MAX_DEPTH];
+};
+
+struct profiler_thread {
+    char *tag;
+    timer_t timer;
+
+    size_t head;                // advanced only by the signal handler of the thread
+    size_t tail;                // advanced only by the PROFILER thread
+    int exited;
+
+    struct profiler_thread *next;
+    struct profiler_sample samples[PROFILER_RING_SAMPLES];
+};
+
+// the aggregated stacks are indexed by thread tag and the addresses of their frames
+struct profiler_stack {
+    uint64_t count;
+    int depth;
+    void *pc[PROFILER_MAX_DEPTH];
+};
+
+static int profiler_running = 0;
+static struct itimerspec profiler_interval;
+static netdata_thread_t profiler_aggregator;
+
+static __thread struct profiler_thread *profiler_thread = NULL;
+
+static netdata_mutex_t profiler_threads_mutex = NETDATA_MUTEX_INITIALIZER;
+static struct profiler_thread *profiler_threads = NULL;
+
+static netdata_mutex_t profiler_stacks_mutex = NETDATA_MUTEX_INITIALIZER;
+static DICTIONARY *profiler_stacks = NULL;
+
+static uint64_t profiler_samples = 0, profiler_dropped = 0;
+
+// ----------------------------------------------------------------------------
+// sampling
+
+static void profiler_signal_handler(int signo, siginfo_t *info, void *context) {
+    (void)signo;
+    (void)info;
+    (void)context;
+
+    struct profiler_thread *t = profiler_thread;
+    if(unlikely(!t)) return;
+
+    int saved_errno = errno;
+
+    size_t head = t->head;
+    if(likely(head - __atomic_load_n(&t->tail, __ATOMIC_ACQUIRE) < PROFILER_RING_SAMPLES)) {
+        struct profiler_sample *s = &t->samples[head & (PROFILER_RING_SAMPLES - 1)];
+        s->depth = backtrace(s->pc, PROFILER_MAX_DEPTH);
+        __atomic_store_n(&t->head, head + 1, __ATOMIC_RELEASE);
+        __atomic_fetch_add(&profiler_samples, 1, __ATOMIC_RELAXED);
+    }
+    else
+        __atomic_fetch_add(&profiler_dropped, 1, __ATOMIC_RELAXED);
+
+    errno = saved_errno;
+}
+
+void profiler_thread_start(void) {
+    if(!__atomic_load_n(&profiler_running, __ATOMIC_ACQUIRE) || profiler_thread)
+        return;
+
+    clockid_t clock;
+    if(pthread_getcpuclockid(pthread_self(), &clock) != 0) {
+        error("PROFILER: cannot get the CPU clock of thread %d", gettid());
+        return;
+    }
+
+    struct profiler_thread *t = callocz(1, sizeof(struct profiler_thread));
+    t->tag = strdupz(netdata_thread_tag());
+
+    struct sigevent sev;
+    memset(&sev, 0, sizeof(sev));
+    sev.sigev_notify = SIGEV_THREAD_ID;
+    sev.sigev_signo = SIGPROF;
+    sev.sigev_notify_thread_id = gettid();
+
+    if(timer_create(clock, &sev, &t->timer) != 0) {
+        error("PROFILER: cannot create the sampling timer of thread %d (%s)", gettid(), t->tag);
+        freez(t->tag);
+        freez(t);
+        return;
+    }
+
+    netdata_mutex_lock(&profiler_threads_mutex);
+    t->next = profiler_threads;
+    profiler_threads = t;
+    netdata_mutex_unlock(&profiler_threads_mutex);
+
+    profiler_thread = t;
+
+    // netdata threads block all signals
+    sigset_t sigset;
+    sigemptyset(&sigset);
+    sigaddset(&sigset, SIGPROF);
+    pthread_sigmask(SIG_UNBLOCK, &sigset, NULL);
+
+    if(timer_settime(t->timer, 0, &profiler_interval, NULL) != 0)
+        error("PROFILER: cannot start the sampling timer of thread %d (%s)", gettid(), t->tag);
+}
+
+void profiler_thread_stop(void) {
+    struct profiler_thread *t = profiler_thread;
+    if(!t) return;
+
+    timer_delete(t->timer);
+
+    // a signal still pending will find no ring
+    profiler_thread = NULL;
+    __atomic_signal_fence(__ATOMIC_SEQ_CST);
+
+    // the PROFILER thread frees the ring, once it is drained
+    __atomic_store_n(&t->exited, 1, __ATOMIC_RELEASE);
+}
+
+// ----------------------------------------------------------------------------
+// aggregation
+
+static inline char *profiler_hex(char *s, uintptr_t n) {
+    static const char digits[] = "0123456789abcdef";
+    char buf[sizeof(uintptr_t) * 2], *b = buf;
+
+    do {
+        *b++ = digits[n & 0xf];
+        n >>= 4;
+    } while(n);
+
+    while(b > buf)
+        *s++ = *--b;
+
+    return s;
+}
+
+static void profiler_aggregate(const char *tag, struct profiler_sample *sample) {
+    int depth = sample->depth, i;
+    if(depth <= PROFILER_SKIP_FRAMES) return;
+
+    char key[NETDATA_THREAD_TAG_MAX + 1 + PROFILER_MAX_DEPTH * (sizeof(uintptr_t) * 2 + 1) + 1], *s = key;
+    size_t len = strlen(tag);
+    if(len > NETDATA_THREAD_TAG_MAX) len = NETDATA_THREAD_TAG_MAX;
+    memcpy(s, tag, len);
+    s += len;
+
+    for(i = PROFILER_SKIP_FRAMES; i < depth ;i++) {
+        *s++ = ';';
+        s = profiler_hex(s, (uintptr_t)sample->pc[i]);
+    }
+    *s = '\0';
+
+    struct profiler_stack *st = dictionary_get(profiler_stacks, key);
+    if(unlikely(!st)) {
+        struct profiler_stack tmp;
+        tmp.count = 0;
+        tmp.depth = depth - PROFILER_SKIP_FRAMES;
+        memcpy(tmp.pc, &sample->pc[PROFILER_SKIP_FRAMES], sizeof(void *) * tmp.depth);
+        st = dictionary_set(profiler_stacks, key, &tmp, sizeof(struct profiler_stack));
+    }
+
+    st->count++;
+}
+
+static void profiler_drain(void) {
+    netdata_mutex_lock(&profiler_threads_mutex);
+    netdata_mutex_lock(&profiler_stacks_mutex);
+
+    struct profiler_thread **ptr = &profiler_threads;
+    while(*ptr) {
+        struct profiler_thread *t = *ptr;
+        int exited = __atomic_load_n(&t->exited, __ATOMIC_ACQUIRE);
+        size_t head = __atomic_load_n(&t->head, __ATOMIC_ACQUIRE), tail = t->tail;
+
+        for(; tail != head ; tail++)
+            profiler_aggregate(t->tag, &t->samples[tail & (PROFILER_RING_SAMPLES - 1)]);
+
+        __atomic_store_n(&t->tail, tail, __ATOMIC_RELEASE);
+
+        if(exited) {
+            *ptr = t->next;
+            freez(t->tag);
+            freez(t);
+        }
+        else
+            ptr = &t->next;
+    }
+
+    netdata_mutex_unlock(&profiler_stacks_mutex);
+    netdata_mutex_unlock(&profiler_threads_mutex);
+}
+
+static void *profiler_aggregator_main(void *ptr) {
+    (void)ptr;
+
+    heartbeat_t hb;
+    heartbeat_init(&hb);
+
+    while(!netdata_exit) {
+        heartbeat_next(&hb, PROFILER_DRAIN_USEC);
+        profiler_drain();
+    }
+
+    return NULL;
+}
+
+// ----------------------------------------------------------------------------
+// symbols
+// the functions of netdata are not exported, so dladdr() cannot name them -
+// they are looked up in the symbol table of the executable, when it is not stripped
+
+struct profiler_symbol {
+    uintptr_t address;
+    size_t size;
+    char *name;
+};
+
+static pthread_once_t profiler_symbols_once = PTHREAD_ONCE_INIT;
+static struct profiler_symbol *profiler_symbols = NULL;
+static size_t profiler_symbols_count = 0;
+static uintptr_t profiler_executable_base = 0;
+
+static int profiler_executable_base_callback(struct dl_phdr_info *info, size_t size, void *data) {
+    (void)size;
+    (void)data;
+
+    // the first object is the executable
+    profiler_executable_base = (uintptr_t)info->dlpi_addr;
+    return 1;
+}
+
+static int profiler_symbol_compare(const void *a, const void *b) {
+    uintptr_t x = ((const struct profiler_symbol *)a)->address, y = ((const struct profiler_symbol *)b)->address;
+    return (x < y) ? -1 : (x > y) ? 1 : 0;
+}
+
+static void profiler_symbols_load(void) {
+    dl_iterate_phdr(profiler_executable_base_callback, NULL);
+
+    int fd = open("/proc/self/exe", O_RDONLY);
+    if(fd == -1) return;
+
+    struct stat st;
+    if(fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(ElfW(Ehdr))) {
+        close(fd);
+        return;
+    }
+
+    size_t size = (size_t)st.st_size;
+    char *elf = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(elf == MAP_FAILED) return;
+
+    ElfW(Ehdr) *eh = (ElfW(Ehdr) *)elf;
+    if(memcmp(eh->e_ident, ELFMAG, SELFMAG) != 0 || eh->e_shoff + (size_t)eh->e_shnum * sizeof(ElfW(Shdr)) > size) {
+        munmap(elf, size);
+        return;
+    }
+
+    ElfW(Shdr) *sh = (ElfW(Shdr) *)(elf + eh->e_shoff);
+    size_t i, s, allocated = 0;
+
+    for(i = 0; i < eh->e_shnum ;i++) {
+        if(sh[i].sh_type != SHT_SYMTAB || sh[i].sh_link >= eh->e_shnum) continue;
+
+        ElfW(Shdr) *strtab = &sh[sh[i].sh_link];
+        if(sh[i].sh_offset + sh[i].sh_size > size || strtab->sh_offset + strtab->sh_size > size) continue;
+
+        ElfW(Sym) *syms = (ElfW(Sym) *)(elf + sh[i].sh_offset);
+        size_t entries = sh[i].sh_size / sizeof(ElfW(Sym));
+
+        for(s = 0; s < entries ;s++) {
+            if(PROFILER_ELF_ST_TYPE(syms[s].st_info) != STT_FUNC || !syms[s].st_value || !syms[s].st_name || syms[s].st_name >= strtab->sh_size)
+                continue;
+
+            if(profiler_symbols_count == allocated) {
+                allocated = (allocated) ? allocated * 2 : 1024;
+                profiler_symbols = reallocz(profiler_symbols, allocated * sizeof(struct profiler_symbol));
+            }
+
+            struct profiler_symbol *sym = &profiler_symbols[profiler_symbols_count++];
+            sym->address = (uintptr_t)syms[s].st_value;
+            sym->size = (size_t)syms[s].st_size;
+            sym->name = strdupz(elf + strtab->sh_offset + syms[s].st_name);
+        }
+    }
+
+    munmap(elf, size);
+
+    if(profiler_symbols_count)
+        qsort(profiler_symbols, profiler_symbols_count, sizeof(struct profiler_symbol), profiler_symbol_compare);
+
+    info("PROFILER: loaded %zu function symbols of the executable", profiler_symbols_count);
+}
+
+static const char *profiler_executable_symbol(uintptr_t pc) {
+    uintptr_t address = pc - profiler_executable_base;
+    size_t low = 0, high = profiler_symbols_count;
+
+    // the last symbol starting at or before the address
+    while(low < high) {
+        size_t mid = (low + high) / 2;
+        if(profiler_symbols[mid].address <= address)
+            low = mid + 1;
+        else
+            high = mid;
+    }
+
+    if(!low) return NULL;
+
+    struct profiler_symbol *sym = &profiler_symbols[low - 1];
+    if(address >= sym->address + ((sym->size) ? sym->size : 1))
+        return NULL;
+
+    return sym->name;
+}
+
+static void profiler_symbol(BUFFER *wb, void *pc) {
+    const char *name = profiler_executable_symbol((uintptr_t)pc);
+    if(name) {
+        buffer_strcat(wb, name);
+        return;
+    }
+
+    Dl_info info;
+    memset(&info, 0, sizeof(info));
+    if(!dladdr(pc, &info)) {
+        buffer_sprintf(wb, "0x%lx", (unsigned long)(uintptr_t)pc);
+        return;
+    }
+
+    if(info.dli_sname) {
+        buffer_strcat(wb, info.dli_sname);
+        return;
+    }
+
+    if(info.dli_fname && *info.dli_fname) {
+        const char *filename = strrchr(info.dli_fname, '/');
+        buffer_sprintf(wb, "%s+0x%lx", (filename) ? filename + 1 : info.dli_fname, (unsigned long)((uintptr_t)pc - (uintptr_t)info.dli_fbase));
+        return;
+    }
+
+    buffer_sprintf(wb, "0x%lx", (unsigned long)(uintptr_t)pc);
+}
+
+// ----------------------------------------------------------------------------
+// folded stacks
+
+struct profiler_folded {
+    DICTIONARY *stacks;
+    BUFFER *line;
+};
+
+static int profiler_fold_stack(char *name, void *entry, void *data) {
+    struct profiler_stack *st = (struct profiler_stack *)entry;
+    struct profiler_folded *f = (struct profiler_folded *)data;
+    int i;
+
+    char tag[NETDATA_THREAD_TAG_MAX + 1];
+    strncpyz(tag, name, strcspn(name, ";"));
+
+    buffer_flush(f->line);
+    buffer_strcat(f->line, tag);
+
+    // the root of the stack first - the frames above the sampled one are return addresses
+    for(i = st->depth - 1; i >= 0 ;i--) {
+        buffer_strcat(f->line, ";");
+        profiler_symbol(f->line, (i) ? (void *)((uintptr_t)st->pc[i] - 1) : st->pc[i]);
+    }
+
+    uint64_t *count = dictionary_get(f->stacks, buffer_tostring(f->line));
+    if(count)
+        *count += st->count;
+    else
+        dictionary_set(f->stacks, buffer_tostring(f->line), &st->count, sizeof(uint64_t));
+
+    return 0;
+}
+
+static int profiler_print_stack(char *name, void *entry, void *data) {
+    buffer_sprintf((BUFFER *)data, "%s %llu\n", name, (unsigned long long)*(uint64_t *)entry);
+    return 0;
+}
+
+void profiler_folded_stacks(BUFFER *wb, int reset) {
+    if(!profiler_enabled()) return;
+
+    pthread_once(&profiler_symbols_once, profiler_symbols_load);
+
+    profiler_drain();
+
+    struct profiler_folded f = {
+            .stacks = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED),
+            .line = buffer_create(1024)
+    };
+
+    netdata_mutex_lock(&profiler_stacks_mutex);
+    DICTIONARY *stacks = profiler_stacks;
+    if(reset)
+        profiler_stacks = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED);
+    else
+        dictionary_get_all_name_value(stacks, profiler_fold_stack, &f);
+    netdata_mutex_unlock(&profiler_stacks_mutex);
+
+    // symbolize the stacks that were reset without blocking the aggregation
+    if(reset) {
+        dictionary_get_all_name_value(stacks, profiler_fold_stack, &f);
+        dictionary_destroy(stacks);
+    }
+
+    dictionary_get_all_name_value(f.stacks, profiler_print_stack, wb);
+
+    dictionary_destroy(f.stacks);
+    buffer_free(f.line);
+}
+
+// ----------------------------------------------------------------------------
+// initialization
+
+int profiler_init(int frequency) {
+    if(frequency < 1) frequency = 1;
+    if(frequency > 1000) frequency = 1000;
+
+    // backtrace() loads the unwinder the first time it is called,
+    // which is not safe in a signal handler
+    void *pc[PROFILER_MAX_DEPTH];
+    if(backtrace(pc, PROFILER_MAX_DEPTH) <= 0) {
+        error("PROFILER: backtrace() does not work. The sampling profiler is disabled.");
+        return -1;
+    }
+
+    struct sigaction sa;
+    memset(&sa, 0, sizeof(sa));
+    sa.sa_sigaction = profiler_signal_handler;
+    sa.sa_flags = SA_SIGINFO | SA_RESTART;
+    sigfillset(&sa.sa_mask);
+
+    if(sigaction(SIGPROF, &sa, NULL) == -1) {
+        error("PROFILER: cannot install the SIGPROF handler. The sampling profiler is disabled.");
+        return -1;
+    }
+
+    long nsec = 1000000000L / frequency;
+    profiler_interval.it_value.tv_sec = profiler_interval.it_interval.tv_sec = nsec / 1000000000L;
+    profiler_interval.it_value.tv_nsec = profiler_interval.it_interval.tv_nsec = nsec % 1000000000L;
+
+    profiler_stacks = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED);
+
+    __atomic_store_n(&profiler_running, 1, __ATOMIC_RELEASE);
+
+    if(netdata_thread_create(&profiler_aggregator, "PROFILER", NETDATA_THREAD_OPTION_DEFAULT, profiler_aggregator_main, NULL) != 0) {
+        __atomic_store_n(&profiler_running, 0, __ATOMIC_RELEASE);
+        error("PROFILER: cannot create the aggregation thread. The sampling profiler is disabled.");
+        return -1;
+    }
+
+    info("PROFILER: sampling netdata threads %d times per second of CPU time", frequency);
+    return 0;
+}
+
+int profiler_enabled(void) {
+    return __atomic_load_n(&profiler_running, __ATOMIC_ACQUIRE);
+}
+
+void profiler_statistics(uint64_t *samples, uint64_t *dropped) {
+    *samples = __atomic_load_n(&profiler_samples, __ATOMIC_RELAXED);
+    *dropped = __atomic_load_n(&profiler_dropped, __ATOMIC_RELAXED);
+}
+
+#else // !NETDATA_PROFILER
+
+int profiler_init(int frequency) {
+    (void)frequency;
+    error("PROFILER: the sampling profiler is not supported on this system.");
+    return -1;
+}
+
+int profiler_enabled(void) { return 0; }
+void profiler_thread_start(void) { ; }
+void profiler_thread_stop(void) { ; }
+void profiler_folded_stacks(BUFFER *wb, int reset) { (void)wb; (void)reset; }
+
+void profiler_statistics(uint64_t *samples, uint64_t *dropped) {
+    *samples = 0;
+    *dropped = 0;
+}
+
+#endif // NETDATA_PROFILER
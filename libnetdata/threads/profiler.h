@@ -0,0 +1,28 @@
+// SPDX-License-Identifier: GPL-3.0-or-later
+
+#ifndef NETDATA_PROFILER_H
+#define NETDATA_PROFILER_H 1
+
+#include "../libnetdata.h"
+
+// ----------------------------------------------------------------------------
+// sampling profiler
+//
+// Every netdata thread gets a timer on its own CPU clock, that sends it
+// SIGPROF every 1/frequency seconds of CPU time it consumes. The signal
+// handler saves the stack of the thread in a ring buffer of the thread,
+// and a PROFILER thread aggregates the stacks, by thread tag.
+// The aggregated stacks are given in the folded format of flame graphs.
+
+#define PROFILER_DEFAULT_FREQUENCY 99
+
+extern int profiler_init(int frequency);
+extern int profiler_enabled(void);
+
+extern void profiler_thread_start(void);
+extern void profiler_thread_stop(void);
+
+extern void profiler_folded_stacks(BUFFER *wb, int reset);
+extern void profiler_statistics(uint64_t *samples, uint64_t *dropped);
+
+#endif /* NETDATA_PROFILER_H */
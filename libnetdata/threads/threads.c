@@ -8,12 +8,16 @@ static pthread_attr_t *attr = NULL;
 // ----------------------------------------------------------------------------
 // per thread data
 
-typedef struct {
+typedef struct netdata_thread {
     void *arg;
     pthread_t *thread;
     const char *tag;
     void *(*start_routine) (void *);
     NETDATA_THREAD_OPTIONS options;
+
+    pthread_t self;
+    struct threads_cpu *cpu;
+    struct netdata_thread *prev, *next;
 } NETDATA_THREAD;
 
 static __thread NETDATA_THREAD *netdata_thread = NULL;
@@ -51,6 +55,129 @@ pid_t gettid(void) {
 #endif /* __FreeBSD__, __APPLE__*/
 }
 
+// ----------------------------------------------------------------------------
+// CPU time of the threads, by tag
+//
+// The running threads are read on their CPU clocks. When they exit they
+// add their own CPU time to their tag, so that the CPU time of each tag
+// never decreases while any thread of it runs.
+
+#if defined(_POSIX_THREAD_CPUTIME) && _POSIX_THREAD_CPUTIME >= 0
+#define NETDATA_THREADS_CPU 1
+#endif
+
+struct threads_cpu {
+    char *tag;
+    size_t threads;
+    usec_t finished_usec;
+    NETDATA_THREAD *running;
+    struct threads_cpu *next;
+};
+
+static struct threads_cpu *threads_cpu_root = NULL;
+static int threads_cpu_read = 0;
+static netdata_mutex_t threads_cpu_mutex = NETDATA_MUTEX_INITIALIZER;
+
+#ifdef NETDATA_THREADS_CPU
+static inline usec_t thread_cpu_usec(pthread_t thread) {
+    clockid_t clockid;
+    struct timespec ts;
+
+    if(unlikely(pthread_getcpuclockid(thread, &clockid) != 0 || clock_gettime(clockid, &ts) != 0))
+        return 0;
+
+    return (usec_t)ts.tv_sec * USEC_PER_SEC + (usec_t)ts.tv_nsec / NSEC_PER_USEC;
+}
+#endif
+
+static void threads_cpu_register(NETDATA_THREAD *nt) {
+    nt->self = pthread_self();
+
+    netdata_mutex_lock(&threads_cpu_mutex);
+
+    struct threads_cpu *tc;
+    for(tc = threads_cpu_root; tc ; tc = tc->next)
+        if(!strcmp(tc->tag, nt->tag)) break;
+
+    if(!tc) {
+        tc = callocz(1, sizeof(struct threads_cpu));
+        tc->tag = strdupz(nt->tag);
+        tc->next = threads_cpu_root;
+        threads_cpu_root = tc;
+    }
+
+    tc->threads++;
+    nt->cpu = tc;
+    nt->prev = NULL;
+    nt->next = tc->running;
+    if(tc->running) tc->running->prev = nt;
+    tc->running = nt;
+
+    netdata_mutex_unlock(&threads_cpu_mutex);
+}
+
+static void threads_cpu_free_unsafe(struct threads_cpu *tc) {
+    struct threads_cpu **ptr = &threads_cpu_root;
+    while(*ptr != tc) ptr = &(*ptr)->next;
+    *ptr = tc->next;
+
+    freez(tc->tag);
+    freez(tc);
+}
+
+static void threads_cpu_unregister(NETDATA_THREAD *nt) {
+    struct threads_cpu *tc = nt->cpu;
+    if(!tc) return;
+
+    netdata_mutex_lock(&threads_cpu_mutex);
+
+    if(nt->next) nt->next->prev = nt->prev;
+    if(nt->prev) nt->prev->next = nt->next;
+    else tc->running = nt->next;
+    tc->threads--;
+
+#ifdef NETDATA_THREADS_CPU
+    tc->finished_usec += thread_cpu_usec(nt->self);
+#endif
+
+    // when nobody reads them, there is no reason to keep the exited ones
+    if(!tc->threads && !threads_cpu_read)
+        threads_cpu_free_unsafe(tc);
+
+    netdata_mutex_unlock(&threads_cpu_mutex);
+    nt->cpu = NULL;
+}
+
+void netdata_threads_cpu_usage(void (*callback)(const char *tag, unsigned long long cpu_usec, size_t threads, void *data), void *data) {
+#ifdef NETDATA_THREADS_CPU
+    netdata_mutex_lock(&threads_cpu_mutex);
+    threads_cpu_read = 1;
+
+    struct threads_cpu *tc = threads_cpu_root;
+    while(tc) {
+        struct threads_cpu *next = tc->next;
+
+        usec_t usec = tc->finished_usec;
+        NETDATA_THREAD *nt;
+        for(nt = tc->running; nt ; nt = nt->next)
+            usec += thread_cpu_usec(nt->self);
+
+        callback(tc->tag, usec, tc->threads, data);
+
+        // all its threads have exited, and this was their last report
+        if(!tc->threads)
+            threads_cpu_free_unsafe(tc);
+
+        tc = next;
+    }
+
+    netdata_mutex_unlock(&threads_cpu_mutex);
+#else
+    (void)callback;
+    (void)data;
+#endif
+}
+
 // ----------------------------------------------------------------------------
 // early initialization
 
@@ -106,6 +233,9 @@ static void thread_cleanup(void *ptr) {
     if(!(netdata_thread->options & NETDATA_THREAD_OPTION_DONT_LOG_CLEANUP))
         info("thread with task id %d finished", gettid());
 
+    profiler_thread_stop();
+    threads_cpu_unregister(netdata_thread);
+
     freez((void *)netdata_thread->tag);
     netdata_thread->tag = NULL;
 
@@ -178,6 +308,8 @@ static void *thread_start(void *ptr) {
         error("cannot set pthread cancel state to ENABLE.");
 
     thread_set_name_np(ptr);
+    threads_cpu_register(ptr);
+    profiler_thread_start();
 
     void *ret = NULL;
     pthread_cleanup_push(thread_cleanup, ptr);
@@ -188,7 +320,7 @@ static void *thread_start(void *ptr) {
 }
 
 int netdata_thread_create(netdata_thread_t *thread, const char *tag, NETDATA_THREAD_OPTIONS options, void *(*start_routine) (void *), void *arg) {
-    NETDATA_THREAD *info = mallocz(sizeof(NETDATA_THREAD));
+    NETDATA_THREAD *info = callocz(1, sizeof(NETDATA_THREAD));
     info->arg = arg;
     info->thread = thread;
     info->tag = strdupz(tag);
@@ -32,6 +32,8 @@ extern int netdata_thread_cancel(netdata_thread_t thread);
 extern int netdata_thread_join(netdata_thread_t thread, void **retval);
 extern int netdata_thread_detach(pthread_t thread);
 
+extern void netdata_threads_cpu_usage(void (*callback)(const char *tag, unsigned long long cpu_usec, size_t threads, void *data), void *data);
+
 #define NETDATA_THREAD_NAME_MAX 15
 extern void uv_thread_set_name_np(uv_thread_t ut, const char* name);
 extern void os_thread_get_current_name_np(char threadname[NETDATA_THREAD_NAME_MAX + 1]);
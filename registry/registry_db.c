@@ -9,215 +9,420 @@ int registry_db_should_be_saved(void) {
 }
 
 // ----------------------------------------------------------------------------
-// INTERNAL FUNCTIONS FOR SAVING REGISTRY OBJECTS
+// THE BINARY REGISTRY DATABASE
+//
+// registry.db is a header, followed by a record for each URL, a machine record
+// with its machine URL records for each machine, a person record with its
+// person URL records for each person and the totals. URLs and machines are
+// referenced by their number in the file, so each URL is stored once. All
+// numbers are in host byte order and the strings are not terminated, so that
+// the file can be loaded with mmap().
+// The registry databases of older versions are text files, still loaded by
+// registry_db_load_text().
+
+#define REGISTRY_DB_MAGIC "netdata-registry"
+#define REGISTRY_DB_MAGIC_SZ 16
+#define REGISTRY_DB_VERSION 2
+#define REGISTRY_DB_BYTE_ORDER 0x01020304
+
+struct registry_db_header {
+    char magic[REGISTRY_DB_MAGIC_SZ];
+    uint32_t version;
+    uint32_t byte_order;
+} __attribute__ ((packed));
+
+// 'R' URL, followed by the URL
+struct registry_db_url {
+    uint8_t type;
+    uint16_t url_len;
+} __attribute__ ((packed));
+
+// 'M' machine, 'P' person
+struct registry_db_object {
+    uint8_t type;
+    uint32_t first_t;
+    uint32_t last_t;
+    uint32_t usages;
+    char guid[GUID_LEN];
+} __attribute__ ((packed));
+
+// 'V' machine URL
+struct registry_db_machine_url {
+    uint8_t type;
+    uint32_t first_t;
+    uint32_t last_t;
+    uint32_t usages;
+    uint8_t flags;
+    uint32_t url_id;
+} __attribute__ ((packed));
+
+// 'U' person URL, followed by the machine name
+struct registry_db_person_url {
+    uint8_t type;
+    uint32_t first_t;
+    uint32_t last_t;
+    uint32_t usages;
+    uint8_t flags;
+    uint32_t machine_id;
+    uint32_t url_id;
+    uint16_t name_len;
+} __attribute__ ((packed));
+
+// 'T' totals
+struct registry_db_totals {
+    uint8_t type;
+    uint64_t persons_count;
+    uint64_t machines_count;
+    uint64_t usages_count;
+    uint64_t urls_count;
+    uint64_t persons_urls_count;
+    uint64_t machines_urls_count;
+} __attribute__ ((packed));
 
-static int registry_machine_save_url(void *entry, void *file) {
-    REGISTRY_MACHINE_URL *mu = entry;
-    FILE *fp = file;
+// ----------------------------------------------------------------------------
+// INTERNAL FUNCTIONS FOR SAVING REGISTRY OBJECTS
+//
+// These run in the process forked to save the registry, so they do not log
+// and do not take any locks. Errors are returned to the parent.
+// They number the URLs and the machines as they save them.
+
+struct registry_db_writer {
+    int fd;
+    int error;      // the errno of the first failure
+    uint32_t urls;
+    uint32_t machines;
+    size_t len;
+    char buffer[65536];
+};
+
+static void registry_db_flush(struct registry_db_writer *w) {
+    char *s = w->buffer;
+
+    while(w->len && !w->error) {
+        ssize_t ret = write(w->fd, s, w->len);
+        if(ret == -1) {
+            if(errno != EINTR)
+                w->error = errno;
+            continue;
+        }
 
-    debug(D_REGISTRY, "Registry: registry_machine_save_url('%s')", mu->url->url);
+        s += ret;
+        w->len -= (size_t)ret;
+    }
+}
 
-    int ret = fprintf(fp, "V\t%08x\t%08x\t%08x\t%02x\t%s\n",
-            mu->first_t,
-            mu->last_t,
-            mu->usages,
-            mu->flags,
-            mu->url->url
-    );
+// size has to fit in the buffer
+static inline void registry_db_write(struct registry_db_writer *w, const void *data, size_t size) {
+    if(unlikely(w->len + size > sizeof(w->buffer)))
+        registry_db_flush(w);
 
-    // error handling is done at registry_db_save()
+    if(unlikely(w->error))
+        return;
 
-    return ret;
+    memcpy(&w->buffer[w->len], data, size);
+    w->len += size;
 }
 
-static int registry_machine_save(void *entry, void *file) {
-    REGISTRY_MACHINE *m = entry;
-    FILE *fp = file;
+static int registry_url_save(void *entry, void *writer) {
+    REGISTRY_URL *u = entry;
+    struct registry_db_writer *w = writer;
 
-    debug(D_REGISTRY, "Registry: registry_machine_save('%s')", m->guid);
+    struct registry_db_url r = {
+            .type = 'R',
+            .url_len = u->len
+    };
 
-    int ret = fprintf(fp, "M\t%08x\t%08x\t%08x\t%s\n",
-            m->first_t,
-            m->last_t,
-            m->usages,
-            m->guid
-    );
+    u->id = w->urls++;
+    registry_db_write(w, &r, sizeof(r));
+    registry_db_write(w, u->url, r.url_len);
 
-    if(ret >= 0) {
-        int ret2 = dictionary_get_all(m->machine_urls, registry_machine_save_url, fp);
-        if(ret2 < 0) return ret2;
-        ret += ret2;
-    }
+    return (w->error)?-1:(int)(sizeof(r) + r.url_len);
+}
 
-    // error handling is done at registry_db_save()
+static int registry_machine_save_url(void *entry, void *writer) {
+    REGISTRY_MACHINE_URL *mu = entry;
+    struct registry_db_writer *w = writer;
+
+    struct registry_db_machine_url r = {
+            .type = 'V',
+            .first_t = mu->first_t,
+            .last_t = mu->last_t,
+            .usages = mu->usages,
+            .flags = mu->flags,
+            .url_id = mu->url->id
+    };
+
+    registry_db_write(w, &r, sizeof(r));
 
-    return ret;
+    return (w->error)?-1:(int)sizeof(r);
 }
 
-static inline int registry_person_save_url(void *entry, void *file) {
-    REGISTRY_PERSON_URL *pu = entry;
-    FILE *fp = file;
+static int registry_machine_save(void *entry, void *writer) {
+    REGISTRY_MACHINE *m = entry;
+    struct registry_db_writer *w = writer;
 
-    debug(D_REGISTRY, "Registry: registry_person_save_url('%s')", pu->url->url);
+    struct registry_db_object r = {
+            .type = 'M',
+            .first_t = m->first_t,
+            .last_t = m->last_t,
+            .usages = m->usages
+    };
+    memcpy(r.guid, m->guid, GUID_LEN);
 
-    int ret = fprintf(fp, "U\t%08x\t%08x\t%08x\t%02x\t%s\t%s\t%s\n",
-            pu->first_t,
-            pu->last_t,
-            pu->usages,
-            pu->flags,
-            pu->machine->guid,
-            pu->machine_name,
-            pu->url->url
-    );
+    m->id = w->machines++;
+    registry_db_write(w, &r, sizeof(r));
+    if(w->error) return -1;
 
-    // error handling is done at registry_db_save()
+    int ret = dictionary_get_all(m->machine_urls, registry_machine_save_url, w);
+    if(ret < 0) return ret;
 
-    return ret;
+    return ret + (int)sizeof(r);
 }
 
-static inline int registry_person_save(void *entry, void *file) {
+static inline int registry_person_save_url(void *entry, void *writer) {
+    REGISTRY_PERSON_URL *pu = entry;
+    struct registry_db_writer *w = writer;
+
+    struct registry_db_person_url r = {
+            .type = 'U',
+            .first_t = pu->first_t,
+            .last_t = pu->last_t,
+            .usages = pu->usages,
+            .flags = pu->flags,
+            .machine_id = pu->machine->id,
+            .url_id = pu->url->id,
+            .name_len = (uint16_t)strlen(pu->machine_name)
+    };
+
+    registry_db_write(w, &r, sizeof(r));
+    registry_db_write(w, pu->machine_name, r.name_len);
+
+    return (w->error)?-1:(int)(sizeof(r) + r.name_len);
+}
+
+static inline int registry_person_save(void *entry, void *writer) {
     REGISTRY_PERSON *p = entry;
-    FILE *fp = file;
-
-    debug(D_REGISTRY, "Registry: registry_person_save('%s')", p->guid);
-
-    int ret = fprintf(fp, "P\t%08x\t%08x\t%08x\t%s\n",
-            p->first_t,
-            p->last_t,
-            p->usages,
-            p->guid
-    );
-
-    if(ret >= 0) {
-        //int ret2 = dictionary_get_all(p->person_urls, registry_person_save_url, fp);
-        int ret2 = avl_traverse(&p->person_urls, registry_person_save_url, fp);
-        if (ret2 < 0) return ret2;
-        ret += ret2;
-    }
+    struct registry_db_writer *w = writer;
+
+    struct registry_db_object r = {
+            .type = 'P',
+            .first_t = p->first_t,
+            .last_t = p->last_t,
+            .usages = p->usages
+    };
+    memcpy(r.guid, p->guid, GUID_LEN);
 
-    // error handling is done at registry_db_save()
+    registry_db_write(w, &r, sizeof(r));
+    if(w->error) return -1;
 
-    return ret;
+    int ret = avl_traverse(&p->person_urls, registry_person_save_url, w);
+    if(ret < 0) return ret;
+
+    return ret + (int)sizeof(r);
 }
 
 // ----------------------------------------------------------------------------
 // SAVE THE REGISTRY DATABASE
-
-int registry_db_save(void) {
-    if(unlikely(!registry.enabled))
-        return -1;
-
-    if(unlikely(!registry_db_should_be_saved()))
-        return -2;
-
-    error_log_limit_unlimited();
-
+//
+// The registry log is rotated and the registry is written by a forked process,
+// from its copy-on-write snapshot of the memory, while netdata continues to
+// serve (and log) registry requests. So saving costs the requests a fork(),
+// not a rewrite of the whole registry. When the new database is in place, the
+// rotated log it includes is deleted.
+
+/*
+ * Write the registry to a new database and replace the active one with it
+ * Return 0 on success, or an errno
+ */
+int registry_db_save_to_disk(void) {
     char tmp_filename[FILENAME_MAX + 1];
     char old_filename[FILENAME_MAX + 1];
 
     snprintfz(old_filename, FILENAME_MAX, "%s.old", registry.db_filename);
     snprintfz(tmp_filename, FILENAME_MAX, "%s.tmp", registry.db_filename);
 
-    debug(D_REGISTRY, "Registry: Creating file '%s'", tmp_filename);
-    FILE *fp = fopen(tmp_filename, "w");
-    if(!fp) {
-        error("Registry: Cannot create file: %s", tmp_filename);
-        error_log_limit_reset();
-        return -1;
+    struct registry_db_writer *w = mallocz(sizeof(struct registry_db_writer));
+    w->error = 0;
+    w->urls = 0;
+    w->machines = 0;
+    w->len = 0;
+    w->fd = open(tmp_filename, O_WRONLY | O_CREAT | O_TRUNC, 0664);
+    if(w->fd == -1) {
+        int ret = errno;
+        freez(w);
+        return ret;
     }
 
-    // dictionary_get_all() has its own locking, so this is safe to do
-
-    debug(D_REGISTRY, "Saving all machines");
-    int bytes1 = dictionary_get_all(registry.machines, registry_machine_save, fp);
-    if(bytes1 < 0) {
-        error("Registry: Cannot save registry machines - return value %d", bytes1);
-        fclose(fp);
-        error_log_limit_reset();
-        return bytes1;
+    struct registry_db_header header = {
+            .version = REGISTRY_DB_VERSION,
+            .byte_order = REGISTRY_DB_BYTE_ORDER
+    };
+    memcpy(header.magic, REGISTRY_DB_MAGIC, REGISTRY_DB_MAGIC_SZ);
+    registry_db_write(w, &header, sizeof(header));
+
+    if(avl_traverse(&registry.registry_urls_root_index, registry_url_save, w) >= 0
+       && dictionary_get_all(registry.machines, registry_machine_save, w) >= 0)
+        (void)dictionary_get_all(registry.persons, registry_person_save, w);
+
+    struct registry_db_totals totals = {
+            .type = 'T',
+            .persons_count = registry.persons_count,
+            .machines_count = registry.machines_count,
+            .usages_count = registry.usages_count + 1, // this is required - it is lost on db rotation
+            .urls_count = registry.urls_count,
+            .persons_urls_count = registry.persons_urls_count,
+            .machines_urls_count = registry.machines_urls_count
+    };
+    registry_db_write(w, &totals, sizeof(totals));
+    registry_db_flush(w);
+
+    if(!w->error && fsync(w->fd) == -1)
+        w->error = errno;
+
+    if(close(w->fd) == -1 && !w->error)
+        w->error = errno;
+
+    int ret = w->error;
+    freez(w);
+
+    if(ret) {
+        unlink(tmp_filename);
+        return ret;
     }
-    debug(D_REGISTRY, "Registry: saving machines took %d bytes", bytes1);
 
-    debug(D_REGISTRY, "Saving all persons");
-    int bytes2 = dictionary_get_all(registry.persons, registry_person_save, fp);
-    if(bytes2 < 0) {
-        error("Registry: Cannot save registry persons - return value %d", bytes2);
-        fclose(fp);
-        error_log_limit_reset();
-        return bytes2;
+    // keep the active db as .old
+    if(unlink(old_filename) == -1 && errno != ENOENT)
+        return errno;
+
+    if(link(registry.db_filename, old_filename) == -1 && errno != ENOENT)
+        return errno;
+
+    // make the new db active
+    if(rename(tmp_filename, registry.db_filename) == -1)
+        return errno;
+
+    // the entries of the rotated log are now in the db
+    if(unlink(registry.log_rotated_filename) == -1 && errno != ENOENT)
+        return errno;
+
+    return 0;
+}
+
+static void registry_db_saved(int ret) {
+    usec_t duration_ut = now_monotonic_usec() - registry.save_started_ut;
+
+    if(likely(!ret)) {
+        info("Registry: saved the registry db '%s' in %llu ms.", registry.db_filename, duration_ut / USEC_PER_MS);
+        return;
     }
-    debug(D_REGISTRY, "Registry: saving persons took %d bytes", bytes2);
-
-    // save the totals
-    fprintf(fp, "T\t%016llx\t%016llx\t%016llx\t%016llx\t%016llx\t%016llx\n",
-            registry.persons_count,
-            registry.machines_count,
-            registry.usages_count + 1, // this is required - it is lost on db rotation
-            registry.urls_count,
-            registry.persons_urls_count,
-            registry.machines_urls_count
-    );
 
-    fclose(fp);
+    errno = ret;
+    error("Registry: cannot save the registry db '%s'. The rotated registry log '%s' is kept.",
+            registry.db_filename, registry.log_rotated_filename);
 
-    errno = 0;
+    // save it again with the next entry
+    registry.log_count += registry.save_log_count;
+}
 
-    // remove the .old db
-    debug(D_REGISTRY, "Registry: Removing old db '%s'", old_filename);
-    if(unlink(old_filename) == -1 && errno != ENOENT)
-        error("Registry: cannot remove old registry file '%s'", old_filename);
+/*
+ * Check if the process saving the registry has finished
+ */
+void registry_db_save_check(void) {
+    if(likely(!registry.save_pid))
+        return;
 
-    // rename the db to .old
-    debug(D_REGISTRY, "Registry: Link current db '%s' to .old: '%s'", registry.db_filename, old_filename);
-    if(link(registry.db_filename, old_filename) == -1 && errno != ENOENT)
-        error("Registry: cannot move file '%s' to '%s'. Saving registry DB failed!", registry.db_filename, old_filename);
+    int ret;
+    ssize_t bytes = read(registry.save_fd, &ret, sizeof(ret));
+    if(bytes == -1 && (errno == EAGAIN || errno == EINTR))
+        return;
 
+    if(bytes != sizeof(ret))
+        ret = EIO; // it died before reporting
+
+    close(registry.save_fd);
+    registry.save_fd = -1;
+
+    // the signals handler may have reaped it already
+    (void)waitpid(registry.save_pid, NULL, WNOHANG);
+    registry.save_pid = 0;
+
+    registry_db_saved(ret);
+}
+
+int registry_db_save(void) {
+    if(unlikely(!registry.enabled))
+        return -1;
+
+    registry_db_save_check();
+    if(unlikely(registry.save_pid))
+        return -2;
+
+    if(unlikely(!registry_db_should_be_saved()))
+        return -2;
+
+    error_log_limit_unlimited();
+
+    // the entries logged so far will be saved in the db
+    if(registry_log_rotate() != 0) {
+        error_log_limit_reset();
+        return -1;
+    }
+
+    registry.save_log_count = registry.log_count;
+    registry.log_count = 0;
+    registry.save_started_ut = now_monotonic_usec();
+
+    int pipefd[2];
+    pid_t pid = -1;
+
+    if(pipe(pipefd) == -1)
+        error("Registry: cannot create a pipe to save the registry db in the background.");
     else {
-        // remove the database (it is saved in .old)
-        debug(D_REGISTRY, "Registry: removing db '%s'", registry.db_filename);
-        if (unlink(registry.db_filename) == -1 && errno != ENOENT)
-            error("Registry: cannot remove old registry file '%s'", registry.db_filename);
-
-        // move the .tmp to make it active
-        debug(D_REGISTRY, "Registry: linking tmp db '%s' to active db '%s'", tmp_filename, registry.db_filename);
-        if (link(tmp_filename, registry.db_filename) == -1) {
-            error("Registry: cannot move file '%s' to '%s'. Saving registry DB failed!", tmp_filename,
-                    registry.db_filename);
-
-            // move the .old back
-            debug(D_REGISTRY, "Registry: linking old db '%s' to active db '%s'", old_filename, registry.db_filename);
-            if(link(old_filename, registry.db_filename) == -1)
-                error("Registry: cannot move file '%s' to '%s'. Recovering the old registry DB failed!", old_filename, registry.db_filename);
+        pid = fork();
+        if(pid == 0) {
+            // the child
+            close(pipefd[0]);
+            int ret = registry_db_save_to_disk();
+            if(write(pipefd[1], &ret, sizeof(ret)) != sizeof(ret))
+                ret = EIO;
+            _exit(ret?1:0);
         }
-        else {
-            debug(D_REGISTRY, "Registry: removing tmp db '%s'", tmp_filename);
-            if(unlink(tmp_filename) == -1)
-                error("Registry: cannot remove tmp registry file '%s'", tmp_filename);
-
-            // it has been moved successfully
-            // discard the current registry log
-            registry_log_recreate();
-            registry.log_count = 0;
+
+        close(pipefd[1]);
+        if(pid == -1) {
+            error("Registry: cannot fork to save the registry db in the background.");
+            close(pipefd[0]);
         }
     }
 
+    if(likely(pid > 0)) {
+        debug(D_REGISTRY, "Registry: saving the registry db in process %d", (int)pid);
+        if(fcntl(pipefd[0], F_SETFL, O_NONBLOCK) == -1)
+            error("Registry: cannot set the registry save pipe to non-blocking mode.");
+
+        registry.save_pid = pid;
+        registry.save_fd = pipefd[0];
+    }
+    else
+        registry_db_saved(registry_db_save_to_disk());
+
     // continue operations
     error_log_limit_reset();
 
-    return -1;
+    return 0;
 }
 
 // ----------------------------------------------------------------------------
 // LOAD THE REGISTRY DATABASE
 
-size_t registry_db_load(void) {
+static size_t registry_db_load_text(void) {
     char *s, buf[4096 + 1];
     REGISTRY_PERSON *p = NULL;
     REGISTRY_MACHINE *m = NULL;
     REGISTRY_URL *u = NULL;
     size_t line = 0;
 
-    debug(D_REGISTRY, "Registry: loading active db from: '%s'", registry.db_filename);
+    debug(D_REGISTRY, "Registry: loading active text db from: '%s'", registry.db_filename);
     FILE *fp = fopen(registry.db_filename, "r");
     if(!fp) {
         error("Registry: cannot open registry file: '%s'", registry.db_filename);
@@ -344,3 +549,212 @@ size_t registry_db_load(void) {
 
     return line;
 }
+
+#define REGISTRY_DB_STRING_MAX 65535
+
+static size_t registry_db_load_binary(const char *data, size_t size) {
+    const char *s = data + sizeof(struct registry_db_header), *end = data + size;
+    REGISTRY_PERSON *p = NULL;
+    REGISTRY_MACHINE *m = NULL;
+    size_t records = 0;
+
+    REGISTRY_URL **urls = NULL;
+    size_t urls_count = 0, urls_size = 0;
+
+    REGISTRY_MACHINE **machines = NULL;
+    size_t machines_count = 0, machines_size = 0;
+
+    char guid[GUID_LEN + 1];
+    char *buf = mallocz(REGISTRY_DB_STRING_MAX + 1);
+
+    while(s < end) {
+        size_t remaining = (size_t)(end - s);
+        records++;
+
+        switch(*s) {
+            case 'T': { // totals
+                struct registry_db_totals *r = (struct registry_db_totals *)s;
+                if(unlikely(remaining < sizeof(*r)))
+                    goto truncated;
+
+                registry.persons_count = r->persons_count;
+                registry.machines_count = r->machines_count;
+                registry.usages_count = r->usages_count;
+                registry.urls_count = r->urls_count;
+                registry.persons_urls_count = r->persons_urls_count;
+                registry.machines_urls_count = r->machines_urls_count;
+                s += sizeof(*r);
+                break;
+            }
+
+            case 'R': { // URL
+                struct registry_db_url *r = (struct registry_db_url *)s;
+                if(unlikely(remaining < sizeof(*r) || remaining < sizeof(*r) + r->url_len))
+                    goto truncated;
+
+                if(unlikely(urls_count == urls_size)) {
+                    urls_size = (urls_size) ? urls_size * 2 : 1024;
+                    urls = reallocz(urls, urls_size * sizeof(REGISTRY_URL *));
+                }
+
+                strncpyz(buf, (char *)(r + 1), r->url_len);
+                urls[urls_count++] = registry_url_get(buf, r->url_len);
+                s += sizeof(*r) + r->url_len;
+                break;
+            }
+
+            case 'P': { // person
+                struct registry_db_object *r = (struct registry_db_object *)s;
+                if(unlikely(remaining < sizeof(*r)))
+                    goto truncated;
+
+                m = NULL;
+                strncpyz(guid, r->guid, GUID_LEN);
+                p = registry_person_allocate(guid, r->first_t);
+                p->last_t = r->last_t;
+                p->usages = r->usages;
+                debug(D_REGISTRY, "Registry loaded person '%s', first: %u, last: %u, usages: %u", p->guid, p->first_t, p->last_t, p->usages);
+                s += sizeof(*r);
+                break;
+            }
+
+            case 'M': { // machine
+                struct registry_db_object *r = (struct registry_db_object *)s;
+                if(unlikely(remaining < sizeof(*r)))
+                    goto truncated;
+
+                if(unlikely(machines_count == machines_size)) {
+                    machines_size = (machines_size) ? machines_size * 2 : 1024;
+                    machines = reallocz(machines, machines_size * sizeof(REGISTRY_MACHINE *));
+                }
+
+                p = NULL;
+                strncpyz(guid, r->guid, GUID_LEN);
+                m = registry_machine_allocate(guid, r->first_t);
+                m->last_t = r->last_t;
+                m->usages = r->usages;
+                machines[machines_count++] = m;
+                debug(D_REGISTRY, "Registry loaded machine '%s', first: %u, last: %u, usages: %u", m->guid, m->first_t, m->last_t, m->usages);
+                s += sizeof(*r);
+                break;
+            }
+
+            case 'U': { // person URL
+                struct registry_db_person_url *r = (struct registry_db_person_url *)s;
+                if(unlikely(remaining < sizeof(*r) || remaining < sizeof(*r) + r->name_len))
+                    goto truncated;
+
+                s += sizeof(*r) + r->name_len;
+
+                if(unlikely(!p)) {
+                    error("Registry: ignoring record %zu, no person loaded.", records);
+                    continue;
+                }
+
+                if(unlikely(r->machine_id >= machines_count || r->url_id >= urls_count)) {
+                    error("Registry: ignoring record %zu, it refers to machine %u and URL %u that are not loaded.",
+                            records, r->machine_id, r->url_id);
+                    continue;
+                }
+
+                strncpyz(buf, (char *)(r + 1), r->name_len);
+
+                REGISTRY_PERSON_URL *pu = registry_person_url_allocate(p, machines[r->machine_id], urls[r->url_id], buf, r->name_len, r->first_t);
+                pu->last_t = r->last_t;
+                pu->usages = r->usages;
+                pu->flags = r->flags;
+                debug(D_REGISTRY, "Registry loaded person URL '%s' with name '%s' of machine '%s', first: %u, last: %u, usages: %u, flags: %02x", pu->url->url, pu->machine_name, pu->machine->guid, pu->first_t, pu->last_t, pu->usages, pu->flags);
+                break;
+            }
+
+            case 'V': { // machine URL
+                struct registry_db_machine_url *r = (struct registry_db_machine_url *)s;
+                if(unlikely(remaining < sizeof(*r)))
+                    goto truncated;
+
+                s += sizeof(*r);
+
+                if(unlikely(!m)) {
+                    error("Registry: ignoring record %zu, no machine loaded.", records);
+                    continue;
+                }
+
+                if(unlikely(r->url_id >= urls_count)) {
+                    error("Registry: ignoring record %zu, it refers to URL %u that is not loaded.", records, r->url_id);
+                    continue;
+                }
+
+                REGISTRY_MACHINE_URL *mu = registry_machine_url_allocate(m, urls[r->url_id], r->first_t);
+                mu->last_t = r->last_t;
+                mu->usages = r->usages;
+                mu->flags = r->flags;
+                debug(D_REGISTRY, "Registry loaded machine URL '%s', machine '%s', first: %u, last: %u, usages: %u, flags: %02x", mu->url->url, m->guid, mu->first_t, mu->last_t, mu->usages, mu->flags);
+                break;
+            }
+
+            default:
+                error("Registry: unknown record type 0x%02x at offset %zu of '%s'. Ignoring the rest of the file.",
+                        (unsigned)(uint8_t)*s, (size_t)(s - data), registry.db_filename);
+                goto cleanup;
+        }
+    }
+    goto cleanup;
+
+truncated:
+    error("Registry: record %zu of '%s' is truncated. Ignoring the rest of the file.", records, registry.db_filename);
+
+cleanup:
+    freez(buf);
+    freez(urls);
+    freez(machines);
+    return records;
+}
+
+size_t registry_db_load(void) {
+    size_t records;
+    usec_t started_ut = now_monotonic_usec();
+
+    int fd = open(registry.db_filename, O_RDONLY);
+    if(fd == -1) {
+        error("Registry: cannot open registry file: '%s'", registry.db_filename);
+        return 0;
+    }
+
+    struct stat st;
+    if(fstat(fd, &st) == -1 || (size_t)st.st_size < sizeof(struct registry_db_header)) {
+        close(fd);
+        return registry_db_load_text();
+    }
+
+    size_t size = (size_t)st.st_size;
+    char *data = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if(data == MAP_FAILED) {
+        error("Registry: cannot mmap() registry file: '%s'", registry.db_filename);
+        return 0;
+    }
+
+    struct registry_db_header *header = (struct registry_db_header *)data;
+    if(memcmp(header->magic, REGISTRY_DB_MAGIC, REGISTRY_DB_MAGIC_SZ) != 0) {
+        munmap(data, size);
+        return registry_db_load_text();
+    }
+
+    if(header->version != REGISTRY_DB_VERSION || header->byte_order != REGISTRY_DB_BYTE_ORDER) {
+        error("Registry: file '%s' is version %u with byte order 0x%08x, but this netdata supports version %u with byte order 0x%08x.",
+                registry.db_filename, header->version, header->byte_order, REGISTRY_DB_VERSION, REGISTRY_DB_BYTE_ORDER);
+        munmap(data, size);
+        return 0;
+    }
+
+    debug(D_REGISTRY, "Registry: loading active db from: '%s'", registry.db_filename);
+    (void)madvise(data, size, MADV_SEQUENTIAL);
+
+    records = registry_db_load_binary(data, size);
+    munmap(data, size);
+
+    info("Registry: loaded %zu records from '%s' in %llu ms.", records, registry.db_filename,
+         (now_monotonic_usec() - started_ut) / USEC_PER_MS);
+    return records;
+}
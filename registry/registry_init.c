@@ -32,6 +32,9 @@ int registry_init(void) {
     snprintfz(filename, FILENAME_MAX, "%s/registry-log.db", registry.pathname);
     registry.log_filename = config_get(CONFIG_SECTION_REGISTRY, "registry log file", filename);
 
+    snprintfz(filename, FILENAME_MAX, "%s.old", registry.log_filename);
+    registry.log_rotated_filename = strdupz(filename);
+
     // configuration options
     registry.save_registry_every_entries = (unsigned long long)config_get_number(CONFIG_SECTION_REGISTRY, "registry save db every new entries", 1000000);
     registry.persons_expiration = config_get_number(CONFIG_SECTION_REGISTRY, "registry expire idle persons days", 365) * 86400;
@@ -74,6 +77,9 @@ int registry_init(void) {
     // initialize locks
     netdata_mutex_init(&registry.lock);
 
+    registry.save_pid = 0;
+    registry.save_fd = -1;
+
     // create dictionaries
     registry.persons = dictionary_create(DICTIONARY_FLAGS);
     registry.machines = dictionary_create(DICTIONARY_FLAGS);
@@ -48,11 +48,18 @@ struct registry {
     char *pathname;
     char *db_filename;
     char *log_filename;
+    char *log_rotated_filename;
     char *machine_guid_filename;
 
     // open files
     FILE *log_fp;
 
+    // the process saving the db
+    pid_t save_pid;
+    int save_fd;
+    usec_t save_started_ut;
+    unsigned long long save_log_count;
+
     // the database
     DICTIONARY *persons;    // dictionary of REGISTRY_PERSON *,  with key the REGISTRY_PERSON.guid
     DICTIONARY *machines;   // dictionary of REGISTRY_MACHINE *, with key the REGISTRY_MACHINE.guid
@@ -78,11 +85,13 @@ extern REGISTRY_MACHINE *registry_request_machine(char *person_guid, char *machi
 extern void registry_log(char action, REGISTRY_PERSON *p, REGISTRY_MACHINE *m, REGISTRY_URL *u, char *name);
 extern int registry_log_open(void);
 extern void registry_log_close(void);
-extern void registry_log_recreate(void);
+extern int registry_log_rotate(void);
 extern ssize_t registry_log_load(void);
 
 // REGISTRY DB (in registry_db.c)
 extern int registry_db_save(void);
+extern int registry_db_save_to_disk(void);
+extern void registry_db_save_check(void);
 extern size_t registry_db_load(void);
 extern int registry_db_should_be_saved(void);
 
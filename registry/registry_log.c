@@ -4,6 +4,9 @@
 #include "registry_internals.h"
 
 void registry_log(char action, REGISTRY_PERSON *p, REGISTRY_MACHINE *m, REGISTRY_URL *u, char *name) {
+    if(unlikely(registry.save_pid))
+        registry_db_save_check();
+
     if(likely(registry.log_fp)) {
         if(unlikely(fprintf(registry.log_fp, "%c\t%08x\t%s\t%s\t%s\t%s\n",
                 action,
@@ -48,31 +51,81 @@ void registry_log_close(void) {
     }
 }
 
-void registry_log_recreate(void) {
-    if(registry.log_fp != NULL) {
-        registry_log_close();
+static int registry_log_append(const char *filename, const char *to_filename) {
+    char buf[65536];
+    size_t bytes;
+    int ret = 0;
 
-        // open it with truncate
-        registry.log_fp = fopen(registry.log_filename, "w");
-        if(registry.log_fp) fclose(registry.log_fp);
-        else error("Cannot truncate registry log '%s'", registry.log_filename);
+    FILE *fp = fopen(filename, "r");
+    if(!fp) {
+        if(errno == ENOENT) return 0;
+        error("Registry: cannot open registry log '%s'", filename);
+        return -1;
+    }
 
-        registry.log_fp = NULL;
-        registry_log_open();
+    FILE *to = fopen(to_filename, "a");
+    if(!to) {
+        error("Registry: cannot open registry log '%s' for appending", to_filename);
+        fclose(fp);
+        return -1;
+    }
+
+    while((bytes = fread(buf, 1, sizeof(buf), fp)) > 0) {
+        if(fwrite(buf, 1, bytes, to) != bytes) {
+            error("Registry: cannot append registry log '%s' to '%s'", filename, to_filename);
+            ret = -1;
+            break;
+        }
     }
+
+    if(ferror(fp)) {
+        error("Registry: cannot read registry log '%s'", filename);
+        ret = -1;
+    }
+
+    fclose(fp);
+    if(fclose(to) != 0 && !ret) {
+        error("Registry: cannot append registry log '%s' to '%s'", filename, to_filename);
+        ret = -1;
+    }
+
+    return ret;
 }
 
-ssize_t registry_log_load(void) {
-    ssize_t line = -1;
+/*
+ * Move the entries of the registry log to the rotated log, to be saved in the db
+ * Return 0 on success
+ */
+int registry_log_rotate(void) {
+    int ret = 0;
 
-    // closing the log is required here
-    // otherwise we will append to it the values we read
     registry_log_close();
 
-    debug(D_REGISTRY, "Registry: loading active db from: %s", registry.log_filename);
-    FILE *fp = fopen(registry.log_filename, "r");
+    if(access(registry.log_rotated_filename, F_OK) == 0) {
+        // the last save failed, its entries are still in the rotated log
+        ret = registry_log_append(registry.log_filename, registry.log_rotated_filename);
+        if(!ret) {
+            FILE *fp = fopen(registry.log_filename, "w");
+            if(fp) fclose(fp);
+            else error("Cannot truncate registry log '%s'", registry.log_filename);
+        }
+    }
+    else if(rename(registry.log_filename, registry.log_rotated_filename) == -1 && errno != ENOENT) {
+        error("Registry: cannot rename registry log '%s' to '%s'", registry.log_filename, registry.log_rotated_filename);
+        ret = -1;
+    }
+
+    registry_log_open();
+    return ret;
+}
+
+static ssize_t registry_log_load_file(const char *filename) {
+    ssize_t line = -1;
+
+    debug(D_REGISTRY, "Registry: loading active db from: %s", filename);
+    FILE *fp = fopen(filename, "r");
     if(!fp)
-        error("Registry: cannot open registry file: %s", registry.log_filename);
+        error("Registry: cannot open registry file: %s", filename);
     else {
         char *s, buf[4096 + 1];
         line = 0;
@@ -121,7 +174,7 @@ ssize_t registry_log_load(void) {
                     break;
 
                 default:
-                    error("Registry: ignoring line %zd of filename '%s': %s.", line, registry.log_filename, s);
+                    error("Registry: ignoring line %zd of filename '%s': %s.", line, filename, s);
                     break;
             }
         }
@@ -129,6 +182,24 @@ ssize_t registry_log_load(void) {
         fclose(fp);
     }
 
+    return line;
+}
+
+ssize_t registry_log_load(void) {
+    ssize_t line = -1;
+
+    // closing the log is required here
+    // otherwise we will append to it the values we read
+    registry_log_close();
+
+    // the entries of a save that did not complete come first
+    if(access(registry.log_rotated_filename, F_OK) == 0)
+        line = registry_log_load_file(registry.log_rotated_filename);
+
+    ssize_t active = registry_log_load_file(registry.log_filename);
+    if(active >= 0)
+        line = ((line > 0) ? line : 0) + active;
+
     // open the log again
     registry_log_open();
 
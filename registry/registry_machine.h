@@ -25,6 +25,7 @@ struct registry_machine {
     char guid[GUID_LEN + 1];    // the GUID
 
     uint32_t links;             // the number of REGISTRY_PERSON_URL linked to this machine
+    uint32_t id;                // the number of this machine in the saved registry db
 
     DICTIONARY *machine_urls;   // MACHINE_URL *
 
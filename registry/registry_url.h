@@ -17,6 +17,8 @@ struct registry_url {
 
     uint32_t links; // the number of links to this URL - when none is left, we free it
 
+    uint32_t id;    // the number of this URL in the saved registry db
+
     uint16_t len;   // the length of the URL in bytes
     char url[1];    // the URL - dynamically allocated to more size
 };
@@ -187,6 +187,8 @@ static char *receiver_next_line(struct receiver_state *r, int *pos) {
 }
 
 
+LATENCY_HISTOGRAM streaming_parse_histogram = LATENCY_HISTOGRAM_INITIALIZER("streaming_parse");
+
 size_t streaming_parser(struct receiver_state *rpt, struct plugind *cd, FILE *fp) {
     size_t result;
     PARSER_USER_OBJECT *user = callocz(1, sizeof(*user));
@@ -220,14 +222,31 @@ size_t streaming_parser(struct receiver_state *rpt, struct plugind *cd, FILE *fp
 
     user->parser = parser;
 
+    // the time spent parsing the lines of each chart update, from BEGIN to END
+    size_t updates = user->count;
+    usec_t parse_ut = 0;
+
     do {
         if (receiver_read(rpt, fp))
             break;
         int pos = 0;
         char *line;
         while ((line = receiver_next_line(rpt, &pos))) {
-            if (unlikely(netdata_exit || rpt->shutdown || parser_action(parser,  line)))
+            if (unlikely(netdata_exit || rpt->shutdown))
+                goto done;
+
+            usec_t started_ut = now_monotonic_high_precision_usec();
+            int rc = parser_action(parser,  line);
+            parse_ut += now_monotonic_high_precision_usec() - started_ut;
+
+            if (unlikely(rc))
                 goto done;
+
+            if (user->count != updates) {
+                updates = user->count;
+                latency_histogram_add(&streaming_parse_histogram, parse_ut);
+                parse_ut = 0;
+            }
         }
         rpt->last_msg_t = now_realtime_sec();
     }
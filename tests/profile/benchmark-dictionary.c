@@ -1,33 +1,45 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
 /*
+ * Compares the AVL and the hash table backends of the dictionary,
+ * single threaded and with threads running mixes of gets and sets.
+ *
  * 1. build netdata (as normally)
  * 2. cd tests/profile/
- * 3. compile with:
- *    gcc -O3 -Wall -Wextra -I ../../src/ -I ../../ -o benchmark-dictionary benchmark-dictionary.c ../../src/dictionary.o ../../src/log.o ../../src/avl.o ../../src/common.o -pthread
- *
+ * 3. make benchmark-dictionary
+ * 4. ./benchmark-dictionary [entries]
  */
 
 #include "config.h"
 #include "libnetdata/libnetdata.h"
+#include "libnetdata/required_dummies.h"
 
 struct myvalue {
 	int i;
 };
 
-void netdata_cleanup_and_exit(int ret) { exit(ret); }
+static unsigned long long cpu_usec(struct rusage *start, struct rusage *end) {
+	unsigned long long dt = (end->ru_utime.tv_sec * 1000000ULL + end->ru_utime.tv_usec) - (start->ru_utime.tv_sec * 1000000ULL + start->ru_utime.tv_usec);
+	return (dt)?dt:1;
+}
 
-int main(int argc, char **argv) {
-	if(argc || argv) {;}
+static const char *backend_name(uint8_t flags) {
+	return (flags & DICTIONARY_FLAG_HASH_TABLE)?"hash table":"avl";
+}
 
-//	DICTIONARY *dict = dictionary_create(DICTIONARY_FLAG_SINGLE_THREADED|DICTIONARY_FLAG_WITH_STATISTICS);
-	DICTIONARY *dict = dictionary_create(DICTIONARY_FLAG_WITH_STATISTICS);
+// ----------------------------------------------------------------------------
+// single threaded
+
+static void benchmark_single_threaded(uint8_t flags, int max) {
+	DICTIONARY *dict = dictionary_create(flags | DICTIONARY_FLAG_WITH_STATISTICS);
 	if(!dict) fatal("Cannot create dictionary.");
 
 	struct rusage start, end;
 	unsigned long long dt;
 	char buf[100 + 1];
 	struct myvalue value, *v;
-	int i, max = 30000000, max2;
+	int i, max2;
+
+	fprintf(stderr, "\n%s dictionary, single threaded\n\n", backend_name(flags));
 
 	// ------------------------------------------------------------------------
 
@@ -41,8 +53,8 @@ int main(int argc, char **argv) {
 		dictionary_set(dict, buf, &value, sizeof(struct myvalue));
 	}
 	getrusage(RUSAGE_SELF, &end);
-	dt = (end.ru_utime.tv_sec * 1000000ULL + end.ru_utime.tv_usec) - (start.ru_utime.tv_sec * 1000000ULL + start.ru_utime.tv_usec);
-	fprintf(stderr, "Added %d entries in %llu nanoseconds: %llu inserts per second\n", max, dt, max * 1000000ULL / dt);
+	dt = cpu_usec(&start, &end);
+	fprintf(stderr, "Added %d entries in %llu microseconds: %llu inserts per second\n", max, dt, max * 1000000ULL / dt);
 	fprintf(stderr, " > Dictionary: %llu inserts, %llu deletes, %llu searches\n\n", dict->stats->inserts, dict->stats->deletes, dict->stats->searches);
 
 	// ------------------------------------------------------------------------
@@ -61,8 +73,8 @@ int main(int argc, char **argv) {
 			fprintf(stderr, "ERROR: expected %d but got %d\n", i, v->i);
 	}
 	getrusage(RUSAGE_SELF, &end);
-	dt = (end.ru_utime.tv_sec * 1000000ULL + end.ru_utime.tv_usec) - (start.ru_utime.tv_sec * 1000000ULL + start.ru_utime.tv_usec);
-	fprintf(stderr, "Read %d entries in %llu nanoseconds: %llu searches per second\n", max, dt, max * 1000000ULL / dt);
+	dt = cpu_usec(&start, &end);
+	fprintf(stderr, "Read %d entries in %llu microseconds: %llu searches per second\n", max, dt, max * 1000000ULL / dt);
 	fprintf(stderr, " > Dictionary: %llu inserts, %llu deletes, %llu searches\n\n", dict->stats->inserts, dict->stats->deletes, dict->stats->searches);
 
 	// ------------------------------------------------------------------------
@@ -77,8 +89,8 @@ int main(int argc, char **argv) {
 		dictionary_set(dict, buf, &value, sizeof(struct myvalue));
 	}
 	getrusage(RUSAGE_SELF, &end);
-	dt = (end.ru_utime.tv_sec * 1000000ULL + end.ru_utime.tv_usec) - (start.ru_utime.tv_sec * 1000000ULL + start.ru_utime.tv_usec);
-	fprintf(stderr, "Reset %d entries in %llu nanoseconds: %llu resets per second\n", max, dt, max * 1000000ULL / dt);
+	dt = cpu_usec(&start, &end);
+	fprintf(stderr, "Reset %d entries in %llu microseconds: %llu resets per second\n", max, dt, max * 1000000ULL / dt);
 	fprintf(stderr, " > Dictionary: %llu inserts, %llu deletes, %llu searches\n\n", dict->stats->inserts, dict->stats->deletes, dict->stats->searches);
 
 	// ------------------------------------------------------------------------
@@ -96,8 +108,8 @@ int main(int argc, char **argv) {
 			fprintf(stderr, "ERROR: cannot got non-existing value %d from the dictionary\n", i);
 	}
 	getrusage(RUSAGE_SELF, &end);
-	dt = (end.ru_utime.tv_sec * 1000000ULL + end.ru_utime.tv_usec) - (start.ru_utime.tv_sec * 1000000ULL + start.ru_utime.tv_usec);
-	fprintf(stderr, "Searched %d non-existing entries in %llu nanoseconds: %llu not found searches per second\n", max, dt, max * 1000000ULL / dt);
+	dt = cpu_usec(&start, &end);
+	fprintf(stderr, "Searched %d non-existing entries in %llu microseconds: %llu not found searches per second\n", max, dt, max * 1000000ULL / dt);
 	fprintf(stderr, " > Dictionary: %llu inserts, %llu deletes, %llu searches\n\n", dict->stats->inserts, dict->stats->deletes, dict->stats->searches);
 
 	// ------------------------------------------------------------------------
@@ -112,19 +124,124 @@ int main(int argc, char **argv) {
 		dictionary_del(dict, buf);
 	}
 	getrusage(RUSAGE_SELF, &end);
-	dt = (end.ru_utime.tv_sec * 1000000ULL + end.ru_utime.tv_usec) - (start.ru_utime.tv_sec * 1000000ULL + start.ru_utime.tv_usec);
-	fprintf(stderr, "Deleted %d entries in %llu nanoseconds: %llu deletes per second\n", max, dt, max * 1000000ULL / dt);
+	dt = cpu_usec(&start, &end);
+	fprintf(stderr, "Deleted %d entries in %llu microseconds: %llu deletes per second\n", max, dt, max * 1000000ULL / dt);
 	fprintf(stderr, " > Dictionary: %llu inserts, %llu deletes, %llu searches\n\n", dict->stats->inserts, dict->stats->deletes, dict->stats->searches);
 
 	// ------------------------------------------------------------------------
 
 	getrusage(RUSAGE_SELF, &start);
-	dict->stats->inserts = dict->stats->deletes = dict->stats->searches = 0ULL;
 	fprintf(stderr, "Destroying dictionary\n");
 	dictionary_destroy(dict);
 	getrusage(RUSAGE_SELF, &end);
-	dt = (end.ru_utime.tv_sec * 1000000ULL + end.ru_utime.tv_usec) - (start.ru_utime.tv_sec * 1000000ULL + start.ru_utime.tv_usec);
-	fprintf(stderr, "Destroyed in %llu nanoseconds\n", dt);
+	dt = cpu_usec(&start, &end);
+	fprintf(stderr, "Destroyed in %llu microseconds\n", dt);
+}
+
+// ----------------------------------------------------------------------------
+// multi threaded get/set mixes
+// the values are linked, so that the value a get returns stays valid while other threads set it
+
+struct mix_thread {
+	pthread_t thread;
+	DICTIONARY *dict;
+	struct myvalue *values;
+	int entries;
+	int operations;
+	int write_percent;
+	unsigned int seed;
+	size_t errors;
+};
+
+static void *mix_thread_main(void *ptr) {
+	struct mix_thread *t = (struct mix_thread *)ptr;
+	char buf[100 + 1];
+	struct myvalue *v;
+	int i;
+
+	for(i = 0; i < t->operations; i++) {
+		int n = (int)(rand_r(&t->seed) % (unsigned int)t->entries);
+		snprintf(buf, 100, "%d", n);
+
+		if((int)(rand_r(&t->seed) % 100) < t->write_percent)
+			dictionary_set(t->dict, buf, &t->values[n], sizeof(struct myvalue));
+		else {
+			v = dictionary_get(t->dict, buf);
+			if(!v || v->i != n)
+				t->errors++;
+		}
+	}
+
+	return NULL;
+}
+
+static void benchmark_multi_threaded(uint8_t flags, int entries, int threads, int write_percent) {
+	DICTIONARY *dict = dictionary_create(flags | DICTIONARY_FLAG_VALUE_LINK_DONT_CLONE);
+	if(!dict) fatal("Cannot create dictionary.");
+
+	struct myvalue *values = mallocz(sizeof(struct myvalue) * (size_t)entries);
+	char buf[100 + 1];
+	int i;
+
+	for(i = 0; i < entries; i++) {
+		values[i].i = i;
+		snprintf(buf, 100, "%d", i);
+		dictionary_set(dict, buf, &values[i], sizeof(struct myvalue));
+	}
+
+	struct mix_thread *t = callocz((size_t)threads, sizeof(struct mix_thread));
+	int operations = entries;
+
+	usec_t started = now_monotonic_usec();
+
+	for(i = 0; i < threads; i++) {
+		t[i].dict = dict;
+		t[i].values = values;
+		t[i].entries = entries;
+		t[i].operations = operations / threads;
+		t[i].write_percent = write_percent;
+		t[i].seed = (unsigned int)i + 1;
+
+		if(pthread_create(&t[i].thread, NULL, mix_thread_main, &t[i]) != 0)
+			fatal("Cannot create thread.");
+	}
+
+	size_t errors = 0;
+	for(i = 0; i < threads; i++) {
+		pthread_join(t[i].thread, NULL);
+		errors += t[i].errors;
+	}
+
+	usec_t dt = now_monotonic_usec() - started;
+	if(!dt) dt = 1;
+
+	fprintf(stderr, "%-10s %2d threads, %2d%% sets: %10llu operations per second%s\n"
+			, backend_name(flags), threads, write_percent
+			, (unsigned long long)operations * 1000000ULL / dt
+			, (errors)?", ERRORS":"");
+
+	freez(t);
+	dictionary_destroy(dict);
+	freez(values);
+}
+
+int main(int argc, char **argv) {
+	int max = (argc > 1) ? atoi(argv[1]) : 1000000;
+	int threads[] = { 1, 2, 4, 8, 0 };
+	int write_percents[] = { 0, 10, 50, -1 };
+	uint8_t backends[] = { DICTIONARY_FLAG_DEFAULT, DICTIONARY_FLAG_HASH_TABLE };
+	int b, t, w;
+
+	if(max <= 0) max = 1000000;
+
+	for(b = 0; b < 2; b++)
+		benchmark_single_threaded(backends[b], max);
+
+	fprintf(stderr, "\nmulti threaded get/set mixes on %d entries\n\n", max);
+	for(w = 0; write_percents[w] >= 0; w++)
+		for(t = 0; threads[t]; t++)
+			for(b = 0; b < 2; b++)
+				benchmark_multi_threaded(backends[b], max, threads[t], write_percents[w]);
 
 	return 0;
 }
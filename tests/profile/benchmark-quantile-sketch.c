@@ -0,0 +1,110 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * Compares the exact mode of statsd histograms and timers (keep all values,
+ * sort them on flush) with the quantile sketch mode, in memory, time to add
+ * the values, time to flush them and error of the median and the 95th percentile.
+ *
+ * 1. build netdata (as normally)
+ * 2. cd tests/profile/
+ * 3. make benchmark-quantile-sketch
+ * 4. ./benchmark-quantile-sketch [relative accuracy %]
+ */
+
+#include "config.h"
+#include "libnetdata/libnetdata.h"
+#include "libnetdata/required_dummies.h"
+
+// log-normally distributed values, like latencies in milliseconds
+static LONG_DOUBLE random_value(void) {
+	double u1 = ((double)random() + 1.0) / ((double)RAND_MAX + 2.0);
+	double u2 = ((double)random() + 1.0) / ((double)RAND_MAX + 2.0);
+	double normal = sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+	return (LONG_DOUBLE)exp(3.0 + normal);
+}
+
+static double relative_error(LONG_DOUBLE estimate, LONG_DOUBLE exact) {
+	return (double)(fabsl(estimate - exact) / fabsl(exact) * 100.0);
+}
+
+static void benchmark(size_t entries, double accuracy) {
+	LONG_DOUBLE *input = mallocz(sizeof(LONG_DOUBLE) * entries);
+	size_t i;
+
+	for(i = 0; i < entries ;i++)
+		input[i] = random_value();
+
+	// exact - the way statsd keeps values
+	usec_t started = now_monotonic_usec();
+
+	size_t size = 0, used = 0;
+	LONG_DOUBLE *values = NULL;
+	for(i = 0; i < entries ;i++) {
+		if(used == size) {
+			size += 10;
+			values = reallocz(values, sizeof(LONG_DOUBLE) * size);
+		}
+		values[used++] = input[i];
+	}
+
+	usec_t exact_add = now_monotonic_usec() - started;
+	started = now_monotonic_usec();
+
+	sort_series(values, used);
+	LONG_DOUBLE exact_median = median_on_sorted_series(values, used);
+	LONG_DOUBLE exact_average = average(values, used);
+	LONG_DOUBLE exact_stddev = standard_deviation(values, used);
+	size_t pct_len = (size_t)floor((double)used * 95.0 / 100.0);
+	LONG_DOUBLE exact_percentile = values[pct_len - 1];
+
+	usec_t exact_flush = now_monotonic_usec() - started;
+	size_t exact_memory = sizeof(LONG_DOUBLE) * size;
+	freez(values);
+
+	// sketch
+	QUANTILE_SKETCH sketch;
+	quantile_sketch_init(&sketch, accuracy / 100.0, QUANTILE_SKETCH_DEFAULT_MAX_BUCKETS);
+
+	started = now_monotonic_usec();
+
+	for(i = 0; i < entries ;i++)
+		quantile_sketch_add(&sketch, input[i], 1.0);
+
+	usec_t sketch_add = now_monotonic_usec() - started;
+	started = now_monotonic_usec();
+
+	LONG_DOUBLE sketch_median = quantile_sketch_quantile(&sketch, 0.5);
+	LONG_DOUBLE sketch_average = quantile_sketch_average(&sketch);
+	LONG_DOUBLE sketch_stddev = quantile_sketch_standard_deviation(&sketch);
+	LONG_DOUBLE sketch_percentile = quantile_sketch_quantile(&sketch, 0.95);
+
+	usec_t sketch_flush = now_monotonic_usec() - started;
+	size_t sketch_memory = quantile_sketch_memory(&sketch);
+	quantile_sketch_free(&sketch);
+
+	fprintf(stderr, "%9zu values: exact %10zu bytes, add %8llu usec, flush %8llu usec | "
+			"sketch %6zu bytes, add %8llu usec, flush %5llu usec | "
+			"error median %5.2f%%, 95%% %5.2f%%, average %5.2f%%, stddev %5.2f%%\n"
+			, entries
+			, exact_memory, exact_add, exact_flush
+			, sketch_memory, sketch_add, sketch_flush
+			, relative_error(sketch_median, exact_median)
+			, relative_error(sketch_percentile, exact_percentile)
+			, relative_error(sketch_average, exact_average)
+			, relative_error(sketch_stddev, exact_stddev)
+	);
+
+	freez(input);
+}
+
+int main(int argc, char **argv) {
+	double accuracy = (argc > 1) ? atof(argv[1]) : 1.0;
+	size_t entries;
+
+	srandom(1);
+
+	fprintf(stderr, "sketch relative accuracy %0.2f%%\n", accuracy);
+	for(entries = 1000; entries <= 10000000 ; entries *= 10)
+		benchmark(entries, accuracy);
+
+	return 0;
+}
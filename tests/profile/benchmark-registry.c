@@ -1,227 +1,255 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
-
 /*
- * compile with
- *  gcc -O1 -ggdb -Wall -Wextra -I ../src/ -I ../ -o benchmark-registry benchmark-registry.c ../src/dictionary.o ../src/log.o ../src/avl.o ../src/common.o ../src/appconfig.o ../src/web_buffer.o ../src/storage_number.o ../src/rrd.o ../src/health.o -pthread -luuid -lm -DHAVE_CONFIG_H -DVARLIB_DIR="\"/tmp\""
+ * Benchmarks saving and loading the registry database.
+ *
+ * It fills a registry in memory with PERSONS persons accessing MACHINES
+ * machines, each person accessing URLS_PER_PERSON of them, and then:
+ *
+ *  - saves it, measuring how long the requests are stopped (the log
+ *    rotation and the fork()) and how long the background save takes
+ *  - saves it in the foreground, like a netdata that cannot fork()
+ *  - loads the binary database, and the same registry in the text format
+ *    of older netdata versions, for comparison
+ *
+ * It exits with 1 when a loaded registry does not have the persons,
+ * machines and links of the registry it saved.
+ *
+ * 1. build netdata (as normally)
+ * 2. cd tests/profile/
+ * 3. make benchmark-registry
+ * 4. ./benchmark-registry [PERSONS] [MACHINES] [URLS_PER_PERSON]
+ *
+ * The files are written in /tmp/benchmark-registry/
  */
 
-char *hostname = "me";
-
-#include "../src/registry.c"
-
-void netdata_cleanup_and_exit(int ret) { exit(ret); }
-
-// ----------------------------------------------------------------------------
-// TESTS
-
-int test1(int argc, char **argv) {
+#include "config.h"
+#include "libnetdata/libnetdata.h"
+#include "libnetdata/required_dummies.h"
+#include "registry/registry_internals.h"
 
-	void print_stats(uint32_t requests, unsigned long long start, unsigned long long end) {
-		fprintf(stderr, " > SPEED: %u requests served in %0.2f seconds ( >>> %llu per second <<< )\n",
-				requests, (end-start) / 1000000.0, (unsigned long long)requests * 1000000ULL / (end-start));
+#define BENCHMARK_DIR "/tmp/benchmark-registry"
 
-		fprintf(stderr, " > DB   : persons %llu, machines %llu, unique URLs %llu, accesses %llu, URLs: for persons %llu, for machines %llu\n",
-				registry.persons_count, registry.machines_count, registry.urls_count, registry.usages_count,
-				registry.persons_urls_count, registry.machines_urls_count);
-	}
-
-	(void) argc;
-	(void) argv;
-
-	uint32_t u, users = 1000000;
-	uint32_t m, machines = 200000;
-	uint32_t machines2 = machines * 2;
-
-	char **users_guids = malloc(users * sizeof(char *));
-	char **machines_guids = malloc(machines2 * sizeof(char *));
-	char **machines_urls = malloc(machines2 * sizeof(char *));
-	unsigned long long start;
+static unsigned long long now_ms(void) {
+	return now_monotonic_usec() / USEC_PER_MS;
+}
 
-	registry_init();
+static void registry_reset(void) {
+	// the previous registry is leaked, this is a benchmark
+	registry.persons = dictionary_create(DICTIONARY_FLAGS);
+	registry.machines = dictionary_create(DICTIONARY_FLAGS);
+	avl_init(&registry.registry_urls_root_index, registry_url_compare);
 
-	fprintf(stderr, "Generating %u machine guids\n", machines2);
-	for(m = 0; m < machines2 ;m++) {
-		uuid_t uuid;
-		machines_guids[m] = malloc(36+1);
-		uuid_generate(uuid);
-		uuid_unparse(uuid, machines_guids[m]);
-
-		char buf[FILENAME_MAX + 1];
-		snprintfz(buf, FILENAME_MAX, "http://%u.netdata.rocks/", m+1);
-		machines_urls[m] = strdup(buf);
+	registry.persons_count = registry.machines_count = registry.usages_count = 0;
+	registry.urls_count = registry.persons_urls_count = registry.machines_urls_count = 0;
+	registry.log_count = 0;
+}
 
-		// fprintf(stderr, "\tmachine %u: '%s', url: '%s'\n", m + 1, machines_guids[m], machines_urls[m]);
+static void registry_setup(void) {
+	if(mkdir(BENCHMARK_DIR, 0770) == -1 && errno != EEXIST) {
+		perror(BENCHMARK_DIR);
+		exit(1);
 	}
 
-	start = timems();
-	fprintf(stderr, "\nGenerating %u users accessing %u machines\n", users, machines);
-	m = 0;
-	time_t now = time(NULL);
-	for(u = 0; u < users ; u++) {
-		if(++m == machines) m = 0;
-
-		PERSON *p = registry_request_access(NULL, machines_guids[m], machines_urls[m], "test", now);
-		users_guids[u] = p->guid;
-	}
-	print_stats(u, start, timems());
+	registry.enabled = 1;
+	registry.pathname = BENCHMARK_DIR;
+	registry.db_filename = BENCHMARK_DIR "/registry.db";
+	registry.log_filename = BENCHMARK_DIR "/registry-log.db";
+	registry.log_rotated_filename = BENCHMARK_DIR "/registry-log.db.old";
+	registry.save_registry_every_entries = ULLONG_MAX;
+	registry.persons_expiration = 365 * 86400;
+	registry.max_url_length = 1024;
+	registry.max_name_length = 50;
+	registry.save_pid = 0;
+	registry.save_fd = -1;
+	netdata_mutex_init(&registry.lock);
+
+	unlink(registry.db_filename);
+	unlink(registry.log_filename);
+	unlink(registry.log_rotated_filename);
+
+	registry_reset();
+	registry_log_open();
+}
 
-	start = timems();
-	fprintf(stderr, "\nAll %u users accessing again the same %u servers\n", users, machines);
-	m = 0;
-	now = time(NULL);
-	for(u = 0; u < users ; u++) {
-		if(++m == machines) m = 0;
+// ----------------------------------------------------------------------------
+// the text database of older netdata versions, to compare the loading times
 
-		PERSON *p = registry_request_access(users_guids[u], machines_guids[m], machines_urls[m], "test", now);
+static int text_machine_url(void *entry, void *file) {
+	REGISTRY_MACHINE_URL *mu = entry;
+	return fprintf(file, "V\t%08x\t%08x\t%08x\t%02x\t%s\n", mu->first_t, mu->last_t, mu->usages, mu->flags, mu->url->url);
+}
 
-		if(p->guid != users_guids[u])
-			fprintf(stderr, "ERROR: expected to get user guid '%s' but git '%s'", users_guids[u], p->guid);
-	}
-	print_stats(u, start, timems());
+static int text_machine(void *entry, void *file) {
+	REGISTRY_MACHINE *m = entry;
+	int ret = fprintf(file, "M\t%08x\t%08x\t%08x\t%s\n", m->first_t, m->last_t, m->usages, m->guid);
+	return ret + dictionary_get_all(m->machine_urls, text_machine_url, file);
+}
 
-	start = timems();
-	fprintf(stderr, "\nAll %u users accessing a new server, out of the %u servers\n", users, machines);
-	m = 1;
-	now = time(NULL);
-	for(u = 0; u < users ; u++) {
-		if(++m == machines) m = 0;
+static int text_person_url(void *entry, void *file) {
+	REGISTRY_PERSON_URL *pu = entry;
+	return fprintf(file, "U\t%08x\t%08x\t%08x\t%02x\t%s\t%s\t%s\n", pu->first_t, pu->last_t, pu->usages, pu->flags,
+			pu->machine->guid, pu->machine_name, pu->url->url);
+}
 
-		PERSON *p = registry_request_access(users_guids[u], machines_guids[m], machines_urls[m], "test", now);
+static int text_person(void *entry, void *file) {
+	REGISTRY_PERSON *p = entry;
+	int ret = fprintf(file, "P\t%08x\t%08x\t%08x\t%s\n", p->first_t, p->last_t, p->usages, p->guid);
+	return ret + avl_traverse(&p->person_urls, text_person_url, file);
+}
 
-		if(p->guid != users_guids[u])
-			fprintf(stderr, "ERROR: expected to get user guid '%s' but git '%s'", users_guids[u], p->guid);
+static void text_save(const char *filename) {
+	FILE *fp = fopen(filename, "w");
+	if(!fp) {
+		perror(filename);
+		exit(1);
 	}
-	print_stats(u, start, timems());
-
-	start = timems();
-	fprintf(stderr, "\n%u random users accessing a random server, out of the %u servers\n", users, machines);
-	now = time(NULL);
-	for(u = 0; u < users ; u++) {
-		uint32_t tu = random() * users / RAND_MAX;
-		uint32_t tm = random() * machines / RAND_MAX;
-
-		PERSON *p = registry_request_access(users_guids[tu], machines_guids[tm], machines_urls[tm], "test", now);
 
-		if(p->guid != users_guids[tu])
-			fprintf(stderr, "ERROR: expected to get user guid '%s' but git '%s'", users_guids[tu], p->guid);
-	}
-	print_stats(u, start, timems());
+	dictionary_get_all(registry.machines, text_machine, fp);
+	dictionary_get_all(registry.persons, text_person, fp);
+	fprintf(fp, "T\t%016llx\t%016llx\t%016llx\t%016llx\t%016llx\t%016llx\n",
+			registry.persons_count, registry.machines_count, registry.usages_count + 1,
+			registry.urls_count, registry.persons_urls_count, registry.machines_urls_count);
+	fclose(fp);
+}
 
-	start = timems();
-	fprintf(stderr, "\n%u random users accessing a random server, out of %u servers\n", users, machines2);
-	now = time(NULL);
-	for(u = 0; u < users ; u++) {
-		uint32_t tu = random() * users / RAND_MAX;
-		uint32_t tm = random() * machines2 / RAND_MAX;
+// ----------------------------------------------------------------------------
 
-		PERSON *p = registry_request_access(users_guids[tu], machines_guids[tm], machines_urls[tm], "test", now);
+static off_t file_size(const char *filename) {
+	struct stat st;
+	return (stat(filename, &st) == -1) ? 0 : st.st_size;
+}
 
-		if(p->guid != users_guids[tu])
-			fprintf(stderr, "ERROR: expected to get user guid '%s' but git '%s'", users_guids[tu], p->guid);
-	}
-	print_stats(u, start, timems());
-
-	for(m = 0; m < 10; m++) {
-		start = timems();
-		fprintf(stderr,
-				"\n%u random user accesses to a random server, out of %u servers,\n > using 1/10000 with a random url, 1/1000 with a mismatched url\n",
-				users * 2, machines2);
-		now = time(NULL);
-		for (u = 0; u < users * 2; u++) {
-			uint32_t tu = random() * users / RAND_MAX;
-			uint32_t tm = random() * machines2 / RAND_MAX;
-
-			char *url = machines_urls[tm];
-			char buf[FILENAME_MAX + 1];
-			if (random() % 10000 == 1234) {
-				snprintfz(buf, FILENAME_MAX, "http://random.%ld.netdata.rocks/", random());
-				url = buf;
-			}
-			else if (random() % 1000 == 123)
-				url = machines_urls[random() * machines2 / RAND_MAX];
-
-			PERSON *p = registry_request_access(users_guids[tu], machines_guids[tm], url, "test", now);
-
-			if (p->guid != users_guids[tu])
-				fprintf(stderr, "ERROR: expected to get user guid '%s' but git '%s'", users_guids[tu], p->guid);
-		}
-		print_stats(u, start, timems());
-	}
+struct registry_counts {
+	unsigned long long persons;
+	unsigned long long machines;
+	unsigned long long urls;
+	unsigned long long persons_urls;
+	unsigned long long machines_urls;
+};
+
+static struct registry_counts registry_counts(void) {
+	struct registry_counts c = {
+		.persons = registry.persons_count,
+		.machines = registry.machines_count,
+		.urls = registry.urls_count,
+		.persons_urls = registry.persons_urls_count,
+		.machines_urls = registry.machines_urls_count
+	};
+	return c;
+}
 
-	fprintf(stderr, "\n\nSAVE\n");
-	start = timems();
-	registry_save();
-	print_stats(registry.persons_count, start, timems());
+static int check_db(const char *title, struct registry_counts *expected) {
+	struct registry_counts c = registry_counts();
+	if(!memcmp(&c, expected, sizeof(c)))
+		return 0;
 
-	fprintf(stderr, "\n\nCLEANUP\n");
-	start = timems();
-	registry_free();
-	print_stats(registry.persons_count, start, timems());
-	return 0;
+	fprintf(stderr, "%s: expected persons %llu, machines %llu, urls %llu, person urls %llu, machine urls %llu, "
+			"found persons %llu, machines %llu, urls %llu, person urls %llu, machine urls %llu\n", title,
+			expected->persons, expected->machines, expected->urls, expected->persons_urls, expected->machines_urls,
+			c.persons, c.machines, c.urls, c.persons_urls, c.machines_urls);
+	return 1;
 }
 
-// ----------------------------------------------------------------------------
-// TESTING
+static void print_db(const char *title, unsigned long long ms) {
+	fprintf(stderr, "%-40s: %6llu ms (persons %llu, machines %llu, urls %llu, person urls %llu)\n", title, ms,
+			registry.persons_count, registry.machines_count, registry.urls_count, registry.persons_urls_count);
+}
 
 int main(int argc, char **argv) {
-	config_set_boolean("registry", "enabled", 1);
-
-	//debug_flags = 0xFFFFFFFF;
-	test1(argc, argv);
-	exit(0);
+	uint32_t persons = (argc > 1) ? (uint32_t)strtoul(argv[1], NULL, 0) : 200000;
+	uint32_t machines = (argc > 2) ? (uint32_t)strtoul(argv[2], NULL, 0) : 20000;
+	uint32_t urls_per_person = (argc > 3) ? (uint32_t)strtoul(argv[3], NULL, 0) : 5;
+	uint32_t p, m, u;
 
-	(void)argc;
-	(void)argv;
+	error_log_syslog = 0;
+	error_log_throttle_period = 0;
 
+	if(!persons || !machines || !urls_per_person) {
+		fprintf(stderr, "usage: %s [PERSONS] [MACHINES] [URLS_PER_PERSON]\n", argv[0]);
+		return 1;
+	}
 
-	PERSON *p1, *p2;
+	registry_setup();
 
-	fprintf(stderr, "\n\nINITIALIZATION\n");
+	char **machine_guids = mallocz(machines * sizeof(char *));
+	char **machine_urls = mallocz(machines * sizeof(char *));
+	for(m = 0; m < machines; m++) {
+		uuid_t uuid;
+		char buf[100];
 
-	registry_init();
+		machine_guids[m] = mallocz(GUID_LEN + 1);
+		uuid_generate(uuid);
+		uuid_unparse_lower(uuid, machine_guids[m]);
 
-	int i = 2;
+		snprintfz(buf, 99, "http://%u.netdata.rocks:19999/", m);
+		machine_urls[m] = strdupz(buf);
+	}
 
-	fprintf(stderr, "\n\nADDING ENTRY\n");
-	p1 = registry_request_access("2c95abd0-1542-11e6-8c66-00508db7e9c9", "7c173980-145c-11e6-b86f-00508db7e9c1", "http://localhost:19999/", "test", time(NULL));
+	fprintf(stderr, "Filling the registry with %u persons accessing %u of %u machines each...\n",
+			persons, urls_per_person, machines);
 
-	if(0)
-	while(i--) {
-#ifdef REGISTRY_STDOUT_DUMP
-		fprintf(stderr, "\n\nADDING ENTRY\n");
-#endif /* REGISTRY_STDOUT_DUMP */
-		p1 = registry_request_access(NULL, "7c173980-145c-11e6-b86f-00508db7e9c1", "http://localhost:19999/", "test", time(NULL));
+	unsigned long long start = now_ms();
+	time_t now = now_realtime_sec();
+	for(p = 0; p < persons; p++) {
+		char *guid = NULL;
 
-#ifdef REGISTRY_STDOUT_DUMP
-		fprintf(stderr, "\n\nADDING ANOTHER URL\n");
-#endif /* REGISTRY_STDOUT_DUMP */
-		p1 = registry_request_access(p1->guid, "7c173980-145c-11e6-b86f-00508db7e9c1", "http://127.0.0.1:19999/", "test", time(NULL));
+		for(u = 0; u < urls_per_person; u++) {
+			char name[] = "benchmark";
+			char url[100];
 
-#ifdef REGISTRY_STDOUT_DUMP
-		fprintf(stderr, "\n\nADDING ANOTHER URL\n");
-#endif /* REGISTRY_STDOUT_DUMP */
-		p1 = registry_request_access(p1->guid, "7c173980-145c-11e6-b86f-00508db7e9c1", "http://my.server:19999/", "test", time(NULL));
+			m = (uint32_t)random() % machines;
+			strncpyz(url, machine_urls[m], 99);
 
-#ifdef REGISTRY_STDOUT_DUMP
-		fprintf(stderr, "\n\nADDING ANOTHER MACHINE\n");
-#endif /* REGISTRY_STDOUT_DUMP */
-		p1 = registry_request_access(p1->guid, "7c173980-145c-11e6-b86f-00508db7e9c1", "http://my.server:19999/", "test", time(NULL));
+			REGISTRY_PERSON *person = registry_request_access(guid, machine_guids[m], url, name, now);
+			guid = person->guid;
+		}
+	}
+	print_db("filled", now_ms() - start);
+	struct registry_counts filled = registry_counts();
 
-#ifdef REGISTRY_STDOUT_DUMP
-		fprintf(stderr, "\n\nADDING ANOTHER PERSON\n");
-#endif /* REGISTRY_STDOUT_DUMP */
-		p2 = registry_request_access(NULL, "7c173980-145c-11e6-b86f-00508db7e9c3", "http://localhost:19999/", "test", time(NULL));
+	// ------------------------------------------------------------------------
+	// save
 
-#ifdef REGISTRY_STDOUT_DUMP
-		fprintf(stderr, "\n\nADDING ANOTHER MACHINE\n");
-#endif /* REGISTRY_STDOUT_DUMP */
-		p2 = registry_request_access(p2->guid, "7c173980-145c-11e6-b86f-00508db7e9c3", "http://localhost:19999/", "test", time(NULL));
-	}
+	registry.save_registry_every_entries = 0;
 
-	fprintf(stderr, "\n\nSAVE\n");
-	registry_save();
+	start = now_ms();
+	registry_db_save();
+	unsigned long long stopped = now_ms() - start;
 
-	fprintf(stderr, "\n\nCLEANUP\n");
-	registry_free();
-	return 0;
+	while(registry.save_pid) {
+		usleep(1000);
+		registry_db_save_check();
+	}
+	unsigned long long saved = now_ms() - start;
+
+	fprintf(stderr, "%-40s: %6llu ms\n", "save, requests stopped", stopped);
+	fprintf(stderr, "%-40s: %6llu ms (%lld bytes)\n", "save, in the background", saved, (long long)file_size(registry.db_filename));
+
+	start = now_ms();
+	int ret = registry_db_save_to_disk();
+	fprintf(stderr, "%-40s: %6llu ms (%s)\n", "save, in the foreground", now_ms() - start, ret ? strerror(ret) : "ok");
+
+	start = now_ms();
+	text_save(BENCHMARK_DIR "/registry.text.db");
+	fprintf(stderr, "%-40s: %6llu ms (%lld bytes)\n", "save, text db of older versions", now_ms() - start,
+			(long long)file_size(BENCHMARK_DIR "/registry.text.db"));
+
+	// ------------------------------------------------------------------------
+	// load
+
+	registry_reset();
+	start = now_ms();
+	registry_db_load();
+	print_db("load, binary db", now_ms() - start);
+	int errors = check_db("load, binary db", &filled);
+
+	registry_reset();
+	registry.db_filename = BENCHMARK_DIR "/registry.text.db";
+	start = now_ms();
+	registry_db_load();
+	print_db("load, text db of older versions", now_ms() - start);
+	errors += check_db("load, text db of older versions", &filled);
+
+	registry_log_close();
+	return errors ? 1 : 0;
 }
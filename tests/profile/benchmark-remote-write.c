@@ -0,0 +1,410 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * A stand-in for a Prometheus remote write server, and a benchmark of
+ * packing write requests and sending them pipelined to it.
+ *
+ * The server accepts pipelined HTTP/1.1 POST requests and answers each of
+ * them with 204 No Content, LATENCY milliseconds after it arrived, so the
+ * round-trip time to a remote endpoint can be simulated locally.
+ * It does not decode the requests, it only checks the snappy preamble.
+ *
+ *  benchmark-remote-write server PORT [LATENCY]
+ *      runs the server forever, printing the requests received per second.
+ *      Point a prometheus_remote_write exporting instance to localhost:PORT.
+ *
+ *  benchmark-remote-write [SAMPLES] [SAMPLES_PER_REQUEST] [LATENCY]
+ *      packs SAMPLES samples in requests of SAMPLES_PER_REQUEST samples
+ *      with the functions of the exporting connector, and sends them to an
+ *      embedded server, allowing 1, 2, 4 ... 64 requests in flight.
+ *
+ * It needs protobuf and snappy, so it is not built by default:
+ *
+ * 1. build netdata with the prometheus remote write connector
+ * 2. cd tests/profile/
+ * 3. make benchmark-remote-write
+ * 4. ./benchmark-remote-write 1000000 1000 10
+ */
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <strings.h>
+#include <errno.h>
+#include <time.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include <sys/socket.h>
+
+#include "exporting/prometheus/remote_write/remote_write_request.h"
+
+#define MAX_CLIENTS 64
+#define MAX_PENDING 65536
+
+static const char response[] = "HTTP/1.1 204 No Content\r\n\r\n";
+#define RESPONSE_LEN (sizeof(response) - 1)
+
+static void diep(char *s)
+{
+	perror(s);
+	exit(1);
+}
+
+static unsigned long long now_usec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (unsigned long long)ts.tv_sec * 1000000ULL + (unsigned long long)ts.tv_nsec / 1000ULL;
+}
+
+// ----------------------------------------------------------------------------
+// the server
+
+struct client {
+	int fd;
+	char *in;
+	size_t in_len, in_size;
+
+	// the times the responses are due, in the order of the requests
+	unsigned long long *due;
+	size_t due_head, due_tail;
+};
+
+static unsigned long long server_latency_ut = 0;
+static volatile size_t server_requests = 0, server_bytes = 0, server_errors = 0;
+
+static int listen_on(int port)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) diep("socket");
+
+	int one = 1;
+	setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+
+	struct sockaddr_in sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa.sin_port = htons(port);
+
+	if(bind(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) diep("bind");
+	if(listen(fd, 16) < 0) diep("listen");
+	return fd;
+}
+
+static int listening_port(int fd)
+{
+	struct sockaddr_in sa;
+	socklen_t len = sizeof(sa);
+	if(getsockname(fd, (struct sockaddr *)&sa, &len) < 0) diep("getsockname");
+	return ntohs(sa.sin_port);
+}
+
+static void client_close(struct client *c)
+{
+	close(c->fd);
+	free(c->in);
+	free(c->due);
+	memset(c, 0, sizeof(*c));
+	c->fd = -1;
+}
+
+// parse the complete requests in the input buffer of a client
+static void client_parse(struct client *c)
+{
+	size_t pos = 0;
+
+	while(pos < c->in_len) {
+		char *s = &c->in[pos];
+		char *body = memmem(s, c->in_len - pos, "\r\n\r\n", 4);
+		if(!body) break;
+		body += 4;
+
+		size_t content_length = 0;
+		for(char *line = memmem(s, body - s, "\r\n", 2) + 2; line < body - 2; line = memmem(line, body - line, "\r\n", 2) + 2)
+			if(!strncasecmp(line, "Content-Length:", 15))
+				content_length = strtoul(line + 15, NULL, 10);
+
+		if((size_t)(body - c->in) + content_length > c->in_len) break;
+
+		// the body starts with the uncompressed length as a varint
+		if(strncmp(s, "POST ", 5) || !content_length || !body[0])
+			server_errors++;
+
+		server_requests++;
+		server_bytes += (body - s) + content_length;
+
+		if(c->due_tail - c->due_head < MAX_PENDING)
+			c->due[c->due_tail++ % MAX_PENDING] = now_usec() + server_latency_ut;
+
+		pos = (body - c->in) + content_length;
+	}
+
+	memmove(c->in, &c->in[pos], c->in_len - pos);
+	c->in_len -= pos;
+}
+
+static void *server_thread(void *ptr)
+{
+	int listen_fd = *(int *)ptr;
+	struct client clients[MAX_CLIENTS];
+	for(int i = 0; i < MAX_CLIENTS; i++) clients[i].fd = -1;
+
+	for(;;) {
+		struct pollfd fds[MAX_CLIENTS + 1];
+		int map[MAX_CLIENTS + 1];
+		int n = 0;
+		unsigned long long now = now_usec(), next_due = now + 1000000ULL;
+
+		fds[n].fd = listen_fd;
+		fds[n].events = POLLIN;
+		map[n++] = -1;
+
+		for(int i = 0; i < MAX_CLIENTS; i++) {
+			struct client *c = &clients[i];
+			if(c->fd == -1) continue;
+
+			// send the responses that are due, in order
+			while(c->due_head < c->due_tail && c->due[c->due_head % MAX_PENDING] <= now) {
+				if(send(c->fd, response, RESPONSE_LEN, MSG_NOSIGNAL) != (ssize_t)RESPONSE_LEN) break;
+				c->due_head++;
+			}
+			if(c->due_head < c->due_tail && c->due[c->due_head % MAX_PENDING] < next_due)
+				next_due = c->due[c->due_head % MAX_PENDING];
+
+			fds[n].fd = c->fd;
+			fds[n].events = POLLIN;
+			map[n++] = i;
+		}
+
+		int timeout_ms = (int)((next_due - now + 999) / 1000);
+		if(poll(fds, n, timeout_ms) < 0 && errno != EINTR) diep("poll");
+
+		if(fds[0].revents & POLLIN) {
+			int fd = accept(listen_fd, NULL, NULL);
+			for(int i = 0; fd != -1 && i < MAX_CLIENTS; i++) {
+				if(clients[i].fd != -1) continue;
+				clients[i].fd = fd;
+				clients[i].due = malloc(MAX_PENDING * sizeof(unsigned long long));
+				fd = -1;
+			}
+			if(fd != -1) close(fd);
+		}
+
+		for(int j = 1; j < n; j++) {
+			if(!(fds[j].revents & (POLLIN | POLLHUP | POLLERR))) continue;
+			struct client *c = &clients[map[j]];
+
+			if(c->in_size - c->in_len < 65536) {
+				c->in_size = c->in_size * 2 + 65536;
+				c->in = realloc(c->in, c->in_size);
+			}
+
+			ssize_t r = recv(c->fd, &c->in[c->in_len], c->in_size - c->in_len, MSG_DONTWAIT);
+			if(r > 0) {
+				c->in_len += r;
+				client_parse(c);
+			}
+			else if(r == 0 || (errno != EAGAIN && errno != EWOULDBLOCK))
+				client_close(c);
+		}
+	}
+
+	return NULL;
+}
+
+static int server(int port, int latency_ms)
+{
+	int fd = listen_on(port);
+	server_latency_ut = (unsigned long long)latency_ms * 1000ULL;
+
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, server_thread, &fd)) diep("pthread_create");
+
+	fprintf(stderr, "listening on port %d, responding after %d ms\n", listening_port(fd), latency_ms);
+
+	size_t last_requests = 0, last_bytes = 0;
+	for(;;) {
+		sleep(1);
+		size_t requests = server_requests, bytes = server_bytes;
+		fprintf(stderr, "%zu requests/s, %zu KiB/s, %zu malformed\n"
+				, requests - last_requests, (bytes - last_bytes) / 1024, server_errors);
+		last_requests = requests;
+		last_bytes = bytes;
+	}
+
+	return 0;
+}
+
+// ----------------------------------------------------------------------------
+// the client
+
+static char *payload = NULL;
+static size_t payload_size = 0;
+
+// pack a request the way the exporting connector does
+static size_t pack_request(void *write_request, size_t first, size_t samples, int64_t timestamp, char *header, size_t header_size)
+{
+	char name[100], dimension[100];
+
+	for(size_t i = first; i < first + samples; i++) {
+		snprintf(name, 100, "netdata_benchmark_chart_%zu_average", i / 10);
+		snprintf(dimension, 100, "dimension%zu", i % 10);
+		add_metric(write_request, name, "benchmark.chart", "benchmark", dimension, "benchmark-host", (double)i, timestamp);
+	}
+
+	size_t size = get_write_request_size(write_request);
+	if(size > payload_size) {
+		payload_size = size;
+		payload = realloc(payload, payload_size);
+	}
+
+	if(pack_and_clear_write_request(write_request, payload, &size)) {
+		fprintf(stderr, "cannot pack write request\n");
+		exit(1);
+	}
+
+	int len = snprintf(header, header_size,
+			"POST /receive HTTP/1.1\r\n"
+			"Host: localhost\r\n"
+			"Accept: */*\r\n"
+			"X-Prometheus-Remote-Write-Version: 0.1.0\r\n"
+			"Content-Length: %zu\r\n"
+			"Content-Type: application/x-www-form-urlencoded\r\n\r\n",
+			size);
+
+	return (size_t)len + size;
+}
+
+static void send_all(int fd, const char *buf, size_t len)
+{
+	while(len) {
+		ssize_t r = send(fd, buf, len, MSG_NOSIGNAL);
+		if(r <= 0) diep("send");
+		buf += r;
+		len -= r;
+	}
+}
+
+static size_t receive_responses(int fd, int wait)
+{
+	static size_t partial = 0;
+	char buf[65536];
+
+	ssize_t r = recv(fd, buf, sizeof(buf), wait ? 0 : MSG_DONTWAIT);
+	if(r == 0) {
+		fprintf(stderr, "the server closed the connection\n");
+		exit(1);
+	}
+	if(r < 0) {
+		if(errno == EAGAIN || errno == EWOULDBLOCK) return 0;
+		diep("recv");
+	}
+
+	partial += r;
+	size_t responses = partial / RESPONSE_LEN;
+	partial %= RESPONSE_LEN;
+	return responses;
+}
+
+static void benchmark(int port, size_t samples, size_t samples_per_request, size_t max_in_flight, void *write_request)
+{
+	int fd = socket(AF_INET, SOCK_STREAM, 0);
+	if(fd < 0) diep("socket");
+
+	int one = 1;
+	setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+	struct sockaddr_in sa;
+	memset(&sa, 0, sizeof(sa));
+	sa.sin_family = AF_INET;
+	sa.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+	sa.sin_port = htons(port);
+	if(connect(fd, (struct sockaddr *)&sa, sizeof(sa)) < 0) diep("connect");
+
+	char header[1024];
+	size_t requests = 0, in_flight = 0, bytes = 0;
+	unsigned long long packing_ut = 0, started_ut = now_usec();
+
+	for(size_t first = 0; first < samples; first += samples_per_request) {
+		size_t n = (samples - first < samples_per_request) ? samples - first : samples_per_request;
+
+		unsigned long long t = now_usec();
+		size_t len = pack_request(write_request, first, n, 1600000000000LL + (int64_t)requests, header, sizeof(header));
+		packing_ut += now_usec() - t;
+
+		while(in_flight >= max_in_flight)
+			in_flight -= receive_responses(fd, 1);
+
+		size_t header_len = strlen(header);
+		send_all(fd, header, header_len);
+		send_all(fd, payload, len - header_len);
+
+		in_flight++;
+		requests++;
+		bytes += len;
+
+		in_flight -= receive_responses(fd, 0);
+	}
+
+	while(in_flight)
+		in_flight -= receive_responses(fd, 1);
+
+	unsigned long long total_ut = now_usec() - started_ut;
+	close(fd);
+
+	fprintf(stderr, "in flight %3zu: %6zu requests, %8zu KiB, packing %8llu usec (%9.0f samples/s), total %9llu usec (%9.0f samples/s, %7.0f requests/s)\n"
+			, max_in_flight, requests, bytes / 1024
+			, packing_ut, (double)samples * 1000000.0 / (double)(packing_ut ? packing_ut : 1)
+			, total_ut, (double)samples * 1000000.0 / (double)total_ut
+			, (double)requests * 1000000.0 / (double)total_ut);
+}
+
+int main(int argc, char **argv)
+{
+	if(argc > 1 && !strcmp(argv[1], "server")) {
+		if(argc < 3) {
+			fprintf(stderr, "usage: %s server PORT [LATENCY]\n", argv[0]);
+			return 1;
+		}
+		return server(atoi(argv[2]), (argc > 3) ? atoi(argv[3]) : 0);
+	}
+
+	size_t samples = (argc > 1) ? strtoul(argv[1], NULL, 0) : 1000000;
+	size_t samples_per_request = (argc > 2) ? strtoul(argv[2], NULL, 0) : 1000;
+	int latency_ms = (argc > 3) ? atoi(argv[3]) : 10;
+
+	if(!samples || !samples_per_request) {
+		fprintf(stderr, "usage: %s [SAMPLES] [SAMPLES_PER_REQUEST] [LATENCY]\n", argv[0]);
+		return 1;
+	}
+
+	int fd = listen_on(0);
+	int port = listening_port(fd);
+	server_latency_ut = (unsigned long long)latency_ms * 1000ULL;
+
+	pthread_t thread;
+	if(pthread_create(&thread, NULL, server_thread, &fd)) diep("pthread_create");
+
+	fprintf(stderr, "%zu samples, %zu samples per request, the server responds after %d ms\n"
+			, samples, samples_per_request, latency_ms);
+
+	void *write_request = init_write_request();
+
+	for(size_t max_in_flight = 1; max_in_flight <= 64; max_in_flight *= 2)
+		benchmark(port, samples, samples_per_request, max_in_flight, write_request);
+
+	free_write_request(write_request);
+	protocol_buffers_shutdown();
+	free(payload);
+
+	if(server_errors)
+		fprintf(stderr, "the server received %zu malformed requests\n", server_errors);
+
+	return server_errors ? 1 : 0;
+}
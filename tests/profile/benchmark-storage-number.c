@@ -0,0 +1,188 @@
+/* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * Compares pack_storage_number() and unpack_storage_number() with
+ * the loops of multiplications and divisions they replaced, in speed
+ * and in results.
+ *
+ * 1. build netdata (as normally)
+ * 2. cd tests/profile/
+ * 3. make benchmark-storage-number
+ * 4. ./benchmark-storage-number [values]
+ */
+
+#include "config.h"
+#include "libnetdata/libnetdata.h"
+#include "libnetdata/required_dummies.h"
+
+// ----------------------------------------------------------------------------
+// the loops
+
+static storage_number loop_pack_storage_number(calculated_number value, uint32_t flags) {
+	storage_number r = get_storage_number_flags(flags);
+	if(!value) return r;
+
+	int m = 0;
+	calculated_number n = value, factor = 10;
+
+	if(n < 0) {
+		r += (1 << 31);
+		n = -n;
+	}
+
+	if(n / 10000000.0 > 0x00ffffff) {
+		factor = 100;
+		r |= SN_EXISTS_100;
+	}
+
+	while(m < 7 && n > (calculated_number)0x00ffffff) {
+		n /= factor;
+		m++;
+	}
+
+	if(m) {
+		r += (1 << 30) + (m << 27);
+
+		if(n > (calculated_number)0x00ffffff) {
+			r += 0x00ffffff;
+			return r;
+		}
+	}
+	else {
+		while(m < 7 && n < (calculated_number)0x0019999e) {
+			n *= 10;
+			m++;
+		}
+
+		if (unlikely(n > (calculated_number) (0x00ffffff))) {
+			n /= 10;
+			m--;
+		}
+		r += (0 << 30) + (m << 27);
+	}
+
+#ifdef STORAGE_WITH_MATH
+	r += lrint((double) n);
+#else
+	r += (storage_number)n;
+#endif
+
+	return r;
+}
+
+static calculated_number loop_unpack_storage_number(storage_number value) {
+	if(!value) return 0;
+
+	int sign = 0, exp = 0;
+	int factor = 10;
+
+	if(unlikely(value & (1 << 31)))
+		sign = 1;
+
+	if(unlikely(value & (1 << 30)))
+		exp = 1;
+
+	if(unlikely(value & (1 << 26)))
+		factor = 100;
+
+	int mul = (value & ((1<<29)|(1<<28)|(1<<27))) >> 27;
+
+	value ^= value & ((1<<31)|(1<<30)|(1<<29)|(1<<28)|(1<<27)|(1<<26)|(1<<25)|(1<<24));
+
+	calculated_number n = value;
+
+	if(exp) {
+		for(; mul; mul--)
+			n *= factor;
+	}
+	else {
+		for( ; mul ; mul--)
+			n /= 10;
+	}
+
+	if(sign) n = -n;
+	return n;
+}
+
+// ----------------------------------------------------------------------------
+
+// values like the ones collected: integers, rates with decimals and a few large ones
+static calculated_number random_value(size_t i) {
+	calculated_number n = (calculated_number)random() / (calculated_number)RAND_MAX;
+
+	switch(i % 4) {
+		case 0:  n = calculated_number_round(n * 100000.0); break;
+		case 1:  n = calculated_number_round(n * 10000000.0) / 1000.0; break;
+		case 2:  n = n * 100.0; break;
+		default: n = n * calculated_number_pow(10, (calculated_number)(random() % 30) - 10); break;
+	}
+
+	return (random() % 10) ? n : -n;
+}
+
+int main(int argc, char **argv) {
+	size_t entries = (argc > 1) ? (size_t)str2ul(argv[1]) : 10000000, i;
+	if(!entries) entries = 10000000;
+
+	calculated_number *input = mallocz(sizeof(calculated_number) * entries);
+	storage_number *packed = mallocz(sizeof(storage_number) * entries);
+	storage_number *packed_loop = mallocz(sizeof(storage_number) * entries);
+
+	srandom(1);
+	for(i = 0; i < entries ;i++)
+		input[i] = random_value(i);
+
+	// ------------------------------------------------------------------------
+	// pack
+
+	usec_t started = now_monotonic_high_precision_usec();
+	for(i = 0; i < entries ;i++)
+		packed_loop[i] = loop_pack_storage_number(input[i], SN_EXISTS);
+	usec_t pack_loop = now_monotonic_high_precision_usec() - started;
+
+	started = now_monotonic_high_precision_usec();
+	for(i = 0; i < entries ;i++)
+		packed[i] = pack_storage_number(input[i], SN_EXISTS);
+	usec_t pack_table = now_monotonic_high_precision_usec() - started;
+
+	size_t pack_differences = 0;
+	for(i = 0; i < entries ;i++)
+		if(packed[i] != packed_loop[i])
+			pack_differences++;
+
+	// ------------------------------------------------------------------------
+	// unpack
+
+	calculated_number sum_loop = 0, sum_table = 0;
+
+	started = now_monotonic_high_precision_usec();
+	for(i = 0; i < entries ;i++)
+		sum_loop += loop_unpack_storage_number(packed[i]);
+	usec_t unpack_loop = now_monotonic_high_precision_usec() - started;
+
+	started = now_monotonic_high_precision_usec();
+	for(i = 0; i < entries ;i++)
+		sum_table += unpack_storage_number(packed[i]);
+	usec_t unpack_table = now_monotonic_high_precision_usec() - started;
+
+	size_t unpack_differences = 0;
+	char a[100], b[100];
+	for(i = 0; i < entries ;i++) {
+		snprintfz(a, 99, CALCULATED_NUMBER_FORMAT, unpack_storage_number(packed[i]));
+		snprintfz(b, 99, CALCULATED_NUMBER_FORMAT, loop_unpack_storage_number(packed[i]));
+		if(strcmp(a, b) != 0)
+			unpack_differences++;
+	}
+
+	fprintf(stderr, "%zu values\n", entries);
+	fprintf(stderr, "pack   loops %8llu usec, tables %8llu usec, %zu packed differently\n"
+			, pack_loop, pack_table, pack_differences);
+	fprintf(stderr, "unpack loops %8llu usec, tables %8llu usec, %zu printed differently\n"
+			, unpack_loop, unpack_table, unpack_differences);
+	fprintf(stderr, "sums " CALCULATED_NUMBER_FORMAT ", " CALCULATED_NUMBER_FORMAT "\n"
+			, sum_loop, sum_table);
+
+	freez(input);
+	freez(packed);
+	freez(packed_loop);
+	return 0;
+}
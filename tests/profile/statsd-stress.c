@@ -1,4 +1,17 @@
 /* SPDX-License-Identifier: GPL-3.0-or-later */
+/*
+ * Sends statsd metrics over UDP, from multiple threads.
+ *
+ *  statsd-stress THREADS METRICS IP PORT
+ *      sends forever, printing the metrics sent per second
+ *
+ *  statsd-stress THREADS METRICS IP PORT SECONDS [NETDATA_PORT]
+ *      sends for SECONDS and prints the average packets sent per second.
+ *      THREADS can also be a range, like 1-16, to repeat the test
+ *      with 1, 2, 4, 8 and 16 threads.
+ *      When NETDATA_PORT is given, the packets per second netdata processed
+ *      are also queried from its netdata.statsd_packets chart.
+ */
 #include <stdlib.h>
 #include <arpa/inet.h>
 #include <netinet/in.h>
@@ -18,6 +31,7 @@ void diep(char *s)
 
 size_t run_threads = 1;
 size_t metrics = 1024;
+volatile int running = 1;
 
 #define SERVER_IP "127.0.0.1"
 #define PORT 8125
@@ -86,8 +100,8 @@ static void *spam_thread(void *__data) {
 	}
 	//printf("\n");
 
-	for (;;) {
-		for(i = 0; i < metrics ;i++) {
+	while (running) {
+		for(i = 0; i < metrics && running ;i++) {
 			if (sendto(s, packets[i], lengths[i], 0, (void *)data->si_other, data->slen) < 0) {
 				printf("C ==> DROPPED\n");
 				return NULL;
@@ -102,24 +116,46 @@ static void *spam_thread(void *__data) {
 	return NULL;
 }
 
-int main(int argc, char *argv[])
-{
-	if (argc != 5) {
-		fprintf(stderr, "Usage: '%s THREADS METRICS IP PORT'\n", argv[0]);
-		exit(-1);
-	}
+// query netdata for the average udp packets/s its statsd server processed
+// between after and before seconds ago (negative numbers)
+static double netdata_statsd_packets(struct sockaddr_in *netdata, int after, int before) {
+	int s;
+	char buffer[4096];
 
-	run_threads = atoi(argv[1]);
-	metrics = atoi(argv[2]);
-	char *ip = argv[3];
-	int port = atoi(argv[4]);
+	if ((s = socket(AF_INET, SOCK_STREAM, 0))==-1)
+		diep("socket");
+
+	if (connect(s, (struct sockaddr *)netdata, sizeof(*netdata)) == -1)
+		diep("connect");
+
+	int len = snprintf(buffer, sizeof(buffer),
+			"GET /api/v1/data?chart=netdata.statsd_packets&dimensions=udp&after=%d&before=%d&points=1&group=average&format=ssv&options=abs HTTP/1.0\r\n"
+			"Connection: close\r\n\r\n", after, before);
+
+	if (write(s, buffer, len) != len)
+		diep("write");
+
+	size_t bytes = 0;
+	ssize_t rc;
+	while (bytes < sizeof(buffer) - 1 && (rc = read(s, &buffer[bytes], sizeof(buffer) - 1 - bytes)) > 0)
+		bytes += rc;
 
-	struct thread_data data[run_threads];
+	buffer[bytes] = '\0';
+	close(s);
+
+	char *body = strstr(buffer, "\r\n\r\n");
+	if (!body) return 0.0;
+	return strtod(&body[4], NULL);
+}
+
+static void run(size_t threads_count, char *ip, int port, int seconds, int netdata_port) {
+	struct thread_data data[threads_count];
 	struct sockaddr_in si_other;
-	pthread_t threads[run_threads], report;
+	pthread_t threads[threads_count], report;
 	size_t i;
 
-	srand(time(NULL));
+	run_threads = threads_count;
+	running = 1;
 
 	memset(&si_other, 0, sizeof(si_other));
 	si_other.sin_family = AF_INET;
@@ -137,15 +173,82 @@ int main(int argc, char *argv[])
 		pthread_create(&threads[i], NULL, spam_thread, &data[i]);
 	}
 
-	printf("\n");
-	printf("THREADS     : %zu\n", run_threads);
-	printf("METRICS     : %zu\n", metrics);
-	printf("DESTINATION : %s:%d\n", ip, port);
-	printf("\n");
-	pthread_create(&report, NULL, report_thread, &data);
+	if (!seconds) {
+		printf("\n");
+		printf("THREADS     : %zu\n", run_threads);
+		printf("METRICS     : %zu\n", metrics);
+		printf("DESTINATION : %s:%d\n", ip, port);
+		printf("\n");
+		pthread_create(&report, NULL, report_thread, &data);
 
-	for (i =0; i < run_threads; ++i)
+		for (i =0; i < run_threads; ++i)
+			pthread_join(threads[i], NULL);
+
+		return;
+	}
+
+	sleep(seconds);
+	running = 0;
+
+	size_t total = 0;
+	for (i = 0; i < run_threads; ++i) {
 		pthread_join(threads[i], NULL);
+		total += data[i].counter;
+	}
+
+	printf("THREADS %3zu: sent %12.0f packets/s", run_threads, (double)total / seconds);
+
+	if (netdata_port) {
+		struct sockaddr_in netdata = si_other;
+		netdata.sin_port = htons(netdata_port);
+
+		// let netdata collect the last second, and leave
+		// a second out on both edges of the test
+		sleep(2);
+		printf(", netdata processed %12.0f packets/s", netdata_statsd_packets(&netdata, -(seconds + 1), -3));
+	}
+
+	printf("\n");
+	fflush(stdout);
+}
+
+int main(int argc, char *argv[])
+{
+	if (argc != 5 && argc != 6 && argc != 7) {
+		fprintf(stderr, "Usage: '%s THREADS METRICS IP PORT [SECONDS [NETDATA_PORT]]'\n", argv[0]);
+		exit(-1);
+	}
+
+	size_t min_threads = atoi(argv[1]), max_threads = min_threads;
+	char *range = strchr(argv[1], '-');
+	if (range) max_threads = atoi(&range[1]);
+
+	metrics = atoi(argv[2]);
+	char *ip = argv[3];
+	int port = atoi(argv[4]);
+	int seconds = (argc > 5) ? atoi(argv[5]) : 0;
+	int netdata_port = (argc > 6) ? atoi(argv[6]) : 0;
+
+	if (min_threads < 1 || max_threads < min_threads || (min_threads != max_threads && !seconds)) {
+		fprintf(stderr, "Invalid THREADS '%s' - a range of threads requires SECONDS\n", argv[1]);
+		exit(-1);
+	}
+
+	if (netdata_port && seconds < 5) {
+		fprintf(stderr, "At least 5 SECONDS are required to query netdata\n");
+		exit(-1);
+	}
+
+	srand(time(NULL));
+
+	if (seconds) {
+		printf("METRICS %zu, DESTINATION %s:%d, %d SECONDS PER TEST\n", metrics, ip, port, seconds);
+		fflush(stdout);
+	}
+
+	size_t threads;
+	for (threads = min_threads; threads <= max_threads ; threads *= 2)
+		run(threads, ip, port, seconds, netdata_port);
 
 	return 0;
 }
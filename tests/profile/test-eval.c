@@ -261,13 +261,18 @@ void print_expression(EVAL_NODE *op, const char *failed_at, int error) {
 }
 */
 
-int health_variable_lookup(const char *variable, uint32_t hash, RRDCALC *rc, calculated_number *result) {
+RRDVAR *health_variable_bind(const char *variable, uint32_t hash, RRDCALC *rc) {
 	(void)variable;
 	(void)hash;
 	(void)rc;
-	(void)result;
 
-	return 0;
+	return NULL;
+}
+
+calculated_number rrdvar2number(RRDVAR *rv) {
+	(void)rv;
+
+	return NAN;
 }
 
 int main(int argc, char **argv) {
@@ -290,7 +295,7 @@ int main(int argc, char **argv) {
 			printf("\nEvaluates to: %Lf\n\n", exp->result);
 		}
 		else {
-			printf("\nEvaluation failed with code %d and message: %s\n\n", exp->error, buffer_tostring(exp->error_msg));
+			printf("\nEvaluation failed with code %d and message: %s\n\n", exp->error, expression_error_msg(exp));
 		}
 		expression_free(exp);
 	}
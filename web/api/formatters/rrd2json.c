@@ -10,7 +10,7 @@ static inline void free_temp_rrddim(RRDDIM *temp_rd)
     RRDDIM *t;
     while (temp_rd) {
         t = temp_rd->next;
-        freez((char *)temp_rd->id);
+        string_freez(temp_rd->id);
         freez((char *)temp_rd->name);
 #ifdef ENABLE_DBENGINE
         if (temp_rd->rrd_memory_mode == RRD_MEMORY_MODE_DBENGINE)
@@ -54,7 +54,7 @@ void build_context_param_list(struct context_param **param_list, RRDSET *st)
     rrddim_foreach_read(rd1, st) {
         RRDDIM *rd = mallocz(rd1->memsize);
         memcpy(rd, rd1, rd1->memsize);
-        rd->id = strdupz(rd1->id);
+        rd->id = string_dup(rd1->id);
         rd->name = strdupz(rd1->name);
         rd->state = mallocz(sizeof(*rd->state));
         memcpy(rd->state, rd1->state, sizeof(*rd->state));
@@ -139,9 +139,10 @@ int rrdset2value_api_v1(
         , time_t *db_after
         , time_t *db_before
         , int *value_is_null
+        , struct rrdr_window **window
 ) {
 
-    RRDR *r = rrd2rrdr(st, points, after, before, group_method, group_time, options, dimensions, NULL);
+    RRDR *r = rrd2rrdr_window(window, st, points, after, before, group_method, group_time, options, dimensions);
 
     if(!r) {
         if(value_is_null) *value_is_null = 1;
@@ -83,6 +83,7 @@ extern int rrdset2value_api_v1(
         , time_t *db_after
         , time_t *db_before
         , int *value_is_null
+        , struct rrdr_window **window
 );
 
 extern void build_context_param_list(struct context_param **param_list, RRDSET *st);
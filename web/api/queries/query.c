@@ -659,6 +659,293 @@ static inline void do_dimension_fixedstep(
 #endif
 }
 
+// ----------------------------------------------------------------------------
+// incrementally maintained windows
+//
+// health evaluates the same lookup every few seconds, while the window of the
+// lookup slides by just a few points. For the groupings that can be updated
+// incrementally (average, sum, min, max), a window keeps the points of each
+// dimension in a ring, together with their running aggregates, so that every
+// evaluation reads from the db only the points that entered the window since
+// the previous one.
+
+struct rrdr_window_dimension {
+    RRDDIM *rd;                     // the dimension the points belong to
+    time_t update_every;            // the time between the points in the ring
+    time_t before;                  // the timestamp of the newest point in the ring
+    int reload;                     // the ring cannot slide, it has to be read again from the db
+
+    long entries;                   // the size of the ring, the group of the query
+    long oldest;                    // the position of the oldest point in the ring
+    long used;                      // the number of points in the ring
+    storage_number *points;         // the points, as stored in the db
+
+    size_t count;                   // the points that exist
+    size_t non_zero;                // the points that exist and are not zero
+    size_t resets;                  // the points that have the reset flag
+    calculated_number sum;          // the sum of the existing points (average, sum)
+    long slides;                    // the points added since the sum was recalculated
+
+    long extreme;                   // the position of the min or max point, -1 for none
+    int extreme_invalid;            // the extreme point left the ring, it has to be found again
+};
+
+struct rrdr_window {
+    RRDR_GROUPING group_method;
+    long dimensions;
+    struct rrdr_window_dimension *dims;
+};
+
+static inline int rrdr_window_grouping_is_incremental(RRDR_GROUPING group_method) {
+    return group_method == RRDR_GROUPING_AVERAGE || group_method == RRDR_GROUPING_SUM ||
+           group_method == RRDR_GROUPING_MIN || group_method == RRDR_GROUPING_MAX;
+}
+
+void rrdr_window_free(struct rrdr_window *w) {
+    if(unlikely(!w)) return;
+
+    long c;
+    for(c = 0; c < w->dimensions ; c++)
+        freez(w->dims[c].points);
+
+    freez(w->dims);
+    freez(w);
+}
+
+// get the window of a query, creating it when it does not match the query
+static struct rrdr_window *rrdr_window_get(struct rrdr_window **window, RRDR_GROUPING group_method, long dimensions) {
+    struct rrdr_window *w = *window;
+
+    if(unlikely(!w || w->group_method != group_method || w->dimensions != dimensions)) {
+        rrdr_window_free(w);
+
+        w = callocz(1, sizeof(struct rrdr_window));
+        w->group_method = group_method;
+        w->dimensions = dimensions;
+        w->dims = callocz((size_t)dimensions, sizeof(struct rrdr_window_dimension));
+        *window = w;
+    }
+
+    return w;
+}
+
+// the min and max groupings select the value with the min or max absolute value,
+// keeping the oldest when there are more than one
+static inline int rrdr_window_is_extreme(RRDR_GROUPING group_method, calculated_number value, calculated_number extreme) {
+    if(group_method == RRDR_GROUPING_MAX)
+        return calculated_number_fabs(value) > calculated_number_fabs(extreme);
+
+    return calculated_number_fabs(value) < calculated_number_fabs(extreme);
+}
+
+static inline void rrdr_window_dimension_reset(struct rrdr_window_dimension *wd, RRDDIM *rd, time_t update_every, long entries) {
+    if(unlikely(wd->entries != entries)) {
+        wd->points = reallocz(wd->points, sizeof(storage_number) * entries);
+        wd->entries = entries;
+    }
+
+    wd->rd = rd;
+    wd->update_every = update_every;
+    wd->before = 0;
+    wd->reload = 0;
+    wd->oldest = 0;
+    wd->used = 0;
+    wd->count = 0;
+    wd->non_zero = 0;
+    wd->resets = 0;
+    wd->sum = 0.0;
+    wd->slides = 0;
+    wd->extreme = -1;
+    wd->extreme_invalid = 0;
+}
+
+static inline void rrdr_window_dimension_remove(struct rrdr_window_dimension *wd, long pos) {
+    storage_number n = wd->points[pos];
+    if(unlikely(!does_storage_number_exist(n))) return;
+
+    calculated_number value = unpack_storage_number(n);
+
+    wd->count--;
+    wd->sum -= value;
+    if(likely(value != 0.0)) wd->non_zero--;
+    if(unlikely(did_storage_number_reset(n))) wd->resets--;
+    if(unlikely(pos == wd->extreme)) wd->extreme_invalid = 1;
+}
+
+static inline void rrdr_window_dimension_remove_oldest(struct rrdr_window_dimension *wd) {
+    rrdr_window_dimension_remove(wd, wd->oldest);
+
+    if(++wd->oldest == wd->entries) wd->oldest = 0;
+    wd->used--;
+}
+
+static inline void rrdr_window_dimension_remove_newest(struct rrdr_window_dimension *wd) {
+    rrdr_window_dimension_remove(wd, (wd->oldest + wd->used - 1) % wd->entries);
+    wd->used--;
+}
+
+static inline void rrdr_window_dimension_append(struct rrdr_window_dimension *wd, RRDR_GROUPING group_method, storage_number n) {
+    long pos = (wd->oldest + wd->used) % wd->entries;
+
+    wd->points[pos] = n;
+    wd->used++;
+    wd->slides++;
+
+    if(unlikely(!does_storage_number_exist(n))) return;
+
+    calculated_number value = unpack_storage_number(n);
+
+    wd->count++;
+    wd->sum += value;
+    if(likely(value != 0.0)) wd->non_zero++;
+    if(unlikely(did_storage_number_reset(n))) wd->resets++;
+
+    if(!wd->extreme_invalid && (wd->extreme == -1 || rrdr_window_is_extreme(group_method, value, unpack_storage_number(wd->points[wd->extreme]))))
+        wd->extreme = pos;
+}
+
+// walk the ring from the oldest to the newest point, to get rid of the rounding
+// errors the running sum accumulates and to find the min or max point
+static void rrdr_window_dimension_recalculate(struct rrdr_window_dimension *wd, RRDR_GROUPING group_method) {
+    calculated_number sum = 0.0, extreme = 0.0;
+    long i;
+
+    wd->extreme = -1;
+    for(i = 0; i < wd->used ; i++) {
+        long pos = (wd->oldest + i) % wd->entries;
+        storage_number n = wd->points[pos];
+        if(unlikely(!does_storage_number_exist(n))) continue;
+
+        calculated_number value = unpack_storage_number(n);
+        sum += value;
+
+        if(wd->extreme == -1 || rrdr_window_is_extreme(group_method, value, extreme)) {
+            wd->extreme = pos;
+            extreme = value;
+        }
+    }
+
+    wd->sum = sum;
+    wd->slides = 0;
+    wd->extreme_invalid = 0;
+}
+
+// the equivalent of do_dimension_fixedstep() for a query of 1 point,
+// reading from the db only the points that are not already in the window
+// returns 0 when the window could not be filled, so that the caller can fall back to the db
+static inline int do_dimension_window(
+        RRDR *r
+        , struct rrdr_window *w
+        , RRDDIM *rd
+        , long dim_id_in_rrdr
+        , time_t after_wanted
+        , time_t before_wanted
+        , time_t first_entry_t
+){
+    struct rrdr_window_dimension *wd = &w->dims[dim_id_in_rrdr];
+    time_t dt = r->update_every / r->group;
+    long group_size = r->group;
+
+    time_t now;
+    int reloaded = 0;
+    if(likely(wd->rd == rd && !wd->reload && wd->update_every == dt && wd->entries == group_size && wd->used == group_size &&
+              before_wanted >= wd->before && before_wanted - wd->before < (group_size - 1) * dt &&
+              !((before_wanted - wd->before) % dt))) {
+        // the window slid forward, but it still overlaps the one we have
+
+        // the newest point we have may have been collected while we were reading it,
+        // so read it again, together with the points that entered the window
+        rrdr_window_dimension_remove_newest(wd);
+        now = wd->before;
+
+        long slide = (before_wanted - wd->before) / dt;
+        while(slide--)
+            rrdr_window_dimension_remove_oldest(wd);
+    }
+    else {
+        rrdr_window_dimension_reset(wd, rd, dt, group_size);
+        now = after_wanted;
+        reloaded = 1;
+    }
+
+    struct rrddim_query_handle handle;
+    size_t db_points_read = 0;
+    time_t db_now;
+
+    for(rd->state->query_ops.init(rd, &handle, now, before_wanted) ; now <= before_wanted ; now += dt) {
+        db_now = now; // this is needed to set db_now in case the next_metric implementation does not set it
+        storage_number n = rd->state->query_ops.next_metric(&handle, &db_now);
+        if(unlikely(db_now > before_wanted))
+            break;
+
+        for ( ; now <= db_now ; now += dt) {
+            rrdr_window_dimension_append(wd, w->group_method, (likely(now >= db_now)) ? n : SN_EMPTY_SLOT);
+            db_points_read++;
+        }
+        now = db_now;
+    }
+    rd->state->query_ops.finalize(&handle);
+
+    r->internal.db_points_read += db_points_read;
+
+    if(unlikely(wd->used != group_size)) {
+        wd->rd = NULL;
+        return 0;
+    }
+
+    wd->before = before_wanted;
+
+    // the db maps the timestamps next to its first entry to the same slot,
+    // so a window starting there does not have its points where a slide expects them
+    wd->reload = (after_wanted <= first_entry_t);
+
+    // a window read from scratch has its sum added in time order, like the db query does
+    if(unlikely(reloaded))
+        wd->slides = 0;
+
+    if(unlikely(wd->extreme_invalid || wd->slides > wd->entries))
+        rrdr_window_dimension_recalculate(wd, w->group_method);
+
+    long rrdr_line = rrdr_line_init(r, before_wanted, -1);
+    RRDR_VALUE_FLAGS *rrdr_value_options_ptr = &r->o[rrdr_line * r->d + dim_id_in_rrdr];
+
+    // update the dimension options
+    if(likely(wd->non_zero))
+        r->od[dim_id_in_rrdr] |= RRDR_DIMENSION_NONZERO;
+
+    // store the specific point options
+    *rrdr_value_options_ptr = (wd->resets) ? RRDR_VALUE_RESET : RRDR_VALUE_NOTHING;
+
+    calculated_number value;
+    if(unlikely(!wd->count)) {
+        value = 0.0;
+        *rrdr_value_options_ptr |= RRDR_VALUE_EMPTY;
+    }
+    else if(w->group_method == RRDR_GROUPING_AVERAGE)
+        value = wd->sum / wd->count;
+    else if(w->group_method == RRDR_GROUPING_SUM)
+        value = wd->sum;
+    else
+        value = unpack_storage_number(wd->points[wd->extreme]);
+
+    r->v[rrdr_line * r->d + dim_id_in_rrdr] = value;
+
+    if(likely(dim_id_in_rrdr)) {
+        if(unlikely(value < r->min)) r->min = value;
+        if(unlikely(value > r->max)) r->max = value;
+    }
+    else
+        r->min = r->max = value;
+
+    r->internal.result_points_generated++;
+
+    r->before = before_wanted;
+    r->after = before_wanted - (group_size - 1) * dt;
+    rrdr_done(r, rrdr_line);
+
+    return 1;
+}
+
 // ----------------------------------------------------------------------------
 // fill RRDR for the whole chart
 
@@ -679,7 +966,7 @@ static void rrd2rrdr_log_request_response_metdata(RRDR *r
         //, size_t before_slot
         , const char *msg
         ) {
-    netdata_rwlock_rdlock(&r->st->rrdset_rwlock);
+    rrdset_rdlock(r->st);
     info("INTERNAL ERROR: rrd2rrdr() on %s update every %d with %s grouping %s (group: %ld, resampling_time: %ld, resampling_group: %ld), "
          "after (got: %zu, want: %zu, req: %zu, db: %zu), "
          "before (got: %zu, want: %zu, req: %zu, db: %zu), "
@@ -822,6 +1109,7 @@ static RRDR *rrd2rrdr_fixedstep(
         , time_t last_entry_t
         , int absolute_period_requested
         , struct context_param *context_param_list
+        , struct rrdr_window **window
 ) {
     int aligned = !(options & RRDR_OPTION_NOT_ALIGNED);
 
@@ -1066,6 +1354,14 @@ static RRDR *rrd2rrdr_fixedstep(
         rrdr_disable_not_selected_dimensions(r, options, dimensions, temp_rd);
 
 
+    // -------------------------------------------------------------------------
+    // use the window of the caller, if the query can be answered by it
+
+    struct rrdr_window *w = NULL;
+    if(window && !temp_rd && points_wanted == 1 && resampling_group == 1 && rrdr_window_grouping_is_incremental(group_method))
+        w = rrdr_window_get(window, group_method, dimensions_count);
+
+
     // -------------------------------------------------------------------------
     // do the work for each dimension
 
@@ -1083,17 +1379,19 @@ static RRDR *rrd2rrdr_fixedstep(
         }
         r->od[c] |= RRDR_DIMENSION_SELECTED;
 
-        // reset the grouping for the new dimension
-        r->internal.grouping_reset(r);
-
-        do_dimension_fixedstep(
-                r
-                , points_wanted
-                , rd
-                , c
-                , after_wanted
-                , before_wanted
-                );
+        if(!w || !do_dimension_window(r, w, rd, c, after_wanted, before_wanted, first_entry_t)) {
+            // reset the grouping for the new dimension
+            r->internal.grouping_reset(r);
+
+            do_dimension_fixedstep(
+                    r
+                    , points_wanted
+                    , rd
+                    , c
+                    , after_wanted
+                    , before_wanted
+                    );
+        }
 
         if(r->od[c] & RRDR_DIMENSION_NONZERO)
             dimensions_nonzero++;
@@ -1556,7 +1854,7 @@ static RRDR *rrd2rrdr_variablestep(
 }
 #endif //#ifdef ENABLE_DBENGINE
 
-RRDR *rrd2rrdr(
+static RRDR *rrd2rrdr_internal(
         RRDSET *st
         , long points_requested
         , long long after_requested
@@ -1566,6 +1864,7 @@ RRDR *rrd2rrdr(
         , RRDR_OPTIONS options
         , const char *dimensions
         , struct context_param *context_param_list
+        , struct rrdr_window **window
 )
 {
     int rrd_update_every;
@@ -1612,7 +1911,7 @@ RRDR *rrd2rrdr(
             }
             return rrd2rrdr_fixedstep(st, points_requested, after_requested, before_requested, group_method,
                                       resampling_time_requested, options, dimensions, rrd_update_every,
-                                      first_entry_t, last_entry_t, absolute_period_requested, context_param_list);
+                                      first_entry_t, last_entry_t, absolute_period_requested, context_param_list, window);
         } else {
             if (rrd_update_every != (uint16_t)max_interval) {
                 rrd_update_every = (uint16_t) max_interval;
@@ -1629,5 +1928,46 @@ RRDR *rrd2rrdr(
 #endif
     return rrd2rrdr_fixedstep(st, points_requested, after_requested, before_requested, group_method,
                               resampling_time_requested, options, dimensions,
-                              rrd_update_every, first_entry_t, last_entry_t, absolute_period_requested, context_param_list);
+                              rrd_update_every, first_entry_t, last_entry_t, absolute_period_requested, context_param_list, window);
+}
+
+LATENCY_HISTOGRAM rrd2rrdr_histogram = LATENCY_HISTOGRAM_INITIALIZER("rrd2rrdr");
+
+RRDR *rrd2rrdr(
+        RRDSET *st
+        , long points_requested
+        , long long after_requested
+        , long long before_requested
+        , RRDR_GROUPING group_method
+        , long resampling_time_requested
+        , RRDR_OPTIONS options
+        , const char *dimensions
+        , struct context_param *context_param_list
+)
+{
+    usec_t started_ut = now_monotonic_high_precision_usec();
+
+    RRDR *r = rrd2rrdr_internal(st, points_requested, after_requested, before_requested, group_method,
+                                resampling_time_requested, options, dimensions, context_param_list, NULL);
+
+    latency_histogram_add(&rrd2rrdr_histogram, now_monotonic_high_precision_usec() - started_ut);
+    return r;
+}
+
+// like rrd2rrdr(), but queries of 1 point with an incremental grouping are answered
+// by the window, which is created on the first call and should be freed with rrdr_window_free()
+RRDR *rrd2rrdr_window(
+        struct rrdr_window **window
+        , RRDSET *st
+        , long points_requested
+        , long long after_requested
+        , long long before_requested
+        , RRDR_GROUPING group_method
+        , long resampling_time_requested
+        , RRDR_OPTIONS options
+        , const char *dimensions
+)
+{
+    return rrd2rrdr_internal(st, points_requested, after_requested, before_requested, group_method,
+                             resampling_time_requested, options, dimensions, NULL, window);
 }
\ No newline at end of file
@@ -21,4 +21,7 @@ extern const char *group_method2string(RRDR_GROUPING group);
 extern void web_client_api_v1_init_grouping(void);
 extern RRDR_GROUPING web_client_api_request_v1_data_group(const char *name, RRDR_GROUPING def);
 
+struct rrdr_window;
+extern void rrdr_window_free(struct rrdr_window *window);
+
 #endif //NETDATA_API_DATA_QUERY_H
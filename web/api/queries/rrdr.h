@@ -98,6 +98,9 @@ typedef struct rrdresult {
 
 #define rrdr_rows(r) ((r)->rows)
 
+// the points of a query, kept between calls to answer the next one incrementally
+struct rrdr_window;
+
 #include "../../../database/rrd.h"
 extern void rrdr_free(RRDR *r);
 extern RRDR *rrdr_create(struct rrdset *st, long n, struct context_param *context_param_list);
@@ -110,6 +113,13 @@ extern RRDR *rrd2rrdr(
     RRDR_GROUPING group_method, long resampling_time_requested, RRDR_OPTIONS options, const char *dimensions,
     struct context_param *context_param_list);
 
+extern LATENCY_HISTOGRAM rrd2rrdr_histogram;
+
+extern RRDR *rrd2rrdr_window(
+    struct rrdr_window **window, RRDSET *st, long points_requested, long long after_requested,
+    long long before_requested, RRDR_GROUPING group_method, long resampling_time_requested, RRDR_OPTIONS options,
+    const char *dimensions);
+
 #include "query.h"
 
 #endif //NETDATA_QUERIES_RRDR_H
@@ -64,13 +64,15 @@ RRDHOST *__wrap_rrdhost_find_by_hostname(const char *hostname, uint32_t hash)
 /* Note: we've got some intricate code inside the global statistics module, might be useful to pull it inside the
          test set instead of mocking it. */
 void __wrap_finished_web_request_statistics(
-    uint64_t dt, uint64_t bytes_received, uint64_t bytes_sent, uint64_t content_size, uint64_t compressed_content_size)
+    uint64_t dt, uint64_t bytes_received, uint64_t bytes_sent, uint64_t content_size, uint64_t compressed_content_size,
+    WEB_REQUEST_ENDPOINT endpoint)
 {
     (void)dt;
     (void)bytes_received;
     (void)bytes_sent;
     (void)content_size;
     (void)compressed_content_size;
+    (void)endpoint;
 }
 
 char *__wrap_config_get(struct config *root, const char *section, const char *name, const char *default_value)
@@ -500,7 +500,7 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
     struct context_param  *context_param_list = NULL;
     if (context && !chart) {
         RRDSET *st1;
-        uint32_t context_hash = simple_hash(context);
+        const char *context_string = string_strdupz(context);
         uint32_t key_hash;
 
         if (chart_label_key)
@@ -508,11 +508,12 @@ inline int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, c
 
         rrdhost_rdlock(host);
         rrdset_foreach_read(st1, host) {
-            if (st1->hash_context == context_hash && !strcmp(st1->context, context) &&
+            if (st1->context == context_string &&
                 (!chart_label_key || rrdset_contains_label_key(st1, chart_label_key, key_hash)))
                 build_context_param_list(&context_param_list, st1);
         }
         rrdhost_unlock(host);
+        string_freez(context_string);
         if (likely(context_param_list && context_param_list->rd))  // Just set the first one
             st = context_param_list->rd->rrdset;
     }
@@ -997,6 +998,42 @@ inline int web_client_api_request_v1_info(RRDHOST *host, struct web_client *w, c
     return HTTP_RESP_OK;
 }
 
+// the stacks sampled by the profiler, in the folded format of flame graphs
+int web_client_api_request_v1_mgmt_profile(RRDHOST *host, struct web_client *w, char *url) {
+    (void)host;
+
+    BUFFER *wb = w->response.data;
+    buffer_flush(wb);
+    wb->contenttype = CT_TEXT_PLAIN;
+    buffer_no_cacheable(wb);
+
+    if (!w->auth_bearer_token || strcmp(w->auth_bearer_token, api_secret)) {
+        buffer_strcat(wb, "Auth Error\n");
+        return HTTP_RESP_FORBIDDEN;
+    }
+
+    if (!profiler_enabled()) {
+        buffer_strcat(wb, "The sampling profiler is not running. Enable it with 'sampling profiler = yes' in the [global] section of netdata.conf.\n");
+        return HTTP_RESP_BAD_REQUEST;
+    }
+
+    int reset = 0;
+    while (url) {
+        char *value = mystrsep(&url, "&");
+        if (!value || !*value) continue;
+
+        char *name = mystrsep(&value, "=");
+        if (!name || !*name) continue;
+        if (!value || !*value) continue;
+
+        if (!strcmp(name, "reset"))
+            reset = (!strcmp(value, "yes") || !strcmp(value, "true") || !strcmp(value, "1"));
+    }
+
+    profiler_folded_stacks(wb, reset);
+    return HTTP_RESP_OK;
+}
+
 static struct api_command {
     const char *command;
     uint32_t hash;
@@ -1022,6 +1059,7 @@ static struct api_command {
         { "alarm_count",     0, WEB_CLIENT_ACL_DASHBOARD, web_client_api_request_v1_alarm_count     },
         { "allmetrics",      0, WEB_CLIENT_ACL_DASHBOARD, web_client_api_request_v1_allmetrics      },
         { "manage/health",   0, WEB_CLIENT_ACL_MGMT,      web_client_api_request_v1_mgmt_health     },
+        { "manage/profile",  0, WEB_CLIENT_ACL_MGMT,      web_client_api_request_v1_mgmt_profile    },
         // terminator
         { NULL,              0, WEB_CLIENT_ACL_NONE,      NULL                                      },
 };
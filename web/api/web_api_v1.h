@@ -23,6 +23,7 @@ extern int web_client_api_request_v1_archivedcharts(RRDHOST *host, struct web_cl
 extern int web_client_api_request_v1_chart(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1_data(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1_registry(RRDHOST *host, struct web_client *w, char *url);
+extern int web_client_api_request_v1_mgmt_profile(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1_info(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1(RRDHOST *host, struct web_client *w, char *url);
 extern int web_client_api_request_v1_info_fill_buffer(RRDHOST *host, BUFFER *wb);
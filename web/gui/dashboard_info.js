@@ -3348,6 +3348,18 @@ netdataDashboard.context = {
         info: 'Measures latency between MQTT publish of the message and it\'s PUB_ACK being received'
     },
 
+    'netdata.aclk_query_queue': {
+        info: 'The number of queries waiting in the ACLK query queue at the end of the sample, the maximum during the sample, and how many queued queries were replaced by a duplicate.'
+    },
+
+    'netdata.aclk_response_bytes': {
+        info: 'The size of the responses to cloud queries as produced by the API, and the size of the messages sent to the cloud for them, after encoding and compression.'
+    },
+
+    'netdata.aclk_query_wait': {
+        info: 'Queries processed by the ACLK query threads, by the time they waited in the queue after they were due to run. Each dimension counts the queries that waited up to its time.'
+    },
+
     // ------------------------------------------------------------------------
     // VerneMQ
 
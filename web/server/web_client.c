@@ -67,6 +67,35 @@ static inline char *strip_control_characters(char *url) {
     return url;
 }
 
+static inline WEB_REQUEST_ENDPOINT web_client_request_endpoint(struct web_client *w) {
+    if(w->mode == WEB_CLIENT_MODE_FILECOPY)
+        return WEB_REQUEST_ENDPOINT_FILES;
+
+    const char *api = (w->mode == WEB_CLIENT_MODE_NORMAL) ? strstr(w->last_url, "/api/v1/") : NULL;
+    if(!api)
+        return WEB_REQUEST_ENDPOINT_OTHER;
+
+    api += sizeof("/api/v1/") - 1;
+    size_t len = strcspn(api, "/?");
+
+    if(len == 4 && !strncmp(api, "data", len))
+        return WEB_REQUEST_ENDPOINT_DATA;
+
+    if(len == 9 && !strncmp(api, "badge.svg", len))
+        return WEB_REQUEST_ENDPOINT_BADGE;
+
+    if(len == 10 && !strncmp(api, "allmetrics", len))
+        return WEB_REQUEST_ENDPOINT_ALLMETRICS;
+
+    if((len == 5 && !strncmp(api, "chart", len)) || (len == 6 && !strncmp(api, "charts", len)) || (len == 4 && !strncmp(api, "info", len)))
+        return WEB_REQUEST_ENDPOINT_CHARTS;
+
+    if(len >= 5 && !strncmp(api, "alarm", 5))
+        return WEB_REQUEST_ENDPOINT_ALARMS;
+
+    return WEB_REQUEST_ENDPOINT_API;
+}
+
 void web_client_request_done(struct web_client *w) {
     web_client_uncrock_socket(w);
 
@@ -89,7 +118,8 @@ void web_client_request_done(struct web_client *w) {
                                         w->stats_received_bytes,
                                         w->stats_sent_bytes,
                                         size,
-                                        sent);
+                                        sent,
+                                        web_client_request_endpoint(w));
 
         w->stats_received_bytes = 0;
         w->stats_sent_bytes = 0;
@@ -190,8 +220,8 @@ void web_client_request_done(struct web_client *w) {
     // if we had enabled compression, release it
 #ifdef NETDATA_WITH_ZLIB
     if(w->response.zinitialized) {
-        debug(D_DEFLATE, "%llu: Freeing compression resources.", w->id);
-        deflateEnd(&w->response.zstream);
+        // the zlib state is reset when the next response is compressed, and freed with the client
+        debug(D_DEFLATE, "%llu: Releasing compression resources.", w->id);
         w->response.zsent = 0;
         w->response.zhave = 0;
         w->response.zstream.avail_in = 0;
@@ -472,10 +502,6 @@ void web_client_enable_deflate(struct web_client *w, int gzip) {
         return;
     }
 
-    w->response.zstream.zalloc = Z_NULL;
-    w->response.zstream.zfree = Z_NULL;
-    w->response.zstream.opaque = Z_NULL;
-
     w->response.zstream.next_in = (Bytef *)w->response.data->buffer;
     w->response.zstream.avail_in = 0;
     w->response.zstream.total_in = 0;
@@ -484,19 +510,29 @@ void web_client_enable_deflate(struct web_client *w, int gzip) {
     w->response.zstream.avail_out = 0;
     w->response.zstream.total_out = 0;
 
-    w->response.zstream.zalloc = Z_NULL;
-    w->response.zstream.zfree = Z_NULL;
-    w->response.zstream.opaque = Z_NULL;
-
 //  if(deflateInit(&w->response.zstream, Z_DEFAULT_COMPRESSION) != Z_OK) {
 //      error("%llu: Failed to initialize zlib. Proceeding without compression.", w->id);
 //      return;
 //  }
 
-    // Select GZIP compression: windowbits = 15 + 16 = 31
-    if(deflateInit2(&w->response.zstream, web_gzip_level, Z_DEFLATED, 15 + ((gzip)?16:0), 8, web_gzip_strategy) != Z_OK) {
-        error("%llu: Failed to initialize zlib. Proceeding without compression.", w->id);
-        return;
+    if(w->response.zallocated) {
+        // reuse the zlib state of the previous response, instead of allocating it again
+        if(deflateReset(&w->response.zstream) != Z_OK) {
+            error("%llu: Failed to reset zlib. Proceeding without compression.", w->id);
+            return;
+        }
+    }
+    else {
+        w->response.zstream.zalloc = Z_NULL;
+        w->response.zstream.zfree = Z_NULL;
+        w->response.zstream.opaque = Z_NULL;
+
+        // Select GZIP compression: windowbits = 15 + 16 = 31
+        if(deflateInit2(&w->response.zstream, web_gzip_level, Z_DEFLATED, 15 + ((gzip)?16:0), 8, web_gzip_strategy) != Z_OK) {
+            error("%llu: Failed to initialize zlib. Proceeding without compression.", w->id);
+            return;
+        }
+        w->response.zallocated = 1;
     }
 
     w->response.zsent = 0;
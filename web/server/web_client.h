@@ -134,6 +134,7 @@ struct response {
     size_t zsent;                                        // the compressed bytes we have sent to the client
     size_t zhave;                                        // the compressed bytes that we have received from zlib
     unsigned int zinitialized : 1;
+    unsigned int zallocated : 1;                         // the zlib state is kept between the requests of the client
 #endif /* NETDATA_WITH_ZLIB */
 };
 
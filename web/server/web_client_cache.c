@@ -26,6 +26,12 @@ static void web_client_zero(struct web_client *w) {
     BUFFER *b2 = w->response.header;
     BUFFER *b3 = w->response.header_output;
 
+#ifdef NETDATA_WITH_ZLIB
+    // remember the zlib state, to reuse it for the next client
+    z_stream zstream = w->response.zstream;
+    unsigned int zallocated = w->response.zallocated;
+#endif
+
     // empty the buffers
     buffer_flush(b1);
     buffer_flush(b2);
@@ -40,9 +46,19 @@ static void web_client_zero(struct web_client *w) {
     w->response.data = b1;
     w->response.header = b2;
     w->response.header_output = b3;
+
+#ifdef NETDATA_WITH_ZLIB
+    // restore the zlib state
+    w->response.zstream = zstream;
+    w->response.zallocated = zallocated;
+#endif
 }
 
 static void web_client_free(struct web_client *w) {
+#ifdef NETDATA_WITH_ZLIB
+    if(w->response.zallocated)
+        deflateEnd(&w->response.zstream);
+#endif
     buffer_free(w->response.header_output);
     buffer_free(w->response.header);
     buffer_free(w->response.data);